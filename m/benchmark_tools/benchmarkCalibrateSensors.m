@@ -0,0 +1,219 @@
+function [results, selected] = benchmarkCalibrateSensors(varargin)
+%BENCHMARKCALIBRATESENSORS  Time the calibration kernels for each available instruction set.
+%
+%  Syntax:
+%    [RESULTS, SELECTED] = BENCHMARKCALIBRATESENSORS()
+%    [RESULTS, SELECTED] = BENCHMARKCALIBRATESENSORS(OPTIONS)
+%    [RESULTS, SELECTED] = BENCHMARKCALIBRATESENSORS(OPT1, VAL1, ...)
+%
+%  Description:
+%    [RESULTS, SELECTED] = BENCHMARKCALIBRATESENSORS() times the kernels of
+%    CALIBRATESENSORS ('sbect' and 'affine') on synthetic raw measurements of
+%    several sizes, with the version of the kernels for each instruction set
+%    available on this processor, and compares the results of all versions.
+%    SELECTED is the name of the instruction set selected by default
+%    when the mex file is loaded. RESULTS is a struct array with an element for
+%    each instruction set, kernel and size with fields:
+%      ISA: instruction set name.
+%      KERNEL: kernel name.
+%      SAMPLES: number of records.
+%      SECONDS: minimum elapsed time of the repetitions.
+%      SPEEDUP: ratio of the time of the 'default' version to this one.
+%      DIFFERENCE: maximum relative difference of the results to the ones of
+%        the 'default' version (zero if they are identical).
+%
+%    [RESULTS, SELECTED] = BENCHMARKCALIBRATESENSORS(OPTIONS) and
+%    [RESULTS, SELECTED] = BENCHMARKCALIBRATESENSORS(OPT1, VAL1, ...)
+%    accept the following options given in key-value pairs OPT1, VAL1...
+%    or in a struct OPTIONS with field names as option keys and field values
+%    as option values:
+%      SIZES: number of records.
+%        Numeric array with the number of records of each test.
+%        Default value: [1e4 1e6]
+%      SIGNALS: number of signals of the 'affine' kernel.
+%        Default value: 3
+%      REPEAT: number of repetitions of each test.
+%        The minimum time is reported, to reduce the noise of the measure.
+%        Default value: 20
+%      CSV: CSV output file.
+%        String with the name of the file to write the results to in comma
+%        separated values, with a header line and a line for each element of
+%        RESULTS. If empty, it is not written.
+%        Default value: ''
+%
+%  Notes:
+%    The kernels run in a single thread during the benchmark (the environment
+%    variable GLIDER_TOOLBOX_THREADS is set to 1 and restored when finished),
+%    so that only the effect of the instruction set is measured.
+%    The version of the kernels selected at load time is restored too.
+%
+%    The small sizes fit in the processor cache and show the effect of the
+%    vector instructions on the computations, while the large ones are usually
+%    limited by the memory bandwidth.
+%
+%    When the mex file uses the vector logarithms of the GNU C library (see
+%    SETUPMEXCALIBRATESENSORS), the 'sbect' temperatures of each version differ
+%    in the last bits, by about 1e-13 degrees Celsius. The relative difference
+%    is larger (about 1e-12) for temperatures close to zero.
+%
+%  Examples:
+%    [results, selected] = benchmarkCalibrateSensors()
+%    results = benchmarkCalibrateSensors('sizes', 1e5, 'repeat', 50, ...
+%                                        'csv', 'calibratesensors.csv')
+%
+%  See also:
+%    CALIBRATESENSORS
+%    SETUPMEXCALIBRATESENSORS
+%    RUNBENCHMARK
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(0, 8);
+
+
+  %% Set options and default values.
+  options.sizes = [1e4 1e6];
+  options.signals = 3;
+  options.repeat = 20;
+  options.csv = '';
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:benchmarkCalibrateSensors:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:benchmarkCalibrateSensors:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+
+
+  %% Get the available instruction sets and run single threaded.
+  [selected, isa_list] = calibratesensors('isa');
+  fprintf('Instruction set selected at load time: %s.\n', selected);
+  fprintf('Instruction sets available: %s.\n', sprintf(' %s', isa_list{:}));
+  if ~strcmp(selected, 'none')
+    isa_list = [{'default'} setdiff(isa_list, {'default'}, 'stable')];
+  end
+  threads = getenv('GLIDER_TOOLBOX_THREADS');
+  setenv('GLIDER_TOOLBOX_THREADS', '1');
+
+
+  %% Time each kernel for each size and instruction set.
+  temp_coefs = [4.38052489e-3 6.25478746e-4 2.34258763e-5 2.50671271e-6];
+  cond_coefs = [-9.92304872 1.11163373 -2.02979731e-3 2.29265437e-4 -9.57e-8 3.25e-6];
+  affine_coefs = [0.0118 * (1:options.signals)' 38 + (1:options.signals)'];
+  results = struct('isa', {}, 'kernel', {}, 'samples', {}, ...
+                   'seconds', {}, 'speedup', {}, 'difference', {});
+  try
+    for size_idx = 1:numel(options.sizes)
+      num_samples = options.sizes(size_idx);
+      temp_freq = 3000 + 4000 * rand(num_samples, 1);
+      cond_freq = 5000 + 3000 * rand(num_samples, 1);
+      pres = 1000 * rand(num_samples, 1);
+      counts = num2cell(round(4096 * rand(num_samples, options.signals)), 1);
+      kernel_list = {'sbect' 'affine'};
+      for kernel_idx = 1:numel(kernel_list)
+        kernel = kernel_list{kernel_idx};
+        switch kernel
+          case 'sbect'
+            args = {temp_freq, cond_freq, pres, temp_coefs, cond_coefs};
+            num_outputs = 2;
+          case 'affine'
+            args = [counts {affine_coefs}];
+            num_outputs = options.signals;
+        end
+        reference = [];
+        reference_seconds = nan;
+        for isa_idx = 1:numel(isa_list)
+          isa_name = isa_list{isa_idx};
+          calibratesensors('isa', isa_name);
+          outputs = cell(1, num_outputs);
+          seconds = inf;
+          for repeat_idx = 1:options.repeat
+            kernel_start = tic();
+            [outputs{:}] = calibratesensors(kernel, args{:});
+            seconds = min(seconds, toc(kernel_start));
+          end
+          if isempty(reference)
+            reference = outputs;
+            reference_seconds = seconds;
+          end
+          difference = max(cellfun( ...
+            @(r, o)(max([0; abs(o(:) - r(:)) ./ max(abs(r(:)), realmin())])), ...
+            reference, outputs));
+          result = struct('isa', isa_name, 'kernel', kernel, ...
+                          'samples', num_samples, 'seconds', seconds, ...
+                          'speedup', reference_seconds / seconds, ...
+                          'difference', difference);
+          fprintf('  %-8s %-8s %10d %12.6f s %6.2fx %9.2e\n', ...
+                  isa_name, kernel, num_samples, seconds, result.speedup, ...
+                  result.difference);
+          results(end+1) = result; %#ok<AGROW>
+        end
+      end
+    end
+  catch exception
+    calibratesensors('isa', 'auto');
+    setenv('GLIDER_TOOLBOX_THREADS', threads);
+    rethrow(exception);
+  end
+  calibratesensors('isa', 'auto');
+  setenv('GLIDER_TOOLBOX_THREADS', threads);
+
+
+  %% Write the results.
+  if ~isempty(options.csv)
+    [fid, fid_msg] = fopen(options.csv, 'w');
+    if fid < 0
+      error('glider_toolbox:benchmarkCalibrateSensors:FileError', ...
+            'Could not open file %s: %s.', options.csv, fid_msg);
+    end
+    fprintf(fid, 'isa,kernel,samples,seconds,speedup,difference\n');
+    for result_idx = 1:numel(results)
+      result = results(result_idx);
+      fprintf(fid, '%s,%s,%d,%.6f,%.3f,%.3g\n', ...
+              result.isa, result.kernel, result.samples, ...
+              result.seconds, result.speedup, result.difference);
+    end
+    fclose(fid);
+  end
+
+end
@@ -0,0 +1,212 @@
+function [data, meta] = generateBenchmarkData(num_profiles, varargin)
+%GENERATEBENCHMARKDATA  Generate synthetic glider data of given size from CTD test data.
+%
+%  Syntax:
+%    [DATA, META] = GENERATEBENCHMARKDATA(NUM_PROFILES)
+%    [DATA, META] = GENERATEBENCHMARKDATA(NUM_PROFILES, OPTIONS)
+%    [DATA, META] = GENERATEBENCHMARKDATA(NUM_PROFILES, OPT1, VAL1, ...)
+%
+%  Description:
+%    [DATA, META] = GENERATEBENCHMARKDATA(NUM_PROFILES) generates a synthetic
+%    glider trajectory with NUM_PROFILES profiles repeating the profiles of
+%    the CTD test data in the private test directory of the toolbox, and returns
+%    it in struct DATA, in the format returned by PROCESSGLIDERDATA, with the
+%    metadata of each sequence in struct META. Each repetition of the test
+%    profiles is shifted in time after the end of the previous one, and in
+%    space by a small horizontal drift, so that the resulting trajectory is
+%    a realistic mission of the desired size. DATA has the following fields:
+%      TIME: time (seconds since 1970-01-01 00:00:00 UTC).
+%      LATITUDE: latitude (degrees).
+%      LONGITUDE: longitude (degrees).
+%      DEPTH: depth (m, approximated by pressure).
+%      PRESSURE: pressure (dbar).
+%      CONDUCTIVITY: conductivity (S m-1).
+%      TEMPERATURE: temperature (Celsius).
+%      PITCH: pitch (rad).
+%      ROLL: roll (rad).
+%      HEADING: heading (rad).
+%      PROFILE_INDEX: profile index of the test data, renumbered.
+%
+%    [DATA, META] = GENERATEBENCHMARKDATA(NUM_PROFILES, OPTIONS) and
+%    [DATA, META] = GENERATEBENCHMARKDATA(NUM_PROFILES, OPT1, VAL1, ...)
+%    accept the following options given in key-value pairs OPT1, VAL1...
+%    or in a struct OPTIONS with field names as option keys and field values
+%    as option values:
+%      GLIDER: glider data shape.
+%        String setting the sampling pattern of the output data:
+%          'slocum': navigation and science records interleaved as in the
+%            test data, with CTD readings invalid in navigation records.
+%          'seaglider': merged records with valid CTD readings only,
+%            as in Seaglider engineering data.
+%          'seaexplorer': payload records with valid CTD readings, and
+%            attitude readings only in one of every four records, as in
+%            merged SeaExplorer navigation and payload data.
+%        Default value: 'slocum'
+%      FIXTURE: test data to repeat.
+%        String with the name of a CTD test data file in the private test
+%        directory of the toolbox, or the path to any other file in the
+%        same format.
+%        Default value: 'ctd_pumped.dat'
+%      DRIFT: horizontal drift between repetitions.
+%        Number with the latitude and longitude increment (degrees) of each
+%        repetition of the test data with respect to the previous one.
+%        Default value: 0.01
+%      FILENAME: output text file.
+%        String with the name of a file to write the data to in the format of
+%        the CTD test data (readable by LOAD). If empty, no file is written.
+%        Default value: '' (do not write the data)
+%
+%  Notes:
+%    The test data files have a two line header and a record per line with
+%    the columns time, conductivity, temperature, pressure, pitch, roll,
+%    heading, latitude, longitude and profile number.
+%
+%    The data is built repeating the whole test data with a single array
+%    expansion, and then trimmed to the requested number of profiles.
+%
+%  Examples:
+%    [data, meta] = generateBenchmarkData(1000)
+%    [data, meta] = generateBenchmarkData(1e5, 'glider', 'seaglider', ...
+%                                         'filename', 'benchmark.dat')
+%
+%  See also:
+%    RUNBENCHMARK
+%    PROCESSGLIDERDATA
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 9);
+
+
+  %% Set options and default values.
+  options.glider = 'slocum';
+  options.fixture = 'ctd_pumped.dat';
+  options.drift = 0.01;
+  options.filename = '';
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:generateBenchmarkData:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:generateBenchmarkData:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+
+
+  %% Load the test data.
+  fixture_file = options.fixture;
+  if ~exist(fixture_file, 'file')
+    fixture_file = fullfile(fileparts(mfilename('fullpath')), ...
+                            '..', 'private', 'test', options.fixture);
+  end
+  fixture = load(fixture_file);
+  column_names = {'time' 'conductivity' 'temperature' 'pressure' ...
+                  'pitch' 'roll' 'heading' 'latitude' 'longitude' ...
+                  'profile_index'};
+  column_units = {'s' 'S/m' 'C' 'dbar' 'rad' 'rad' 'rad' 'deg' 'deg' '-'};
+
+
+  %% Apply the sampling pattern of the glider.
+  ctd_valid = all(~isnan(fixture(:, 2:4)), 2) & all(fixture(:, 2:4) > 0, 2);
+  switch lower(options.glider)
+    case 'slocum'
+    case 'seaglider'
+      fixture = fixture(ctd_valid, :);
+    case 'seaexplorer'
+      fixture = fixture(ctd_valid, :);
+      fixture(mod(1:size(fixture, 1), 4) ~= 1, 5:7) = nan;
+    otherwise
+      error('glider_toolbox:generateBenchmarkData:InvalidGlider', ...
+            'Invalid glider: %s.', options.glider);
+  end
+
+
+  %% Repeat the test data up to the requested number of profiles.
+  % Each repetition starts one median sampling period after the end of the
+  % previous one, and its profiles are numbered after the previous ones.
+  fixture_profiles = fix(max(fixture(:, 10)));
+  if fixture_profiles < 1
+    error('glider_toolbox:generateBenchmarkData:InvalidFixture', ...
+          'No profiles in test data: %s.', fixture_file);
+  end
+  num_repeats = ceil(num_profiles / fixture_profiles);
+  fixture_period = fixture(end, 1) - fixture(1, 1) ...
+                 + median(diff(fixture(:, 1)));
+  num_records = size(fixture, 1);
+  repeat_index = reshape(repmat(0:num_repeats-1, num_records, 1), [], 1);
+  values = repmat(fixture, num_repeats, 1);
+  values(:, 1) = values(:, 1) + fixture_period * repeat_index;
+  values(:, 8:9) = values(:, 8:9) + options.drift * repeat_index(:, [1 1]);
+  values(:, 10) = values(:, 10) + fixture_profiles * repeat_index;
+  last_record = find(values(:, 10) <= num_profiles + 0.5, 1, 'last');
+  values = values(1:last_record, :);
+
+
+  %% Build the output structs.
+  data = cell2struct(num2cell(values, 1), column_names, 2);
+  data.depth = data.pressure;
+  meta = struct();
+  for column_idx = 1:numel(column_names)
+    meta.(column_names{column_idx}).sources = {options.fixture};
+    meta.(column_names{column_idx}).units = column_units{column_idx};
+  end
+  meta.depth.sources = {'pressure'};
+  meta.depth.units = 'm';
+
+
+  %% Write the data in the test data format, if needed.
+  if ~isempty(options.filename)
+    [fid, fid_msg] = fopen(options.filename, 'w');
+    if fid < 0
+      error('glider_toolbox:generateBenchmarkData:FileError', ...
+            'Could not open file %s: %s.', options.filename, fid_msg);
+    end
+    fprintf(fid, ['%%' repmat(' %14s', 1, numel(column_names)) '\n'], ...
+            column_names{:});
+    fprintf(fid, ['%%' repmat(' %14s', 1, numel(column_units)) '\n'], ...
+            column_units{:});
+    fprintf(fid, ['%.8f' repmat(' %14.8f', 1, numel(column_names) - 2) ...
+                  ' %14.1f\n'], values');
+    fclose(fid);
+  end
+
+end
@@ -0,0 +1,348 @@
+function results = runBenchmark(varargin)
+%RUNBENCHMARK  Time the processing stages over synthetic missions of several sizes.
+%
+%  Syntax:
+%    RESULTS = RUNBENCHMARK()
+%    RESULTS = RUNBENCHMARK(OPTIONS)
+%    RESULTS = RUNBENCHMARK(OPT1, VAL1, ...)
+%
+%  Description:
+%    RESULTS = RUNBENCHMARK() generates synthetic missions with GENERATEBENCHMARKDATA
+%    for each glider shape and number of profiles given in options (see below),
+%    and times each of the following stages of the processing chain on them:
+%      'load': load the mission from a text file in the CTD test data format.
+%      'find_profiles': identify profiles with FINDPROFILES.
+%      'lag_correction': correct thermal lag profile by profile
+%        with CORRECTTHERMALLAG (with constant parameters).
+%      'salinity': derive salinity with SW_SALT.
+%      'gridding': grid conductivity, temperature and salinity with
+%        GRIDGLIDERDATA.
+%      'netcdf': write the gridded data with SAVENC.
+%      'figures': generate the gridded data figures with GENERATEGLIDERFIGURES
+%        (with the default figure configuration in CONFIGFIGURES).
+%    Each stage uses the output of the previous ones, so a stage is skipped if
+%    a stage it depends on fails or is not selected. RESULTS is a struct array
+%    with an element for each glider shape, mission size and stage with fields:
+%      GLIDER: glider shape.
+%      PROFILES: number of profiles.
+%      SAMPLES: number of records.
+%      STAGE: stage name.
+%      SECONDS: minimum elapsed time of the repetitions of the stage
+%        (NaN if failed or skipped).
+%      STATUS: 'ok', 'failed' or 'skipped'.
+%      MESSAGE: error message when failed, empty otherwise.
+%
+%    RESULTS = RUNBENCHMARK(OPTIONS) and RESULTS = RUNBENCHMARK(OPT1, VAL1, ...)
+%    accept the following options given in key-value pairs OPT1, VAL1...
+%    or in a struct OPTIONS with field names as option keys and field values
+%    as option values:
+%      SIZES: number of profiles of the missions.
+%        Numeric array with the number of profiles of each mission.
+%        Default value: [1e3 1e4 1e5]
+%      GLIDERS: glider shapes of the missions.
+%        String cell array with the glider shapes (see GENERATEBENCHMARKDATA).
+%        Default value: {'slocum' 'seaglider' 'seaexplorer'}
+%      STAGES: stages to time.
+%        String cell array with the names of the stages to time.
+%        Default value: all stages listed above.
+%      REPEAT: number of repetitions of each stage.
+%        Positive integer with the number of times each stage is timed.
+%        The minimum time is reported, to reduce the noise of the measure.
+%        Default value: 1
+%      FIXTURE: test data to repeat (see GENERATEBENCHMARKDATA).
+%        Default value: 'ctd_pumped.dat'
+%      DIRNAME: work directory.
+%        String with the path to the directory where the mission text files,
+%        NetCDF files and figures are written.
+%        Default value: a new temporary directory (removed when finished)
+%      JSON: JSON output file.
+%        String with the name of the file to write the results to in JSON,
+%        with the fields VERSION (toolbox version), DATE (UTC date of the run),
+%        PLATFORM (output of COMPUTER), ENGINE (MATLAB or Octave version) and
+%        RESULTS (the struct array described above). If empty, it is not
+%        written.
+%        Default value: ''
+%      CSV: CSV output file.
+%        String with the name of the file to write the results to in comma
+%        separated values, with a header line and a line for each element of
+%        RESULTS. If empty, it is not written.
+%        Default value: ''
+%
+%  Notes:
+%    The stages are timed individually with TIC and TOC, without the
+%    generation of the data and the writing of the mission text files.
+%    The results of several runs may be compared by the fields GLIDER,
+%    PROFILES and STAGE to track performance regressions.
+%
+%    The largest default size produces missions of several million records.
+%    Use smaller sizes for quick checks.
+%
+%  Examples:
+%    results = runBenchmark('sizes', 1000, 'gliders', {'slocum'})
+%    results = runBenchmark('sizes', [1e3 1e4], ...
+%                           'stages', {'load' 'find_profiles' 'gridding'}, ...
+%                           'repeat', 3, ...
+%                           'json', 'benchmark.json', 'csv', 'benchmark.csv')
+%
+%  See also:
+%    GENERATEBENCHMARKDATA
+%    FINDPROFILES
+%    CORRECTTHERMALLAG
+%    GRIDGLIDERDATA
+%    SAVENC
+%    GENERATEGLIDERFIGURES
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(0, 16);
+
+
+  %% Set options and default values.
+  stage_list = {'load' 'find_profiles' 'lag_correction' 'salinity' ...
+                'gridding' 'netcdf' 'figures'};
+  options.sizes = [1e3 1e4 1e5];
+  options.gliders = {'slocum' 'seaglider' 'seaexplorer'};
+  options.stages = stage_list;
+  options.repeat = 1;
+  options.fixture = 'ctd_pumped.dat';
+  options.dirname = '';
+  options.json = '';
+  options.csv = '';
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:runBenchmark:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:runBenchmark:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+  selected_stages = cellstr(options.stages);
+  invalid_stages = setdiff(selected_stages, stage_list);
+  if ~isempty(invalid_stages)
+    error('glider_toolbox:runBenchmark:InvalidStage', ...
+          'Invalid stage: %s.', invalid_stages{1});
+  end
+
+
+  %% Set the work directory.
+  work_dir = options.dirname;
+  remove_work_dir = isempty(work_dir);
+  if remove_work_dir
+    work_dir = tempname();
+  end
+  if ~exist(work_dir, 'dir')
+    [success, message] = mkdir(work_dir);
+    if ~success
+      error('glider_toolbox:runBenchmark:DirError', ...
+            'Could not create directory %s: %s.', work_dir, message);
+    end
+  end
+
+
+  %% Run the stages for each glider shape and mission size.
+  glider_list = cellstr(options.gliders);
+  size_list = options.sizes(:)';
+  results = struct('glider', {}, 'profiles', {}, 'samples', {}, ...
+                   'stage', {}, 'seconds', {}, 'status', {}, 'message', {});
+  for glider_idx = 1:numel(glider_list)
+    glider = glider_list{glider_idx};
+    for size_idx = 1:numel(size_list)
+      num_profiles = size_list(size_idx);
+      mission_name = sprintf('%s_%d', glider, num_profiles);
+      mission_file = fullfile(work_dir, [mission_name '.dat']);
+      fprintf('Generating benchmark mission %s...\n', mission_name);
+      [data, meta] = generateBenchmarkData(num_profiles, ...
+                                           'glider', glider, ...
+                                           'fixture', options.fixture, ...
+                                           'filename', mission_file);
+      num_samples = numel(data.time);
+      state = struct('data', data, 'meta', meta, ...
+                     'file', mission_file, 'dirname', work_dir, ...
+                     'name', mission_name);
+      done = struct();
+      for stage_idx = 1:numel(stage_list)
+        stage = stage_list{stage_idx};
+        if ~ismember(stage, selected_stages)
+          done.(stage) = false;
+          continue
+        end
+        result = struct('glider', glider, 'profiles', num_profiles, ...
+                        'samples', num_samples, 'stage', stage, ...
+                        'seconds', nan, 'status', 'skipped', 'message', '');
+        if all(cellfun(@(s)(isfield(done, s) && done.(s)), ...
+                       stageDependencies(stage)))
+          try
+            for repeat_idx = 1:options.repeat
+              stage_start = tic();
+              new_state = runStage(stage, state);
+              result.seconds = min(result.seconds, toc(stage_start));
+            end
+            state = new_state;
+            result.status = 'ok';
+          catch exception
+            result.seconds = nan;
+            result.status = 'failed';
+            result.message = exception.message;
+          end
+        end
+        done.(stage) = strcmp(result.status, 'ok');
+        fprintf('  %-16s %-8s %12.6f s\n', stage, result.status, result.seconds);
+        results(end+1) = result; %#ok<AGROW>
+      end
+    end
+  end
+
+
+  %% Write the results.
+  if ~isempty(options.json)
+    [~, ~, endian] = computer();
+    report = struct();
+    report.version = configGliderToolboxVersion();
+    report.date = datestr(posixtime2utc(posixtime()), 'yyyy-mm-ddTHH:MM:SSZ');
+    report.platform = [computer() ' ' endian];
+    report.engine = version();
+    report.results = results;
+    savejson(report, options.json);
+  end
+  if ~isempty(options.csv)
+    [fid, fid_msg] = fopen(options.csv, 'w');
+    if fid < 0
+      error('glider_toolbox:runBenchmark:FileError', ...
+            'Could not open file %s: %s.', options.csv, fid_msg);
+    end
+    fprintf(fid, 'glider,profiles,samples,stage,seconds,status,message\n');
+    for result_idx = 1:numel(results)
+      result = results(result_idx);
+      fprintf(fid, '%s,%d,%d,%s,%.6f,%s,"%s"\n', ...
+              result.glider, result.profiles, result.samples, ...
+              result.stage, result.seconds, result.status, ...
+              strrep(result.message, '"', '""'));
+    end
+    fclose(fid);
+  end
+
+
+  %% Remove the temporary work directory.
+  if remove_work_dir
+    rmdir(work_dir, 's');
+  end
+
+end
+
+
+function dependencies = stageDependencies(stage)
+%STAGEDEPENDENCIES  Stages whose output is needed by the given stage.
+  switch stage
+    case {'load' 'find_profiles' 'salinity'}
+      dependencies = {};
+    case 'lag_correction'
+      dependencies = {'find_profiles'};
+    case 'gridding'
+      dependencies = {'find_profiles' 'salinity'};
+    case {'netcdf' 'figures'}
+      dependencies = {'find_profiles' 'salinity' 'gridding'};
+  end
+end
+
+
+function state = runStage(stage, state)
+%RUNSTAGE  Run a benchmark stage updating the state of the mission.
+  switch stage
+    case 'load'
+      values = load(state.file);
+      state.data.time = values(:, 1);
+    case 'find_profiles'
+      [state.data.profile_index, state.data.profile_direction] = ...
+        findProfiles(state.data.time, state.data.depth, ...
+                     'stall', 3, 'inversion', 3, 'interrupt', 180, ...
+                     'length', 10);
+      state.meta.profile_index.sources = {'time' 'depth'};
+    case 'lag_correction'
+      segments = summarizeSegments(state.data.profile_index);
+      temp_cor = nan(size(state.data.time));
+      cond_cor = nan(size(state.data.time));
+      for profile_idx = 1:numel(segments.index)
+        prof_select = segments.first(profile_idx):segments.last(profile_idx);
+        [temp_cor(prof_select), cond_cor(prof_select)] = ...
+          correctThermalLag(state.data.time(prof_select), ...
+                            state.data.conductivity(prof_select), ...
+                            state.data.temperature(prof_select), ...
+                            [0.0135 7.1499]);
+      end
+      state.data.temperature_corrected_thermal = temp_cor;
+      state.data.conductivity_corrected_thermal = cond_cor;
+    case 'salinity'
+      state.data.salinity = ...
+        sw_salt(state.data.conductivity * (10 / sw_c3515()), ...
+                state.data.temperature, state.data.pressure);
+      state.meta.salinity.sources = {'conductivity' 'temperature' 'pressure'};
+    case 'gridding'
+      [state.data_grid, state.meta_grid] = ...
+        gridGliderData(state.data, state.meta, 'variable_list', ...
+                       {'conductivity' 'temperature' 'salinity'});
+    case 'netcdf'
+      var_names = fieldnames(state.data_grid);
+      var_meta = struct();
+      for var_idx = 1:numel(var_names)
+        var_name = var_names{var_idx};
+        if strcmp(var_name, 'depth')
+          var_meta.(var_name).dimensions = {'depth'};
+        elseif isvector(state.data_grid.(var_name))
+          var_meta.(var_name).dimensions = {'time'};
+        else
+          var_meta.(var_name).dimensions = {'time' 'depth'};
+        end
+      end
+      global_meta = struct();
+      global_meta.dimensions = ...
+        struct('name', {'time' 'depth'}, ...
+               'length', {0 numel(state.data_grid.depth)});
+      global_meta.attributes = struct('name', {}, 'value', {});
+      global_meta.name = fullfile(state.dirname, [state.name '.nc']);
+      savenc(state.data_grid, var_meta, global_meta);
+    case 'figures'
+      [~, figures_grid] = configFigures();
+      generateGliderFigures(state.data_grid, figures_grid, ...
+                            'dirname', state.dirname);
+      close('all');
+  end
+end
@@ -1,9 +1,10 @@
-function list = mget(h, path, target)
+function list = mget(h, path, target, codec)
 %MGET  Download file(s) from an SFTP server.
 %
 %  Syntax:
 %    MGET(H, PATH)
 %    MGET(H, PATH, TARGET)
+%    MGET(H, PATH, TARGET, CODEC)
 %    LIST = MGET(H, ...)
 %
 %  Description:
@@ -16,6 +17,13 @@ function list = mget(h, path, target)
 %    MGET(H, PATH, TARGET) downloads the file(s) to the given target directory
 %    instead of the current one.
 %
+%    MGET(H, PATH, TARGET, CODEC) decompresses the files while they are
+%    downloaded. CODEC is a string with the compression format of the files:
+%    'gzip', 'xz' or 'zstd', or 'auto' to detect it from the contents of each
+%    file (files not compressed are downloaded unchanged). The compression
+%    extension of the downloaded files ('.gz', '.xz' or '.zst') is removed
+%    from the local names. The target may be empty to use the current one.
+%
 %    LIST = MGET(H, ...) returns the list of downloaded files.
 %
 %  Examples:
@@ -28,6 +36,8 @@ function list = mget(h, path, target)
 %    % Download all hidden files and directories in remote working directory,
 %    % to a different directory:
 %    list = mget(h, '.*', stash)
+%    % Download and decompress all compressed archives in remote directory:
+%    list = mget(h, 'archive/*.xz', [], 'auto')
 %
 %  See also:
 %    SFTP
@@ -52,9 +62,12 @@ function list = mget(h, path, target)
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-  if (nargin < 3)
+  if (nargin < 3) || isempty(target)
     target = pwd();
   end
+  if (nargin < 4)
+    codec = 'none';
+  end
     
   try
     atts = mexsftp('lsfile', h.sftp_handle, path);
@@ -113,8 +126,11 @@ function list = mget(h, path, target)
         dflags(end + (1:numel(atts))) = [atts.isdir]';
         rpaths(end + (1:numel(atts))) = strcat(rpath, '/', {atts.name}');
       end
-    else
+    elseif strcmp(codec, 'none')
       mexsftp('getfile', h.sftp_handle, rpath, lpath);
+    else
+      lpath = regexprep(lpath, '\.(gz|xz|zst)$', '');
+      mexsftp('getfile', h.sftp_handle, rpath, lpath, codec);
     end
     list{end+1, 1} = lpath;
   end
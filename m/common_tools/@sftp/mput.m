@@ -1,9 +1,10 @@
-function list = mput(h, path)
+function list = mput(h, path, codec)
 %MPUT  Upload file(s) to an SFTP server.
 %
 %  Syntax:
 %    MPUT(H, PATH)
-%    LIST = MPUT(H, PATH)
+%    MPUT(H, PATH, CODEC)
+%    LIST = MPUT(H, ...)
 %
 %  Description:
 %    MPUT(H, PATH) uploads file(s) to the server.
@@ -12,6 +13,11 @@ function list = mput(h, path)
 %    Otherwise, the path is considered a glob which may contain wildcards 
 %    ('*'), and only files matching the glob are uploaded, if any.
 %
+%    MPUT(H, PATH, CODEC) compresses the files while they are uploaded.
+%    CODEC is a string with the compression format: 'gzip', 'xz' or 'zstd'.
+%    The respective extension ('.gz', '.xz' or '.zst') is appended to the 
+%    remote names.
+%
 %    LIST = MPUT(H, ...) returns the list of uploaded files.
 %
 %  Examples:
@@ -21,6 +27,8 @@ function list = mput(h, path)
 %    mput(h, '*')
 %    % Upoad all hidden files and directories to remote working directory.
 %    list = mput(h, '.*')
+%    % Upload and compress all NetCDF files in current directory:
+%    list = mput(h, '*.nc', 'xz')
 %
 %  See also:
 %    SFTP
@@ -64,6 +72,22 @@ function list = mput(h, path)
     atts = atts(~(strcmp({atts.name}, '.') | strcmp({atts.name}, '..')));
   end
     
+  if (nargin < 3)
+    codec = 'none';
+  end
+  switch codec
+    case 'none'
+      codec_ext = '';
+    case 'gzip'
+      codec_ext = '.gz';
+    case 'xz'
+      codec_ext = '.xz';
+    case 'zstd'
+      codec_ext = '.zst';
+    otherwise
+      error('sftp:mput:InvalidCodec', 'Invalid compression format: %s.', codec);
+  end
+  
   target = mexsftp('pwd', h.sftp_handle);
   if target(end) ~= '/'
     target = [target '/'];
@@ -87,7 +111,8 @@ function list = mput(h, path)
       end
     else
       mexsftp('putfile', h.sftp_handle, ...
-              fullfile(source, lpath), strcat(target, rpath));
+              fullfile(source, lpath), strcat(target, rpath, codec_ext), codec);
+      rpath = strcat(rpath, codec_ext);
     end
     list{end+1, 1} = strcat(target, rpath);
   end
@@ -0,0 +1,63 @@
+function data = mread(h, path, target)
+%MREAD  Download a file from an SFTP server to memory.
+%
+%  Syntax:
+%    DATA = MREAD(H, PATH)
+%    DATA = MREAD(H, PATH, TARGET)
+%
+%  Description:
+%    DATA = MREAD(H, PATH) downloads the file in the given path on the server
+%    and returns its contents in a column vector of class uint8, without 
+%    writing it to disk. The path must be a file, not a directory or a glob.
+%
+%    DATA = MREAD(H, PATH, TARGET) also writes the file to the local path 
+%    TARGET as it is downloaded, to keep a copy of the raw file. TARGET is the
+%    full name of the local file, and its leading directories should exist.
+%
+%  Notes:
+%    The contents may be passed directly to the readers accepting file contents
+%    in memory (like XBD2MAT or SX2MAT), avoiding to write the file to disk 
+%    and read it back when the file is only needed for its data.
+%
+%  Examples:
+%    % Decode a binary file on the dockserver without storing it:
+%    bytes = mread(h, 'from-glider/happyglider-1970-000-0-0.sbd');
+%    [meta, data] = xbd2mat(bytes);
+%    % Decode it and keep a copy of the raw file:
+%    bytes = mread(h, 'from-glider/happyglider-1970-000-0-0.sbd', ...
+%                  fullfile('binary', 'happyglider-1970-000-0-0.sbd'));
+%    [meta, data] = xbd2mat(bytes);
+%
+%  See also:
+%    SFTP
+%    MGET
+%    XBD2MAT
+%    SX2MAT
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2014-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  if (nargin < 3)
+    data = mexsftp('getfile', h.sftp_handle, path);
+  else
+    data = mexsftp('getfile', h.sftp_handle, path, target);
+  end
+  
+end
@@ -0,0 +1,60 @@
+function [data, ok] = peek(h, paths, nbytes)
+%PEEK  Read the beginning of files on an SFTP server without downloading them.
+%
+%  Syntax:
+%    DATA = PEEK(H, PATHS, NBYTES)
+%    [DATA, OK] = PEEK(H, PATHS, NBYTES)
+%
+%  Description:
+%    DATA = PEEK(H, PATHS, NBYTES) reads the first NBYTES bytes of the files
+%    on the server given by string or cell array of strings PATHS, and returns
+%    them in a cell array DATA of the same size as PATHS, with a row vector of
+%    class uint8 for each file. The vector is shorter than NBYTES if the file
+%    is shorter, and empty if the file could not be read.
+%
+%    [DATA, OK] = PEEK(H, PATHS, NBYTES) also returns a logical array OK of the
+%    same size as PATHS whether each file was successfully read.
+%
+%  Notes:
+%    The read requests are pipelined, so peeking the header of many files is
+%    much faster than downloading them or reading them one by one. This is
+%    useful to classify remote files by their contents before downloading.
+%
+%  Examples:
+%    % Check the mission of binary files on a dockserver:
+%    atts = dir(h, '*.sbd');
+%    data = peek(h, {atts.name}, 1024);
+%    headers = cellfun(@xbdheader, data, 'UniformOutput', false);
+%
+%  See also:
+%    SFTP
+%    DIR
+%    MGET
+%    XBDHEADER
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2014-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  if ischar(paths)
+    paths = cellstr(paths);
+  end
+  [data, ok] = mexsftp('peek', h.sftp_handle, paths, double(nbytes));
+  
+end
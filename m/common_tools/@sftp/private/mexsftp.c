@@ -44,6 +44,14 @@
  * if the path to the dynamic library is included during the linkage:
  *   mex -Ilibssh/include -Llibssh/lib -Wl,-rpath=/path/to/libssh/lib -lssh mexsftp.c
  *
+ * Streaming decompression and compression of transferred files is optional.
+ * Each compression format is enabled defining a macro and linking against 
+ * the respective library (zlib, liblzma and libzstd):
+ *   mex -DMEXSFTP_WITH_ZLIB -DMEXSFTP_WITH_LZMA -DMEXSFTP_WITH_ZSTD \
+ *       -lssh -lz -llzma -lzstd mexsftp.c
+ * Defining also MEXSFTP_CODEC_CHECK builds a round trip check of the enabled
+ * formats instead of the interface (it is built and run by SETUPMEXSFTP).
+ *
  * Notes:
  *   The implementation trick here is to store the ssh and sftp sessions in a
  *   structure referenced by a pointer, and pass that pointer into and out of
@@ -68,6 +76,15 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#ifdef MEXSFTP_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MEXSFTP_WITH_LZMA
+#include <lzma.h>
+#endif
+#ifdef MEXSFTP_WITH_ZSTD
+#include <zstd.h>
+#endif
 
 
 static char * prepend_pwd(const char *path, const char *pwd)
@@ -279,6 +296,428 @@ static sftp_attributes atts_sftp_attributes_list(sftp_attributes_list iter)
 }
 
 
+typedef enum {
+  SFTP_CODEC_NONE = 0,
+  SFTP_CODEC_AUTO,
+  SFTP_CODEC_GZIP,
+  SFTP_CODEC_XZ,
+  SFTP_CODEC_ZSTD
+} sftp_codec_type;
+
+typedef struct sftp_codec_struct {
+  sftp_codec_type type;
+  int compress;
+  int done;
+#ifdef MEXSFTP_WITH_ZLIB
+  z_stream zstrm;
+#endif
+#ifdef MEXSFTP_WITH_LZMA
+  lzma_stream xstrm;
+#endif
+#ifdef MEXSFTP_WITH_ZSTD
+  ZSTD_DStream *zstd_dstrm;
+  ZSTD_CStream *zstd_cstrm;
+#endif
+} sftp_codec_struct;
+
+typedef sftp_codec_struct *sftp_codec;
+
+typedef int (*sftp_codec_sink)(void *dest, const char *data, size_t len);
+
+static int parse_sftp_codec_type(const char *name)
+{
+  if (strcmp(name, "none") == 0)
+    return SFTP_CODEC_NONE;
+  if (strcmp(name, "auto") == 0)
+    return SFTP_CODEC_AUTO;
+  if (strcmp(name, "gzip") == 0)
+    return SFTP_CODEC_GZIP;
+  if (strcmp(name, "xz") == 0)
+    return SFTP_CODEC_XZ;
+  if (strcmp(name, "zstd") == 0)
+    return SFTP_CODEC_ZSTD;
+  return -1;
+}
+
+static sftp_codec_type magic_sftp_codec_type(const char *data, size_t len)
+{
+  const unsigned char *bytes = (const unsigned char *) data;
+  if (len >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B)
+    return SFTP_CODEC_GZIP;
+  if (len >= 6 && memcmp(bytes, "\xFD" "7zXZ\0", 6) == 0)
+    return SFTP_CODEC_XZ;
+  if (len >= 4 && memcmp(bytes, "\x28\xB5\x2F\xFD", 4) == 0)
+    return SFTP_CODEC_ZSTD;
+  return SFTP_CODEC_NONE;
+}
+
+static sftp_codec_type extension_sftp_codec_type(const char *path)
+{
+  size_t len = strlen(path);
+  if (len > 3 && strcmp(path + len - 3, ".gz") == 0)
+    return SFTP_CODEC_GZIP;
+  if (len > 3 && strcmp(path + len - 3, ".xz") == 0)
+    return SFTP_CODEC_XZ;
+  if (len > 4 && strcmp(path + len - 4, ".zst") == 0)
+    return SFTP_CODEC_ZSTD;
+  return SFTP_CODEC_NONE;
+}
+
+static sftp_codec make_sftp_codec(sftp_codec_type type, int compress)
+{
+  sftp_codec codec;
+  int rc;
+  codec = malloc(sizeof *codec);
+  if (! codec)
+    return NULL;
+  memset(codec, 0, sizeof *codec);
+  codec->type = type;
+  codec->compress = compress;
+  codec->done = 0;
+  rc = -1;
+  switch (type) {
+#ifdef MEXSFTP_WITH_ZLIB
+    case SFTP_CODEC_GZIP:
+      /* Window bits 15 plus 16 write a gzip wrapper, plus 32 detect it. */
+      rc = compress
+        ? deflateInit2(&codec->zstrm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                       15 + 16, 8, Z_DEFAULT_STRATEGY)
+        : inflateInit2(&codec->zstrm, 15 + 32);
+      rc = (rc == Z_OK) ? 0 : -1;
+      break;
+#endif
+#ifdef MEXSFTP_WITH_LZMA
+    case SFTP_CODEC_XZ:
+      codec->xstrm = (lzma_stream) LZMA_STREAM_INIT;
+      rc = compress
+        ? lzma_easy_encoder(&codec->xstrm, 6, LZMA_CHECK_CRC64)
+        : lzma_stream_decoder(&codec->xstrm, UINT64_MAX, LZMA_CONCATENATED);
+      rc = (rc == LZMA_OK) ? 0 : -1;
+      break;
+#endif
+#ifdef MEXSFTP_WITH_ZSTD
+    case SFTP_CODEC_ZSTD:
+      if (compress) {
+        codec->zstd_cstrm = ZSTD_createCStream();
+        rc = codec->zstd_cstrm ? 0 : -1;
+      } else {
+        codec->zstd_dstrm = ZSTD_createDStream();
+        rc = (codec->zstd_dstrm
+              && ! ZSTD_isError(ZSTD_initDStream(codec->zstd_dstrm))) ? 0 : -1;
+      }
+      break;
+#endif
+    default:
+      break;
+  }
+  if (rc != 0) {
+    free(codec);
+    return NULL;
+  }
+  return codec;
+}
+
+static void free_sftp_codec(sftp_codec codec)
+{
+  switch (codec->type) {
+#ifdef MEXSFTP_WITH_ZLIB
+    case SFTP_CODEC_GZIP:
+      if (codec->compress)
+        deflateEnd(&codec->zstrm);
+      else
+        inflateEnd(&codec->zstrm);
+      break;
+#endif
+#ifdef MEXSFTP_WITH_LZMA
+    case SFTP_CODEC_XZ:
+      lzma_end(&codec->xstrm);
+      break;
+#endif
+#ifdef MEXSFTP_WITH_ZSTD
+    case SFTP_CODEC_ZSTD:
+      if (codec->zstd_cstrm)
+        ZSTD_freeCStream(codec->zstd_cstrm);
+      if (codec->zstd_dstrm)
+        ZSTD_freeDStream(codec->zstd_dstrm);
+      break;
+#endif
+    default:
+      break;
+  }
+  free(codec);
+}
+
+/* Run one step of the codec on the given input to the given output buffer.
+ * Input pointer and length are updated with the consumed input, 
+ * and output length is updated with the produced output.
+ * Return 1 if the step should be repeated with the remaining input 
+ * (or to flush pending output), 0 if the input has been processed,
+ * or -1 on error (and set the message).
+ */
+static int step_sftp_codec(sftp_codec codec, const char* *message,
+                           const char* *in, size_t *inlen,
+                           char *out, size_t *outlen, int finish)
+{
+  size_t outsize;
+  outsize = *outlen;
+  *outlen = 0;
+  switch (codec->type) {
+#ifdef MEXSFTP_WITH_ZLIB
+    case SFTP_CODEC_GZIP: {
+      int zrc;
+      z_stream *z = &codec->zstrm;
+      z->next_in = (Bytef *) *in;
+      z->avail_in = (uInt) *inlen;
+      z->next_out = (Bytef *) out;
+      z->avail_out = (uInt) outsize;
+      zrc = codec->compress
+        ? deflate(z, finish ? Z_FINISH : Z_NO_FLUSH)
+        : inflate(z, Z_NO_FLUSH);
+      *in += *inlen - z->avail_in;
+      *inlen = z->avail_in;
+      *outlen = outsize - z->avail_out;
+      if (zrc == Z_STREAM_END) {
+        codec->done = 1;
+        /* Concatenated gzip members are decompressed as a single stream. */
+        if (! codec->compress && *inlen > 0) {
+          codec->done = 0;
+          if (inflateReset(z) != Z_OK) {
+            *message = "Compression library error";
+            return -1;
+          }
+          return 1;
+        }
+        return 0;
+      }
+      if (zrc != Z_OK && zrc != Z_BUF_ERROR) {
+        *message = z->msg ? z->msg : "Compression library error";
+        return -1;
+      }
+      if (zrc == Z_BUF_ERROR && *outlen == 0)
+        return 0;
+      return (*inlen > 0 || z->avail_out == 0 || (codec->compress && finish));
+    }
+#endif
+#ifdef MEXSFTP_WITH_LZMA
+    case SFTP_CODEC_XZ: {
+      lzma_ret xrc;
+      lzma_stream *x = &codec->xstrm;
+      x->next_in = (const uint8_t *) *in;
+      x->avail_in = *inlen;
+      x->next_out = (uint8_t *) out;
+      x->avail_out = outsize;
+      xrc = lzma_code(x, finish ? LZMA_FINISH : LZMA_RUN);
+      *in += *inlen - x->avail_in;
+      *inlen = x->avail_in;
+      *outlen = outsize - x->avail_out;
+      if (xrc == LZMA_STREAM_END) {
+        codec->done = 1;
+        return 0;
+      }
+      if (xrc == LZMA_BUF_ERROR && ! finish)
+        return 0;
+      if (xrc != LZMA_OK) {
+        *message = (xrc == LZMA_BUF_ERROR) ? "Truncated compressed data"
+                 : (xrc == LZMA_MEM_ERROR) ? "Memory error"
+                 : "Invalid compressed data";
+        return -1;
+      }
+      return (*inlen > 0 || x->avail_out == 0 || finish);
+    }
+#endif
+#ifdef MEXSFTP_WITH_ZSTD
+    case SFTP_CODEC_ZSTD: {
+      size_t zrc;
+      ZSTD_inBuffer zin;
+      ZSTD_outBuffer zout;
+      zin.src = *in;
+      zin.size = *inlen;
+      zin.pos = 0;
+      zout.dst = out;
+      zout.size = outsize;
+      zout.pos = 0;
+      zrc = codec->compress
+        ? ZSTD_compressStream2(codec->zstd_cstrm, &zout, &zin,
+                               finish ? ZSTD_e_end : ZSTD_e_continue)
+        : ZSTD_decompressStream(codec->zstd_dstrm, &zout, &zin);
+      if (ZSTD_isError(zrc)) {
+        *message = ZSTD_getErrorName(zrc);
+        return -1;
+      }
+      *in += zin.pos;
+      *inlen -= zin.pos;
+      *outlen = zout.pos;
+      if (codec->compress) {
+        codec->done = finish && (zrc == 0);
+        return finish ? (zrc != 0) : (*inlen > 0 || zout.pos == zout.size);
+      }
+      /* A hint of zero marks the end of a frame. Keep the flag until the
+       * input of a concatenated frame arrives, since a call with no input
+       * after a complete frame (like the final one) returns a nonzero hint. */
+      if (zrc == 0)
+        codec->done = 1;
+      else if (zin.pos > 0)
+        codec->done = 0;
+      return (*inlen > 0 || zout.pos == zout.size);
+    }
+#endif
+    default:
+      (void) outsize;
+      *message = "Unsupported compression format";
+      return -1;
+  }
+}
+
+/* Process input through the codec and pass the output to the sink.
+ * The last call should set the finish flag to flush the output (compression)
+ * or to check that the input is complete (decompression).
+ */
+static int run_sftp_codec(sftp_codec codec, const char* *message,
+                          const char *in, size_t inlen, int finish,
+                          sftp_codec_sink sink, void *dest)
+{
+  char out[65536];
+  size_t outlen;
+  int more;
+  do {
+    outlen = sizeof(out);
+    more = step_sftp_codec(codec, message, &in, &inlen, out, &outlen, finish);
+    if (more < 0)
+      return -1;
+    if (outlen > 0 && sink(dest, out, outlen) != 0) {
+      *message = NULL;
+      return -1;
+    }
+  } while (more);
+  if (finish && ! codec->done) {
+    *message = "Truncated compressed data";
+    return -1;
+  }
+  return 0;
+}
+
+
+typedef struct sftp_output_sink {
+  FILE *file;
+  char *data;
+  size_t size;
+  size_t capacity;
+} sftp_output_sink;
+
+static int write_sftp_output_sink(void *dest, const char *data, size_t len)
+{
+  sftp_output_sink *sink = dest;
+  if (sink->file && fwrite(data, 1, len, sink->file) != len)
+    return -1;
+  if (sink->data) {
+    if (sink->capacity < sink->size + len) {
+      for (; sink->capacity < sink->size + len; sink->capacity *= 2);
+      sink->data = mxRealloc(sink->data, sink->capacity);
+    }
+    memcpy(sink->data + sink->size, data, len);
+    sink->size += len;
+  }
+  return 0;
+}
+
+static int write_sftp_file_sink(void *dest, const char *data, size_t len)
+{
+  return (sftp_write((sftp_file) dest, data, len) != (ssize_t) len) ? -1 : 0;
+}
+
+#ifdef MEXSFTP_CODEC_CHECK
+/* Process a whole buffer through a new codec in chunks of the given size,
+ * with a final call with no input to finish, as getfile and putfile do.
+ * Return 0 on success, or -1 on error (and set the message).
+ */
+static int feed_sftp_codec(sftp_codec_type type, int compress,
+                           const char *in, size_t inlen, size_t chunk,
+                           sftp_output_sink *sink, const char* *message)
+{
+  sftp_codec codec;
+  size_t off, len;
+  int err;
+  codec = make_sftp_codec(type, compress);
+  if (! codec) {
+    *message = "Unsupported compression format";
+    return -1;
+  }
+  *message = "Output error";
+  for (off = 0, err = 0; ! err && off < inlen; off += len) {
+    len = (inlen - off < chunk) ? inlen - off : chunk;
+    err = run_sftp_codec(codec, message, in + off, len, 0,
+                         write_sftp_output_sink, sink);
+  }
+  if (! err)
+    err = run_sftp_codec(codec, message, NULL, 0, 1,
+                         write_sftp_output_sink, sink);
+  free_sftp_codec(codec);
+  if (err && ! *message)
+    *message = "Output error";
+  return err;
+}
+
+/* Check the round trip of a codec on generated text data:
+ * the decompression of the compressed data (and of two concatenated copies)
+ * should give the original data, and a truncated stream should be an error.
+ * Return 0 on success, or -1 on failure (and set the message).
+ */
+static int check_sftp_codec(sftp_codec_type type, const char* *message)
+{
+  static const char alphabet[] = "glider toolbox 0123456789\n";
+  const size_t len = 1 << 20;
+  sftp_output_sink packed = {NULL, NULL, 0, 65536};
+  sftp_output_sink unpacked = {NULL, NULL, 0, 65536};
+  char *data;
+  unsigned long seed;
+  size_t i;
+  int err;
+  data = mxMalloc(len);
+  for (i = 0, seed = 1; i < len; i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    data[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+  }
+  packed.data = mxMalloc(packed.capacity);
+  unpacked.data = mxMalloc(unpacked.capacity);
+  err = feed_sftp_codec(type, 1, data, len, 32768, &packed, message);
+  if (! err)
+    err = feed_sftp_codec(type, 0, packed.data, packed.size, 4093,
+                          &unpacked, message);
+  if (! err && (unpacked.size != len || memcmp(unpacked.data, data, len))) {
+    *message = "Decompressed data differ from original data";
+    err = -1;
+  }
+  if (! err) {
+    unpacked.size = 0;
+    packed.capacity = 2 * packed.size;
+    packed.data = mxRealloc(packed.data, packed.capacity);
+    memcpy(packed.data + packed.size, packed.data, packed.size);
+    packed.size = 2 * packed.size;
+    err = feed_sftp_codec(type, 0, packed.data, packed.size, 4093,
+                          &unpacked, message);
+    if (! err && (unpacked.size != 2 * len 
+                  || memcmp(unpacked.data, data, len)
+                  || memcmp(unpacked.data + len, data, len))) {
+      *message = "Decompressed concatenated data differ from original data";
+      err = -1;
+    }
+  }
+  if (! err) {
+    unpacked.size = 0;
+    if (feed_sftp_codec(type, 0, packed.data, packed.size / 4, 4093,
+                        &unpacked, message) == 0) {
+      *message = "Truncated compressed data not detected";
+      err = -1;
+    }
+  }
+  mxFree(unpacked.data);
+  mxFree(packed.data);
+  mxFree(data);
+  return err;
+}
+#endif
+
+
 typedef struct sftp_connection_struct {
   ssh_session ssh;
   sftp_session sftp;
@@ -558,6 +997,70 @@ static bool isdir_sftp_attributes(sftp_attributes atts)
   return atts && atts->type == SSH_FILEXFER_TYPE_DIRECTORY;
 }
 
+/* Serial date number of the POSIX epoch (1970-01-01 00:00:00 UTC). */
+#define MEXSFTP_DATENUM_EPOCH 719529.0
+
+static mxArray *
+columns_sftp_attributes_list(sftp_attributes_list list)
+{
+  const int nfield = 6;
+  const char* fields[] = {"name", "bytes", "isdir", "mtime", "datenum", "date"};
+  struct tm mtime;
+  time_t secs;
+  size_t count;
+  mwIndex index;
+  sftp_attributes atts;
+  sftp_attributes_list iter;
+  mxArray *columns, *names;
+  uint64_T *bytes;
+  mxLogical *isdir;
+  double *posix, *serial, *date;
+  
+  count = length_sftp_attributes_list(list);
+  names = mxCreateCellMatrix(count, 1);
+  columns = mxCreateStructMatrix(1, 1, nfield, fields);
+  mxSetField(columns, 0, "name", names);
+  mxSetField(columns, 0, "bytes",
+             mxCreateNumericMatrix(count, 1, mxUINT64_CLASS, mxREAL));
+  mxSetField(columns, 0, "isdir", mxCreateLogicalMatrix(count, 1));
+  mxSetField(columns, 0, "mtime", mxCreateDoubleMatrix(count, 1, mxREAL));
+  mxSetField(columns, 0, "datenum", mxCreateDoubleMatrix(count, 1, mxREAL));
+  mxSetField(columns, 0, "date", mxCreateDoubleMatrix(count, 6, mxREAL));
+  bytes = (uint64_T *) mxGetData(mxGetField(columns, 0, "bytes"));
+  isdir = mxGetLogicals(mxGetField(columns, 0, "isdir"));
+  posix = mxGetPr(mxGetField(columns, 0, "mtime"));
+  serial = mxGetPr(mxGetField(columns, 0, "datenum"));
+  date = mxGetPr(mxGetField(columns, 0, "date"));
+  
+  /* Fill the columns in a single pass over the list.
+   * The date vectors are in UTC (gmtime_r is reentrant and does not depend
+   * on the time zone settings), and the serial date numbers are consistent
+   * with them.
+   */
+  for (iter = head_sftp_attributes_list(list), index = 0;
+       iter != lend_sftp_attributes_list(list);
+       iter = next_sftp_attributes_list(iter), index++) {
+    atts = atts_sftp_attributes_list(iter);
+    mxSetCell(names, index, mxCreateString(atts->name));
+    bytes[index] = atts->size;
+    isdir[index] = isdir_sftp_attributes(atts);
+    posix[index] = atts->mtime;
+    serial[index] = MEXSFTP_DATENUM_EPOCH + atts->mtime / 86400.0;
+    secs = (time_t) atts->mtime;
+    if (gmtime_r(&secs, &mtime)) {
+      date[index + 0 * count] = mtime.tm_year + 1900;
+      date[index + 1 * count] = mtime.tm_mon + 1;
+      date[index + 2 * count] = mtime.tm_mday;
+      date[index + 3 * count] = mtime.tm_hour;
+      date[index + 4 * count] = mtime.tm_min;
+      date[index + 5 * count] = mtime.tm_sec;
+    }
+  }
+  
+  return columns;
+}
+
+
 static void
 lsfile_sftp_connection(int *rc, const char* *message, sftp_attributes *atts,
                        sftp_connection conn, const char* path)
@@ -947,15 +1450,23 @@ delfile_sftp_connection(int *rc, const char* *message,
 
 static void
 getfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
-                        const char* rpath, const char* lpath)
+                        const char* rpath, const char* lpath,
+                        char* *mdata, size_t *msize, sftp_codec_type ctype)
 {
   FILE *lfile;
   sftp_file rfile;
+  sftp_attributes ratts;
+  sftp_output_sink sink;
+  sftp_codec codec;
   ssh_session ssh;
   sftp_session sftp;
   char *pwd, *erpath;
+  char *mbuff, *zbuff, *ztemp;
+  const char *cmsg;
+  size_t mlen, mcap, zcap;
+  uint64_t zbase, zfed, zend;
   int blen, rlen;
-  int reof, rerr, werr;
+  int reof, rerr, werr, cerr;
   int nreq, nbad, ireq;
   int reqs[32] = {0};
   int rsps[32] = {0};
@@ -992,13 +1503,71 @@ getfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
     free(erpath);
     return;
   }
-  lfile = fopen(lpath, "wb");
-  if (! lfile) {
-    *message = strerror(errno);
-    *rc = SSH_ERROR;
-    sftp_close(rfile);
-    free(erpath);
-    return;
+  /* The file may be written to a local file, to memory, or both.
+   * The memory buffer is allocated with the size of the remote file,
+   * and it is grown if the file grows while it is being read.
+   * It is allocated with the MATLAB memory manager, so that it can be handed
+   * to an output array without copying it.
+   */
+  lfile = NULL;
+  mbuff = NULL;
+  mlen = 0;
+  mcap = 0;
+  if (lpath) {
+    lfile = fopen(lpath, "wb");
+    if (! lfile) {
+      *message = strerror(errno);
+      *rc = SSH_ERROR;
+      sftp_close(rfile);
+      free(erpath);
+      return;
+    }
+  }
+  if (mdata || ctype != SFTP_CODEC_NONE) {
+    ratts = sftp_fstat(rfile);
+    mcap = (ratts && ratts->size > 0) ? ratts->size : min_blen;
+    if (ratts)
+      sftp_attributes_free(ratts);
+  }
+  if (mdata)
+    mbuff = mxMalloc(mcap);
+  /* The file may be decompressed while it is received.
+   * The responses may arrive in any order, but the decompression needs the
+   * data in order. So the compressed data is staged in a buffer, and the 
+   * complete leading part of the staged data is decompressed to the outputs
+   * after each round of responses and removed from the buffer.
+   * The staged data starts at offset zbase of the remote file, the data up
+   * to offset zfed has already been decompressed, and the data up to offset
+   * zend has been received (but there may be pending requests before it).
+   * If the format is detected automatically and the file is not compressed,
+   * the staged data is passed through to the outputs unchanged.
+   */
+  codec = NULL;
+  zbuff = NULL;
+  zcap = 0;
+  zbase = 0;
+  zfed = 0;
+  zend = 0;
+  cerr = 0;
+  cmsg = NULL;
+  sink.file = lfile;
+  sink.data = mbuff;
+  sink.size = 0;
+  sink.capacity = mcap;
+  if (ctype != SFTP_CODEC_NONE) {
+    zcap = (mcap < max_blen) ? mcap : max_blen;
+    zbuff = malloc(zcap);
+    if (! zbuff) {
+      *message = "Memory error";
+      *rc = SSH_ERROR;
+      sftp_close(rfile);
+      if (lfile)
+        fclose(lfile);
+      if (mbuff)
+        mxFree(mbuff);
+      free(erpath);
+      return;
+    }
   }
   /* Read the file in chuncks.
    * To read the file synchronously chunk by chunk is slow. Instead:
@@ -1021,7 +1590,7 @@ getfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
    * dynamically. 
    */
   for (blen = max_blen, nreq = 1, reof = 0, rerr = 0, werr = 0, nbad = 0, rlen = 0;
-       (nreq > nbad) && (! rerr) && (! werr);
+       (nreq > nbad) && (! rerr) && (! werr) && (! cerr);
        nreq += (nbad > 0 || reof || nreq >= max_nreq) ? 0 : 1,
        blen /= (0 < rlen && rlen < blen && blen > min_blen) ? 2 : 1) {
     for (ireq = nreq - 1; (ireq >= 0) && (! rerr); ireq--) {
@@ -1063,9 +1632,34 @@ getfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
           rsps[ireq] = sftp_async_read(rfile, buff, lens[ireq], reqs[ireq]);
           rerr = (sftp_seek64(rfile, tell) < 0);
           if (rsps[ireq] > 0) {
-            werr = fseek(lfile, offs[ireq], SEEK_SET) < 0;
-            werr = werr || fwrite(buff, 1, rsps[ireq], lfile) - rsps[ireq];
-            werr = werr || fseek(lfile, 0, SEEK_END) < 0;
+            if (zbuff) {
+              size = offs[ireq] + rsps[ireq];
+              if (zcap < size - zbase) {
+                for (; zcap < size - zbase; zcap *= 2);
+                ztemp = realloc(zbuff, zcap);
+                cerr = ! ztemp;
+                cmsg = ztemp ? NULL : "Memory error";
+                zbuff = ztemp ? ztemp : zbuff;
+              }
+              if (! cerr) {
+                memcpy(zbuff + (offs[ireq] - zbase), buff, rsps[ireq]);
+                zend = (zend < size) ? size : zend;
+              }
+            } else {
+              if (lfile) {
+                werr = fseek(lfile, offs[ireq], SEEK_SET) < 0;
+                werr = werr || fwrite(buff, 1, rsps[ireq], lfile) - rsps[ireq];
+                werr = werr || fseek(lfile, 0, SEEK_END) < 0;
+              }
+              if (mbuff) {
+                if (mcap < offs[ireq] + rsps[ireq]) {
+                  for (; mcap < offs[ireq] + rsps[ireq]; mcap *= 2);
+                  mbuff = mxRealloc(mbuff, mcap);
+                }
+                memcpy(mbuff + offs[ireq], buff, rsps[ireq]);
+                mlen = (mlen < offs[ireq] + rsps[ireq]) ? offs[ireq] + rsps[ireq] : mlen;
+              }
+            }
             rlen = (rlen < rsps[ireq] && rsps[ireq] < blen && blen <= lens[ireq]) ? rsps[ireq] : rlen;
             offs[ireq] += rsps[ireq];
             lens[ireq] -= rsps[ireq];
@@ -1078,36 +1672,106 @@ getfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
         }
       }
     }
+    if (zbuff && ! rerr && ! werr && ! cerr) {
+      /* Decompress the complete leading part of the staged data, 
+       * which ends at the offset of the first incomplete request.
+       */
+      for (size = zend, ireq = 0; ireq < nreq; ireq++)
+        if (lens[ireq] && offs[ireq] < size)
+          size = offs[ireq];
+      if (! codec && ctype != SFTP_CODEC_NONE && size - zbase >= 6) {
+        if (ctype == SFTP_CODEC_AUTO)
+          ctype = magic_sftp_codec_type(zbuff, size - zbase);
+        if (ctype != SFTP_CODEC_NONE) {
+          codec = make_sftp_codec(ctype, 0);
+          cerr = ! codec;
+          cmsg = codec ? NULL : "Unsupported compression format";
+        }
+      }
+      if (! cerr && (codec || ctype == SFTP_CODEC_NONE) && size > zfed) {
+        if (codec)
+          cerr = run_sftp_codec(codec, &cmsg, zbuff + (zfed - zbase), 
+                                size - zfed, 0, write_sftp_output_sink, &sink);
+        else
+          cerr = write_sftp_output_sink(&sink, zbuff + (zfed - zbase), 
+                                        size - zfed);
+        werr = cerr && ! cmsg;
+        cerr = cerr && cmsg;
+        zfed = size;
+        memmove(zbuff, zbuff + (zfed - zbase), zend - zfed);
+        zbase = zfed;
+      }
+    }
   }
+  if (zbuff && ! rerr && ! werr && ! cerr && nbad <= 0) {
+    /* Flush the remaining staged data and check the end of the stream. */
+    if (! codec && ctype != SFTP_CODEC_NONE) {
+      if (ctype == SFTP_CODEC_AUTO)
+        ctype = magic_sftp_codec_type(zbuff, zend - zbase);
+      if (ctype != SFTP_CODEC_NONE) {
+        codec = make_sftp_codec(ctype, 0);
+        cerr = ! codec;
+        cmsg = codec ? NULL : "Unsupported compression format";
+      }
+    }
+    if (codec && ! cerr) {
+      cerr = run_sftp_codec(codec, &cmsg, zbuff + (zfed - zbase),
+                            zend - zfed, 1, write_sftp_output_sink, &sink);
+    } else if (! cerr && zend > zfed) {
+      cerr = write_sftp_output_sink(&sink, zbuff + (zfed - zbase), 
+                                    zend - zfed);
+    }
+    werr = cerr && ! cmsg;
+    cerr = cerr && cmsg;
+    mbuff = sink.data;
+    mlen = sink.size;
+  } else if (zbuff) {
+    mbuff = sink.data;
+  }
+  if (codec)
+    free_sftp_codec(codec);
+  if (zbuff)
+    free(zbuff);
   if (werr) {
     *message = strerror(errno);
     *rc = SSH_ERROR;
     sftp_close(rfile);
-    fclose(lfile);
+    if (lfile)
+      fclose(lfile);
+    if (mbuff)
+      mxFree(mbuff);
     free(erpath);
     return;
   }
-  if (rerr) {
-    *message = sftp_get_error_msg(sftp);
-    *rc = sftp_get_error(sftp);
+  if (cerr) {
+    *message = cmsg;
+    *rc = SSH_ERROR;
     sftp_close(rfile);
-    fclose(lfile);
+    if (lfile)
+      fclose(lfile);
+    if (mbuff)
+      mxFree(mbuff);
     free(erpath);
     return;
   }
-  if (nbad > 0) {
+  if (rerr || nbad > 0) {
     *message = sftp_get_error_msg(sftp);
     *rc = sftp_get_error(sftp);
     sftp_close(rfile);
-    fclose(lfile);
+    if (lfile)
+      fclose(lfile);
+    if (mbuff)
+      mxFree(mbuff);
     free(erpath);
     return;
   }
-  *rc = fclose(lfile);
+  *rc = lfile ? fclose(lfile) : 0;
   if (*rc != 0) {
     *message = strerror(errno);
     *rc = SSH_ERROR;
     sftp_close(rfile);
+    if (mbuff)
+      mxFree(mbuff);
     free(erpath);
     return;
   }
@@ -1115,20 +1779,116 @@ getfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
   if (*rc != SSH_OK) {
     *message = sftp_get_error_msg(sftp);
     *rc = sftp_get_error(sftp);
+    if (mbuff)
+      mxFree(mbuff);
     free(erpath);
     return;
   }
+  if (mdata) {
+    *mdata = mbuff;
+    *msize = mlen;
+  }
   free(erpath);
 }
 
+static void
+peek_sftp_connection(int *rc, const char* *message, sftp_connection conn,
+                     size_t nfile, char* *rpaths, size_t nbytes,
+                     char* *buffs, size_t *lens, int *oks)
+{
+  sftp_file rfiles[32];
+  int reqs[32];
+  sftp_file rfile;
+  sftp_session sftp;
+  char *pwd, *erpath;
+  size_t first, last, ifile;
+  int rlen;
+  const size_t max_nreq = sizeof(reqs) / sizeof(reqs[0]);
+  if (! conn) {
+    *message = "Invalid sftp connection handle";
+    *rc = SSH_FX_NO_CONNECTION;
+    return;
+  }
+  sftp = conn->sftp;
+  pwd = conn->pwd;
+  if (! sftp) {
+    *message = "Not open sftp connection";
+    *rc = SSH_FX_NO_CONNECTION;
+    return;
+  }
+  /* Read the beginning of the files in batches.
+   * To open and read each file synchronously costs several round trips per
+   * file, and that dominates when only a few bytes of many files are needed.
+   * Instead, for each batch of files:
+   *   - Open the files and request the read of the first bytes of each one
+   *     without waiting the server response.
+   *   - Collect the responses in order.
+   * Servers may respond with less data than requested. In that case read the
+   * missing data synchronously (it is unusual for the small sizes involved).
+   * Files that can not be opened or read are not an error: they are marked
+   * as failed and the rest of files are processed.
+   */
+  for (first = 0; first < nfile; first = last) {
+    last = (nfile - first > max_nreq) ? first + max_nreq : nfile;
+    for (ifile = first; ifile < last; ifile++) {
+      oks[ifile] = 0;
+      lens[ifile] = 0;
+      reqs[ifile - first] = -1;
+      rfiles[ifile - first] = NULL;
+      erpath = expand_path(rpaths[ifile], pwd);
+      if (! erpath) {
+        for (; ifile > first; ifile--)
+          if (rfiles[ifile - first - 1])
+            sftp_close(rfiles[ifile - first - 1]);
+        *message = "Memory error";
+        *rc = SSH_ERROR;
+        return;
+      }
+      rfile = sftp_open(sftp, erpath, O_RDONLY, 0);
+      free(erpath);
+      rfiles[ifile - first] = rfile;
+      if (rfile && nbytes > 0)
+        reqs[ifile - first] = sftp_async_read_begin(rfile, nbytes);
+    }
+    for (ifile = first; ifile < last; ifile++) {
+      rfile = rfiles[ifile - first];
+      if (! rfile)
+        continue;
+      if (nbytes == 0) {
+        oks[ifile] = 1;
+      } else if (reqs[ifile - first] >= 0) {
+        do {
+          rlen = sftp_async_read(rfile, buffs[ifile], nbytes, 
+                                 reqs[ifile - first]);
+        } while (rlen == SSH_AGAIN);
+        if (rlen >= 0)
+          lens[ifile] = rlen;
+        while (rlen > 0 && lens[ifile] < nbytes) {
+          rlen = (sftp_seek64(rfile, lens[ifile]) < 0) ? -1 :
+                 sftp_read(rfile, buffs[ifile] + lens[ifile],
+                           nbytes - lens[ifile]);
+          if (rlen > 0)
+            lens[ifile] += rlen;
+        }
+        oks[ifile] = (rlen >= 0);
+      }
+      sftp_close(rfile);
+    }
+  }
+  *rc = SSH_OK;
+}
+
 
 static void
 putfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
-                        const char* lpath, const char* rpath)
+                        const char* lpath, const char* rpath,
+                        sftp_codec_type ctype)
 {
   struct stat atts;
   FILE *lfile;
   sftp_file rfile;
+  sftp_codec codec;
+  const char *cmsg;
   ssh_session ssh;
   sftp_session sftp;
   char *pwd, *erpath;
@@ -1178,6 +1938,24 @@ putfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
     free(erpath);
     return;
   }
+  /* The file may be compressed while it is sent,
+   * in the format given by the extension of the remote file if automatic.
+   */
+  codec = NULL;
+  cmsg = NULL;
+  if (ctype == SFTP_CODEC_AUTO)
+    ctype = extension_sftp_codec_type(rpath);
+  if (ctype != SFTP_CODEC_NONE) {
+    codec = make_sftp_codec(ctype, 1);
+    if (! codec) {
+      *message = "Unsupported compression format";
+      *rc = SSH_ERROR;
+      sftp_close(rfile);
+      fclose(lfile);
+      free(erpath);
+      return;
+    }
+  }
   /* Write the file in chuncks. 
    * libssh does not support asynchronous write operations.
    * Write the file synchronously chunk by chunk.
@@ -1185,7 +1963,17 @@ putfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
   for (rlen = fread(buff, 1, blen, lfile), rerr = (rlen < 0), werr = 0;
        (! rerr) && (! werr) && (rlen > 0);
        rlen = fread(buff, 1, blen, lfile), rerr = (rlen < 0)) {
-    werr = sftp_write(rfile, buff, rlen) - rlen;
+    if (codec)
+      werr = run_sftp_codec(codec, &cmsg, buff, rlen, 0, 
+                            write_sftp_file_sink, rfile);
+    else
+      werr = sftp_write(rfile, buff, rlen) - rlen;
+  }
+  if (codec) {
+    if (! rerr && ! werr)
+      werr = run_sftp_codec(codec, &cmsg, NULL, 0, 1,
+                            write_sftp_file_sink, rfile);
+    free_sftp_codec(codec);
   }
   if (rerr) {
     *message = strerror(errno);
@@ -1196,7 +1984,7 @@ putfile_sftp_connection(int *rc, const char* *message, sftp_connection conn,
     return;
   }
   if (werr) {
-    *message = ssh_get_error(ssh);
+    *message = cmsg ? cmsg : ssh_get_error(ssh);
     *rc = SSH_ERROR;
     sftp_close(rfile);
     fclose(lfile);
@@ -1568,18 +2356,24 @@ void mexsftp_lsdir( int nlhs, mxArray *plhs[],
   const char *message;
   int rc;
   char *path;
+  char format[8];
   
   /* Check for proper number of arguments, dimensions and types. */
   if (nlhs != 1)
     mexErrMsgIdAndTxt("sftp:lsdir:BadCall", "One output required.");
-  if (nrhs != 2)
-    mexErrMsgIdAndTxt("sftp:lsdir:BadCall", "Two inputs required.");
+  if (nrhs != 2 && nrhs != 3)
+    mexErrMsgIdAndTxt("sftp:lsdir:BadCall", "Two or three inputs required.");
   if (! (mxGetClassID(prhs[0]) == mxUINT64_CLASS
          && mxGetNumberOfElements(prhs[0]) == 1) )
     mexErrMsgIdAndTxt("sftp:lsdir:BadCall", 
                       "Connection must be scalar of class uint64 (pointer).");
   if (! (mxIsChar(prhs[1]) && mxGetM(prhs[1]) == 1))
     mexErrMsgIdAndTxt("sftp:lsdir:BadCall", "Path should be a string.");
+  if (nrhs == 3 && ! (mxIsChar(prhs[2]) && mxGetM(prhs[2]) == 1 
+                      && mxGetN(prhs[2]) == 7
+                      && mxGetString(prhs[2], format, sizeof(format)) == 0
+                      && strcmp(format, "columns") == 0))
+    mexErrMsgIdAndTxt("sftp:lsdir:BadCall", "Format should be 'columns'.");
   
   /* Get the sftp connection handle. */
   conn = *((sftp_connection *) mxGetData(prhs[0]));
@@ -1593,6 +2387,14 @@ void mexsftp_lsdir( int nlhs, mxArray *plhs[],
     mexErrMsgIdAndTxt("sftp:lsdir:ListError", 
                       "SFTP stat failed (%d): %s.", rc, message);
 
+  /* Return the attributes in columns, if required. */
+  if (nrhs == 3) {
+    plhs[0] = columns_sftp_attributes_list(list);
+    free_sftp_attributes_list(list);
+    mxFree(path);
+    return;
+  }
+
   /* Initialize output data. */
   count = length_sftp_attributes_list(list);
   plhs[0] = mxCreateStructMatrix(count, 1, nfield, fields);
@@ -1636,18 +2438,24 @@ void mexsftp_lsglob( int nlhs, mxArray *plhs[],
   const char *message;
   int rc;
   char *glob;
+  char format[8];
   
   /* Check for proper number of arguments, dimensions and types. */
   if (nlhs != 1)
     mexErrMsgIdAndTxt("sftp:lsglob:BadCall", "One output required.");
-  if (nrhs != 2)
-    mexErrMsgIdAndTxt("sftp:lsglob:BadCall", "Two inputs required.");
+  if (nrhs != 2 && nrhs != 3)
+    mexErrMsgIdAndTxt("sftp:lsglob:BadCall", "Two or three inputs required.");
   if (! (mxGetClassID(prhs[0]) == mxUINT64_CLASS
          && mxGetNumberOfElements(prhs[0]) == 1) )
     mexErrMsgIdAndTxt("sftp:lsglob:BadCall", 
                       "Connection must be scalar of class uint64 (pointer).");
   if (! (mxIsChar(prhs[1]) && mxGetM(prhs[1]) == 1))
     mexErrMsgIdAndTxt("sftp:lsglob:BadCall", "Glob should be a string.");
+  if (nrhs == 3 && ! (mxIsChar(prhs[2]) && mxGetM(prhs[2]) == 1 
+                      && mxGetN(prhs[2]) == 7
+                      && mxGetString(prhs[2], format, sizeof(format)) == 0
+                      && strcmp(format, "columns") == 0))
+    mexErrMsgIdAndTxt("sftp:lsglob:BadCall", "Format should be 'columns'.");
   
   /* Get the sftp connection handle. */
   conn = *((sftp_connection *) mxGetData(prhs[0]));
@@ -1661,6 +2469,14 @@ void mexsftp_lsglob( int nlhs, mxArray *plhs[],
     mexErrMsgIdAndTxt("sftp:lsglob:ListError", 
                       "SFTP stat failed (%d): %s.", rc, message);
 
+  /* Return the attributes in columns, if required. */
+  if (nrhs == 3) {
+    plhs[0] = columns_sftp_attributes_list(list);
+    free_sftp_attributes_list(list);
+    mxFree(glob);
+    return;
+  }
+
   /* Initialize output data. */
   count = length_sftp_attributes_list(list);
   plhs[0] = mxCreateStructMatrix(count, 1, nfield, fields);
@@ -1849,40 +2665,151 @@ void mexsftp_getfile( int nlhs, mxArray *plhs[],
   const char *message;
   int rc;
   char *rpath, *lpath;
+  char *mdata;
+  size_t msize;
+  char codec[8];
+  int ctype;
   
   /* Check for proper number of arguments, dimensions and types. */
-  if (nlhs != 0)
-    mexErrMsgIdAndTxt("sftp:getfile:BadCall", "Zero outputs required.");
-  if (nrhs != 3)
-    mexErrMsgIdAndTxt("sftp:getfile:BadCall", "Three inputs required.");
+  if (nlhs > 1)
+    mexErrMsgIdAndTxt("sftp:getfile:BadCall", "Zero or one outputs required.");
+  if (nlhs == 0 && nrhs != 3 && nrhs != 4)
+    mexErrMsgIdAndTxt("sftp:getfile:BadCall", "Three or four inputs required.");
+  if (nlhs == 1 && (nrhs < 2 || nrhs > 4))
+    mexErrMsgIdAndTxt("sftp:getfile:BadCall", "Two to four inputs required.");
   if (! (mxGetClassID(prhs[0]) == mxUINT64_CLASS
          && mxGetNumberOfElements(prhs[0]) == 1) )
     mexErrMsgIdAndTxt("sftp:getfile:BadCall", 
                       "Connection must be scalar of class uint64 (pointer).");
   if (! (mxIsChar(prhs[1]) && mxGetM(prhs[1]) == 1))
     mexErrMsgIdAndTxt("sftp:getfile:BadCall", "Remote path should be a string.");
-  if (! (mxIsChar(prhs[2]) && mxGetM(prhs[2]) == 1))
+  if (nrhs >= 3 && ! (mxIsChar(prhs[2]) 
+                      && (mxGetM(prhs[2]) == 1 
+                          || (nlhs == 1 && mxIsEmpty(prhs[2])))))
     mexErrMsgIdAndTxt("sftp:getfile:BadCall", "Local path should be a string.");
+  ctype = SFTP_CODEC_NONE;
+  if (nrhs == 4 && ! (mxIsChar(prhs[3]) && mxGetM(prhs[3]) == 1
+                      && mxGetString(prhs[3], codec, sizeof(codec)) == 0
+                      && (ctype = parse_sftp_codec_type(codec)) >= 0))
+    mexErrMsgIdAndTxt("sftp:getfile:BadCall", 
+                      "Compression should be 'none', 'auto', 'gzip', 'xz' or 'zstd'.");
   
   /* Get the sftp connection handle. */
   conn = *((sftp_connection *) mxGetData(prhs[0]));
   
-  /* Get the paths. */
+  /* Get the paths (an empty local path means no local file). */
   rpath = mxArrayToString(prhs[1]);
-  lpath = mxArrayToString(prhs[2]);
+  lpath = (nrhs >= 3 && ! mxIsEmpty(prhs[2])) ? mxArrayToString(prhs[2]) : NULL;
     
-  /* Get the file. */
-  getfile_sftp_connection(&rc, &message, conn, rpath, lpath);
+  /* Get the file, to memory if there is an output. */
+  getfile_sftp_connection(&rc, &message, conn, rpath, lpath,
+                          (nlhs == 1) ? &mdata : NULL, &msize, ctype);
   if (rc != SSH_OK)
     mexErrMsgIdAndTxt("sftp:getfile:GetError", 
                       "SFTP get failed (%d): %s.", rc, message);
 
+  /* Hand the downloaded bytes to the output without copying them. */
+  if (nlhs == 1) {
+    plhs[0] = mxCreateNumericMatrix(0, 1, mxUINT8_CLASS, mxREAL);
+    mxSetData(plhs[0], mdata);
+    mxSetM(plhs[0], msize);
+  }
+
   /* Free internal data. */
-  mxFree(lpath);
+  if (lpath)
+    mxFree(lpath);
   mxFree(rpath);
 }
 
 
+void mexsftp_peek( int nlhs, mxArray *plhs[],
+                   int nrhs, const mxArray *prhs[] )
+{
+  sftp_connection conn;
+  const char *message;
+  int rc;
+  size_t nfile, nbytes, ifile;
+  char* *rpaths;
+  char* *buffs;
+  size_t *lens;
+  int *oks;
+  mxArray *bytes;
+  mxLogical *okflags;
+  
+  /* Check for proper number of arguments, dimensions and types. */
+  if (nlhs != 1 && nlhs != 2)
+    mexErrMsgIdAndTxt("sftp:peek:BadCall", "One or two outputs required.");
+  if (nrhs != 3)
+    mexErrMsgIdAndTxt("sftp:peek:BadCall", "Three inputs required.");
+  if (! (mxGetClassID(prhs[0]) == mxUINT64_CLASS
+         && mxGetNumberOfElements(prhs[0]) == 1) )
+    mexErrMsgIdAndTxt("sftp:peek:BadCall", 
+                      "Connection must be scalar of class uint64 (pointer).");
+  if (! mxIsCell(prhs[1]))
+    mexErrMsgIdAndTxt("sftp:peek:BadCall", 
+                      "Paths should be a cell array of strings.");
+  nfile = mxGetNumberOfElements(prhs[1]);
+  for (ifile = 0; ifile < nfile; ifile++)
+    if (! (mxGetCell(prhs[1], ifile) 
+           && mxIsChar(mxGetCell(prhs[1], ifile))
+           && mxGetM(mxGetCell(prhs[1], ifile)) == 1))
+      mexErrMsgIdAndTxt("sftp:peek:BadCall", 
+                        "Paths should be a cell array of strings.");
+  if (! (mxIsDouble(prhs[2]) && mxGetNumberOfElements(prhs[2]) == 1
+         && mxGetScalar(prhs[2]) >= 0 
+         && mxGetScalar(prhs[2]) <= 0x7fffffff
+         && mxGetScalar(prhs[2]) == (size_t) mxGetScalar(prhs[2])))
+    mexErrMsgIdAndTxt("sftp:peek:BadCall", 
+                      "Number of bytes should be a non-negative integer.");
+  
+  /* Get the sftp connection handle. */
+  conn = *((sftp_connection *) mxGetData(prhs[0]));
+  
+  /* Get the paths and the number of bytes. */
+  nbytes = (size_t) mxGetScalar(prhs[2]);
+  rpaths = mxCalloc(nfile, sizeof(char *));
+  buffs = mxCalloc(nfile, sizeof(char *));
+  lens = mxCalloc(nfile, sizeof(size_t));
+  oks = mxCalloc(nfile, sizeof(int));
+  
+  /* Initialize output data, reading the bytes directly into the outputs. */
+  plhs[0] = mxCreateCellArray(mxGetNumberOfDimensions(prhs[1]),
+                              mxGetDimensions(prhs[1]));
+  for (ifile = 0; ifile < nfile; ifile++) {
+    rpaths[ifile] = mxArrayToString(mxGetCell(prhs[1], ifile));
+    bytes = mxCreateNumericMatrix(1, nbytes, mxUINT8_CLASS, mxREAL);
+    buffs[ifile] = (char *) mxGetData(bytes);
+    mxSetCell(plhs[0], ifile, bytes);
+  }
+  
+  /* Peek the files. */
+  peek_sftp_connection(&rc, &message, conn, nfile, rpaths, nbytes,
+                       buffs, lens, oks);
+  if (rc != SSH_OK)
+    mexErrMsgIdAndTxt("sftp:peek:PeekError", 
+                      "SFTP peek failed (%d): %s.", rc, message);
+
+  /* Trim the outputs to the bytes actually read. */
+  for (ifile = 0; ifile < nfile; ifile++)
+    mxSetN(mxGetCell(plhs[0], ifile), lens[ifile]);
+  if (nlhs == 2) {
+    plhs[1] = mxCreateLogicalArray(mxGetNumberOfDimensions(prhs[1]),
+                                   mxGetDimensions(prhs[1]));
+    okflags = mxGetLogicals(plhs[1]);
+    for (ifile = 0; ifile < nfile; ifile++)
+      okflags[ifile] = oks[ifile] ? 1 : 0;
+  }
+
+  /* Free internal data. */
+  for (ifile = 0; ifile < nfile; ifile++)
+    mxFree(rpaths[ifile]);
+  mxFree(oks);
+  mxFree(lens);
+  mxFree(buffs);
+  mxFree(rpaths);
+}
+
+
 void mexsftp_putfile( int nlhs, mxArray *plhs[],
                       int nrhs, const mxArray *prhs[] )
 {
@@ -1890,12 +2817,14 @@ void mexsftp_putfile( int nlhs, mxArray *plhs[],
   const char *message;
   int rc;
   char *lpath, *rpath;
+  char codec[8];
+  int ctype;
   
   /* Check for proper number of arguments, dimensions and types. */
   if (nlhs != 0)
     mexErrMsgIdAndTxt("sftp:putfile:BadCall", "Zero outputs required.");
-  if (nrhs != 3)
-    mexErrMsgIdAndTxt("sftp:putfile:BadCall", "Three inputs required.");
+  if (nrhs != 3 && nrhs != 4)
+    mexErrMsgIdAndTxt("sftp:putfile:BadCall", "Three or four inputs required.");
   if (! (mxGetClassID(prhs[0]) == mxUINT64_CLASS
          && mxGetNumberOfElements(prhs[0]) == 1) )
     mexErrMsgIdAndTxt("sftp:putfile:BadCall", 
@@ -1904,6 +2833,12 @@ void mexsftp_putfile( int nlhs, mxArray *plhs[],
     mexErrMsgIdAndTxt("sftp:putfile:BadCall", "Remote path should be a string.");
   if (! (mxIsChar(prhs[2]) && mxGetM(prhs[2]) == 1))
     mexErrMsgIdAndTxt("sftp:putfile:BadCall", "Local path should be a string.");
+  ctype = SFTP_CODEC_NONE;
+  if (nrhs == 4 && ! (mxIsChar(prhs[3]) && mxGetM(prhs[3]) == 1
+                      && mxGetString(prhs[3], codec, sizeof(codec)) == 0
+                      && (ctype = parse_sftp_codec_type(codec)) >= 0))
+    mexErrMsgIdAndTxt("sftp:putfile:BadCall", 
+                      "Compression should be 'none', 'auto', 'gzip', 'xz' or 'zstd'.");
   
   /* Get the sftp connection handle. */
   conn = *((sftp_connection *) mxGetData(prhs[0]));
@@ -1913,7 +2848,7 @@ void mexsftp_putfile( int nlhs, mxArray *plhs[],
   rpath = mxArrayToString(prhs[2]);
     
   /* Put the file. */
-  putfile_sftp_connection(&rc, &message, conn, lpath, rpath);
+  putfile_sftp_connection(&rc, &message, conn, lpath, rpath, ctype);
   if (rc != SSH_OK)
     mexErrMsgIdAndTxt("sftp:putfile:PutError", 
                       "SFTP put failed (%d): %s.", rc, message);
@@ -1924,6 +2859,27 @@ void mexsftp_putfile( int nlhs, mxArray *plhs[],
 }
 
 
+#ifdef MEXSFTP_CODEC_CHECK
+/* Entry point of the build made by SETUPMEXSFTP to check each codec:
+ *   CHECK(CODEC) throws an error if the round trip check of the codec fails.
+ */
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[] )
+{
+  const char *message;
+  char codec[8];
+  int ctype;
+  (void) plhs;
+  if (! (nlhs == 0 && nrhs == 1 && mxIsChar(prhs[0]) && mxGetM(prhs[0]) == 1
+         && mxGetString(prhs[0], codec, sizeof(codec)) == 0
+         && (ctype = parse_sftp_codec_type(codec)) >= SFTP_CODEC_GZIP))
+    mexErrMsgIdAndTxt("sftp:codeccheck:BadCall", 
+                      "Compression should be 'gzip', 'xz' or 'zstd'.");
+  if (check_sftp_codec(ctype, &message) != 0)
+    mexErrMsgIdAndTxt("sftp:codeccheck:CheckError", 
+                      "Round trip check of %s failed: %s.", codec, message);
+}
+#else
 void mexFunction( int nlhs, mxArray *plhs[],
                   int nrhs, const mxArray *prhs[] )
 {
@@ -1973,6 +2929,8 @@ void mexFunction( int nlhs, mxArray *plhs[],
     funcptr = &mexsftp_getfile;
   else if (0 == strcmp(funcname, "putfile"))
     funcptr = &mexsftp_putfile;
+  else if (0 == strcmp(funcname, "peek"))
+    funcptr = &mexsftp_peek;
     
   /* Free internal variables. */
   mxFree(funcname);
@@ -1984,3 +2942,4 @@ void mexFunction( int nlhs, mxArray *plhs[],
   /* Call the required function with the right parameters. */
   (*funcptr)(nlhs, plhs, nrhs - 1, &prhs[1] );
 }
+#endif
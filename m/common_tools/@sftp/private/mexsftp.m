@@ -11,12 +11,20 @@ function varargout = mexsftp(funcname, varargin)
 %    ATTS = MEXSFTP('lsfile', H, FILE)
 %    ATTS = MEXSFTP('lsdir', H, DIRECTORY)
 %    ATTS = MEXSFTP('lsglob', H, GLOB)
+%    ATTS = MEXSFTP('lsdir', H, DIRECTORY, 'columns')
+%    ATTS = MEXSFTP('lsglob', H, GLOB, 'columns')
 %    MEXSFTP('mkdir', H, PATH)
 %    MEXSFTP('rmdir', H, PATH)
 %    MEXSFTP('rename', H, SOURCE, TARGET)
 %    MEXSFTP('delfile', H, PATH)
 %    MEXSFTP('getfile', H, RPATH, LPATH)
+%    DATA = MEXSFTP('getfile', H, RPATH)
+%    DATA = MEXSFTP('getfile', H, RPATH, LPATH)
+%    MEXSFTP('getfile', H, RPATH, LPATH, CODEC)
+%    DATA = MEXSFTP('getfile', H, RPATH, LPATH, CODEC)
 %    MEXSFTP('putfile', H, LPATH, RPATH)
+%    MEXSFTP('putfile', H, LPATH, RPATH, CODEC)
+%    [DATA, OK] = MEXSFTP('peek', H, PATHS, NBYTES)
 %
 %  Description:
 %    H = MEXSFTP('create', H, HOST, PORT, USER, PASS) creates a connection
@@ -56,6 +64,20 @@ function varargout = mexsftp(funcname, varargin)
 %    described above. Wildcards are only allowed in the file name, not in the 
 %    leading directory path. If no file matches the glob, the result is empty.
 %
+%    ATTS = MEXSFTP('lsdir', H, DIRECTORY, 'columns') and 
+%    ATTS = MEXSFTP('lsglob', H, GLOB, 'columns') return the attributes of the
+%    same entries in a scalar struct with a column array for each attribute,
+%    with a row per entry, built in the mex file without intermediate structs:
+%      NAME: cell array of strings with the file names.
+%      BYTES: uint64 array with the file sizes in bytes.
+%      ISDIR: logical array whether the files are directories.
+%      MTIME: double array with the modification times as POSIX times
+%        (seconds since 1970-01-01 00:00:00 UTC).
+%      DATENUM: double array with the modification times as serial date
+%        numbers in UTC.
+%      DATE: double matrix with the modification times as date vectors in UTC
+%        (one per row).
+%
 %    MEXSFTP('mkdir', H, PATH) creates a new directory on the server.
 %    Parent directories should exist.
 %
@@ -72,15 +94,53 @@ function varargout = mexsftp(funcname, varargin)
 %    on the server to the local path. Local path is the full name of the target,
 %    and leading directories should exist. Remote path must not be a directory.
 %
+%    DATA = MEXSFTP('getfile', H, RPATH) downloads the file from the remote path
+%    on the server to memory instead, and returns its contents in a column
+%    vector of class uint8. Each response is copied from the read buffer to
+%    the memory of the output array as it arrives (decompressed data is copied
+%    from the codec buffer), and that memory is handed to the output without
+%    a final copy. No local file is written.
+%
+%    DATA = MEXSFTP('getfile', H, RPATH, LPATH) downloads the file to memory
+%    and also writes it to the local path as it is received.
+%
+%    MEXSFTP('getfile', H, RPATH, LPATH, CODEC) and 
+%    DATA = MEXSFTP('getfile', H, RPATH, LPATH, CODEC) decompress the remote 
+%    file while it is received, and write or return the decompressed data.
+%    The local path may be empty when there is an output, to get the data in
+%    memory only. CODEC is a string with the compression format of the remote
+%    file: 'gzip', 'xz' or 'zstd', 'auto' to detect it from the magic bytes at
+%    the beginning of the file (leaving the file unchanged if not compressed),
+%    or 'none' to copy the file unchanged.
+%
 %    MEXSFTP('putfile', H, LPATH, RPATH) uploads a file from the local path to
 %    the remote path on the server. Remote path is the full name of the target
 %    and leading directories should exist. Local path must not be a directory.
 %
+%    MEXSFTP('putfile', H, LPATH, RPATH, CODEC) compresses the local file while
+%    it is sent. CODEC is a string with the compression format: 'gzip', 'xz' or
+%    'zstd', 'auto' to choose it from the extension of the remote path ('.gz',
+%    '.xz' or '.zst', leaving the file unchanged otherwise), or 'none'.
+%
+%    [DATA, OK] = MEXSFTP('peek', H, PATHS, NBYTES) reads the first NBYTES
+%    bytes of each remote file in cell array of strings PATHS, and returns them
+%    in a cell array DATA of the same size, with a row vector of class uint8 
+%    for each file (shorter than NBYTES if the file is shorter). Logical array
+%    OK flags the files successfully read. Files that can not be opened or read
+%    are not an error, their entry in DATA is empty and their flag in OK false.
+%    The reads are pipelined: the read requests of a batch of files are sent
+%    before waiting for any response, so the cost of many small reads is not 
+%    dominated by the round trips.
+%
 %  Notes:
 %    This function provides an interface to perform operations through an SFTP
 %    connection to a remote server using the API provided by the library libssh.
 %    All low level operations are implemented in the companion mex file.
 %
+%    The compression formats are available only if the mex file is built with
+%    the respective libraries (zlib, liblzma and libzstd, see SETUPMEXSFTP).
+%    Using a format not available is an error.
+%
 %    This function is not intended to be called directly by the user,
 %    but to implement methods of the SFTP objects. Use methods of SFTP instead.
 %
@@ -90,6 +150,7 @@ function varargout = mexsftp(funcname, varargin)
 %
 %  See also:
 %    SFTP
+%    SETUPMEXSFTP
 %
 %  Authors:
 %    Joan Pau Beltran  <joanpau.beltran@socib.cat>
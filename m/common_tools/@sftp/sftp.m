@@ -21,7 +21,9 @@ function h = sftp(host, username, password)
 %    CD
 %    DIR
 %    MGET
+%    MREAD
 %    MPUT
+%    PEEK
 %    RENAME
 %    DELETE
 %    MKDIR
@@ -0,0 +1,299 @@
+function [lock, owner] = acquireLock(lock_dir, varargin)
+%ACQUIRELOCK  Acquire an exclusive lock shared by concurrent processing runs.
+%
+%  Syntax:
+%    [LOCK, OWNER] = ACQUIRELOCK(LOCK_DIR)
+%    [LOCK, OWNER] = ACQUIRELOCK(LOCK_DIR, OPTIONS)
+%    [LOCK, OWNER] = ACQUIRELOCK(LOCK_DIR, OPT1, VAL1, ...)
+%
+%  Description:
+%    [LOCK, OWNER] = ACQUIRELOCK(LOCK_DIR) tries to acquire the lock named by
+%    string LOCK_DIR, creating the lock directory with that name. On success,
+%    LOCK is a struct describing the lock (to be used with REFRESHLOCK and
+%    RELEASELOCK), and OWNER is empty. If the lock is held by another process,
+%    LOCK is empty and OWNER is a struct describing the lock holder, and the
+%    holder is requested to process again when it finishes (see below).
+%    LOCK and OWNER structs have the following fields:
+%      DIRNAME: string with the name of the lock directory.
+%      PID: number with the process identifier of the holder.
+%      HOST: string with the name of the host of the holder.
+%      START: serial date number with the local time the lock was acquired.
+%      HEARTBEAT: serial date number with the local time the lock was
+%        refreshed by the holder for the last time.
+%
+%    [LOCK, OWNER] = ACQUIRELOCK(LOCK_DIR, OPTIONS) and
+%    [LOCK, OWNER] = ACQUIRELOCK(LOCK_DIR, OPT1, VAL1, ...) accept the following
+%    options given in key-value pairs OPT1, VAL1... or in a struct OPTIONS with
+%    field names as option keys and field values as option values:
+%      TIMEOUT: stale lock timeout.
+%        Number of seconds after the last heartbeat of the holder for the lock
+%        to be considered stale. A stale lock is broken and acquired again.
+%        Default value: 21600 (6 hours)
+%      PENDING: request to the lock holder to process again.
+%        Boolean setting whether a busy lock should be marked as pending,
+%        meaning that the holder should repeat its work when finished,
+%        because new input is available.
+%        Default value: true
+%
+%  Notes:
+%    The lock is the existence of the lock directory. Directory creation is
+%    atomic in POSIX systems (also in NFS file systems), so only one process
+%    may succeed when several processes try to acquire the lock at once.
+%    The directory contains the file OWNER with the identity of the holder,
+%    and its modification time is the heartbeat of the lock (see REFRESHLOCK).
+%
+%    A lock is stale when its holder died without releasing it. The holder is
+%    considered dead when it runs on the same host and there is no process with
+%    its identifier or the process was started after the lock was acquired
+%    (the identifier has been reused, maybe by the calling process itself),
+%    or when its heartbeat is older than the timeout.
+%
+%    A stale lock is claimed renaming its owner file, which only one process
+%    may do, and it is broken only if the claimed owner is the holder found
+%    dead. Otherwise the lock has been broken and acquired again meanwhile,
+%    and the owner file is restored.
+%
+%    A busy lock is marked as pending creating the file PENDING in the lock
+%    directory. RELEASELOCK returns whether the lock was marked as pending,
+%    so that the holder may process the new input handed off to it.
+%    If the lock is released before the pending mark is written,
+%    the lock is acquired instead.
+%
+%  Examples:
+%    [lock, owner] = acquireLock('glider_data/happyglider/processing.lock')
+%    if ~isempty(lock)
+%      % Do the work...
+%      refreshLock(lock)
+%      % Do more work...
+%      pending = releaseLock(lock)
+%    end
+%
+%  See also:
+%    REFRESHLOCK
+%    RELEASELOCK
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 5);
+
+
+  %% Set options and default values.
+  options.timeout = 21600;
+  options.pending = true;
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:acquireLock:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:acquireLock:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+
+
+  %% Get the identity of this process.
+  ISOCTAVE = exist('OCTAVE_VERSION','builtin');
+  if ISOCTAVE
+    pid = getpid();
+    host = gethostname();
+  else
+    pid = feature('getpid');
+    [~, host] = system('hostname');
+    host = strtrim(host);
+  end
+
+
+  %% Try to acquire the lock, breaking it if it is stale.
+  % The base directory of the lock must exist for MKDIR to be atomic.
+  % A failed claim of a stale lock is retried once.
+  lock = [];
+  owner = [];
+  lock_base = fileparts(lock_dir);
+  if ~isempty(lock_base) && ~exist(lock_base, 'dir')
+    [status, message] = mkdir(lock_base);
+    if ~status
+      error('glider_toolbox:acquireLock:LockDirError', ...
+            'Could not create lock base directory %s: %s.', lock_base, message);
+    end
+  end
+  for attempt = 1:3
+    % MKDIR succeeds with a message when the directory already exists.
+    [status, message] = mkdir(lock_dir);
+    if status && isempty(message)
+      lock = struct('dirname', lock_dir, 'pid', pid, 'host', host, ...
+                    'start', now(), 'heartbeat', now());
+      writeLockFile(fullfile(lock_dir, 'owner'), lock);
+      owner = [];
+      return
+    elseif ~status
+      error('glider_toolbox:acquireLock:LockDirError', ...
+            'Could not create lock directory %s: %s.', lock_dir, message);
+    end
+    % Check whether the holder is dead.
+    % The start times have a resolution of one second, so allow some slack
+    % when checking that the process is older than the lock.
+    owner = readLockOwner(lock_dir);
+    stale = (now() - owner.heartbeat) * 86400 > options.timeout;
+    if ~stale && owner.pid > 0 && strcmp(owner.host, host) && isunix()
+      [alive, started] = readProcessStart(owner.pid);
+      stale = ~alive || (started - owner.start) * 86400 > 5;
+    end
+    if ~stale
+      break
+    end
+    % Claim the stale lock renaming its owner file (or creating it as a
+    % directory if the holder died before writing it), so that only one
+    % process may break it, and the new lock of another process acquired
+    % after the check is not removed.
+    owner_file = fullfile(lock_dir, 'owner');
+    claim_file = fullfile(lock_dir, sprintf('owner.stale.%d', pid));
+    if owner.pid > 0
+      claimed = movefile(owner_file, claim_file);
+      if claimed
+        claim = readLockFile(claim_file);
+        if isempty(claim) || claim.pid ~= owner.pid ...
+            || ~strcmp(claim.host, owner.host) || claim.start ~= owner.start
+          movefile(claim_file, owner_file);
+          continue
+        end
+      end
+    else
+      [claimed, message] = mkdir(owner_file);
+      claimed = claimed && isempty(message);
+    end
+    if ~claimed
+      break
+    end
+    disp(['Breaking stale lock ' lock_dir ...
+          ' (pid ' num2str(owner.pid) ' on ' owner.host ').']);
+    stale_dir = sprintf('%s.stale.%d.%s', lock_dir, pid, ...
+                        datestr(now(), 'yyyymmddTHHMMSS'));
+    if movefile(lock_dir, stale_dir)
+      rmdir(stale_dir, 's');
+    end
+  end
+
+
+  %% Mark the busy lock as pending.
+  % If the pending mark can not be written the lock has just been released,
+  % so try to acquire it instead.
+  if ~isempty(owner) && options.pending
+    if ~writeLockFile(fullfile(lock_dir, 'pending'), ...
+                      struct('pid', pid, 'host', host, 'start', now()))
+      [lock, owner] = acquireLock(lock_dir, 'timeout', options.timeout, ...
+                                  'pending', false);
+    end
+  end
+
+end
+
+
+function success = writeLockFile(filename, info)
+%WRITELOCKFILE  Write process identity to lock file.
+  success = false;
+  fid = fopen(filename, 'w');
+  if fid >= 0
+    fprintf(fid, '%d %s %s\n', info.pid, info.host, ...
+            datestr(info.start, 'yyyy-mm-ddTHH:MM:SS'));
+    success = (fclose(fid) == 0);
+  end
+end
+
+
+function owner = readLockOwner(lock_dir)
+%READLOCKOWNER  Read lock holder identity from lock directory.
+%  If the owner file is not there yet (or anymore), the holder is unknown
+%  and the time of the lock directory is used as heartbeat.
+  owner = struct('dirname', lock_dir, 'pid', 0, 'host', '', ...
+                 'start', NaN, 'heartbeat', now());
+  owner_file = fullfile(lock_dir, 'owner');
+  owner_info = dir(owner_file);
+  if ~isscalar(owner_info)
+    lock_info = dir(lock_dir);
+    lock_info = lock_info(strcmp({lock_info.name}, '.'));
+    if isscalar(lock_info)
+      owner.heartbeat = lock_info.datenum;
+    end
+    return
+  end
+  owner.heartbeat = owner_info.datenum;
+  info = readLockFile(owner_file);
+  if ~isempty(info)
+    owner.pid = info.pid;
+    owner.host = info.host;
+    owner.start = info.start;
+  end
+end
+
+
+function info = readLockFile(filename)
+%READLOCKFILE  Read process identity from lock file (empty if not available).
+  info = [];
+  fid = fopen(filename, 'r');
+  if fid < 0
+    return
+  end
+  values = textscan(fid, '%d %s %s', 1);
+  fclose(fid);
+  if ~isempty(values{1}) && ~isempty(values{2}) && ~isempty(values{3})
+    info = struct('pid', double(values{1}), 'host', values{2}{1}, ...
+                  'start', datenum(values{3}{1}, 'yyyy-mm-ddTHH:MM:SS'));
+  end
+end
+
+
+function [alive, start] = readProcessStart(pid)
+%READPROCESSSTART  Check whether a local process exists and get its start time.
+%  PS is used instead of KILL -0, which also fails for processes of other users.
+%  The elapsed time ([[DD-]HH:]MM:SS) is read instead of the start time
+%  because its format is standard and does not depend on the locale.
+  start = NaN;
+  [status, etime] = system(sprintf('ps -p %d -o etime= 2> /dev/null', pid));
+  alive = (status == 0);
+  if ~alive
+    return
+  end
+  fields = str2double(regexp(strtrim(etime), '[-:]', 'split'));
+  weights = [86400 3600 60 1];
+  if numel(fields) >= 2 && numel(fields) <= 4 && all(isfinite(fields))
+    start = now() - sum(fields .* weights(end-numel(fields)+1:end)) / 86400;
+  end
+end
@@ -46,6 +46,22 @@ function files = getfiles(connection, varargin)
 %       If not given, the test is based on the modification time, and only
 %       files on the server newer than respective local files are downloaded.
 %      Default value: [] (overwrite all exisiting files)
+%     HEADER: filter files on the server by their contents.
+%       Name or handle of the predicate function the beginning of the files
+%       selected by the other filters must satisfy to be included in the
+%       download. The function receives a single input with the first bytes of
+%       the remote file (a vector of class uint8, see option HEADER_BYTES),
+%       and returns one logical output whether to download respective file.
+%       The bytes of all candidate files are read in a single pipelined 
+%       operation before any download, so files not satisfying the predicate
+%       are never transferred. Files that can not be read are not downloaded.
+%       This filter requires a connection supporting the PEEK method (SFTP).
+%       If not given, files are not filtered by their contents.
+%       Default value: [] (do not filter files by contents)
+%     HEADER_BYTES: number of bytes to read for the HEADER filter.
+%       Positive integer with the number of bytes at the beginning of each file
+%       passed to the HEADER filter.
+%       Default value: 4096
 %
 %  Examples:
 %    connection = ftp('ftp://myserver.org')
@@ -59,10 +75,19 @@ function files = getfiles(connection, varargin)
 %      'target', 'funnymission/binary', ...
 %      'include', '^.*\.[smdtne]bd$', ...
 %      'update', @(l,r)(l.datenum < r.datenum) );
+%    % Download only the binary files of a given mission, checking the mission
+%    % name in the header of remote files through an SFTP connection.
+%    files = getfiles( ...
+%      sftp('myserver.org'), ...
+%      'source', '/var/opt/gmc/gliders/happyglider/from-glider', ...
+%      'include', '^.*\.[smdtne]bd$', ...
+%      'header', @(b)(strcmp(getfield(xbdheader(b), 'mission_name'), ...
+%                            'FUNNY.MI')) );
 %
 %  See also:
 %    FTP
 %    SFTP
+%    PEEK
 %
 %  Authors:
 %    Joan Pau Beltran  <joanpau.beltran@socib.cat>
@@ -84,7 +109,7 @@ function files = getfiles(connection, varargin)
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-  narginchk(1, 13);
+  narginchk(1, 17);
   
   
   %% Set options and default values.
@@ -94,6 +119,8 @@ function files = getfiles(connection, varargin)
   options.exclude = [];
   options.new = [];
   options.update = [];
+  options.header = [];
+  options.header_bytes = 4096;
 
 
   %% Parse optional arguments.
@@ -162,6 +189,14 @@ function files = getfiles(connection, varargin)
       updatefunc = str2func(udpatefunc);
     end
   end
+  header_all = true;
+  if ~isequal([], options.header)
+    header_all = false;
+    headerfunc = options.header;
+    if ischar(headerfunc)
+      headerfunc = str2func(headerfunc);
+    end
+  end
   
   
   %% List remote files and fetch the required ones.
@@ -195,6 +230,12 @@ function files = getfiles(connection, varargin)
                                        latts(lindex(select & lexist)), ...
                                        ratts(select & lexist));
   end
+  if ~header_all
+    select(select) = ~[ratts(select).isdir];
+    [headers, peeked] = peek(connection, {ratts(select).name}, ...
+                             options.header_bytes);
+    select(select) = peeked(:) & cellfun(@(b)(headerfunc(b)), headers(:));
+  end
   if (totarget)
     getfunc = @(name)(mget(connection, name, target));
   else
@@ -0,0 +1,442 @@
+function [files, contents] = getmirrorfiles(servers, varargin)
+%GETMIRRORFILES  Fetch new and updated files from a remote directory mirrored on several servers.
+%
+%  Syntax:
+%    FILES = GETMIRRORFILES(SERVERS, OPTIONS)
+%    FILES = GETMIRRORFILES(SERVERS, OPT1, VAL1, ...)
+%    [FILES, CONTENTS] = GETMIRRORFILES(...)
+%
+%  Description:
+%    FILES = GETMIRRORFILES(SERVERS, OPTIONS) and
+%    FILES = GETMIRRORFILES(SERVERS, OPT1, VAL1, ...) retrieve files from a
+%    directory available on one or more remote servers given in struct array
+%    SERVERS, fetching each file only once even if it is present on several
+%    servers, according to the options given in key-value pairs OPT1, VAL1...
+%    or in a scalar struct OPTIONS with field names as option keys and field
+%    values as option values. Each element of SERVERS has the fields needed
+%    to connect to the server through functions FTP or SFTP:
+%      HOST: url as either fully qualified name or IP with optional port.
+%      USER: user to access the server if needed (string).
+%      PASS: password of the server if needed (string).
+%      CONN: name or handle of connection type function, @FTP (default) or @SFTP.
+%    Recognized options are the same as in function GETFILES:
+%      SOURCE: remote source directory.
+%        String with the name of the remote directory to download the files
+%        from, the same on all servers.
+%        Default value: [] (use remote current working directory)
+%      TARGET: local target directory.
+%        String with the name of the local directory to download the files to.
+%        Default value: [] (use local current working directory)
+%      INCLUDE: name pattern of files to include in the download.
+%        Default value: [] (download all files in source directory)
+%      EXCLUDE: name pattern of files to exclude from the download.
+%        Default value: [] (do not exclude any file)
+%      NEW: filter new files on the remote servers.
+%        Default value: [] (download all new files)
+%      UPDATE: filter files on the servers already existing at the local side.
+%        Default value: [] (update files newer on the server)
+%      HEADER: filter files on the servers by their contents.
+%        It requires that the servers support the PEEK method (SFTP).
+%        Default value: [] (do not filter files by contents)
+%      HEADER_BYTES: number of bytes to read for the HEADER filter.
+%        Default value: 4096
+%    See GETFILES for a detailed description of each option. In addition:
+%      CONTENTS: download the files to memory too.
+%        Boolean setting whether the files fetched from servers supporting the
+%        MREAD method (SFTP) should also be returned in memory. Each file is
+%        received once, and it is written to the target directory as it is
+%        received, so the local copy is still made.
+%        Default value: false
+%    FILES is a row cell array of strings with the names of the fetched files,
+%    as returned by GETFILES.
+%
+%    [FILES, CONTENTS] = GETMIRRORFILES(...) also returns a row cell array
+%    CONTENTS with the same size as FILES, with the contents of each fetched
+%    file as a column vector of class uint8 when option CONTENTS is true and
+%    the file was fetched through SFTP, or empty otherwise.
+%
+%  Notes:
+%    The retrieval is done in three steps:
+%      - The source directory is listed on all servers concurrently,
+%        measuring the response time of each server. Servers that can not be
+%        listed are reported with a warning and ignored.
+%      - The listings are merged by file name, size and modification time.
+%        When the copies of a file differ between servers, the largest one is
+%        chosen (and the newest one among the largest ones). The filters are
+%        applied to the merged listing as in GETFILES.
+%      - Each selected file is assigned to one of the servers that have it,
+%        balancing the amount of bytes to transfer from each server weighted
+%        by its response time, and the files are fetched from all the servers
+%        concurrently. Files that could not be fetched from the assigned server
+%        are retried on the other servers that have them.
+%
+%    The concurrent steps are PARFOR loops over the servers, with a connection
+%    to each server opened in the loop. They run in parallel when a parallel
+%    pool is available, and sequentially otherwise.
+%
+%  Examples:
+%    servers(1).host = 'dockserver01.myportal.org';
+%    servers(2).host = 'dockserver02.myportal.org';
+%    servers(2).conn = @sftp;
+%    files = getmirrorfiles( ...
+%      servers, ...
+%      'source', '/var/opt/gmc/gliders/happyglider/from-glider', ...
+%      'target', 'funnymission/binary', ...
+%      'include', '^.*\.[smdtne]bd$', ...
+%      'update', @(l,r)(l.bytes < r.bytes) );
+%
+%  See also:
+%    GETFILES
+%    FTP
+%    SFTP
+%    PARFOR
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2014-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 19);
+
+
+  %% Set options and default values.
+  options.source = [];
+  options.target = [];
+  options.include = [];
+  options.exclude = [];
+  options.new = [];
+  options.update = [];
+  options.header = [];
+  options.header_bytes = 4096;
+  options.contents = false;
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:getmirrorfiles:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:getmirrorfiles:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+
+
+  %% Parse options to more practical values.
+  % The target is made absolute because the fetching may happen in workers
+  % with a different current directory.
+  source = options.source;
+  target = options.target;
+  if isequal([], target)
+    target = pwd();
+  end
+  [status, attrout] = fileattrib(target);
+  if ~status
+    [success, message] = mkdir(target);
+    if ~success
+      error('glider_toolbox:getmirrorfiles:DirectoryError', ...
+            'Could not create directory %s: %s.', target, message);
+    end
+    [~, attrout] = fileattrib(target);
+  end
+  target = attrout.Name;
+  newfunc = options.new;
+  if ischar(newfunc)
+    newfunc = str2func(newfunc);
+  end
+  updatefunc = options.update;
+  if ischar(updatefunc)
+    updatefunc = str2func(updatefunc);
+  end
+  headerfunc = options.header;
+  if ischar(headerfunc)
+    headerfunc = str2func(headerfunc);
+  end
+  header_bytes = options.header_bytes;
+  get_contents = options.contents;
+
+
+  %% List the source directory on all servers concurrently.
+  num_servers = numel(servers);
+  server_atts = cell(num_servers, 1);
+  server_time = inf(num_servers, 1);
+  server_error = cell(num_servers, 1);
+  parfor server_idx = 1:num_servers
+    [server_atts{server_idx}, server_time(server_idx), server_error{server_idx}] = ...
+      listServer(servers(server_idx), source);
+  end
+  server_listed = cellfun(@isempty, server_error);
+  for server_idx = find(~server_listed(:)')
+    warning('glider_toolbox:getmirrorfiles:ListError', ...
+            'Error listing files on %s: %s', ...
+            servers(server_idx).host, server_error{server_idx});
+  end
+  if ~any(server_listed)
+    error('glider_toolbox:getmirrorfiles:ListError', ...
+          'Could not list files on any server.');
+  end
+
+
+  %% Merge the listings by name, size and modification time.
+  % Each distinct copy of a file is identified by its key, and the servers
+  % holding it are recorded in a servers x copies logical matrix.
+  % Only the largest and newest copy of each name is kept.
+  atts_server = cell(num_servers, 1);
+  for server_idx = 1:num_servers
+    atts_server{server_idx} = ...
+      repmat(server_idx, numel(server_atts{server_idx}), 1);
+  end
+  atts_server = vertcat(atts_server{:});
+  ratts = vertcat(server_atts{:});
+  atts_isfile = ~[ratts.isdir]';
+  ratts = ratts(atts_isfile);
+  atts_server = atts_server(atts_isfile);
+  rnames = {ratts.name}';
+  rbytes = [ratts.bytes]';
+  rdatenums = [ratts.datenum]';
+  rkeys = strcat(rnames, {char(9)}, cellstr(num2str(rbytes, '%d')), ...
+                 {char(9)}, cellstr(num2str(rdatenums, '%.6f')));
+  [~, copy_first, copy_index] = unique(rkeys);
+  copy_holders = accumarray([atts_server copy_index], true, ...
+                            [num_servers numel(copy_first)]);
+  ratts = ratts(copy_first);
+  [~, copy_order] = sortrows([-[ratts.bytes]' -[ratts.datenum]']);
+  [~, name_first] = unique({ratts(copy_order).name}', 'first');
+  copy_select = copy_order(name_first);
+  ratts = ratts(copy_select);
+  copy_holders = copy_holders(:, copy_select);
+
+
+  %% Apply the filters as GETFILES does.
+  latts = dir(target);
+  select = true(size(ratts));
+  lexist = false(size(ratts));
+  lindex = zeros(size(ratts));
+  [lexist(:), lindex(:)] = ismember({ratts.name}', {latts.name}');
+  if ~isequal([], options.include)
+    select(select) = ...
+      ~cellfun(@isempty, regexp({ratts(select).name}, options.include, 'match'));
+  end
+  if ~isequal([], options.exclude)
+    select(select) = ...
+      cellfun(@isempty, regexp({ratts(select).name}, options.exclude, 'match'));
+  end
+  if ~isequal([], newfunc)
+    select(select & ~lexist) = arrayfun(newfunc, ratts(select & ~lexist));
+  end
+  if ~isequal([], updatefunc)
+    select(select & lexist) = arrayfun(updatefunc, ...
+                                       latts(lindex(select & lexist)), ...
+                                       ratts(select & lexist));
+  end
+  ratts = ratts(select);
+  copy_holders = copy_holders(:, select);
+
+
+  %% Assign each file to a server balancing the weighted bytes to transfer.
+  % Larger files are assigned first, to the server with the least cost among
+  % the ones holding the file, where the cost is the amount of bytes already
+  % assigned to the server plus the file size, weighted by the response time.
+  num_files = numel(ratts);
+  file_server = zeros(num_files, 1);
+  server_bytes = zeros(num_servers, 1);
+  [~, file_order] = sort([ratts.bytes]', 'descend');
+  for file_idx = file_order(:)'
+    holders = find(copy_holders(:, file_idx));
+    holders_cost = server_time(holders) ...
+                 .* (server_bytes(holders) + ratts(file_idx).bytes + 1);
+    [~, best] = min(holders_cost);
+    file_server(file_idx) = holders(best);
+    server_bytes(holders(best)) = ...
+      server_bytes(holders(best)) + ratts(file_idx).bytes;
+  end
+
+
+  %% Fetch the files from all servers concurrently.
+  file_names = {ratts.name}';
+  server_names = cell(num_servers, 1);
+  for server_idx = 1:num_servers
+    server_names{server_idx} = file_names(file_server == server_idx);
+  end
+  server_fetched = cell(num_servers, 1);
+  server_contents = cell(num_servers, 1);
+  server_failed = cell(num_servers, 1);
+  parfor server_idx = 1:num_servers
+    [server_fetched{server_idx}, server_failed{server_idx}, ...
+     server_error{server_idx}, server_contents{server_idx}] = ...
+      fetchServer(servers(server_idx), source, target, ...
+                  server_names{server_idx}, headerfunc, header_bytes, ...
+                  get_contents);
+  end
+  files = vertcat(cell(0, 1), server_fetched{:});
+  contents = vertcat(cell(0, 1), server_contents{:});
+
+
+  %% Retry the failed files on the other servers holding them.
+  for server_idx = 1:num_servers
+    if ~isempty(server_error{server_idx})
+      warning('glider_toolbox:getmirrorfiles:DownloadError', ...
+              'Error fetching files from %s: %s', ...
+              servers(server_idx).host, server_error{server_idx});
+    end
+  end
+  failed_names = vertcat(cell(0, 1), server_failed{:});
+  [~, failed_index] = ismember(failed_names, file_names);
+  for failed_idx = failed_index(:)'
+    holders = find(copy_holders(:, failed_idx));
+    holders = holders(holders ~= file_server(failed_idx));
+    [~, holders_order] = sort(server_time(holders));
+    for holder = holders(holders_order)'
+      [fetched, failed, ~, fetched_contents] = ...
+        fetchServer(servers(holder), source, target, ...
+                    file_names(failed_idx), headerfunc, header_bytes, ...
+                    get_contents);
+      files = [files; fetched]; %#ok<AGROW>
+      contents = [contents; fetched_contents]; %#ok<AGROW>
+      if isempty(failed)
+        break;
+      end
+    end
+  end
+  files = reshape(files, 1, []);
+  contents = reshape(contents, 1, []);
+
+end
+
+
+function [atts, elapsed, message] = listServer(server, source)
+%LISTSERVER  List the files in a directory on a server measuring its response time.
+  atts = [];
+  elapsed = inf;
+  message = '';
+  try
+    start = tic();
+    handle = connectServer(server);
+    try
+      if isequal([], source)
+        atts = dir(handle);
+      else
+        atts = dir(handle, source);
+      end
+      elapsed = toc(start);
+    catch exception
+      message = exception.message;
+    end
+    close(handle);
+  catch exception
+    message = exception.message;
+  end
+  if isempty(atts)
+    atts = struct('name', {}, 'date', {}, 'bytes', {}, ...
+                  'isdir', {}, 'datenum', {});
+  end
+  atts = orderfields(atts(:));
+end
+
+
+function [fetched, failed, message, contents] = fetchServer(server, source, target, ...
+                                                            names, headerfunc, header_bytes, ...
+                                                            get_contents)
+%FETCHSERVER  Fetch a list of files from a directory on a server.
+%  When requested and supported by the connection, the files are fetched to
+%  memory and to the target directory at once with MREAD.
+  fetched = cell(0, 1);
+  contents = cell(0, 1);
+  failed = names(:);
+  message = '';
+  if isempty(names)
+    return
+  end
+  try
+    handle = connectServer(server);
+  catch exception
+    message = exception.message;
+    return
+  end
+  try
+    if ~isequal([], source)
+      cd(handle, source);
+    end
+    if ~isequal([], headerfunc)
+      [headers, peeked] = peek(handle, failed, header_bytes);
+      failed = failed(peeked(:) & cellfun(@(b)(headerfunc(b)), headers(:)));
+    end
+    fetched_select = false(size(failed));
+    mread_avail = get_contents && isa(handle, 'sftp');
+    for name_idx = 1:numel(failed)
+      try
+        if mread_avail
+          fetched_name = fullfile(target, failed{name_idx});
+          fetched_data = mread(handle, failed{name_idx}, fetched_name);
+          fetched = [fetched; {fetched_name}]; %#ok<AGROW>
+          contents = [contents; {fetched_data}]; %#ok<AGROW>
+        else
+          fetched_name = mget(handle, failed{name_idx}, target);
+          fetched = [fetched; fetched_name]; %#ok<AGROW>
+          contents = [contents; cell(size(fetched_name))]; %#ok<AGROW>
+        end
+        fetched_select(name_idx) = true;
+      catch exception
+        message = exception.message;
+      end
+    end
+    failed = failed(~fetched_select);
+  catch exception
+    message = exception.message;
+  end
+  close(handle);
+end
+
+
+function handle = connectServer(server)
+%CONNECTSERVER  Open an (S)FTP connection to a server.
+  user = [];
+  pass = [];
+  conn = @ftp;
+  if isfield(server, 'user') && ~isequal(server.user, [])
+    user = server.user;
+  end
+  if isfield(server, 'pass') && ~isequal(server.pass, [])
+    pass = server.pass;
+  end
+  if isfield(server, 'conn') && ~isequal(server.conn, [])
+    conn = server.conn;
+    if ischar(conn)
+      conn = str2func(conn);
+    end
+  end
+  handle = conn(server.host, user, pass);
+end
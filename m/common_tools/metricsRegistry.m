@@ -0,0 +1,56 @@
+function registry = metricsRegistry()
+%METRICSREGISTRY  Registry of the processing metrics recorded in the session.
+%
+%  Syntax:
+%    REGISTRY = METRICSREGISTRY()
+%
+%  Description:
+%    REGISTRY = METRICSREGISTRY() returns the containers.Map holding the
+%    metrics recorded by RECORDMETRIC. Keys are strings identifying each time
+%    series (metric name and label values), and values are structs with the
+%    type, name, labels and current values of the time series.
+%
+%  Notes:
+%    The registry is created on the first call and kept in a persistent
+%    variable. Since containers.Map is a handle class, all the callers share
+%    the same registry and changes made by any of them are seen by the rest.
+%    Use CLEAR METRICSREGISTRY or the RESET option of WRITEMETRICS to start
+%    from an empty registry.
+%
+%  Examples:
+%    registry = metricsRegistry()
+%    keys(registry)
+%
+%  See also:
+%    RECORDMETRIC
+%    WRITEMETRICS
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(0, 0);
+
+  persistent metrics;
+  if isempty(metrics)
+    metrics = containers.Map('KeyType', 'char', 'ValueType', 'any');
+  end
+  registry = metrics;
+
+end
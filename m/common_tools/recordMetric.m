@@ -0,0 +1,115 @@
+function recordMetric(type, name, value, labels)
+%RECORDMETRIC  Record a value of a processing metric.
+%
+%  Syntax:
+%    RECORDMETRIC(TYPE, NAME, VALUE)
+%    RECORDMETRIC(TYPE, NAME, VALUE, LABELS)
+%
+%  Description:
+%    RECORDMETRIC(TYPE, NAME, VALUE) records the number VALUE for the metric
+%    named by string NAME in the metrics registry of the session, to be
+%    exported later by WRITEMETRICS. String TYPE is the kind of metric:
+%      'counter': VALUE is added to the current value of the metric
+%        (e.g. number of files or bytes downloaded).
+%      'gauge': VALUE replaces the current value of the metric
+%        (e.g. time of the last successful run).
+%      'histogram': VALUE is an observation counted in the bucket of the
+%        metric it belongs to (e.g. processing stage duration in seconds).
+%        Observations are counted in buckets with the following upper bounds:
+%        0.1, 0.5, 1, 5, 10, 30, 60, 120, 300, 600, 1800 and 3600 (and Inf).
+%
+%    RECORDMETRIC(TYPE, NAME, VALUE, LABELS) records the value for the metric
+%    with the labels in struct LABELS, whose field names are the label names
+%    and field values are strings with the label values. Each different
+%    combination of label values is a different time series of the metric.
+%
+%  Notes:
+%    Metric and label names should follow the Prometheus conventions:
+%    lower case words separated by underscores, with the unit as suffix,
+%    and counters ending in '_total'.
+%
+%    The registry is a containers.Map returned by METRICSREGISTRY, shared by
+%    all the functions in the session and kept across calls. Recorded time
+%    series are flagged as updated until WRITEMETRICS appends them to the
+%    JSON lines file.
+%
+%  Examples:
+%    labels = struct('deployment', 'happyglider_mission_1')
+%    recordMetric('counter', 'glider_toolbox_files_downloaded_total', 12, labels)
+%    stage_start = tic();
+%    % Some processing...
+%    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+%                 toc(stage_start), setfield(labels, 'stage', 'processing'))
+%
+%  See also:
+%    WRITEMETRICS
+%    METRICSREGISTRY
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(3, 4);
+
+  if nargin < 4
+    labels = struct();
+  end
+
+  histogram_buckets = [0.1 0.5 1 5 10 30 60 120 300 600 1800 3600 Inf];
+
+  %% Build the time series key from the metric name and the label values.
+  label_names = fieldnames(labels);
+  label_values = struct2cell(labels);
+  label_pairs = [label_names(:)'; label_values(:)'];
+  key = [name sprintf('\n%s=%s', label_pairs{:})];
+
+  %% Update the time series.
+  registry = metricsRegistry();
+  if isKey(registry, key)
+    metric = registry(key);
+    if ~strcmp(metric.type, type)
+      error('glider_toolbox:recordMetric:TypeMismatch', ...
+            'Metric %s is a %s, not a %s.', name, metric.type, type);
+    end
+  else
+    metric = struct('type', type, 'name', name, 'labels', labels, ...
+                    'value', 0, 'count', 0, 'sum', 0, ...
+                    'buckets', [], 'bucket_counts', [], 'updated', true);
+    if strcmp(type, 'histogram')
+      metric.buckets = histogram_buckets;
+      metric.bucket_counts = zeros(size(histogram_buckets));
+    end
+  end
+  switch type
+    case 'counter'
+      metric.value = metric.value + value;
+    case 'gauge'
+      metric.value = value;
+    case 'histogram'
+      metric.count = metric.count + 1;
+      metric.sum = metric.sum + value;
+      metric.bucket_counts = metric.bucket_counts + (value <= metric.buckets);
+    otherwise
+      error('glider_toolbox:recordMetric:InvalidType', ...
+            'Invalid metric type: %s.', type);
+  end
+  metric.updated = true;
+  registry(key) = metric; %#ok<NASGU>
+
+end
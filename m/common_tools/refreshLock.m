@@ -0,0 +1,58 @@
+function lock = refreshLock(lock)
+%REFRESHLOCK  Update the heartbeat of a lock held by the current process.
+%
+%  Syntax:
+%    LOCK = REFRESHLOCK(LOCK)
+%
+%  Description:
+%    LOCK = REFRESHLOCK(LOCK) updates the heartbeat of the lock described by
+%    struct LOCK returned by ACQUIRELOCK, touching the owner file in the lock
+%    directory, and returns the struct with the updated heartbeat time.
+%    Long running holders should refresh the lock from time to time,
+%    to prevent other processes from considering it stale.
+%
+%  Examples:
+%    lock = acquireLock('glider_data/happyglider/processing.lock')
+%    lock = refreshLock(lock)
+%
+%  See also:
+%    ACQUIRELOCK
+%    RELEASELOCK
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 1);
+
+  if isempty(lock)
+    return
+  end
+  owner_file = fullfile(lock.dirname, 'owner');
+  fid = fopen(owner_file, 'w');
+  if fid < 0
+    disp(['Error refreshing lock ' lock.dirname '.']);
+    return
+  end
+  fprintf(fid, '%d %s %s\n', lock.pid, lock.host, ...
+          datestr(lock.start, 'yyyy-mm-ddTHH:MM:SS'));
+  fclose(fid);
+  lock.heartbeat = now();
+
+end
@@ -0,0 +1,67 @@
+function pending = releaseLock(lock)
+%RELEASELOCK  Release a lock held by the current process.
+%
+%  Syntax:
+%    PENDING = RELEASELOCK(LOCK)
+%
+%  Description:
+%    PENDING = RELEASELOCK(LOCK) releases the lock described by struct LOCK
+%    returned by ACQUIRELOCK, removing the lock directory, and returns whether
+%    other processes marked the lock as pending while it was held, meaning
+%    that new input is available and the work should be repeated.
+%
+%  Notes:
+%    The lock directory is renamed before checking the pending mark and
+%    removing it. Processes trying to mark the lock as pending after that
+%    fail to do so, and acquire the lock instead. This way pending requests
+%    are never lost.
+%
+%  Examples:
+%    lock = acquireLock('glider_data/happyglider/processing.lock')
+%    pending = releaseLock(lock)
+%
+%  See also:
+%    ACQUIRELOCK
+%    REFRESHLOCK
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 1);
+
+  pending = false;
+  if isempty(lock)
+    return
+  end
+  released_dir = sprintf('%s.released.%d', lock.dirname, lock.pid);
+  [success, message] = movefile(lock.dirname, released_dir);
+  if ~success
+    disp(['Error releasing lock ' lock.dirname ':']);
+    disp(message);
+    return
+  end
+  pending = logical(exist(fullfile(released_dir, 'pending'), 'file'));
+  [success, message] = rmdir(released_dir, 's');
+  if ~success
+    disp(['Error removing released lock ' released_dir ':']);
+    disp(message);
+  end
+
+end
@@ -0,0 +1,258 @@
+function writeMetrics(prom_file, json_file, varargin)
+%WRITEMETRICS  Export processing metrics to Prometheus and JSON lines files.
+%
+%  Syntax:
+%    WRITEMETRICS(PROM_FILE, JSON_FILE)
+%    WRITEMETRICS(PROM_FILE, JSON_FILE, OPTIONS)
+%    WRITEMETRICS(PROM_FILE, JSON_FILE, OPT1, VAL1, ...)
+%
+%  Description:
+%    WRITEMETRICS(PROM_FILE, JSON_FILE) writes the metrics recorded by
+%    RECORDMETRIC in the session registry to the files named by strings
+%    PROM_FILE and JSON_FILE. Any of them may be empty to skip that output.
+%      PROM_FILE is overwritten with the current value of all the metrics in
+%        the Prometheus text exposition format, to be exported by the textfile
+%        collector of the Prometheus node exporter. The file is written to a
+%        temporary file first and then renamed, so that the collector never
+%        reads an incomplete file.
+%      JSON_FILE is appended one line per time series recorded since the
+%        previous export to that file, with a JSON object with the fields TIME
+%        (UTC time stamp of the export), METRIC, TYPE, LABELS and VALUE
+%        (counters and gauges) or COUNT, SUM, BUCKETS and BUCKET_COUNTS
+%        (histograms). BUCKETS are the finite upper bounds of the buckets and
+%        BUCKET_COUNTS the cumulative counts of observations, with an extra
+%        last count for the infinite bound (equal to COUNT). Values are the
+%        current totals of the series, as in the Prometheus file. Non-finite
+%        values (NaN and infinities) are written as null.
+%
+%    WRITEMETRICS(PROM_FILE, JSON_FILE, OPTIONS) and
+%    WRITEMETRICS(PROM_FILE, JSON_FILE, OPT1, VAL1, ...) accept the following
+%    options given in key-value pairs OPT1, VAL1... or in a struct OPTIONS with
+%    field names as option keys and field values as option values:
+%      RESET: clear the registry after writing.
+%        Boolean setting whether the metrics should be removed from the
+%        registry after writing them, to start the next run from scratch.
+%        Default value: false
+%
+%  Examples:
+%    recordMetric('counter', 'glider_toolbox_files_downloaded_total', 12)
+%    writeMetrics('/var/lib/node_exporter/glider_toolbox.prom', ...
+%                 'glider_data/metrics.jsonl')
+%
+%  See also:
+%    RECORDMETRIC
+%    METRICSREGISTRY
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(2, 4);
+
+
+  %% Set options and default values.
+  options.reset = false;
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:writeMetrics:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:writeMetrics:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+
+
+  %% Get the metrics sorted by name, so that series of a metric are together.
+  registry = metricsRegistry();
+  metric_keys = keys(registry);
+  metric_list = values(registry, metric_keys);
+  metric_list = [metric_list{:}];
+  if isempty(metric_list)
+    return
+  end
+  [~, metric_order] = sort({metric_list.name});
+  metric_keys = metric_keys(metric_order);
+  metric_list = metric_list(metric_order);
+
+
+  %% Write the Prometheus text file.
+  if ~isempty(prom_file)
+    prom_temp = [prom_file '.tmp'];
+    [fid, message] = fopen(prom_temp, 'w');
+    if fid < 0
+      error('glider_toolbox:writeMetrics:FileError', ...
+            'Could not open file %s: %s.', prom_temp, message);
+    end
+    last_name = '';
+    for metric_idx = 1:numel(metric_list)
+      metric = metric_list(metric_idx);
+      if ~strcmp(metric.name, last_name)
+        fprintf(fid, '# TYPE %s %s\n', metric.name, metric.type);
+        last_name = metric.name;
+      end
+      labels = formatPromLabels(metric.labels);
+      if strcmp(metric.type, 'histogram')
+        for bucket_idx = 1:numel(metric.buckets)
+          fprintf(fid, '%s_bucket{%s%sle="%s"} %d\n', ...
+                  metric.name, labels, repmat(',', ~isempty(labels)), ...
+                  formatPromNumber(metric.buckets(bucket_idx)), ...
+                  metric.bucket_counts(bucket_idx));
+        end
+        fprintf(fid, '%s_sum%s %s\n', metric.name, ...
+                formatPromBraces(labels), formatPromNumber(metric.sum));
+        fprintf(fid, '%s_count%s %d\n', metric.name, ...
+                formatPromBraces(labels), metric.count);
+      else
+        fprintf(fid, '%s%s %s\n', metric.name, ...
+                formatPromBraces(labels), formatPromNumber(metric.value));
+      end
+    end
+    fclose(fid);
+    [success, message] = movefile(prom_temp, prom_file, 'f');
+    if ~success
+      error('glider_toolbox:writeMetrics:FileError', ...
+            'Could not rename file %s to %s: %s.', prom_temp, prom_file, message);
+    end
+  end
+
+
+  %% Append the JSON lines of the time series updated since the last export.
+  json_select = [metric_list.updated];
+  if ~isempty(json_file) && any(json_select)
+    [fid, message] = fopen(json_file, 'a');
+    if fid < 0
+      error('glider_toolbox:writeMetrics:FileError', ...
+            'Could not open file %s: %s.', json_file, message);
+    end
+    time = datestr(posixtime2utc(posixtime()), 'yyyy-mm-ddTHH:MM:SSZ');
+    for metric_idx = find(json_select)
+      metric = metric_list(metric_idx);
+      label_names = fieldnames(metric.labels);
+      label_values = struct2cell(metric.labels);
+      label_pairs = [cellfun(@formatJSONString, label_names(:)', 'UniformOutput', false);
+                     cellfun(@formatJSONString, label_values(:)', 'UniformOutput', false)];
+      labels = sprintf('%s:%s,', label_pairs{:});
+      fprintf(fid, '{"time":"%s","metric":%s,"type":"%s","labels":{%s}', ...
+              time, formatJSONString(metric.name), metric.type, labels(1:end-1));
+      if strcmp(metric.type, 'histogram')
+        buckets = arrayfun(@formatJSONNumber, metric.buckets(1:end-1), ...
+                           'UniformOutput', false);
+        buckets = sprintf('%s,', buckets{:});
+        counts = sprintf('%d,', metric.bucket_counts);
+        fprintf(fid, ',"count":%d,"sum":%s,"buckets":[%s],"bucket_counts":[%s]}\n', ...
+                metric.count, formatJSONNumber(metric.sum), ...
+                buckets(1:end-1), counts(1:end-1));
+      else
+        fprintf(fid, ',"value":%s}\n', formatJSONNumber(metric.value));
+      end
+    end
+    if fclose(fid) ~= 0
+      error('glider_toolbox:writeMetrics:FileError', ...
+            'Could not close file %s.', json_file);
+    end
+    % Flag the exported series, so that the next export does not repeat them.
+    for metric_idx = find(json_select)
+      metric = metric_list(metric_idx);
+      metric.updated = false;
+      registry(metric_keys{metric_idx}) = metric;
+    end
+  end
+
+
+  %% Clear the registry if requested.
+  if options.reset
+    remove(registry, keys(registry));
+  end
+
+end
+
+
+function str = formatPromLabels(labels)
+%FORMATPROMLABELS  Format label struct as Prometheus label list (no braces).
+  label_names = fieldnames(labels);
+  label_values = struct2cell(labels);
+  label_values = strrep(strrep(strrep(label_values, ...
+                   '\', '\\'), '"', '\"'), sprintf('\n'), '\n');
+  label_pairs = [label_names(:)'; label_values(:)'];
+  str = sprintf('%s="%s",', label_pairs{:});
+  str = str(1:end-1);
+end
+
+
+function str = formatPromBraces(labels)
+%FORMATPROMBRACES  Enclose formatted label list in braces, if not empty.
+  if isempty(labels)
+    str = '';
+  else
+    str = ['{' labels '}'];
+  end
+end
+
+
+function str = formatPromNumber(value)
+%FORMATPROMNUMBER  Format number for Prometheus, including infinities.
+  if isinf(value)
+    str = [repmat('-', value < 0) '+Inf'];
+    str = strrep(str, '-+', '-');
+  else
+    str = sprintf('%.15g', value);
+  end
+end
+
+
+function str = formatJSONNumber(value)
+%FORMATJSONNUMBER  Format number for JSON, with non-finite values as null.
+  if isfinite(value)
+    str = sprintf('%.15g', value);
+  else
+    str = 'null';
+  end
+end
+
+
+function str = formatJSONString(value)
+%FORMATJSONSTRING  Quote and escape string for JSON, including control chars.
+  str = strrep(strrep(value, '\', '\\'), '"', '\"');
+  control_pos = find(str < 32);
+  for pos = control_pos(end:-1:1)
+    str = [str(1:pos-1) sprintf('\\u%04x', double(str(pos))) str(pos+1:end)];
+  end
+  str = ['"' str '"'];
+end
@@ -78,4 +78,9 @@ function gridding_options = configDataGridding()
     'methane_concentration'
   };
 
+  % Casts may be gridded in windows whose readings fit in a memory budget
+  % (in bytes), e.g. 512 MiB:
+  % gridding_options.chunk_memory = 512 * 2^20;
+  gridding_options.chunk_memory = inf;
+
 end
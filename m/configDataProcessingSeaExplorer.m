@@ -77,4 +77,14 @@ function processing_options = configDataProcessingSeaExplorer()
   processing_options.density_list(1).temperature = 'temperature';
   processing_options.density_list(1).pressure    = 'pressure';
 
+  % Optical payload sequences may be kept in single precision, e.g.:
+  % processing_options.single_precision_list = {'chlorophyll' 'cdom' 'backscatter_700'};
+  processing_options.single_precision_list = {};
+
+  % Long missions may be processed in windows of whole profiles whose
+  % temporaries fit in a memory budget (in bytes), e.g. 2 GiB:
+  % processing_options.chunk_memory = 2 * 2^30;
+  processing_options.chunk_memory = inf;
+  processing_options.chunk_overlap = 1;
+
 end
@@ -9,9 +9,20 @@ function [glider_toolbox_dir] = configGliderToolboxPath()
 %    containing this function and all its subdirectories to the workspace
 %    path and returns the full directory path.
 %
+%    In a standalone executable built with SETUPSTANDALONE the functions are
+%    already in the archive of the executable and the path can not be changed.
+%    The directory is taken from the environment variable GLIDER_TOOLBOX_DIR,
+%    or the current directory if not set, so that the configuration files and
+%    external programs of an installed copy of the toolbox are used. The
+%    preferences set by the startup file in interactive sessions are set here.
+%
 %  Examples:
 %    glider_toolbox_dir = configGliderToolboxPath()
 %
+%  See also:
+%    SETUPSTANDALONE
+%    ISDEPLOYED
+%
 %  Authors:
 %    Joan Pau Beltran  <joanpau.beltran@socib.cat>
 
@@ -34,6 +45,15 @@ function [glider_toolbox_dir] = configGliderToolboxPath()
 
   narginchk(0, 0);
 
+  if isdeployed()
+    glider_toolbox_dir = getenv('GLIDER_TOOLBOX_DIR');
+    if isempty(glider_toolbox_dir)
+      glider_toolbox_dir = pwd();
+    end
+    setpref('SNCTOOLS', 'USE_JAVA', true);
+    return
+  end
+
   [glider_toolbox_dir, ~, ~] = fileparts(mfilename('fullpath'));
   addpath(genpath(glider_toolbox_dir));
 
@@ -49,5 +49,10 @@ function db_access = configDBAccess()
   %db_access.user = 'myself';
   %db_access.pass = 'top_secret';
   %db_access.driver = 'org.postgresql.Driver';
+  
+  % Local cache of the deployment information retrieved from the database,
+  % used while younger than cache_ttl seconds or when the database is down.
+  db_access.cache = '';
+  db_access.cache_ttl = 3600;
 
 end
@@ -21,6 +21,11 @@ function local_paths = configPathsLocal(glider_toolbox_dir)
 %      NETCDF_L2: path pattern of NetCDF file for processed grid data
 %        (processed data interpolated on vertical instantaneous profiles).
 %      PROCESSING_LOG: path pattern of processing log file.
+%      LOCK_PATH: path pattern of lock directory of the deployment, held while
+%        the deployment is processed to prevent overlapping runs (see ACQUIRELOCK).
+%      LAG_CACHE: path pattern of sensor and thermal lag parameter estimate
+%        cache file, to skip the estimation on unchanged pairs of casts in
+%        following runs (see option LAG_CACHE of PROCESSGLIDERDATA).
 %    These path patterns are converted to true paths through the function
 %    STRFSTRUCT.
 %
@@ -67,5 +72,7 @@ function local_paths = configPathsLocal(glider_toolbox_dir)
   local_paths.netcdf_l2      = fullfile('netcdf', 'dep${GLIDER_DEPLOYMENT_CODE,l}_${GLIDER_NAME,l}_${GLIDER_INSTRUMENT_NAME,l}_L2_${DEPLOYMENT_START,Tyyyy-mm-dd}_data_rt.nc');
   local_paths.processing_log = fullfile('dep${GLIDER_DEPLOYMENT_CODE,l}_${GLIDER_NAME,l}_${GLIDER_INSTRUMENT_NAME,l}_${DEPLOYMENT_START,Tyyyy-mm-dd}_data_rt.log');
   local_paths.config_record  = fullfile('dep${GLIDER_DEPLOYMENT_CODE,l}_${GLIDER_NAME,l}_${GLIDER_INSTRUMENT_NAME,l}_${DEPLOYMENT_START,Tyyyy-mm-dd}_data_rt.config');
+  local_paths.lock_path      = fullfile('processing.lock');
+  local_paths.lag_cache      = fullfile('lag_params_cache.mat');
    
 end
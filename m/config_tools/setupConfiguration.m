@@ -64,6 +64,8 @@ function [ config ] = setupConfiguration( glider_toolbox_dir, varargin)
 %           -- local_paths.netcdf_l1: File name for L1 products relative to base_dir
 %           -- local_paths.netcdf_l2: File name for L2 products relative to base_dir
 %           -- local_paths.processing_log: File name for log file relative to base_dir
+%           -- local_paths.lock_path: Lock directory name relative to base_dir
+%           -- local_paths.lag_cache: Lag parameter cache file name relative to base_dir
 %       - PUBLIC_PATHS: Definition of public paths and urls (configPathsPublic)
 %           -- public_paths.status: File name or configuration function 
 %           -- public_paths.base_dir: Base directory containing the other folders
@@ -82,6 +84,8 @@ function [ config ] = setupConfiguration( glider_toolbox_dir, varargin)
 %           -- db_access.user: DB user name for access
 %           -- db_access.pass: DB password for access
 %           -- db_access.driver: DB drivers
+%           -- db_access.cache: Local cache file of deployment information
+%           -- db_access.cache_ttl: Seconds the local cache is valid
 %       - DOCKSERVERS: Definition of dockserver access (configDockservers)
 %           -- dockservers.status: File name or configuration function 
 %           -- dockservers.active: Indicates the use of dockserver
@@ -97,6 +101,12 @@ function [ config ] = setupConfiguration( glider_toolbox_dir, varargin)
 %           -- file_options_slocum.status: File name or configuration function 
 %           -- file_options_slocum.format_conversion: Indicates the use of
 %                        binary to ascii conversion
+%           -- file_options_slocum.binary_loading: Indicates that binary
+%                        files are loaded directly, without ascii conversion
+%           -- file_options_slocum.xbd_name_pattern_nav: Navigation binary
+%                        file pattern (when loading binary files)
+%           -- file_options_slocum.xbd_name_pattern_sci: Science binary
+%                        file pattern (when loading binary files)
 %           -- file_options_slocum.xbd_name_pattern: Pattern to indentify
 %                        valid binary files
 %           -- file_options_slocum.dba_name_replace: Pattern for creating
@@ -163,6 +173,19 @@ function [ config ] = setupConfiguration( glider_toolbox_dir, varargin)
 %  Default Values:
 %      Default values result from the call of the 
 %
+%  Notes:
+%    The number of threads used by the mex files of the toolbox (e.g.
+%    CALIBRATESENSORS and PUBLISHFILE) is not part of the configuration, but
+%    it is set through environment variables of the process (see SETENV):
+%      - GLIDER_TOOLBOX_THREADS: maximum number of threads of the process.
+%        By default all the online processors of the node.
+%      - GLIDER_TOOLBOX_THREADS_DIR: directory of the slot files, one per
+%        processor, locked by the processes of the node while their threads
+%        run, so that all the processes together do not run more threads than
+%        processors. Default value: /tmp/glider_toolbox_threads. Set it to a
+%        directory shared by all the processing runs of the node, or to an
+%        empty string to let each process use all the processors.
+%
 %  Authors:
 %    Miguel Charcos Llorens  <mcharcos@socib.es>
 %
@@ -364,6 +387,12 @@ function [ config ] = setupConfiguration( glider_toolbox_dir, varargin)
             end
         end
     end
+    if ~isfield(config.db_access, 'cache')
+        config.db_access.cache = '';
+    end
+    if ~isfield(config.db_access, 'cache_ttl')
+        config.db_access.cache_ttl = 3600;
+    end
 
     %% Configure Dockserver
     config.dockservers = configDockservers();
@@ -540,7 +569,7 @@ function [ config ] = setupConfiguration( glider_toolbox_dir, varargin)
         fields = fieldnames(config_file_options_slocum);
         add2dba_sensors = {};
         for i = 1:numel(fields)
-            if strcmp(fields{i},'format_conversion') == 1
+            if any(strcmp(fields{i}, {'format_conversion' 'binary_loading'}))
                 config.file_options_slocum.(fields{i}) = strcmp(config_file_options_slocum.(fields{i}),'1') + strcmp(config_file_options_slocum.(fields{i}),'true');
             elseif strcmp(fields{i},'add2dba_sensors') == 0
                 config.file_options_slocum.(fields{i}) = config_file_options_slocum.(fields{i});
@@ -563,7 +592,7 @@ function [ config ] = setupConfiguration( glider_toolbox_dir, varargin)
             fields = fieldnames(config_file_options_slocum);
             add2dba_sensors = {};
             for i = 1:numel(fields)
-                if strcmp(fields{i},'format_conversion') == 1
+                if any(strcmp(fields{i}, {'format_conversion' 'binary_loading'}))
                     config.file_options_slocum.(fields{i}) = strcmp(config_file_options_slocum.(fields{i}),'1') + strcmp(config_file_options_slocum.(fields{i}),'true');
                 elseif strcmp(fields{i},'add2dba_sensors') == 0
                     config.file_options_slocum.(fields{i}) = config_file_options_slocum.(fields{i});
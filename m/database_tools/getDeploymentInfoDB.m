@@ -39,6 +39,23 @@ function data = getDeploymentInfoDB(query, dbname, varargin)
 %      TIME_FORMAT: timestamp field format.
 %        String with the format of the timestamp columns returned by the query.
 %        Default value: 'yyyy-mm-dd HH:MM:SS' (ISO 8601 format)
+%      CACHE: local cache file.
+%        String with the name of a MAT file where the result of the query is
+%        stored. If the file contains the result of the same query on the same
+%        database retrieved less than CACHE_TTL seconds ago, the cached result
+%        is returned without accessing the database. If the database access 
+%        fails, the cached result is returned regardless of its age.
+%        If empty, no cache is used.
+%        Default value: '' (do not use a local cache)
+%      CACHE_TTL: local cache time to live.
+%        Number of seconds that a cached result is considered valid.
+%        It may also be given as a string with the number of seconds.
+%        Default value: 3600
+%      KEEP_CONNECTION: keep the database connection open.
+%        Boolean setting whether the connection to the database should be kept
+%        open after the query, to be reused by later calls accessing the same
+%        database with the same credentials.
+%        Default value: true
 %
 %    The returned struct DATA should have the following fields to be considered 
 %    a deployment structure:
@@ -59,6 +76,10 @@ function data = getDeploymentInfoDB(query, dbname, varargin)
 %    by DATENUM, and are converted to serial date number format. 
 %    Null entries are set to invalid (NaN).
 %
+%    The query result is requested in structure format, so that each column
+%    is returned as a single array, and it is converted to the output struct
+%    array column by column, without iterating over the rows.
+%
 %  Examples:
 %    db_access = configDBAccess()
 %    [query, fields] = configDTDeploymentInfoQuery()
@@ -93,7 +114,7 @@ function data = getDeploymentInfoDB(query, dbname, varargin)
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-  narginchk(2,16);
+  narginchk(2,22);
   
   %% Set options and default values.
   options.user = '';
@@ -103,6 +124,9 @@ function data = getDeploymentInfoDB(query, dbname, varargin)
   options.fields = {};
   options.time_fields = {'deployment_start' 'deployment_end'};
   options.time_format = 'yyyy-mm-dd HH:MM:SS';
+  options.cache = '';
+  options.cache_ttl = 3600;
+  options.keep_connection = true;
 
   
   %% Parse optional arguments.
@@ -134,33 +158,92 @@ function data = getDeploymentInfoDB(query, dbname, varargin)
   end
   
   
+  %% Return the cached result if it is still valid.
+  % The cache is only valid for the same query on the same database.
+  cache_ttl = options.cache_ttl;
+  if ischar(cache_ttl)
+    cache_ttl = str2double(cache_ttl);
+  end
+  cache = struct([]);
+  if ~isempty(options.cache) && exist(options.cache, 'file')
+    try
+      cache = load(options.cache);
+      if ~(isfield(cache, 'query') && strcmp(cache.query, query) ...
+           && isfield(cache, 'dbname') && strcmp(cache.dbname, dbname) ...
+           && isfield(cache, 'server') && strcmp(cache.server, options.server))
+        cache = struct([]);
+      end
+    catch exception
+      disp(['Error reading deployment information cache ' options.cache ':']);
+      disp(getReport(exception, 'extended'));
+      cache = struct([]);
+    end
+  end
+  if ~isempty(cache) && (now() - cache.timestamp) * 86400 < cache_ttl
+    disp(['Using cached deployment information: ' options.cache '.']);
+    data = cache.data;
+    return
+  end
+
+
   %% Retrieve data from database as a structure.
+  % Reuse the connection to the same database from previous calls, if any.
+  persistent connections;
+  if isempty(connections)
+    connections = containers.Map('KeyType', 'char', 'ValueType', 'any');
+  end
   if isempty(options.driver) && isempty(options.server)
     access_params = {options.user options.pass};
   else
     access_params = {options.user options.pass options.driver options.server};
   end
-  disp(strcat({'Connecting to '}, options.server, {' ==> '}, dbname, ' ...'));
-  conn = database(dbname, access_params{:});
-  if (~isconnection(conn))
-    error('glider_toolbox:db_tools:ConnectionError', ...
-          'Error connecting to database: %s.', conn.Message);
-  end
-  dbprefs = setdbprefs();
-  setdbprefs({'NullNumberRead', 'NullStringRead', 'DataReturnFormat'}, ...
-             {'NaN',            'null',           'structure'} );
+  conn_key = sprintf('%s\n%s\n%s', options.server, dbname, options.user);
   try
-    data = fetch(conn, query);
-  catch exception
-    close(conn);
+    conn = [];
+    if isKey(connections, conn_key)
+      conn = connections(conn_key);
+      remove(connections, conn_key);
+      if ~isconnection(conn)
+        conn = [];
+      end
+    end
+    if isempty(conn)
+      disp(strcat({'Connecting to '}, options.server, {' ==> '}, dbname, ' ...'));
+      conn = database(dbname, access_params{:});
+      if (~isconnection(conn))
+        error('glider_toolbox:db_tools:ConnectionError', ...
+              'Error connecting to database: %s.', conn.Message);
+      end
+    end
+    dbprefs = setdbprefs();
+    setdbprefs({'NullNumberRead', 'NullStringRead', 'DataReturnFormat'}, ...
+               {'NaN',            'null',           'structure'} );
+    try
+      data = fetch(conn, query);
+    catch exception
+      close(conn);
+      setdbprefs(dbprefs);
+      rethrow(exception);
+    end
     setdbprefs(dbprefs);
-    rethrow(exception);
+    if options.keep_connection
+      connections(conn_key) = conn;
+    else
+      close(conn);
+    end
+  catch exception
+    if isempty(cache)
+      rethrow(exception);
+    end
+    disp('Error retrieving deployment information from database:');
+    disp(getReport(exception, 'extended'));
+    disp(['Using expired cached deployment information: ' options.cache '.']);
+    data = cache.data;
+    return
   end
-  close(conn);
-  setdbprefs(dbprefs);
   
   
-  %% Convert to cell array for postprocessing.
+  %% Convert to cell array of columns for postprocessing.
   % MATLAB is not consistent when the DataReturnFormat is structure.
   % If no rows match the selected query, an empty array is returned instead.
   if isstruct(data)
@@ -170,39 +253,60 @@ function data = getDeploymentInfoDB(query, dbname, varargin)
       fields = cellstr(options.fields(:));
     end
     data = struct2cell(data);
-    for i = 1:size(data, 1)
-      if isnumeric(data{i})
-        data{i} = num2cell(data{i});
-      end
-    end
-    data = horzcat(data{:});
   else
-    fields = cellstr(options.fields);
-    data = cell(0, numel(fields));
+    fields = cellstr(options.fields(:));
+    data = repmat({cell(0, 1)}, size(fields));
   end
 
 
   %% Convert time fields from timestamp string to serial date number.
+  % Convert all the entries of each time column at once.
   time_format = options.time_format;
   time_fields = cellstr(options.time_fields);
-  time_field_columns = ismember(fields, time_fields);
-  time_data = data(:,time_field_columns);
-  if iscellstr(time_data)
-    % DATENUM does not handle empty date string cell arrays properly.
-    time_data_null = strcmp('null', time_data);
-    if any(~time_data_null(:))
-      time_data(~time_data_null) = ...
-        num2cell(datenum(time_data(~time_data_null), time_format));
+  time_field_columns = find(ismember(fields, time_fields));
+  for time_field_idx = time_field_columns(:)'
+    time_data = data{time_field_idx};
+    if iscellstr(time_data)
+      % DATENUM does not handle empty date string cell arrays properly.
+      time_data_null = strcmp('null', time_data);
+      time_data_num = nan(size(time_data));
+      if any(~time_data_null(:))
+        time_data_num(~time_data_null) = ...
+          datenum(time_data(~time_data_null), time_format);
+      end
+      data{time_field_idx} = time_data_num;
+    elseif ~isnumeric(time_data)
+      error('glider_toolbox:db_tools:TimeFieldError', ...
+            'Wrong time data type (not a timestamp string).');
     end
-    time_data(time_data_null) = {NaN};
-  else
-    error('glider_toolbox:db_tools:TimeFieldError', ...
-          'Wrong time data type (not a timestamp string).');
   end
-  data(:, time_field_columns) = time_data;
   
 
-  %% Convert back to structure array with new field names.
-  data = cell2struct(data, fields, 2);
+  %% Convert to structure array with new field names.
+  % Build the struct array from the columns, numeric columns are split into
+  % scalar cells and text columns are already cell arrays of strings.
+  for field_idx = 1:numel(fields)
+    if ~iscell(data{field_idx})
+      data{field_idx} = num2cell(data{field_idx}(:));
+    else
+      data{field_idx} = data{field_idx}(:);
+    end
+  end
+  data = [fields(:)'; data(:)'];
+  data = struct(data{:});
+  
+  
+  %% Update the cache with the new result, if needed.
+  if ~isempty(options.cache)
+    cache = struct('query', query, 'dbname', dbname, ...
+                   'server', options.server, 'timestamp', now());
+    cache.data = data;
+    try
+      save(options.cache, '-struct', 'cache');
+    catch exception
+      disp(['Error writing deployment information cache ' options.cache ':']);
+      disp(getReport(exception, 'extended'));
+    end
+  end
 
 end
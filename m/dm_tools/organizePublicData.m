@@ -6,7 +6,9 @@ function [ ] = organizePublicData( output_path, outputs, figures )
 %
 %  Description:
 %    ORGANIZEPUBLICDATA copies netCDF files and figures to the public
-%    directories that are defined in the configuration input. 
+%    directories that are defined in the configuration input. Files are
+%    published with PUBLISHFILE, so public files that are already up to date
+%    are not copied again, and updated ones are replaced atomically.
 %
 %  Input:
 %    PUBLIC_PATH defines the location of the public directories where the
@@ -92,7 +94,7 @@ function [ ] = organizePublicData( output_path, outputs, figures )
           message = 'not a directory';
         end
         if status
-          [success, message] = copyfile(output_local_file, output_public_file);
+          [success, message] = publishfile(output_local_file, output_public_file);
           if success
             disp(['Public output ' output_name ' succesfully copied: ' ...
                   output_public_file '.']);
@@ -173,6 +175,9 @@ function [ ] = organizePublicData( output_path, outputs, figures )
         message = 'not a directory';
       end
       if status
+        % Publish all the figures at once, the files are processed in parallel.
+        public_figure_local_list = cell(size(public_figure_name_list));
+        public_figure_public_list = cell(size(public_figure_name_list));
         for public_figure_name_idx = 1:numel(public_figure_name_list)
           public_figure_name = public_figure_name_list{public_figure_name_idx};
           figure_local = public_figures_local.(public_figure_name);
@@ -184,15 +189,22 @@ function [ ] = organizePublicData( output_path, outputs, figures )
           figure_public.fullfile = ...
             fullfile(figure_public.dirname, ...
                      [figure_public.filename '.' figure_public.format]);
-          [success, message] = ...
-            copyfile(figure_local.fullfile, figure_public.fullfile);
-          if success
+          public_figure_local_list{public_figure_name_idx} = figure_local;
+          public_figure_public_list{public_figure_name_idx} = figure_public;
+        end
+        [success_list, message_list] = publishfile( ...
+          cellfun(@(f)(f.fullfile), public_figure_local_list, 'UniformOutput', false), ...
+          cellfun(@(f)(f.fullfile), public_figure_public_list, 'UniformOutput', false));
+        for public_figure_name_idx = 1:numel(public_figure_name_list)
+          public_figure_name = public_figure_name_list{public_figure_name_idx};
+          figure_public = public_figure_public_list{public_figure_name_idx};
+          if success_list(public_figure_name_idx)
             public_figures.(public_figure_name) = figure_public;
             disp(['Public figure ' public_figure_name ' succesfully copied.']);
           else
             disp(['Error creating public copy of figure ' ...
                   public_figure_name ': ' figure_public.fullfile '.']);
-            disp(message);
+            disp(message_list{public_figure_name_idx});
           end
         end
       else
@@ -57,6 +57,13 @@ function [] = gliderDataProcessing(varargin)
 %      PUBLIC_FIGURES_EXCEPTIONS: Describes the figues that must not
 %        be copied to the public location. By default all figures will be
 %        copied. Values depend on the configuration file definitions.
+%      METRICS_PROM: Name of the Prometheus text file where the processing
+%        metrics are written after each deployment (see WRITEMETRICS), to be
+%        exported by the textfile collector of the node exporter.
+%        By default metrics are not written to a Prometheus file.
+%      METRICS_JSON: Name of the JSON lines file where the processing metrics
+%        are appended after each deployment (see WRITEMETRICS).
+%        By default metrics are not written to a JSON lines file.
 %
 %  See also:
 %    DEPLOYMENTDATAPROCESSING
@@ -66,6 +73,8 @@ function [] = gliderDataProcessing(varargin)
 %    CREATEFSTRUCT
 %    STARTLOGGING
 %    ORGANIZEPUBLICDATA
+%    RECORDMETRIC
+%    WRITEMETRICS
 %
 %  Authors:
 %    Miguel Charcos Llorens  <mcharcos@socib.es>
@@ -88,7 +97,7 @@ function [] = gliderDataProcessing(varargin)
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  
     %% Initialization
-    narginchk(0, 10);
+    narginchk(0, 14);
 
     % required parameters of deployment structure
     required_deployment_strparam = {'deployment_name', 'glider_name', ...
@@ -104,6 +113,8 @@ function [] = gliderDataProcessing(varargin)
     options.deployment_list    = [];
     options.public_netcdfs_exceptions  = [];
     options.public_figures_exceptions  = [];
+    options.metrics_prom       = '';
+    options.metrics_json       = '';
     
     %% Parse optional arguments.
     % Get option key-value pairs in any accepted call signature.
@@ -183,7 +194,9 @@ function [] = gliderDataProcessing(varargin)
           config.db_query, config.db_access.name, ...
           'user', config.db_access.user, 'pass', config.db_access.pass, ...
           'server', config.db_access.server, 'driver', config.db_access.driver, ...
-          'fields', config.db_fields);
+          'fields', config.db_fields, ...
+          'cache', config.db_access.cache, ...
+          'cache_ttl', config.db_access.cache_ttl);
         if isempty(options.deployment_list)
           disp('Selected glider deployments are not available.');
           return
@@ -232,13 +245,41 @@ function [] = gliderDataProcessing(varargin)
     end
     
     %% Process active deployments.
-    for deployment_idx = 1:numel(options.deployment_list)
-      disp(['Processing deployment ' num2str(deployment_idx) '...']);
+    % Each deployment is locked while processed to prevent overlapping runs
+    % from processing it at the same time (see ACQUIRELOCK). Deployments
+    % locked by another run are skipped handing off the new files to it,
+    % and deployments with files handed off during this run are queued again.
+    deployment_queue = 1:numel(options.deployment_list);
+    while ~isempty(deployment_queue)
+      deployment_idx = deployment_queue(1);
+      deployment_queue(1) = [];
       deployment = options.deployment_list(deployment_idx);
       
       %% Define paths for processing
       data_paths = createFStruct(config.local_paths, deployment);
       
+      %% Acquire deployment lock.
+      lock_dir = fullfile(data_paths.base_dir, data_paths.lock_path);
+      try
+        [deployment_lock, lock_owner] = acquireLock(lock_dir);
+      catch exception
+        disp(['Error acquiring lock of deployment ' ...
+              deployment.deployment_name ' ' lock_dir ':']);
+        disp(getReport(exception, 'extended'));
+        continue;
+      end
+      if isempty(deployment_lock)
+        disp(['Deployment ' deployment.deployment_name ...
+              ' is being processed by another run (pid ' ...
+              num2str(lock_owner.pid) ' on ' lock_owner.host ...
+              '), handing off new files.']);
+        continue;
+      end
+      disp(['Processing deployment ' num2str(deployment_idx) '...']);
+      metric_labels = struct('deployment', deployment.deployment_name, ...
+                             'glider', deployment.glider_name);
+      deployment_timer = tic();
+      
       %% Start deployment processing logging.
       startLogging(fullfile(data_paths.base_dir,data_paths.processing_log), options.glider_toolbox_ver, deployment);
       
@@ -275,13 +316,19 @@ function [] = gliderDataProcessing(varargin)
         [netcdf_products, figure_products, ~, ~] = ...
             deploymentDataProcessing(data_paths, deployment, config, ...
                                         'data_result', 'postprocessed');
+        recordMetric('gauge', 'glider_toolbox_last_success_timestamp_seconds', ...
+                     posixtime(), metric_labels);
       catch exception
         disp(['Error processing deployment ' deployment.deployment_name ':']);
         disp(getReport(exception, 'extended'));
-        continue;
+        netcdf_products = struct();
+        figure_products = struct();
+        recordMetric('counter', 'glider_toolbox_deployment_errors_total', ...
+                     1, metric_labels);
       end
       
       %% Define public paths and copy data to public
+      deployment_lock = refreshLock(deployment_lock);
       if ~isempty(fieldnames(netcdf_products)) || ~isempty(fieldnames(figure_products))
           % remove netcdf exceptions
           if ~isempty(fieldnames(netcdf_products)) && ~isempty(options.public_netcdfs_exceptions)
@@ -309,10 +356,31 @@ function [] = gliderDataProcessing(varargin)
    
       end
       
+      %% Record deployment metrics and export them.
+      recordMetric('histogram', 'glider_toolbox_deployment_duration_seconds', ...
+                   toc(deployment_timer), metric_labels);
+      recordMetric('gauge', 'glider_toolbox_last_run_timestamp_seconds', ...
+                   posixtime(), metric_labels);
+      if ~isempty(options.metrics_prom) || ~isempty(options.metrics_json)
+        try
+          writeMetrics(options.metrics_prom, options.metrics_json);
+        catch exception
+          disp('Error writing processing metrics:');
+          disp(getReport(exception, 'extended'));
+        end
+      end
+      
       %% Stop deployment processing logging.
       disp(['Deployment processing end time: ' ...
             datestr(posixtime2utc(posixtime()), 'yyyy-mm-ddTHH:MM:SS+00:00')]);
       diary('off');
+      
+      %% Release deployment lock and queue it again if new files were handed off.
+      if releaseLock(deployment_lock)
+        disp(['Deployment ' deployment.deployment_name ...
+              ' has new files handed off by another run, queueing it again.']);
+        deployment_queue(end+1) = deployment_idx;
+      end
     end
     
 end
@@ -0,0 +1,287 @@
+function main_glider_data_processing_daemon(varargin)
+%MAIN_GLIDER_DATA_PROCESSING_DAEMON  Run near real time glider processing chain as a long running process.
+%
+%  Syntax:
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON()
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON(OPTIONS)
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON(OPT1, VAL1, ...)
+%
+%  Description:
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON() runs the near real time processing
+%    chain in MAIN_GLIDER_DATA_PROCESSING_RT repeatedly in the same session,
+%    processing a deployment only when new files for it arrive to the remote
+%    servers, instead of processing all active deployments on every run:
+%      - A full run of MAIN_GLIDER_DATA_PROCESSING_RT sets up the toolbox
+%        configuration, gets the list of active deployments and processes all
+%        of them, as when run from a scheduler.
+%      - The remote directories of each active deployment are listed
+%        periodically through connections to the dockservers (Slocum) or
+%        basestations (Seaglider) that are kept open between listings.
+%        The listing of each directory is compared to the previous one, and the
+%        deployments with new or changed files are queued.
+%      - Queued deployments are processed by MAIN_GLIDER_DATA_PROCESSING_RT,
+%        reusing the configuration and the deployment list of the full run.
+%      - The full run is repeated periodically to pick up changes in the
+%        configuration and in the list of active deployments, and to process
+%        files that may have been missed by the listings.
+%
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON(OPTIONS) and
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON(OPT1, VAL1, ...) accept the following
+%    options, given in key-value pairs OPT1, VAL1... or in a struct OPTIONS
+%    with field names as option keys and field values as option values:
+%      POLL: interval between remote listings.
+%        Seconds to wait between two listings of the remote directories.
+%        Default value: 30
+%      REFRESH: interval between full runs.
+%        Seconds between two full runs of the processing chain.
+%        Default value: 3600
+%      ITERATIONS: number of listings.
+%        Stop after the given number of listings (including full runs).
+%        Default value: Inf (run forever)
+%    Option values may also be given as strings, as when running the
+%    standalone executable built by SETUPSTANDALONE from the command line.
+%
+%  Notes:
+%    The remote directories listed are the default ones used by
+%    GETDOCKSERVERFILES and GETBASESTATIONFILES. A file is considered new or
+%    changed when its name, size or modification time differ from the previous
+%    listing. The first listing of a directory queues the deployment, so that
+%    files arrived during the full run are not missed.
+%
+%    Deployment locks are acquired by MAIN_GLIDER_DATA_PROCESSING_RT as usual,
+%    so scheduled runs may coexist with the daemon during a transition.
+%
+%  Examples:
+%    % Run forever, listing every 30 seconds and a full run every hour:
+%    main_glider_data_processing_daemon()
+%    % Run for a day, listing every minute and a full run every 6 hours:
+%    main_glider_data_processing_daemon('poll', 60, 'refresh', 6 * 3600, ...
+%                                       'iterations', 1440)
+%
+%  See also:
+%    MAIN_GLIDER_DATA_PROCESSING_RT
+%    GETDOCKSERVERFILES
+%    GETBASESTATIONFILES
+%    SETUPSTANDALONE
+%    FTP
+%    SFTP
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(0, 6);
+
+
+  %% Set options and default values.
+  options.poll = 30;
+  options.refresh = 3600;
+  options.iterations = Inf;
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:main_glider_data_processing_daemon:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:main_glider_data_processing_daemon:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+  % Convert numeric options given as strings (command line of the executable).
+  for opt = {'poll' 'refresh' 'iterations'}
+    if ischar(options.(opt{1}))
+      options.(opt{1}) = str2double(options.(opt{1}));
+    end
+  end
+
+
+  %% Run the processing chain on listing changes.
+  % The processing script runs in this workspace, so the configuration and
+  % the deployment list it sets up in a full run remain available to the
+  % following runs. All the state of the daemon lives in RT_DAEMON to avoid
+  % clashes with the variables of the script, which checks its WARM and
+  % QUEUE fields to skip the setup and process only the queued deployments.
+  rt_daemon.options = options;
+  rt_daemon.warm = false;
+  rt_daemon.queue = [];
+  rt_daemon.refreshed = -Inf;
+  rt_daemon.iteration = 0;
+  rt_daemon.handles = containers.Map();
+  rt_daemon.listings = containers.Map();
+  config = [];
+  deployment_list = [];
+  while rt_daemon.iteration < rt_daemon.options.iterations
+    rt_daemon.iteration = rt_daemon.iteration + 1;
+    rt_daemon.polled = posixtime();
+    if rt_daemon.polled - rt_daemon.refreshed >= rt_daemon.options.refresh
+      % Update the listings before the full run when the deployments are known
+      % from a previous one, so that only arrivals after it queue deployments.
+      if rt_daemon.warm
+        pollDeployments(rt_daemon, config, deployment_list);
+      end
+      disp('Starting full processing run...');
+      rt_daemon.warm = false;
+      rt_daemon.queue = [];
+      try
+        main_glider_data_processing_rt;
+        rt_daemon.warm = ~isempty(config) && ~isempty(deployment_list);
+      catch exception
+        disp('Error in full processing run:');
+        disp(getReport(exception, 'extended'));
+      end
+      rt_daemon.refreshed = rt_daemon.polled;
+    elseif rt_daemon.warm
+      rt_daemon.queue = pollDeployments(rt_daemon, config, deployment_list);
+      if ~isempty(rt_daemon.queue)
+        disp(['Deployments with new files: ' num2str(rt_daemon.queue(:)') '.']);
+        try
+          main_glider_data_processing_rt;
+        catch exception
+          disp('Error in incremental processing run:');
+          disp(getReport(exception, 'extended'));
+        end
+        rt_daemon.queue = [];
+      end
+    end
+    if rt_daemon.iteration < rt_daemon.options.iterations
+      pause(max(0, rt_daemon.options.poll - (posixtime() - rt_daemon.polled)));
+    end
+  end
+
+
+  %% Close remote connections.
+  rt_daemon.hosts = keys(rt_daemon.handles);
+  for rt_daemon_host_idx = 1:numel(rt_daemon.hosts)
+    try
+      close(rt_daemon.handles(rt_daemon.hosts{rt_daemon_host_idx}));
+    catch exception
+      disp(['Error closing connection to host ' ...
+            rt_daemon.hosts{rt_daemon_host_idx} ':']);
+      disp(getReport(exception, 'extended'));
+    end
+  end
+
+end
+
+
+function queue = pollDeployments(state, config, deployment_list)
+%POLLDEPLOYMENTS  List remote directories of deployments and queue the ones with changes.
+%  The maps of connection handles and listings in STATE are handle objects,
+%  so the updates are seen by the caller.
+  queue = [];
+  for deployment_idx = 1:numel(deployment_list)
+    deployment = deployment_list(deployment_idx);
+    glider_model = deployment.glider_model;
+    if ~isempty(regexpi(glider_model, '.*slocum.*g[12].*', 'match', 'once'))
+      remote_base_dir = ['/var/opt/gmc/gliders/' lower(deployment.glider_name)];
+      remote_dirs = {[remote_base_dir '/from-glider'] [remote_base_dir '/logs']};
+      servers = config.dockservers.server;
+    elseif ~isempty(regexpi(glider_model, '.*seaglider.*', 'match', 'once'))
+      remote_dirs = {['/home/sg' deployment.glider_serial]};
+      servers = config.basestations;
+    else
+      continue
+    end
+    changed = false;
+    for server_idx = 1:numel(servers)
+      server = servers(server_idx);
+      for remote_dir_idx = 1:numel(remote_dirs)
+        remote_dir = remote_dirs{remote_dir_idx};
+        listing = listDirectory(state.handles, server, remote_dir);
+        if isempty(listing)
+          continue
+        end
+        listing_key = [server.host ':' remote_dir];
+        if ~isKey(state.listings, listing_key) ...
+            || ~strcmp(state.listings(listing_key), listing)
+          state.listings(listing_key) = listing;
+          changed = true;
+        end
+      end
+    end
+    if changed
+      queue(end+1) = deployment_idx; %#ok<AGROW>
+    end
+  end
+end
+
+
+function listing = listDirectory(handles, server, remote_dir)
+%LISTDIRECTORY  Listing signature of a remote directory through a cached connection.
+%  The signature is a string with the name, size and modification time of
+%  each file, or empty if the directory could not be listed. Connections are
+%  opened on demand and dropped on errors to be opened again next time.
+  listing = '';
+  try
+    if ~isKey(handles, server.host)
+      user = [];
+      pass = [];
+      conn = @ftp;
+      if isfield(server, 'user') && ~isequal(server.user, [])
+        user = server.user;
+      end
+      if isfield(server, 'pass') && ~isequal(server.pass, [])
+        pass = server.pass;
+      end
+      if isfield(server, 'conn') && ~isequal(server.conn, [])
+        conn = server.conn;
+        if ischar(conn)
+          conn = str2func(conn);
+        end
+      end
+      handles(server.host) = conn(server.host, user, pass);
+    end
+    atts = dir(handles(server.host), remote_dir);
+    atts = atts(~[atts.isdir]);
+    [~, order] = sort({atts.name});
+    atts = atts(order);
+    fields = [{atts.name}; {atts.bytes}; {atts.datenum}];
+    listing = sprintf('%s\t%d\t%.6f\n', fields{:});
+    if isempty(listing)
+      listing = char(10);
+    end
+  catch exception
+    disp(['Error listing ' remote_dir ' on host ' server.host ':']);
+    disp(exception.message);
+    if isKey(handles, server.host)
+      handle = handles(server.host);
+      remove(handles, server.host);
+      close(handle);
+    end
+  end
+end
@@ -53,6 +53,9 @@
 %    with a renaming pattern to specify the name of the resulting text file,
 %    and performs a system call to program 'dbd2asc' by WRC.
 %    The path to the 'dbd2asc' program may be configured in CONFIGWRCPROGRAMS.
+%    Before the conversion, the sensor lists needed by the binary files are
+%    checked against the cache directory with LOADSENSORLISTCACHE, and files
+%    whose sensor list is not available are reported and skipped.
 %    Input file conversion and data loading options may be configured in 
 %    CONFIGDTFILEOPTIONSSLOCUM, CONFIGDTFILEOPTIONSSEAGLIDER, and
 %    CONFIGDTFILEOPTIONSSEAEXPLORER.
@@ -71,7 +74,9 @@
 %    actions (interpolations, filterings, corrections and derivations) 
 %    and its parameters may be configured in CONFIGDATAPROCESSINGSLOCUMG1, 
 %    CONFIGDATAPROCESSINGSLOCUMG2, CONFIGDATAPROCESSINGSEAGLIDER and
-%    CONFIGDATAPROCESSINGSEAEXPLORER.
+%    CONFIGDATAPROCESSINGSEAEXPLORER. The sensor and thermal lag parameter
+%    estimates of each pair of casts are kept in the cache file configured in
+%    CONFIGDTPATHSLOCAL, so that only the new pairs are estimated in later runs.
 %
 %    Processed data is interpolated/binned with GRIDGLIDERDATA to obtain a data 
 %    set with the structure of a trajectory of instantaneous vertical profiles 
@@ -107,6 +112,12 @@
 %    Public products and figures to copy and their locations may be configured
 %    in CONFIGDTPATHSPUBLIC.
 %
+%    Processing metrics of each deployment (files loaded, samples processed,
+%    profiles, errors and stage durations) are recorded with RECORDMETRIC,
+%    and exported by WRITEMETRICS at the end of the run to a Prometheus text
+%    file and a JSON lines log in the glider data directory of the toolbox.
+%    The names of these files are set at the beginning of this script.
+%
 %  See also:
 %    CONFIGWRCPROGRAMS
 %    CONFIGDBACCESS
@@ -139,7 +150,10 @@
 %    DIARY
 %    STRFSTRUCT
 %    XBD2DBA
+%    LOADSENSORLISTCACHE
 %    SAVEJSON
+%    RECORDMETRIC
+%    WRITEMETRICS
 %
 %  Notes:
 %    This script is based on the previous work by Tomeu Garau. He is the true
@@ -170,6 +184,11 @@
 configuration_file = 'configMainDT.txt';
 deployment_file    = 'deploymentDT.txt';
 
+% Processing metrics files relative to the glider data directory
+% (see WRITEMETRICS), empty to skip the output.
+metrics_prom_file = 'glider_toolbox_dt.prom';
+metrics_json_file = 'glider_toolbox_dt_metrics.jsonl';
+
 % required parameters of deployment structure
 required_deployment_strparam = {'deployment_name', 'glider_name', ...
                        'glider_serial', 'glider_model'};
@@ -184,6 +203,15 @@ fconfig = fullfile(glider_toolbox_dir, 'config', configuration_file);
 config = setupConfiguration(glider_toolbox_dir, 'fconfig', fconfig);
 deployment_file = fullfile(glider_toolbox_dir, 'config', deployment_file);
 
+metrics_prom = '';
+metrics_json = '';
+if ~isempty(metrics_prom_file)
+  metrics_prom = fullfile(glider_toolbox_dir, 'glider_data', metrics_prom_file);
+end
+if ~isempty(metrics_json_file)
+  metrics_json = fullfile(glider_toolbox_dir, 'glider_data', metrics_json_file);
+end
+
 %% Configure deployment data and binary paths.
 % This is necessary since we changed the configuration setup
 config.paths_public.netcdf_l0   = fullfile(config.public_paths.base_dir,config.public_paths.netcdf_l0);
@@ -203,6 +231,7 @@ config.paths_local.netcdf_l1      = fullfile(config.local_paths.base_dir,config.
 config.paths_local.netcdf_l2      = fullfile(config.local_paths.base_dir,config.local_paths.netcdf_l2);
 config.paths_local.processing_log = fullfile(config.local_paths.base_dir,config.local_paths.processing_log);
 config.paths_local.config_record  = fullfile(config.local_paths.base_dir,config.local_paths.config_record);
+config.paths_local.lag_cache      = fullfile(config.local_paths.base_dir,config.local_paths.lag_cache);
 
 config.wrcprogs.dbd2asc             = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dbd2asc);
 config.wrcprogs.dba_merge           = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba_merge);
@@ -233,7 +262,9 @@ if user_db_access
       config.db_query, config.db_access.name, ...
       'user', config.db_access.user, 'pass', config.db_access.pass, ...
       'server', config.db_access.server, 'driver', config.db_access.driver, ...
-      'fields', config.db_fields);
+      'fields', config.db_fields, ...
+      'cache', config.db_access.cache, ...
+      'cache_ttl', config.db_access.cache_ttl);
 else
     disp(['Reading information of glider deployments from ' deployment_file '...']);
     try
@@ -290,6 +321,7 @@ for deployment_idx = 1:numel(deployment_list)
   netcdf_l0_file = strfstruct(config.paths_local.netcdf_l0, deployment);
   netcdf_l1_file = strfstruct(config.paths_local.netcdf_l1, deployment);
   netcdf_l2_file = strfstruct(config.paths_local.netcdf_l2, deployment);
+  lag_cache_file = strfstruct(config.paths_local.lag_cache, deployment);
   source_files = {};
   meta_raw = struct();
   data_raw = struct();
@@ -344,11 +376,17 @@ for deployment_idx = 1:numel(deployment_list)
   if isfield(deployment, 'calibrations')
     preprocessing_options.calibration_parameter_list = deployment.calibrations;
   end
+  processing_options.lag_cache = lag_cache_file;
   gridding_options = config.gridding_options;
   netcdf_l1_options = config.output_netcdf_l1;
   netcdf_l2_options = config.output_netcdf_l2;
   figproc_options = config.figures_processed.options;
   figgrid_options = config.figures_gridded.options;
+  % Labels of the metrics of this deployment (see RECORDMETRIC).
+  metric_labels = struct('deployment', deployment_name, ...
+                         'glider', glider_name);
+  deployment_errors = 0;
+  deployment_timer = tic();
 
 
   %% Start deployment processing logging.
@@ -429,13 +467,16 @@ for deployment_idx = 1:numel(deployment_list)
   % and store the returned absolute path for later use.
   % Since some conversion may fail use a cell array of string cell arrays and
   % flatten it when finished, leaving only the succesfully created dbas.
-  % Give a second try to failing files, because they might have failed due to 
-  % a missing cache file generated later.
+  % Check the sensor lists required by the binary files before converting them:
+  % convert first the files providing their sensor list (they generate the
+  % cache files needed by the others), and report upfront and skip the files
+  % whose sensor list cache file is missing.
   switch glider_type
     case {'slocum_g1' 'slocum_g2'}
       if file_options.format_conversion
         % Look for xbds in binary directory.
         disp('Converting binary data files to ascii format...');
+        stage_start = tic();
         bin_dir_contents = dir(binary_dir);
         xbd_select = ~[bin_dir_contents.isdir] ...
           & ~cellfun(@isempty, regexp({bin_dir_contents.name}, file_options.xbd_name_pattern));
@@ -443,33 +484,42 @@ for deployment_idx = 1:numel(deployment_list)
         xbd_sizes = [bin_dir_contents(xbd_select).bytes];
         disp(['Binary files found: ' num2str(numel(xbd_names)) ...
              ' (' num2str(sum(xbd_sizes)*2^-10) ' kB).']);
+        xbd_fullfiles = cellfun(@(n)(fullfile(binary_dir, n)), xbd_names, ...
+                                'UniformOutput', false);
+        [xbd_crcs, xbd_factored, xbd_missing] = ...
+          loadSensorListCache(xbd_fullfiles, cache_dir);
+        if any(xbd_missing)
+          disp(['Binary files with missing sensor list cache files: ' ...
+                num2str(sum(xbd_missing)) '.']);
+          xbd_missing_info = [reshape(xbd_names(xbd_missing), 1, []);
+                              reshape(xbd_crcs(xbd_missing), 1, [])];
+          fprintf('  %s (%s.cac)\n', xbd_missing_info{:});
+        end
+        [~, xbd_order] = sort(xbd_factored);
         new_files = cell(size(xbd_names));
-        for conversion_retry = 1:2
-          for xbd_idx = 1:numel(xbd_names)
-            if isempty(new_files{xbd_idx})
-              xbd_name_ext = xbd_names{xbd_idx};
-              dba_name_ext = regexprep(xbd_name_ext, ...
-                                       file_options.xbd_name_pattern, ...
-                                       file_options.dba_name_replace);
-              xbd_fullfile = fullfile(binary_dir, xbd_name_ext);
-              dba_fullfile = fullfile(ascii_dir, dba_name_ext);
-              try
-                new_files{xbd_idx} = ...
-                  {xbd2dba(xbd_fullfile, dba_fullfile, 'cache', cache_dir, ...
-                           'cmdname', config.wrcprogs.dbd2asc)};
-              catch exception
-                new_files{xbd_idx} = {};
-                if conversion_retry == 2
-                  disp(['Error converting binary file ' xbd_name_ext ':']);
-                  disp(getReport(exception, 'extended'));
-                end
-              end
-            end
+        for xbd_idx = xbd_order(~xbd_missing(xbd_order))
+          xbd_name_ext = xbd_names{xbd_idx};
+          dba_name_ext = regexprep(xbd_name_ext, ...
+                                   file_options.xbd_name_pattern, ...
+                                   file_options.dba_name_replace);
+          xbd_fullfile = xbd_fullfiles{xbd_idx};
+          dba_fullfile = fullfile(ascii_dir, dba_name_ext);
+          try
+            new_files{xbd_idx} = ...
+              {xbd2dba(xbd_fullfile, dba_fullfile, 'cache', cache_dir, ...
+                       'cmdname', config.wrcprogs.dbd2asc)};
+          catch exception
+            new_files{xbd_idx} = {};
+            disp(['Error converting binary file ' xbd_name_ext ':']);
+            disp(getReport(exception, 'extended'));
+            deployment_errors = deployment_errors + 1;
           end
         end
         new_files = [new_files{:}];
         disp(['Binary files converted: ' ...
               num2str(numel(new_files)) ' of ' num2str(numel(xbd_names)) '.']);
+        recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                     toc(stage_start), setfield(metric_labels, 'stage', 'conversion'));
       end
     otherwise
   end
@@ -477,6 +527,7 @@ for deployment_idx = 1:numel(deployment_list)
 
   %% Load data from ascii deployment glider files.
   disp('Loading raw deployment data from text files...');
+  stage_start = tic();
   load_start = utc2posixtime(deployment_start);
   load_final = posixtime();
   if ~isnan(deployment_end)
@@ -521,7 +572,12 @@ for deployment_idx = 1:numel(deployment_list)
   catch exception
     disp('Error loading raw data:');
     disp(getReport(exception, 'extended'));
+    deployment_errors = deployment_errors + 1;
   end
+  recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+               toc(stage_start), setfield(metric_labels, 'stage', 'loading'));
+  recordMetric('counter', 'glider_toolbox_files_loaded_total', ...
+               numel(source_files), metric_labels);
 
 
   %% Add source files to deployment structure if loading succeeded.
@@ -536,6 +592,7 @@ for deployment_idx = 1:numel(deployment_list)
   %% Generate L0 NetCDF file (raw/preprocessed data), if needed and possible.
   if ~isempty(fieldnames(data_raw)) && ~isempty(netcdf_l0_file)
     disp('Generating NetCDF L0 output...');
+    stage_start = tic();
     try
       switch glider_type
         case {'slocum_g1' 'slocum_g2'}
@@ -580,13 +637,17 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp(['Error generating NetCDF L0 (raw data) output ' netcdf_l0_file ':']);
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'netcdf_l0'));
   end
 
 
   %% Preprocess raw glider data.
   if ~isempty(fieldnames(data_raw))
     disp('Preprocessing raw data...');
+    stage_start = tic();
     try
       switch glider_type 
         case 'seaglider'
@@ -600,19 +661,34 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp('Error preprocessing glider deployment data:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'preprocessing'));
   end
 
 
   %% Process preprocessed glider data.
   if ~isempty(fieldnames(data_preprocessed))
     disp('Processing glider data...');
+    stage_start = tic();
     try
       [data_processed, meta_processed] = ...
         processGliderData(data_preprocessed, meta_preprocessed, processing_options);
     catch exception
       disp('Error processing glider deployment data:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
+    end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'processing'));
+    if isfield(data_processed, 'time')
+      recordMetric('counter', 'glider_toolbox_samples_processed_total', ...
+                   numel(data_processed.time), metric_labels);
+    end
+    if isfield(data_processed, 'profile_index')
+      recordMetric('gauge', 'glider_toolbox_profiles', ...
+                   max([0; data_processed.profile_index(:)]), metric_labels);
     end
   end
 
@@ -620,6 +696,7 @@ for deployment_idx = 1:numel(deployment_list)
   %% Generate L1 NetCDF file (processed data), if needed and possible.
   if ~isempty(fieldnames(data_processed)) && ~isempty(netcdf_l1_file)
     disp('Generating NetCDF L1 output...');
+    stage_start = tic();
     try
       outputs.netcdf_l1 = generateOutputNetCDF( ...
         netcdf_l1_file, data_processed, meta_processed, deployment, ...
@@ -632,13 +709,17 @@ for deployment_idx = 1:numel(deployment_list)
       disp(['Error generating NetCDF L1 (processed data) output ' ...
             netcdf_l1_file ':']);
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'netcdf_l1'));
   end
 
 
   %% Generate processed data figures.
   if ~isempty(fieldnames(data_processed)) && ~isempty(figure_dir)
     disp('Generating figures from processed data...');
+    stage_start = tic();
     try
       figures.figproc = generateGliderFigures( ...
         data_processed, figproc_options, ...
@@ -647,26 +728,34 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp('Error generating processed data figures:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'figures_processed'));
   end
 
 
   %% Grid processed glider data.
   if ~isempty(fieldnames(data_processed))
     disp('Gridding glider data...');
+    stage_start = tic();
     try
       [data_gridded, meta_gridded] = ...
         gridGliderData(data_processed, meta_processed, gridding_options);
     catch exception
       disp('Error gridding glider deployment data:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'gridding'));
   end
 
 
   %% Generate L2 (gridded data) netcdf file, if needed and possible.
   if ~isempty(fieldnames(data_gridded)) && ~isempty(netcdf_l2_file)
     disp('Generating NetCDF L2 output...');
+    stage_start = tic();
     try
       outputs.netcdf_l2 = generateOutputNetCDF( ...
         netcdf_l2_file, data_gridded, meta_gridded, deployment, ...
@@ -679,13 +768,17 @@ for deployment_idx = 1:numel(deployment_list)
       disp(['Error generating NetCDF L2 (gridded data) output ' ...
             netcdf_l2_file ':']);
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'netcdf_l2'));
   end
 
 
   %% Generate gridded data figures.
   if ~isempty(fieldnames(data_gridded)) && ~isempty(figure_dir)
     disp('Generating figures from gridded data...');
+    stage_start = tic();
     try
       figures.figgrid = generateGliderFigures( ...
         data_gridded, figgrid_options, ...
@@ -694,11 +787,15 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp('Error generating gridded data figures:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'figures_gridded'));
   end
 
 
   %% Copy selected products to corresponding public location, if needed.
+  stage_start = tic();
   if ~isempty(fieldnames(outputs))
     disp('Copying public outputs...');
     strloglist = '';
@@ -846,9 +943,35 @@ for deployment_idx = 1:numel(deployment_list)
   end
 
 
+  %% Record deployment metrics.
+  recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+               toc(stage_start), setfield(metric_labels, 'stage', 'publishing'));
+  recordMetric('counter', 'glider_toolbox_deployment_errors_total', ...
+               deployment_errors, metric_labels);
+  if deployment_errors == 0
+    recordMetric('gauge', 'glider_toolbox_last_success_timestamp_seconds', ...
+                 posixtime(), metric_labels);
+  end
+  recordMetric('histogram', 'glider_toolbox_deployment_duration_seconds', ...
+               toc(deployment_timer), metric_labels);
+  recordMetric('gauge', 'glider_toolbox_last_run_timestamp_seconds', ...
+               posixtime(), metric_labels);
+
+
   %% Stop deployment processing logging.
   disp(['Deployment processing end time: ' ...
         datestr(posixtime2utc(posixtime()), 'yyyy-mm-ddTHH:MM:SS+00:00')]);
   diary('off');
 
 end
+
+
+%% Export processing metrics of the run.
+if ~isempty(metrics_prom) || ~isempty(metrics_json)
+  try
+    writeMetrics(metrics_prom, metrics_json);
+  catch exception
+    disp('Error writing processing metrics:');
+    disp(getReport(exception, 'extended'));
+  end
+end
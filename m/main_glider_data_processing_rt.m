@@ -45,12 +45,31 @@
 %    the processing of the deployment, and it is turned off when the processing
 %    finishes, with the function DIARY.
 %
+%    Each deployment is locked by ACQUIRELOCK while it is processed, so that
+%    overlapping runs (e.g. when a run lasts longer than the scheduling period)
+%    never process the same deployment at once. A run finding a deployment
+%    locked skips it and marks the lock as pending, handing off the new files
+%    to the run holding it, which processes the deployment again when finished.
+%    The lock directory may be configured in CONFIGPATHSLOCAL.
+%
+%    Instead of running this script from a scheduler, it may be run by
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON, which keeps the configuration and
+%    the deployment list in a long running session and runs it only for the
+%    deployments with new files on the remote servers.
+%
+%    Processing metrics of each deployment (files and bytes downloaded, files
+%    loaded, samples processed, profiles, errors and stage durations) are
+%    recorded with RECORDMETRIC, and exported by WRITEMETRICS at the end of
+%    each run to a Prometheus text file and a JSON lines log in the glider data
+%    directory of the toolbox. The names of these files are set at the
+%    beginning of this script.
+%
 %    New raw data files of the deployment are fetched from remote servers.
 %    For Slocum gliders, binary and log files are retrieved by 
-%    GETDOCKSERVERFILES from each dockserver specified in CONFIGDOCKSERVERS,
+%    GETDOCKSERVERFILES from the dockservers specified in CONFIGDOCKSERVERS,
 %    and stored in the binary and log directories configured in 
 %    CONFIGRTPATHSLOCAL. For Seaglider gliders, engineering data files and 
-%    log data files are retrieved by GETBASESTATIONFILES from each basestation
+%    log data files are retrieved by GETBASESTATIONFILES from the basestations
 %    specified in CONFIGBASESTATIONS, and stored in the ascii folder specified
 %    in CONFIGRTPATHSLOCAL. For SeaExplorer gliders the file retrieval is not
 %    implemented yet. The names of the files to download may be restricted in
@@ -63,8 +82,18 @@
 %    The path to the 'dbd2asc' program may be configured in CONFIGWRCPROGRAMS.
 %    File conversion options may be configured in CONFIGRTFILEOPTIONSSLOCUM,
 %    and the directory for converted text files in CONFIGRTPATHSLOCAL.
+%    Before the conversion, the sensor lists needed by the binary files are
+%    checked against the cache directory with LOADSENSORLISTCACHE, and files
+%    whose sensor list is not available are reported and skipped.
+%    If the option BINARY_LOADING is set in CONFIGRTFILEOPTIONSSLOCUM, the
+%    conversion is skipped and the binary files are loaded directly by
+%    LOADSLOCUMDATA. In that case new binary files fetched from SFTP
+%    dockservers are downloaded to memory and written to the binary directory
+%    in the same transfer, and they are decoded from the downloaded contents
+%    without reading them back from disk.
 %
 %    Input deployment raw data is loaded from the directory of raw text files
+%    (or binary files for Slocum gliders with BINARY_LOADING set)
 %    with LOADSLOCUMDATA, LOADSEAGLIDERDATA or LOADSEAEXPLORERDATA.
 %    Data loading options may be configured in CONFIGRTFILEOPTIONSSLOCUM,
 %    CONFIGRTFILEOPTIONSSEAGLIDER, and CONFIGRTFILEOPTIONSSEAEXPLORER.
@@ -83,7 +112,9 @@
 %    actions (interpolations, filterings, corrections and derivations) 
 %    and its parameters may be configured in CONFIGDATAPROCESSINGSLOCUMG1, 
 %    CONFIGDATAPROCESSINGSLOCUMG2, CONFIGDATAPROCESSINGSEAGLIDER and
-%    CONFIGDATAPROCESSINGSEAEXPLORER.
+%    CONFIGDATAPROCESSINGSEAEXPLORER. The sensor and thermal lag parameter
+%    estimates of each pair of casts are kept in the cache file configured in
+%    CONFIGRTPATHSLOCAL, so that only the new pairs are estimated in later runs.
 %
 %    Processed data is interpolated/binned with GRIDGLIDERDATA to obtain a data 
 %    set with the structure of a trajectory of instantaneous vertical profiles 
@@ -112,7 +143,9 @@
 %    provided that their call syntax is compatible with GENERATEGLIDERFIGURES.
 %
 %    Selected data output products and figures may be copied to a public 
-%    location for distribution purposes. For figures, a service file describing
+%    location for distribution purposes. Files are copied by PUBLISHFILE,
+%    which skips the public files that are already up to date and replaces the
+%    rest atomically. For figures, a service file describing
 %    the available figures and their public location may also be generated.
 %    This file is generated by function SAVEJSON with the figure information
 %    returned by GENERATEGLIDERFIGURES updated with the new public location.
@@ -120,6 +153,7 @@
 %    in CONFIGRTPATHSPUBLIC.
 %
 %  See also:
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON
 %    CONFIGWRCPROGRAMS
 %    CONFIGDOCKSERVERS
 %    CONFIGBASESTATIONS
@@ -155,7 +189,10 @@
 %    DIARY
 %    STRFSTRUCT
 %    XBD2DBA
+%    LOADSENSORLISTCACHE
 %    SAVEJSON
+%    RECORDMETRIC
+%    WRITEMETRICS
 %
 %  Notes:
 %    This script is based on the previous work by Tomeu Garau. He is the true
@@ -185,99 +222,127 @@
 configuration_file = 'configMainRT.txt';
 deployment_file    = 'deploymentRT.txt';
 
+% Processing metrics files relative to the glider data directory
+% (see WRITEMETRICS), empty to skip the output.
+metrics_prom_file = 'glider_toolbox_rt.prom';
+metrics_json_file = 'glider_toolbox_rt_metrics.jsonl';
+
 % required parameters of deployment structure
 required_deployment_strparam = {'deployment_name', 'glider_name', ...
                        'glider_serial', 'glider_model'};
 required_deployment_numparam = {'deployment_id', ...
                        'deployment_start', 'deployment_end'};
 
-%% Configure toolbox and configuration file path.
-glider_toolbox_dir = configGliderToolboxPath();
-glider_toolbox_ver = configGliderToolboxVersion();
-
-fconfig = fullfile(glider_toolbox_dir, 'config', configuration_file);
-config = setupConfiguration(glider_toolbox_dir, 'fconfig', fconfig);
-
-deployment_file = fullfile(glider_toolbox_dir, 'config', deployment_file);
-                        
-                        
-%% Configure deployment data and binary paths.
-% This is necessary since we changed the configuration setup
-config.paths_public.netcdf_l0   = fullfile(config.public_paths.base_dir,config.public_paths.netcdf_l0);
-config.paths_public.netcdf_l1   = fullfile(config.public_paths.base_dir,config.public_paths.netcdf_l1);
-config.paths_public.netcdf_l2   = fullfile(config.public_paths.base_dir,config.public_paths.netcdf_l2);
-config.paths_public.figure_dir  = fullfile(config.public_paths.base_html_dir,config.public_paths.figure_dir);
-config.paths_public.figure_url  = fullfile(config.public_paths.base_url,config.public_paths.figure_dir);
-config.paths_public.figure_info = fullfile(config.public_paths.base_html_dir,config.public_paths.figure_info);
-
-config.paths_local.binary_path    = fullfile(config.local_paths.base_dir,config.local_paths.binary_path);
-config.paths_local.cache_path     = fullfile(config.local_paths.base_dir,config.local_paths.cache_path);
-config.paths_local.log_path       = fullfile(config.local_paths.base_dir,config.local_paths.log_path);
-config.paths_local.ascii_path     = fullfile(config.local_paths.base_dir,config.local_paths.ascii_path);
-config.paths_local.figure_path    = fullfile(config.local_paths.base_dir,config.local_paths.figure_path);
-config.paths_local.netcdf_l0      = fullfile(config.local_paths.base_dir,config.local_paths.netcdf_l0);
-config.paths_local.netcdf_l1      = fullfile(config.local_paths.base_dir,config.local_paths.netcdf_l1);
-config.paths_local.netcdf_l2      = fullfile(config.local_paths.base_dir,config.local_paths.netcdf_l2);
-config.paths_local.processing_log = fullfile(config.local_paths.base_dir,config.local_paths.processing_log);
-config.paths_local.config_record  = fullfile(config.local_paths.base_dir,config.local_paths.config_record);
-
-config.wrcprogs.dbd2asc             = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dbd2asc);
-config.wrcprogs.dba_merge           = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba_merge);
-config.wrcprogs.dba_sensor_filter   = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba_sensor_filter);
-config.wrcprogs.dba_time_filter     = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba_time_filter);
-config.wrcprogs.dba2_orig_matlab    = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba2_orig_matlab);
-config.wrcprogs.rename_dbd_files    = fullfile(config.wrcprogs.base_dir, config.wrcprogs.rename_dbd_files);
-
-%% Configure data base deployment information source.
-[config.db_query, config.db_fields] = configRTDeploymentInfoQueryDB();
-
-
-%% Get list of deployments to process from database.
-% If the active parameter is set and set to 0 then the deployments will be
-% gathered from the deployment file under config
-user_db_access = 1;
-deployment_list = '';
-if ~isempty(config.db_access) && isfield(config.db_access, 'active')
-    user_db_access = config.db_access.active;
-end
-if user_db_access         
-    disp('Querying information of glider deployments...');
-    deployment_list = getDeploymentInfoDB( ...
-      config.db_query, config.db_access.name, ...
-      'user', config.db_access.user, 'pass', config.db_access.pass, ...
-      'server', config.db_access.server, 'driver', config.db_access.driver, ...
-      'fields', config.db_fields);
-else
-    disp(['Reading information of glider deployments from ' deployment_file '...']);
-    try
-        read_deployment = readConfigFile(deployment_file);
-        deployment_list = read_deployment.deployment_list;
-        
-        %Check/modify format of deployment_list 
-        for i=1:numel(required_deployment_strparam)
-           fieldname = required_deployment_strparam(i);
-           if ~isfield( deployment_list, fieldname{1})
-               disp(['ERROR: Deployment definition does not contain ' fieldname{1}]);
-               return;
-           end
-        end
-        for i=1:numel(required_deployment_numparam)
-           fieldname = required_deployment_numparam(i);
-           if ~isfield( deployment_list, fieldname{1})
-               disp(['ERROR: Deployment definition does not contain ' fieldname{1}]);
-               return;
-           else
-               for j=1:numel(deployment_list)   
-                   deployment_list(j).(fieldname{1}) = str2num(deployment_list(j).(fieldname{1}));
-               end
-           end
-        end
-    catch exception
-        disp(['Error reading deployment file ' deployment_file]);
-        disp(getReport(exception, 'extended'));
-    end    
+%% Configure toolbox, deployment information source and deployment list.
+% When run from MAIN_GLIDER_DATA_PROCESSING_DAEMON with a warm state, the
+% configuration and the deployment list of the previous run are reused,
+% and only the deployments queued by the daemon are processed.
+rt_warm = exist('rt_daemon', 'var') && rt_daemon.warm;
+if ~rt_warm
+
+  %% Configure toolbox and configuration file path.
+  glider_toolbox_dir = configGliderToolboxPath();
+  glider_toolbox_ver = configGliderToolboxVersion();
+
+  fconfig = fullfile(glider_toolbox_dir, 'config', configuration_file);
+  config = setupConfiguration(glider_toolbox_dir, 'fconfig', fconfig);
+
+  deployment_file = fullfile(glider_toolbox_dir, 'config', deployment_file);
+
+  metrics_prom = '';
+  metrics_json = '';
+  if ~isempty(metrics_prom_file)
+    metrics_prom = fullfile(glider_toolbox_dir, 'glider_data', metrics_prom_file);
+  end
+  if ~isempty(metrics_json_file)
+    metrics_json = fullfile(glider_toolbox_dir, 'glider_data', metrics_json_file);
+  end
+
+
+  %% Configure deployment data and binary paths.
+  % This is necessary since we changed the configuration setup
+  config.paths_public.netcdf_l0   = fullfile(config.public_paths.base_dir,config.public_paths.netcdf_l0);
+  config.paths_public.netcdf_l1   = fullfile(config.public_paths.base_dir,config.public_paths.netcdf_l1);
+  config.paths_public.netcdf_l2   = fullfile(config.public_paths.base_dir,config.public_paths.netcdf_l2);
+  config.paths_public.figure_dir  = fullfile(config.public_paths.base_html_dir,config.public_paths.figure_dir);
+  config.paths_public.figure_url  = fullfile(config.public_paths.base_url,config.public_paths.figure_dir);
+  config.paths_public.figure_info = fullfile(config.public_paths.base_html_dir,config.public_paths.figure_info);
+
+  config.paths_local.binary_path    = fullfile(config.local_paths.base_dir,config.local_paths.binary_path);
+  config.paths_local.cache_path     = fullfile(config.local_paths.base_dir,config.local_paths.cache_path);
+  config.paths_local.log_path       = fullfile(config.local_paths.base_dir,config.local_paths.log_path);
+  config.paths_local.ascii_path     = fullfile(config.local_paths.base_dir,config.local_paths.ascii_path);
+  config.paths_local.figure_path    = fullfile(config.local_paths.base_dir,config.local_paths.figure_path);
+  config.paths_local.netcdf_l0      = fullfile(config.local_paths.base_dir,config.local_paths.netcdf_l0);
+  config.paths_local.netcdf_l1      = fullfile(config.local_paths.base_dir,config.local_paths.netcdf_l1);
+  config.paths_local.netcdf_l2      = fullfile(config.local_paths.base_dir,config.local_paths.netcdf_l2);
+  config.paths_local.processing_log = fullfile(config.local_paths.base_dir,config.local_paths.processing_log);
+  config.paths_local.config_record  = fullfile(config.local_paths.base_dir,config.local_paths.config_record);
+  config.paths_local.lock_path      = fullfile(config.local_paths.base_dir,config.local_paths.lock_path);
+  config.paths_local.lag_cache      = fullfile(config.local_paths.base_dir,config.local_paths.lag_cache);
+
+  config.wrcprogs.dbd2asc             = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dbd2asc);
+  config.wrcprogs.dba_merge           = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba_merge);
+  config.wrcprogs.dba_sensor_filter   = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba_sensor_filter);
+  config.wrcprogs.dba_time_filter     = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba_time_filter);
+  config.wrcprogs.dba2_orig_matlab    = fullfile(config.wrcprogs.base_dir, config.wrcprogs.dba2_orig_matlab);
+  config.wrcprogs.rename_dbd_files    = fullfile(config.wrcprogs.base_dir, config.wrcprogs.rename_dbd_files);
+
+  %% Configure data base deployment information source.
+  [config.db_query, config.db_fields] = configRTDeploymentInfoQueryDB();
+
+
+  %% Get list of deployments to process from database.
+  % If the active parameter is set and set to 0 then the deployments will be
+  % gathered from the deployment file under config
+  user_db_access = 1;
+  deployment_list = '';
+  if ~isempty(config.db_access) && isfield(config.db_access, 'active')
+      user_db_access = config.db_access.active;
+  end
+  if user_db_access         
+      disp('Querying information of glider deployments...');
+      deployment_list = getDeploymentInfoDB( ...
+        config.db_query, config.db_access.name, ...
+        'user', config.db_access.user, 'pass', config.db_access.pass, ...
+        'server', config.db_access.server, 'driver', config.db_access.driver, ...
+        'fields', config.db_fields, ...
+        'cache', config.db_access.cache, ...
+        'cache_ttl', config.db_access.cache_ttl);
+  else
+      disp(['Reading information of glider deployments from ' deployment_file '...']);
+      try
+          read_deployment = readConfigFile(deployment_file);
+          deployment_list = read_deployment.deployment_list;
+
+          %Check/modify format of deployment_list 
+          for i=1:numel(required_deployment_strparam)
+             fieldname = required_deployment_strparam(i);
+             if ~isfield( deployment_list, fieldname{1})
+                 disp(['ERROR: Deployment definition does not contain ' fieldname{1}]);
+                 return;
+             end
+          end
+          for i=1:numel(required_deployment_numparam)
+             fieldname = required_deployment_numparam(i);
+             if ~isfield( deployment_list, fieldname{1})
+                 disp(['ERROR: Deployment definition does not contain ' fieldname{1}]);
+                 return;
+             else
+                 for j=1:numel(deployment_list)   
+                     deployment_list(j).(fieldname{1}) = str2num(deployment_list(j).(fieldname{1}));
+                 end
+             end
+          end
+      catch exception
+          disp(['Error reading deployment file ' deployment_file]);
+          disp(getReport(exception, 'extended'));
+      end    
+  end
+
 end
 
+
 if isempty(deployment_list)
   disp('No active glider deployments available.');
   return
@@ -286,12 +351,43 @@ else
 end
 
 %% Process active deployments.
-for deployment_idx = 1:numel(deployment_list)
+% Deployments are processed from a queue, holding a lock on each deployment
+% to prevent overlapping runs from processing it at the same time.
+% Deployments locked by another run are skipped, and the lock is marked as
+% pending to hand off the new files to the holder. Deployments marked as
+% pending by another run while being processed here are queued again.
+deployment_queue = 1:numel(deployment_list);
+if rt_warm
+  deployment_queue = rt_daemon.queue(:)';
+end
+while ~isempty(deployment_queue)
+  deployment_idx = deployment_queue(1);
+  deployment_queue(1) = [];
+
+  %% Acquire deployment lock.
+  deployment = deployment_list(deployment_idx);
+  lock_dir = strfstruct(config.paths_local.lock_path, deployment);
+  try
+    [deployment_lock, lock_owner] = acquireLock(lock_dir);
+  catch exception
+    disp(['Error acquiring lock of deployment ' num2str(deployment_idx) ...
+          ' ' lock_dir ':']);
+    disp(getReport(exception, 'extended'));
+    continue
+  end
+  if isempty(deployment_lock)
+    disp(['Deployment ' num2str(deployment_idx) ...
+          ' is being processed by another run (pid ' ...
+          num2str(lock_owner.pid) ' on ' lock_owner.host ...
+          '), handing off new files.']);
+    continue
+  end
+
+
   %% Set deployment field shortcut variables and initialize other ones.
   % Initialization of big data variables may reduce out of memory problems,
   % provided memory is properly freed and not fragmented.
   disp(['Processing deployment ' num2str(deployment_idx) '...']);
-  deployment = deployment_list(deployment_idx);
   processing_log = strfstruct(config.paths_local.processing_log, deployment);
   config_record  = strfstruct(config.paths_local.config_record, deployment);
   binary_dir = strfstruct(config.paths_local.binary_path, deployment);
@@ -302,6 +398,7 @@ for deployment_idx = 1:numel(deployment_list)
   netcdf_l0_file = strfstruct(config.paths_local.netcdf_l0, deployment);
   netcdf_l1_file = strfstruct(config.paths_local.netcdf_l1, deployment);
   netcdf_l2_file = strfstruct(config.paths_local.netcdf_l2, deployment);
+  lag_cache_file = strfstruct(config.paths_local.lag_cache, deployment);
   source_files = {};
   meta_raw = struct();
   data_raw = struct();
@@ -356,11 +453,17 @@ for deployment_idx = 1:numel(deployment_list)
   if isfield(deployment, 'calibrations')
     preprocessing_options.calibration_parameter_list = deployment.calibrations;
   end
+  processing_options.lag_cache = lag_cache_file;
   gridding_options = config.gridding_options;
   netcdf_l1_options = config.output_netcdf_l1;
   netcdf_l2_options = config.output_netcdf_l2;
   figproc_options = config.figures_processed.options;
   figgrid_options = config.figures_gridded.options;
+  % Labels of the metrics of this deployment (see RECORDMETRIC).
+  metric_labels = struct('deployment', deployment_name, ...
+                         'glider', glider_name);
+  deployment_errors = 0;
+  deployment_timer = tic();
 
 
   %% Start deployment processing logging.
@@ -435,108 +538,156 @@ for deployment_idx = 1:numel(deployment_list)
 
 
   %% Download deployment glider files from station(s).
-  % Check for new or updated deployment files in every dockserver.
+  % Check for new or updated deployment files in all dockservers at once,
+  % so that files mirrored on several servers are downloaded only once.
   % Deployment start time must be truncated to days because the date of 
   % a binary file is deduced from its name only up to day precission.
   % Deployment end time may be undefined.
+  % When all the dockservers are accessed through SFTP, the header of the
+  % binary files is inspected remotely and only files opened during the
+  % deployment are downloaded (files from test missions on the day of the
+  % deployment start are skipped). Files whose opening time can not be
+  % parsed are downloaded anyway.
   disp('Download deployment new data...');
+  stage_start = tic();
   download_start = datenum(datestr(deployment_start,'yyyy-mm-dd'),'yyyy-mm-dd');
   if isnan(deployment_end)
     download_final = posixtime2utc(posixtime());
   else
     download_final = deployment_end;
   end
+  download_xbdheader = [];
+  download_conns = {};
+  if isfield(config.dockservers.server, 'conn')
+    download_conns = {config.dockservers.server.conn};
+  end
+  download_sftp = @(c)((ischar(c) && strcmp(c, 'sftp')) || ...
+                       (isa(c, 'function_handle') && ...
+                        any(strcmp(func2str(c), {'sftp' '@sftp'}))));
+  if ~isempty(download_conns) && all(cellfun(download_sftp, download_conns))
+    download_xbdheader = ...
+      @(h)(~(xbdopentime(h) < deployment_start || xbdopentime(h) > download_final));
+  end
+  % When binary files are loaded directly, keep the contents of the binary
+  % files downloaded from SFTP dockservers in memory to decode them later.
+  binary_loading = ...
+    any(strcmp(glider_type, {'slocum_g1' 'slocum_g2'})) ...
+    && isfield(file_options, 'binary_loading') && file_options.binary_loading;
   switch glider_type
     case {'slocum_g1' 'slocum_g2'}
-      new_xbds = cell(size(config.dockservers.server));
-      new_logs = cell(size(config.dockservers.server));
-      for dockserver_idx = 1:numel(config.dockservers.server)
-        dockserver = config.dockservers.server(dockserver_idx);
-        try
-          [new_xbds{dockserver_idx}, new_logs{dockserver_idx}] = ...
-            getDockserverFiles(dockserver, binary_dir, log_dir, ...
-                               'glider', glider_name, ...
-                               'xbd', file_options.xbd_name_pattern, ...                     
-                               'log', file_options.log_name_pattern, ...
-                               'start', download_start, ...
-                               'final', download_final);
-        catch exception
-          disp(['Error getting dockserver files from ' dockserver.host ':']);
-          disp(getReport(exception, 'extended'));
-        end
-      end  
-      new_xbds = [new_xbds{:}];
-      new_logs = [new_logs{:}];
+      new_xbds = {};
+      new_logs = {};
+      new_xbds_contents = {};
+      try
+        [new_xbds, new_logs, new_xbds_contents] = ...
+          getDockserverFiles(config.dockservers.server, binary_dir, log_dir, ...
+                             'glider', glider_name, ...
+                             'xbd', file_options.xbd_name_pattern, ...
+                             'log', file_options.log_name_pattern, ...
+                             'start', download_start, ...
+                             'final', download_final, ...
+                             'xbdheader', download_xbdheader, ...
+                             'xbdcontents', binary_loading);
+      catch exception
+        disp('Error getting dockserver files:');
+        disp(getReport(exception, 'extended'));
+        deployment_errors = deployment_errors + 1;
+      end
+      new_downloads = [new_xbds(:); new_logs(:)];
       disp(['Binary data files downloaded: '  num2str(numel(new_xbds)) '.']);
       disp(['Surface log files downloaded: '  num2str(numel(new_logs)) '.']);
     case {'seaglider'}
-      new_engs = cell(size(config.basestations));
-      new_logs = cell(size(config.basestations));
-      for basestation_idx = 1:numel(config.basestations)
-        basestation = config.dockservers.server(basestation_idx);
-        try
-          [new_engs{basestation_idx}, new_logs{basestation_idx}] = ...
-            getDockserverFiles(basestation, ascii_dir, ascii_dir, ...
-                               'glider', glider_serial, ...
-                               'eng', file_options.eng_name_pattern, ...                     
-                               'log', file_options.log_name_pattern, ...
-                               'start', download_start, ...
-                               'final', download_final);
-        catch exception
-          disp(['Error getting basestation files from ' basestation.host ':']);
-          disp(getReport(exception, 'extended'));
-        end
-      end  
-      new_engs = [new_engs{:}];
-      new_logs = [new_logs{:}];
+      new_engs = {};
+      new_logs = {};
+      try
+        [new_engs, new_logs] = ...
+          getBasestationFiles(config.basestations, glider_serial, ...
+                              ascii_dir, ascii_dir, ...
+                              'eng', file_options.eng_name_pattern, ...
+                              'log', file_options.log_name_pattern, ...
+                              'start', download_start, ...
+                              'final', download_final);
+      catch exception
+        disp('Error getting basestation files:');
+        disp(getReport(exception, 'extended'));
+        deployment_errors = deployment_errors + 1;
+      end
+      new_downloads = [new_engs(:); new_logs(:)];
       disp(['Engineering data files downloaded: '  num2str(numel(new_engs)) '.']);
       disp(['Dive log data files downloaded: '  num2str(numel(new_logs)) '.']);
     case {'seaexplorer'}
       warning('glider_toolbox:main_glider_data_processing_dt:NotImplemented', ...
               'Real time file retrieval not implemented for SeaExplorer')
+      new_downloads = {};
     otherwise
+      new_downloads = {};
   end
+  new_downloads_info = cellfun(@dir, new_downloads, 'UniformOutput', false);
+  recordMetric('counter', 'glider_toolbox_files_downloaded_total', ...
+               numel(new_downloads), metric_labels);
+  recordMetric('counter', 'glider_toolbox_bytes_downloaded_total', ...
+               sum(cellfun(@(d)(sum([d.bytes])), new_downloads_info)), ...
+               metric_labels);
+  recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+               toc(stage_start), setfield(metric_labels, 'stage', 'download'));
 
 
   %% Convert binary glider files to ascii human readable format.
+  deployment_lock = refreshLock(deployment_lock);
   % For Seaglider, do nothing but join the lists of new eng and log files.
   % For Slocum, convert each downloaded binary file to ascii format in the
   % ascii directory and store the returned absolute path for later use.
   % Since some conversion may fail use a cell array of string cell arrays and
   % flatten it when finished, leaving only the succesfully created dbas.
-  % Give a second try to failing files, because they might have failed due to 
-  % a missing cache file generated later.
+  % Check the sensor lists required by the new files before converting them:
+  % convert first the files providing their sensor list (they generate the
+  % cache files needed by the others), and report upfront and skip the files
+  % whose sensor list cache file is missing.
+  % When binary files are loaded directly, skip the conversion.
   switch glider_type
     case {'slocum_g1' 'slocum_g2'}
-      disp('Converting binary data files to ascii format...');
-      new_files = cell(size(new_xbds));
-      for conversion_retry = 1:2
-        for xbd_idx = 1:numel(new_xbds)
-          if isempty(new_files{xbd_idx})
-            xbd_fullfile = new_xbds{xbd_idx};
-            [~, xbd_name, xbd_ext] = fileparts(xbd_fullfile);
-            xbd_name_ext = [xbd_name xbd_ext];
-            dba_name_ext = regexprep(xbd_name_ext, ...
-                                     file_options.xbd_name_pattern, ...
-                                     file_options.dba_name_replace);
-            dba_fullfile = fullfile(ascii_dir, dba_name_ext);
-            try
-              new_files{xbd_idx} = ...
-                {xbd2dba(xbd_fullfile, dba_fullfile, 'cache', cache_dir, ...
-                         'cmdname', config.wrcprogs.dbd2asc)};
-            catch exception
-              new_files{xbd_idx} = {};
-              if conversion_retry == 2
-                disp(['Error converting binary file ' xbd_name_ext ':']);
-                disp(getReport(exception, 'extended'));
-              end
-            end
+      if binary_loading
+        disp('Skip binary conversion: binary files are loaded directly');
+        new_files = new_xbds;
+      else
+        disp('Converting binary data files to ascii format...');
+        stage_start = tic();
+        new_files = cell(size(new_xbds));
+        [new_xbds_crcs, new_xbds_factored, new_xbds_missing] = ...
+          loadSensorListCache(new_xbds, cache_dir);
+        if any(new_xbds_missing)
+          disp(['Binary files with missing sensor list cache files: ' ...
+                num2str(sum(new_xbds_missing)) '.']);
+          new_xbds_missing_info = [reshape(new_xbds(new_xbds_missing), 1, []);
+                                   reshape(new_xbds_crcs(new_xbds_missing), 1, [])];
+          fprintf('  %s (%s.cac)\n', new_xbds_missing_info{:});
+        end
+        [~, new_xbds_order] = sort(new_xbds_factored);
+        for xbd_idx = reshape(new_xbds_order(~new_xbds_missing(new_xbds_order)), 1, [])
+          xbd_fullfile = new_xbds{xbd_idx};
+          [~, xbd_name, xbd_ext] = fileparts(xbd_fullfile);
+          xbd_name_ext = [xbd_name xbd_ext];
+          dba_name_ext = regexprep(xbd_name_ext, ...
+                                   file_options.xbd_name_pattern, ...
+                                   file_options.dba_name_replace);
+          dba_fullfile = fullfile(ascii_dir, dba_name_ext);
+          try
+            new_files{xbd_idx} = ...
+              {xbd2dba(xbd_fullfile, dba_fullfile, 'cache', cache_dir, ...
+                       'cmdname', config.wrcprogs.dbd2asc)};
+          catch exception
+            new_files{xbd_idx} = {};
+            disp(['Error converting binary file ' xbd_name_ext ':']);
+            disp(getReport(exception, 'extended'));
+            deployment_errors = deployment_errors + 1;
           end
         end
+        new_files = [new_files{:}];
+        disp(['Binary files converted: ' ...
+             num2str(numel(new_files)) ' of ' num2str(numel(new_xbds)) '.']);
+        recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                     toc(stage_start), setfield(metric_labels, 'stage', 'conversion'));
       end
-      new_files = [new_files{:}];
-      disp(['Binary files converted: ' ...
-           num2str(numel(new_files)) ' of ' num2str(numel(new_xbds)) '.']);
     case {'seaglider'}
       new_files = [new_engs{:} new_logs{:}];
     case {'seaexplorer'}
@@ -548,11 +699,13 @@ for deployment_idx = 1:numel(deployment_list)
   end
 
 
-  %% Load data from ascii deployment glider files if there is new data.
+  %% Load data from ascii (or binary) deployment glider files if there is new data.
+  deployment_lock = refreshLock(deployment_lock);
   if isempty(new_files)
     disp('No new deployment data, processing and product generation will be skipped.');
   else
     disp('Loading raw deployment data from text files...');
+    stage_start = tic();
     load_start = utc2posixtime(deployment_start);
     load_final = posixtime();
     if ~isnan(deployment_end)
@@ -561,15 +714,39 @@ for deployment_idx = 1:numel(deployment_list)
     try
       switch glider_type
         case {'slocum_g1' 'slocum_g2'}
+          if binary_loading
+            % Decode the new binary files from their downloaded contents,
+            % and the previous ones from the binary directory.
+            load_dir = binary_dir;
+            load_pattern_nav = '^.*\.dbd$';
+            load_pattern_sci = '^.*\.ebd$';
+            if isfield(file_options, 'xbd_name_pattern_nav')
+              load_pattern_nav = file_options.xbd_name_pattern_nav;
+            end
+            if isfield(file_options, 'xbd_name_pattern_sci')
+              load_pattern_sci = file_options.xbd_name_pattern_sci;
+            end
+            load_contents = containers.Map();
+            for xbd_idx = find(~cellfun(@isempty, new_xbds_contents(:)'))
+              [~, xbd_name, xbd_ext] = fileparts(new_xbds{xbd_idx});
+              load_contents([xbd_name xbd_ext]) = new_xbds_contents{xbd_idx};
+            end
+          else
+            load_dir = ascii_dir;
+            load_pattern_nav = file_options.dba_name_pattern_nav;
+            load_pattern_sci = file_options.dba_name_pattern_sci;
+            load_contents = [];
+          end
           [meta_raw, data_raw] = ...
-            loadSlocumData(ascii_dir, ...
-                           file_options.dba_name_pattern_nav, ...
-                           file_options.dba_name_pattern_sci, ...
+            loadSlocumData(load_dir, load_pattern_nav, load_pattern_sci, ...
                            'timenav', file_options.dba_time_sensor_nav, ...
                            'timesci', file_options.dba_time_sensor_sci, ...
                            'sensors', file_options.dba_sensors, ...
                            'period', [load_start load_final], ...
-                           'format', 'struct');
+                           'format', 'struct', ...
+                           'binary', binary_loading, ...
+                           'cache', cache_dir, ...
+                           'contents', load_contents);
           source_files = {meta_raw.headers.filename_label};
         case 'seaglider'
           [meta_raw, data_raw] = ...
@@ -597,7 +774,12 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp('Error loading raw data:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'loading'));
+    recordMetric('counter', 'glider_toolbox_files_loaded_total', ...
+                 numel(source_files), metric_labels);
   end
 
 
@@ -610,6 +792,7 @@ for deployment_idx = 1:numel(deployment_list)
   %% Generate L0 NetCDF file (raw/preprocessed data), if needed and possible.
   if ~isempty(fieldnames(data_raw)) && ~isempty(netcdf_l0_file)
     disp('Generating NetCDF L0 output...');
+    stage_start = tic();
     try
       switch glider_type
         case {'slocum_g1' 'slocum_g2'}
@@ -654,13 +837,18 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp(['Error generating NetCDF L0 (raw data) output ' netcdf_l0_file ':']);
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'netcdf_l0'));
   end
 
 
   %% Preprocess raw glider data.
+  deployment_lock = refreshLock(deployment_lock);
   if ~isempty(fieldnames(data_raw))
     disp('Preprocessing raw data...');
+    stage_start = tic();
     try
       switch glider_type 
         case 'seaglider'
@@ -674,19 +862,34 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp('Error preprocessing glider deployment data:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'preprocessing'));
   end
 
 
   %% Process preprocessed glider data.
   if ~isempty(fieldnames(data_preprocessed))
     disp('Processing glider data...');
+    stage_start = tic();
     try
       [data_processed, meta_processed] = ...
         processGliderData(data_preprocessed, meta_preprocessed, processing_options);
     catch exception
       disp('Error processing glider deployment data:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
+    end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'processing'));
+    if isfield(data_processed, 'time')
+      recordMetric('counter', 'glider_toolbox_samples_processed_total', ...
+                   numel(data_processed.time), metric_labels);
+    end
+    if isfield(data_processed, 'profile_index')
+      recordMetric('gauge', 'glider_toolbox_profiles', ...
+                   max([0; data_processed.profile_index(:)]), metric_labels);
     end
   end
 
@@ -694,6 +897,7 @@ for deployment_idx = 1:numel(deployment_list)
   %% Generate L1 NetCDF file (processed data), if needed and possible.
   if ~isempty(fieldnames(data_processed)) && ~isempty(netcdf_l1_file)
     disp('Generating NetCDF L1 output...');
+    stage_start = tic();
     try
       outputs.netcdf_l1 = generateOutputNetCDF( ...
         netcdf_l1_file, data_processed, meta_processed, deployment, ...
@@ -706,13 +910,17 @@ for deployment_idx = 1:numel(deployment_list)
       disp(['Error generating NetCDF L1 (processed data) output ' ...
             netcdf_l1_file ':']);
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'netcdf_l1'));
   end
 
 
   %% Generate processed data figures.
   if ~isempty(fieldnames(data_processed)) && ~isempty(figure_dir)
     disp('Generating figures from processed data...');
+    stage_start = tic();
     try
       figures.figproc = generateGliderFigures( ...
         data_processed, figproc_options, ...
@@ -721,26 +929,34 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp('Error generating processed data figures:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'figures_processed'));
   end
 
 
   %% Grid processed glider data.
   if ~isempty(fieldnames(data_processed))
     disp('Gridding glider data...');
+    stage_start = tic();
     try
       [data_gridded, meta_gridded] = ...
         gridGliderData(data_processed, meta_processed, gridding_options);
     catch exception
       disp('Error gridding glider deployment data:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'gridding'));
   end
 
 
   %% Generate L2 (gridded data) netcdf file, if needed and possible.
   if ~isempty(fieldnames(data_gridded)) && ~isempty(netcdf_l2_file)
     disp('Generating NetCDF L2 output...');
+    stage_start = tic();
     try
       outputs.netcdf_l2 = generateOutputNetCDF( ...
         netcdf_l2_file, data_gridded, meta_gridded, deployment, ...
@@ -753,13 +969,17 @@ for deployment_idx = 1:numel(deployment_list)
       disp(['Error generating NetCDF L2 (gridded data) output ' ...
             netcdf_l2_file ':']);
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'netcdf_l2'));
   end
 
 
   %% Generate gridded data figures.
   if ~isempty(fieldnames(data_gridded)) && ~isempty(figure_dir)
     disp('Generating figures from gridded data...');
+    stage_start = tic();
     try
       figures.figgrid = generateGliderFigures( ...
         data_gridded, figgrid_options, ...
@@ -768,11 +988,16 @@ for deployment_idx = 1:numel(deployment_list)
     catch exception
       disp('Error generating gridded data figures:');
       disp(getReport(exception, 'extended'));
+      deployment_errors = deployment_errors + 1;
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'figures_gridded'));
   end
 
 
   %% Copy selected products to corresponding public location, if needed.
+  deployment_lock = refreshLock(deployment_lock);
+  stage_start = tic();
   if ~isempty(fieldnames(outputs))
     disp('Copying public outputs...');
     strloglist = '';
@@ -793,7 +1018,7 @@ for deployment_idx = 1:numel(deployment_list)
           message = 'not a directory';
         end
         if status
-          [success, message] = copyfile(output_local_file, output_public_file);
+          [success, message] = publishfile(output_local_file, output_public_file);
           if success
             disp(['Public output ' output_name ' succesfully copied: ' ...
                   output_public_file '.']);
@@ -874,6 +1099,9 @@ for deployment_idx = 1:numel(deployment_list)
         message = 'not a directory';
       end
       if status
+        % Publish all the figures at once, the files are processed in parallel.
+        public_figure_local_list = cell(size(public_figure_name_list));
+        public_figure_public_list = cell(size(public_figure_name_list));
         for public_figure_name_idx = 1:numel(public_figure_name_list)
           public_figure_name = public_figure_name_list{public_figure_name_idx};
           figure_local = public_figures_local.(public_figure_name);
@@ -885,15 +1113,22 @@ for deployment_idx = 1:numel(deployment_list)
           figure_public.fullfile = ...
             fullfile(figure_public.dirname, ...
                      [figure_public.filename '.' figure_public.format]);
-          [success, message] = ...
-            copyfile(figure_local.fullfile, figure_public.fullfile);
-          if success
+          public_figure_local_list{public_figure_name_idx} = figure_local;
+          public_figure_public_list{public_figure_name_idx} = figure_public;
+        end
+        [success_list, message_list] = publishfile( ...
+          cellfun(@(f)(f.fullfile), public_figure_local_list, 'UniformOutput', false), ...
+          cellfun(@(f)(f.fullfile), public_figure_public_list, 'UniformOutput', false));
+        for public_figure_name_idx = 1:numel(public_figure_name_list)
+          public_figure_name = public_figure_name_list{public_figure_name_idx};
+          figure_public = public_figure_public_list{public_figure_name_idx};
+          if success_list(public_figure_name_idx)
             public_figures.(public_figure_name) = figure_public;
             disp(['Public figure ' public_figure_name ' succesfully copied.']);
           else
             disp(['Error creating public copy of figure ' ...
                   public_figure_name ': ' figure_public.fullfile '.']);
-            disp(message);
+            disp(message_list{public_figure_name_idx});
           end
         end
       else
@@ -920,9 +1155,43 @@ for deployment_idx = 1:numel(deployment_list)
   end
 
 
+  %% Record deployment metrics.
+  recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+               toc(stage_start), setfield(metric_labels, 'stage', 'publishing'));
+  recordMetric('counter', 'glider_toolbox_deployment_errors_total', ...
+               deployment_errors, metric_labels);
+  if deployment_errors == 0
+    recordMetric('gauge', 'glider_toolbox_last_success_timestamp_seconds', ...
+                 posixtime(), metric_labels);
+  end
+  recordMetric('histogram', 'glider_toolbox_deployment_duration_seconds', ...
+               toc(deployment_timer), metric_labels);
+  recordMetric('gauge', 'glider_toolbox_last_run_timestamp_seconds', ...
+               posixtime(), metric_labels);
+
+
   %% Stop deployment processing logging.
   disp(['Deployment processing end time: ' ...
         datestr(posixtime2utc(posixtime()), 'yyyy-mm-ddTHH:MM:SS+00:00')]);
   diary('off');
 
+
+  %% Release deployment lock and queue it again if new files were handed off.
+  if releaseLock(deployment_lock)
+    disp(['Deployment ' num2str(deployment_idx) ...
+          ' has new files handed off by another run, queueing it again.']);
+    deployment_queue(end+1) = deployment_idx;
+  end
+
+end
+
+
+%% Export processing metrics of the run.
+if ~isempty(metrics_prom) || ~isempty(metrics_json)
+  try
+    writeMetrics(metrics_prom, metrics_json);
+  catch exception
+    disp('Error writing processing metrics:');
+    disp(getReport(exception, 'extended'));
+  end
 end
@@ -0,0 +1,414 @@
+/**
+ * @file
+ * @brief MATLAB interface to fused calibrations of raw sensor measurements.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2013-2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file implements the function CALIBRATESENSORS, that applies the factory
+ * calibration equations of several signals of a sensor in a single pass over
+ * the raw measurements, writing directly to the output arrays:
+ *   - 'sbect': Sea-Bird CT sail temperature and conductivity from frequencies.
+ *     The conductivity equation uses the calibrated temperature of the same
+ *     record while it is still in a register.
+ *   - 'affine': scale and offset of any number of signals (e.g. WET Labs ECO
+ *     counts). The signals are processed in blocks of records, so that all
+ *     the inputs and outputs of a block stay in cache, and the loops are
+ *     simple enough to be vectorized by the compiler.
+ * Long series are split in chunks of records calibrated concurrently by a set
+ * of POSIX threads, using the shared thread runtime in mexthreads.c.
+ * The kernels in calibratesensors_kernels.h are compiled for several x86
+ * instruction sets (SSE4.2, AVX2, AVX-512) and the best one supported by the
+ * processor is selected at load time (see the 'isa' call).
+ *
+ * The corresponding mex file may be built with the command:
+ *   mex -output calibratesensors calibratesensors.c mexthreads.c -lpthread \
+ *     COPTIMFLAGS='-O3 -ffp-contract=off -fwrapv -DNDEBUG'
+ * On x86-64 GNU/Linux, the logarithm of the Sea-Bird CT kernel is vectorized
+ * with the vector math library of the GNU C library (libmvec), building with:
+ *   mex -output calibratesensors calibratesensors.c mexthreads.c \
+ *     -DCALIBRATESENSORS_LIBMVEC -lmvec -lpthread \
+ *     COPTIMFLAGS='-O3 -ffp-contract=off -fno-math-errno -fwrapv -DNDEBUG'
+ * Contraction of floating point operations must be disabled, otherwise the
+ * AVX-512 version may use fused multiply-add instructions and its results
+ * differ from the other versions. The vector logarithms of each instruction
+ * set differ in the last bits (up to 4 ulp), and so may the temperatures
+ * (and through them the conductivities) computed by each version.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "mex.h"
+#include "mexthreads.h"
+
+#define CALIBRATESENSORS_BLOCK_SIZE 1024
+#define CALIBRATESENSORS_TASK_SIZE 65536
+
+
+/*
+ * Versions of the kernels for each instruction set. The default version uses
+ * the baseline of the compiler. On x86 with GCC, the kernels are also built
+ * for SSE4.2, AVX2 and AVX-512 (without FMA, so that all the versions give
+ * the same results), and the best version supported by the processor is
+ * selected when the mex file is loaded.
+ */
+#if defined(__GNUC__) && !defined(__clang__) \
+    && (defined(__x86_64__) || defined(__i386__)) \
+    && !defined(CALIBRATESENSORS_NO_MULTIVERSION)
+#define CALIBRATESENSORS_MULTIVERSION
+#endif
+
+/*
+ * Vector versions of the logarithm in libmvec, for all the instruction sets.
+ * The math header declares them only with -ffast-math, that would also break
+ * the propagation of invalid values (NaN) in the kernels, so they are declared
+ * here. The compiler uses them only if the logarithm does not set errno
+ * (-fno-math-errno), and the mex file must be linked with -lmvec.
+ */
+#if defined(CALIBRATESENSORS_LIBMVEC) && defined(__GNUC__) \
+    && !defined(__clang__) && defined(__x86_64__)
+double log(double) __attribute__((simd("notinbranch")));
+#endif
+
+#define CALIBRATESENSORS_KERNEL(name) name##_default
+#include "calibratesensors_kernels.h"
+#undef CALIBRATESENSORS_KERNEL
+
+#ifdef CALIBRATESENSORS_MULTIVERSION
+#pragma GCC push_options
+#pragma GCC target("sse4.2")
+#define CALIBRATESENSORS_KERNEL(name) name##_sse42
+#include "calibratesensors_kernels.h"
+#undef CALIBRATESENSORS_KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define CALIBRATESENSORS_KERNEL(name) name##_avx2
+#include "calibratesensors_kernels.h"
+#undef CALIBRATESENSORS_KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#define CALIBRATESENSORS_KERNEL(name) name##_avx512
+#include "calibratesensors_kernels.h"
+#undef CALIBRATESENSORS_KERNEL
+#pragma GCC pop_options
+
+static int supports_sse42(void) { return __builtin_cpu_supports("sse4.2"); }
+static int supports_avx2(void) { return __builtin_cpu_supports("avx2"); }
+static int supports_avx512(void) { return __builtin_cpu_supports("avx512f"); }
+#endif
+
+static int supports_default(void) { return 1; }
+
+
+/**
+ * Version of the kernels for an instruction set.
+ */
+struct calibratesensors_isa
+{
+  const char *name;
+  int (*supported)(void);
+  void (*sbect)(mwSize, const double *, const double *,
+                const double *, mwSize, const double *, const double *,
+                double *, double *);
+  void (*affine)(mwSize, mwSize, mwSize, const double **,
+                 const double *, const double *, double **);
+};
+
+
+/**
+ * Available versions of the kernels, in order of preference.
+ */
+static const struct calibratesensors_isa calibratesensors_isa_list[] =
+{
+#ifdef CALIBRATESENSORS_MULTIVERSION
+  {"avx512", supports_avx512, calibrate_sbect_avx512, calibrate_affine_avx512},
+  {"avx2", supports_avx2, calibrate_sbect_avx2, calibrate_affine_avx2},
+  {"sse4.2", supports_sse42, calibrate_sbect_sse42, calibrate_affine_sse42},
+#endif
+  {"default", supports_default, calibrate_sbect_default, calibrate_affine_default}
+};
+
+#define CALIBRATESENSORS_NUM_ISA \
+  (sizeof(calibratesensors_isa_list) / sizeof(calibratesensors_isa_list[0]))
+
+
+/**
+ * Version of the kernels in use.
+ */
+static const struct calibratesensors_isa *calibratesensors_isa = NULL;
+
+
+/**
+ * @brief Select the best version of the kernels supported by the processor.
+ *
+ * With GCC this is run when the mex file is loaded, otherwise on first call.
+ */
+#ifdef __GNUC__
+__attribute__((constructor))
+#endif
+static void select_isa(void)
+{
+  size_t i;
+#ifdef CALIBRATESENSORS_MULTIVERSION
+  __builtin_cpu_init();
+#endif
+  for (i = 0; !calibratesensors_isa_list[i].supported(); i++)
+    ;
+  calibratesensors_isa = &calibratesensors_isa_list[i];
+}
+
+
+/**
+ * Arguments of a concurrent Sea-Bird CT calibration.
+ */
+struct sbect_args
+{
+  mwSize n;
+  const double *temp_freq;
+  const double *cond_freq;
+  const double *pres;
+  mwSize pres_step;
+  const double *tc;
+  const double *cc;
+  double *temp;
+  double *cond;
+};
+
+
+/**
+ * @brief Thread task calibrating a chunk of records of a Sea-Bird CT.
+ * @param data sbect_args of the whole series.
+ * @param i index of the chunk.
+ */
+static void calibrate_sbect_task(void *data, size_t i)
+{
+  const struct sbect_args *a = (const struct sbect_args *) data;
+  mwSize b = i * CALIBRATESENSORS_TASK_SIZE;
+  mwSize e = (a->n - b < CALIBRATESENSORS_TASK_SIZE)
+           ? a->n : b + CALIBRATESENSORS_TASK_SIZE;
+  calibratesensors_isa->sbect(e - b, a->temp_freq + b, a->cond_freq + b,
+                              a->pres + b * a->pres_step, a->pres_step,
+                              a->tc, a->cc, a->temp + b, a->cond + b);
+}
+
+
+/**
+ * Arguments of a concurrent scale and offset calibration.
+ */
+struct affine_args
+{
+  mwSize n;
+  mwSize m;
+  const double **in;
+  const double *scale;
+  const double *offset;
+  double **out;
+};
+
+
+/**
+ * @brief Thread task calibrating a chunk of records of several signals.
+ * @param data affine_args of the whole series.
+ * @param i index of the chunk.
+ */
+static void calibrate_affine_task(void *data, size_t i)
+{
+  const struct affine_args *a = (const struct affine_args *) data;
+  mwSize b = i * CALIBRATESENSORS_TASK_SIZE;
+  mwSize e = (a->n - b < CALIBRATESENSORS_TASK_SIZE)
+           ? a->n : b + CALIBRATESENSORS_TASK_SIZE;
+  calibratesensors_isa->affine(b, e, a->m, a->in, a->scale, a->offset, a->out);
+}
+
+
+static int is_real_double(const mxArray *a)
+{
+  return mxIsDouble(a) && !mxIsComplex(a) && !mxIsSparse(a);
+}
+
+
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[] )
+{
+  char kind[16];
+  struct sbect_args sbect;
+  struct affine_args affine;
+  mwSize n;
+  int i;
+
+  /* Check for proper number of arguments. */
+  if (nrhs < 1 || !mxIsChar(prhs[0])
+      || mxGetString(prhs[0], kind, sizeof(kind)) != 0)
+    mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                      "First input must be a calibration name.");
+
+  if (!calibratesensors_isa)
+    select_isa();
+
+  if (strcmp(kind, "isa") == 0)
+  {
+    char name[16];
+    size_t k;
+    mwIndex c;
+    if (nrhs > 2)
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "One or two inputs required.");
+    if (nlhs > 2)
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "Too many output arguments.");
+    if (nrhs > 1)
+    {
+      if (!mxIsChar(prhs[1])
+          || mxGetString(prhs[1], name, sizeof(name)) != 0)
+        mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                          "Instruction set must be a string.");
+      if (strcmp(name, "auto") == 0)
+        select_isa();
+      else
+      {
+        for (k = 0; k < CALIBRATESENSORS_NUM_ISA; k++)
+          if (strcmp(calibratesensors_isa_list[k].name, name) == 0
+              && calibratesensors_isa_list[k].supported())
+            break;
+        if (k == CALIBRATESENSORS_NUM_ISA)
+          mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:UnsupportedISA",
+                            "Instruction set not available: %s.", name);
+        calibratesensors_isa = &calibratesensors_isa_list[k];
+      }
+    }
+    plhs[0] = mxCreateString(calibratesensors_isa->name);
+    if (nlhs > 1)
+    {
+      for (c = 0, k = 0; k < CALIBRATESENSORS_NUM_ISA; k++)
+        c += calibratesensors_isa_list[k].supported() ? 1 : 0;
+      plhs[1] = mxCreateCellMatrix(1, c);
+      for (c = 0, k = 0; k < CALIBRATESENSORS_NUM_ISA; k++)
+        if (calibratesensors_isa_list[k].supported())
+          mxSetCell(plhs[1], c++,
+                    mxCreateString(calibratesensors_isa_list[k].name));
+    }
+  }
+  else if (strcmp(kind, "sbect") == 0)
+  {
+    if (nrhs != 6)
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "Six inputs required.");
+    if (nlhs > 2)
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "Too many output arguments.");
+    for (i = 1; i < 6; i++)
+      if (!is_real_double(prhs[i]))
+        mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                          "Inputs must be double non complex arrays.");
+    n = mxGetNumberOfElements(prhs[1]);
+    if (mxGetNumberOfElements(prhs[2]) != n
+        || (mxGetNumberOfElements(prhs[3]) != n
+            && mxGetNumberOfElements(prhs[3]) != 1))
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "Inputs must have the same number of elements.");
+    if (mxGetNumberOfElements(prhs[4]) != 4
+        || mxGetNumberOfElements(prhs[5]) != 6)
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "Wrong number of calibration coefficients.");
+    /* Conductivity is computed along with temperature even if not requested,
+     * in a scratch buffer freed afterwards (plhs[1] may not exist). */
+    plhs[0] = mxCreateNumericArray(mxGetNumberOfDimensions(prhs[1]),
+                                   mxGetDimensions(prhs[1]),
+                                   mxDOUBLE_CLASS, mxREAL);
+    if (nlhs > 1)
+      plhs[1] = mxCreateNumericArray(mxGetNumberOfDimensions(prhs[1]),
+                                     mxGetDimensions(prhs[1]),
+                                     mxDOUBLE_CLASS, mxREAL);
+    sbect.n = n;
+    sbect.temp_freq = mxGetPr(prhs[1]);
+    sbect.cond_freq = mxGetPr(prhs[2]);
+    sbect.pres = mxGetPr(prhs[3]);
+    sbect.pres_step = mxGetNumberOfElements(prhs[3]) == 1 ? 0 : 1;
+    sbect.tc = mxGetPr(prhs[4]);
+    sbect.cc = mxGetPr(prhs[5]);
+    sbect.temp = mxGetPr(plhs[0]);
+    sbect.cond = (nlhs > 1) ? mxGetPr(plhs[1]) : mxMalloc(n * sizeof(double));
+    mexthreads_run((n + CALIBRATESENSORS_TASK_SIZE - 1) / CALIBRATESENSORS_TASK_SIZE,
+                   calibrate_sbect_task, &sbect);
+    if (nlhs < 2)
+      mxFree(sbect.cond);
+  }
+  else if (strcmp(kind, "affine") == 0)
+  {
+    mwSize m = nrhs - 2;
+    mwSize nout;
+    const mxArray *coefs;
+    const double **in;
+    double **out;
+    const double *sd;
+    if (nrhs < 3)
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "At least three inputs required.");
+    if (nlhs > (int) m)
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "Too many output arguments.");
+    coefs = prhs[nrhs - 1];
+    if (!is_real_double(coefs) || mxGetM(coefs) != m || mxGetN(coefs) != 2)
+      mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                        "Coefficients must be a double matrix with a row "
+                        "of scale and offset for each signal.");
+    n = mxGetNumberOfElements(prhs[1]);
+    for (i = 1; i < nrhs - 1; i++)
+    {
+      if (!is_real_double(prhs[i]))
+        mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                          "Inputs must be double non complex arrays.");
+      if (mxGetNumberOfElements(prhs[i]) != n)
+        mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                          "Inputs must have the same number of elements.");
+    }
+    /* Signals are independent, so only the requested outputs are computed
+     * (at least the first one, that is returned in ans). */
+    nout = (nlhs > 1) ? (mwSize) nlhs : 1;
+    in = mxMalloc(nout * sizeof(*in));
+    out = mxMalloc(nout * sizeof(*out));
+    for (i = 0; i < (int) nout; i++)
+    {
+      plhs[i] = mxCreateNumericArray(mxGetNumberOfDimensions(prhs[i + 1]),
+                                     mxGetDimensions(prhs[i + 1]),
+                                     mxDOUBLE_CLASS, mxREAL);
+      in[i] = mxGetPr(prhs[i + 1]);
+      out[i] = mxGetPr(plhs[i]);
+    }
+    sd = mxGetPr(coefs);
+    affine.n = n;
+    affine.m = nout;
+    affine.in = in;
+    affine.scale = sd;
+    affine.offset = sd + m;
+    affine.out = out;
+    mexthreads_run((n + CALIBRATESENSORS_TASK_SIZE - 1) / CALIBRATESENSORS_TASK_SIZE,
+                   calibrate_affine_task, &affine);
+    mxFree(in);
+    mxFree(out);
+  }
+  else
+  {
+    mexErrMsgIdAndTxt("glider_toolbox:calibratesensors:BadCall",
+                      "Unknown calibration: %s.", kind);
+  }
+}
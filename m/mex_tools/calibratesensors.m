@@ -0,0 +1,115 @@
+function varargout = calibratesensors(kind, varargin)
+%CALIBRATESENSORS  Apply sensor factory calibrations in a single pass.
+%
+%  Syntax:
+%    [TEMP, COND] = CALIBRATESENSORS('sbect', TEMP_FREQ, COND_FREQ, PRES, TEMP_COEFS, COND_COEFS)
+%    [Y1, ..., YN] = CALIBRATESENSORS('affine', X1, ..., XN, COEFS)
+%    [ISA, AVAILABLE] = CALIBRATESENSORS('isa')
+%    [ISA, AVAILABLE] = CALIBRATESENSORS('isa', NAME)
+%
+%  Description:
+%    [TEMP, COND] = CALIBRATESENSORS('sbect', TEMP_FREQ, COND_FREQ, PRES, TEMP_COEFS, COND_COEFS)
+%    computes the temperature and conductivity in arrays TEMP and COND from
+%    the raw frequencies in arrays TEMP_FREQ and COND_FREQ and the pressure in
+%    array or scalar PRES, applying the Seabird Electronics CT sail calibration
+%    equations with the coefficients in vectors TEMP_COEFS ([T_G T_H T_I T_J])
+%    and COND_COEFS ([C_G C_H C_I C_J CTCOR CPCOR]). See CALIBRATESBECT.
+%
+%    [Y1, ..., YN] = CALIBRATESENSORS('affine', X1, ..., XN, COEFS) applies
+%    the scale and offset calibration of each raw signal in arrays X1, ..., XN,
+%    returning the calibrated signals in arrays Y1, ..., YN:
+%      YK = COEFS(K,1) * (XK - COEFS(K,2))
+%    where COEFS is a N-by-2 matrix with the scale factor and the offset of
+%    each signal in its rows. See CALIBRATEWLECOBBFL2.
+%
+%    [ISA, AVAILABLE] = CALIBRATESENSORS('isa') returns the name of the
+%    instruction set of the calibration kernels in use in string ISA, and the
+%    names of all the instruction sets available on this processor in string
+%    cell array AVAILABLE, in order of preference ('avx512', 'avx2', 'sse4.2'
+%    and 'default' in the mex file, 'none' in this implementation).
+%
+%    [ISA, AVAILABLE] = CALIBRATESENSORS('isa', NAME) selects the kernels for
+%    the instruction set NAME, that should be one of the available ones,
+%    or 'auto' to select the best one again. It is meant for benchmarks.
+%
+%  Notes:
+%    This function is the common calibration kernel of the calibration
+%    functions of the sensors. The mex file implementation (see
+%    SETUPMEXCALIBRATESENSORS) computes all the outputs in a single pass over
+%    the inputs, without temporary arrays, and it requires double inputs.
+%    This implementation is used when the mex file is not available.
+%    The mex file may use vector logarithms (see SETUPMEXCALIBRATESENSORS),
+%    so its 'sbect' results may differ from this implementation in the last
+%    bits.
+%
+%  Examples:
+%    temp_freq = [3387.875 3668.209 4609.999 4959.066 5544.757 6117.756 6542.459]
+%    cond_freq = [5987.16  6214.10  6888.93  7110.73  7455.09  7763.03  7975.39 ]
+%    temp_coefs = [ 4.38052489e-3  6.25478746e-4  2.34258763e-5  2.50671271e-6]
+%    cond_coefs = [-9.92304872     1.11163373    -2.02979731e-3  2.29265437e-4 -9.57e-8  3.25e-6]
+%    [temp, cond] = ...
+%      calibratesensors('sbect', temp_freq, cond_freq, 0, temp_coefs, cond_coefs)
+%    chlr_cnts = [50 51 51 57 63 80 83 83 81 72 68 67 64 57 56 54 52 51 50]
+%    cdom_cnts = [45 49 50 50 51 56 57 59 57 60 57 61 58 58 58 57 57 60 56]
+%    [chlr, cdom] = ...
+%      calibratesensors('affine', chlr_cnts, cdom_cnts, [0.0118 38; 0.0878 40])
+%    [isa, available] = calibratesensors('isa')
+%
+%  See also:
+%    SETUPMEXCALIBRATESENSORS
+%    BENCHMARKCALIBRATESENSORS
+%    CALIBRATESBECT
+%    CALIBRATEWLECOBBFL2
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, Inf);
+
+  switch kind
+    case 'isa'
+      narginchk(1, 2);
+      if nargin > 1 && ~any(strcmp(varargin{1}, {'none' 'auto'}))
+        error('glider_toolbox:calibratesensors:UnsupportedISA', ...
+              'Instruction set not available: %s.', varargin{1});
+      end
+      varargout = {'none', {'none'}};
+    case 'sbect'
+      narginchk(6, 6);
+      [temp_freq, cond_freq, pres, tc, cc] = varargin{:};
+      tc = tc(:)';
+      cc = cc(:)';
+      temp = 1 ./ polyval(tc([4 3 2 1]), log(1000 ./ temp_freq)) - 273.15;
+      cond = 0.1 * polyval([cc([4 3 2]) 0 cc(1)], cond_freq ./ 1000) ...
+           ./ (1 + cc(5) * temp + cc(6) * pres);
+      varargout = {temp, cond};
+    case 'affine'
+      narginchk(3, Inf);
+      coefs = varargin{end};
+      varargout = cell(1, numel(varargin) - 1);
+      for k = 1:numel(varargout)
+        varargout{k} = coefs(k, 1) * (varargin{k} - coefs(k, 2));
+      end
+    otherwise
+      error('glider_toolbox:calibratesensors:BadCall', ...
+            'Unknown calibration: %s.', kind);
+  end
+
+end
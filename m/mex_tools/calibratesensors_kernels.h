@@ -0,0 +1,110 @@
+/**
+ * @file
+ * @brief Calibration kernels of CALIBRATESENSORS, compiled once per ISA.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2013-2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file is included by calibratesensors.c once for each instruction set
+ * the kernels are compiled for, with the macro CALIBRATESENSORS_KERNEL
+ * defined to give each version of the kernels a distinct name, and the
+ * target instruction set selected with the GCC target pragma.
+ * Hence it has no include guard.
+ *
+ * The loops are written to be vectorized by the compiler. The logarithm in
+ * the Sea-Bird CT kernel is vectorized only when the vector versions of the
+ * GNU C library are enabled (see CALIBRATESENSORS_LIBMVEC in
+ * calibratesensors.c), otherwise that kernel is scalar in all versions.
+ */
+
+/**
+ * @brief Calibrate Sea-Bird CT temperature and conductivity frequencies.
+ *
+ * @param n number of records.
+ * @param temp_freq temperature frequency (Hz).
+ * @param cond_freq conductivity frequency (Hz).
+ * @param pres pressure (dbar).
+ * @param pres_step 1 if there is a pressure for each record, 0 if it is scalar.
+ * @param tc temperature coefficients g, h, i and j.
+ * @param cc conductivity coefficients g, h, i, j, ctcor and cpcor
+ *   (the conductivity polynomial has no linear term).
+ * @param temp calibrated temperature (Celsius).
+ * @param cond calibrated conductivity (S m-1).
+ */
+static void CALIBRATESENSORS_KERNEL(calibrate_sbect)(
+    mwSize n,
+    const double *temp_freq, const double *cond_freq,
+    const double *pres, mwSize pres_step,
+    const double *tc, const double *cc,
+    double *temp, double *cond)
+{
+  /* Coefficients are copied to locals, otherwise they might alias the outputs
+   * and they would be loaded again in each iteration, preventing the loop
+   * from being vectorized. */
+  const double tg = tc[0], th = tc[1], ti = tc[2], tj = tc[3];
+  const double cg = cc[0], ch = cc[1], ci = cc[2], cj = cc[3];
+  const double ctcor = cc[4], cpcor = cc[5];
+  mwSize k;
+  for (k = 0; k < n; k++)
+  {
+    double x = log(1000.0 / temp_freq[k]);
+    double f = cond_freq[k] / 1000.0;
+    double f2 = f * f;
+    double t = 1.0 / (tg + x * (th + x * (ti + x * tj))) - 273.15;
+    temp[k] = t;
+    cond[k] = 0.1 * (cg + f2 * (ch + f * (ci + f * cj)))
+            / (1.0 + ctcor * t + cpcor * pres[k * pres_step]);
+  }
+}
+
+
+/**
+ * @brief Apply scale and offset calibrations to several signals.
+ *
+ * @param first index of the first record to calibrate.
+ * @param last index past the last record to calibrate.
+ * @param m number of signals.
+ * @param in raw signal arrays.
+ * @param scale scale factor of each signal.
+ * @param offset offset of each signal (subtracted before scaling).
+ * @param out calibrated signal arrays.
+ */
+static void CALIBRATESENSORS_KERNEL(calibrate_affine)(
+    mwSize first, mwSize last, mwSize m,
+    const double **in,
+    const double *scale, const double *offset,
+    double **out)
+{
+  mwSize b;
+  mwSize j;
+  mwSize k;
+  for (b = first; b < last; b += CALIBRATESENSORS_BLOCK_SIZE)
+  {
+    mwSize e = (last - b < CALIBRATESENSORS_BLOCK_SIZE)
+             ? last : b + CALIBRATESENSORS_BLOCK_SIZE;
+    for (j = 0; j < m; j++)
+    {
+      const double *x = in[j];
+      double *y = out[j];
+      const double s = scale[j];
+      const double o = offset[j];
+      for (k = b; k < e; k++)
+        y[k] = s * (x[k] - o);
+    }
+  }
+}
@@ -0,0 +1,243 @@
+/**
+ * @file
+ * @brief Shared thread runtime for the mex files of the toolbox.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file implements the functions declared in mexthreads.h.
+ * It does not use the mx or mex API, so it may be linked to any mex file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "mexthreads.h"
+
+
+/**
+ * Shared state of the threads running a set of tasks.
+ */
+struct mexthreads_queue
+{
+  mexthreads_task task;
+  void* data;
+  size_t num_tasks;
+  size_t next_task;
+  pthread_mutex_t mutex;
+};
+
+
+/**
+ * @brief Thread routine running tasks from the shared queue until empty.
+ * @param arg pointer to the shared mexthreads_queue.
+ * @return NULL.
+ */
+static void* mexthreads_worker(void* arg)
+{
+  struct mexthreads_queue* queue = (struct mexthreads_queue*) arg;
+  size_t i;
+  for (;;)
+  {
+    pthread_mutex_lock(&queue->mutex);
+    i = queue->next_task++;
+    pthread_mutex_unlock(&queue->mutex);
+    if (i >= queue->num_tasks)
+      break;
+    queue->task(queue->data, i);
+  }
+  return NULL;
+}
+
+
+/**
+ * @brief Number of threads to use for a set of tasks.
+ *
+ * The number is the least of the number of tasks, the number of online
+ * processors, the limit given by the environment variable
+ * GLIDER_TOOLBOX_THREADS (if set to a positive integer), and the hard limit
+ * MEXTHREADS_MAX_THREADS. The variable is read on every call, so it may be
+ * changed from MATLAB with SETENV between calls.
+ *
+ * @param num_tasks number of tasks.
+ * @return number of threads, including the calling thread (at least 1).
+ */
+size_t mexthreads_count(size_t num_tasks)
+{
+  const char* limit_str;
+  long num_cpus;
+  long limit;
+  size_t num_threads;
+  num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  num_threads = (num_cpus > 0) ? num_cpus : 1;
+  limit_str = getenv(MEXTHREADS_ENV_VAR);
+  if (limit_str && *limit_str)
+  {
+    limit = strtol(limit_str, NULL, 10);
+    if (limit > 0 && (size_t) limit < num_threads)
+      num_threads = limit;
+  }
+  if (num_threads > MEXTHREADS_MAX_THREADS)
+    num_threads = MEXTHREADS_MAX_THREADS;
+  if (num_threads > num_tasks)
+    num_threads = num_tasks;
+  return (num_threads > 0) ? num_threads : 1;
+}
+
+
+/**
+ * @brief Release the processors reserved by mexthreads_reserve.
+ * @param num_threads number of entries of the array of slots.
+ * @param slots file descriptors of the reserved slots or -1.
+ */
+static void mexthreads_release(size_t num_threads, int* slots)
+{
+  size_t k;
+  for (k = 0; k < num_threads; k++)
+    if (slots[k] >= 0)
+    {
+      close(slots[k]);
+      slots[k] = -1;
+    }
+}
+
+
+/**
+ * @brief Reserve processors shared by all the processes of the node.
+ *
+ * The processors of the node are represented by slot files named slot.N in
+ * the directory given by the environment variable GLIDER_TOOLBOX_THREADS_DIR
+ * (MEXTHREADS_SLOT_DIR if not set), one for each online processor. A slot is
+ * reserved by holding an exclusive advisory lock (flock) on its file, so it is
+ * released when the file is closed, even if the process is killed. Slots are
+ * probed starting from one chosen by the process id, so that processes
+ * starting at the same time do not compete for the same slots.
+ *
+ * If the variable is set to an empty string, or the directory or the slot
+ * files can not be created, processors are not shared and the requested
+ * number of threads is returned without reserving any slot.
+ *
+ * @param num_threads number of threads wanted, including the calling thread.
+ * @param slots array of at least num_threads file descriptors, set to the
+ *   descriptors of the reserved slots or -1 (see mexthreads_release).
+ * @return number of threads that may be run (at least 1, the calling thread).
+ */
+static size_t mexthreads_reserve(size_t num_threads, int* slots)
+{
+  const char* dir;
+  char path[4096];
+  long num_cpus;
+  size_t num_slots;
+  size_t num_reserved;
+  size_t first;
+  size_t k;
+  int fd;
+  for (k = 0; k < num_threads; k++)
+    slots[k] = -1;
+  dir = getenv(MEXTHREADS_DIR_ENV_VAR);
+  if (!dir)
+    dir = MEXTHREADS_SLOT_DIR;
+  if (!*dir)
+    return num_threads;
+  if (mkdir(dir, 0777) == 0)
+    chmod(dir, 01777);
+  num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  num_slots = (num_cpus > 0) ? num_cpus : 1;
+  if (num_slots > MEXTHREADS_MAX_THREADS)
+    num_slots = MEXTHREADS_MAX_THREADS;
+  first = (size_t) getpid() % num_slots;
+  num_reserved = 0;
+  for (k = 0; k < num_slots && num_reserved < num_threads; k++)
+  {
+    if (snprintf(path, sizeof(path), "%s/slot.%lu", dir,
+                 (unsigned long) ((first + k) % num_slots)) >= (int) sizeof(path))
+      fd = -1;
+    else
+      fd = open(path, O_RDONLY | O_CREAT, 0666);
+    if (fd < 0)
+    {
+      /* Unusable slot directory, do not share the processors. */
+      mexthreads_release(num_threads, slots);
+      return num_threads;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) == 0)
+      slots[num_reserved++] = fd;
+    else
+      close(fd);
+  }
+  return (num_reserved > 0) ? num_reserved : 1;
+}
+
+
+/**
+ * @brief Run a set of independent tasks concurrently.
+ *
+ * The tasks are run by the calling thread and by up to mexthreads_count - 1
+ * additional threads, that are joined before returning. The threads are
+ * further limited to the processors of the node not reserved by other
+ * processes (see mexthreads_reserve). A single task is run by the calling
+ * thread without creating any thread.
+ *
+ * @param num_tasks number of tasks.
+ * @param task function to run each task (must not call the mx or mex API).
+ * @param data shared data passed to the task function.
+ * @return number of threads used, including the calling thread.
+ */
+size_t mexthreads_run(size_t num_tasks, mexthreads_task task, void* data)
+{
+  struct mexthreads_queue queue;
+  pthread_t threads[MEXTHREADS_MAX_THREADS];
+  int slots[MEXTHREADS_MAX_THREADS];
+  size_t num_wanted;
+  size_t num_threads;
+  size_t i;
+  queue.task = task;
+  queue.data = data;
+  queue.num_tasks = num_tasks;
+  queue.next_task = 0;
+  num_wanted = mexthreads_count(num_tasks);
+  if (num_wanted <= 1)
+  {
+    for (i = 0; i < num_tasks; i++)
+      task(data, i);
+    return 1;
+  }
+  num_threads = mexthreads_reserve(num_wanted, slots);
+  if (num_threads <= 1)
+  {
+    for (i = 0; i < num_tasks; i++)
+      task(data, i);
+    mexthreads_release(num_wanted, slots);
+    return 1;
+  }
+  pthread_mutex_init(&queue.mutex, NULL);
+  for (i = 0; i < num_threads - 1; i++)
+    if (pthread_create(&threads[i], NULL, mexthreads_worker, &queue) != 0)
+      break;
+  num_threads = i;
+  mexthreads_worker(&queue);
+  for (i = 0; i < num_threads; i++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&queue.mutex);
+  mexthreads_release(num_wanted, slots);
+  return num_threads + 1;
+}
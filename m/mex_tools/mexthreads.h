@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @brief Shared thread runtime for the mex files of the toolbox.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file declares the functions shared by the mex files that split their
+ * work in independent tasks run by a set of POSIX threads:
+ *   - The number of threads is limited by the number of online processors,
+ *     by a hard limit, and by the environment variable GLIDER_TOOLBOX_THREADS
+ *     if set. Processes running side by side on the same node share the
+ *     processors through a set of locked slot files, one per processor, in
+ *     the directory given by GLIDER_TOOLBOX_THREADS_DIR (a directory in /tmp
+ *     by default, sharing disabled if empty), so that together they do not
+ *     run more threads than processors.
+ *   - Tasks are handed out dynamically from a shared counter, so threads
+ *     finishing early take the remaining tasks. The calling thread runs tasks
+ *     too, so the work is done even if no thread can be created.
+ *   - Task functions run outside the MATLAB thread and must not call any
+ *     function of the mx or mex API. All the inputs and outputs should be
+ *     prepared before running the tasks, in the calling thread.
+ *
+ * The mex files using it should be built with the source and the library:
+ *   mex -output <target> <target>.c mexthreads.c -lpthread
+ */
+
+#ifndef MEXTHREADS_H
+#define MEXTHREADS_H
+
+#include <stddef.h>
+
+#define MEXTHREADS_MAX_THREADS 64
+#define MEXTHREADS_ENV_VAR "GLIDER_TOOLBOX_THREADS"
+#define MEXTHREADS_DIR_ENV_VAR "GLIDER_TOOLBOX_THREADS_DIR"
+#define MEXTHREADS_SLOT_DIR "/tmp/glider_toolbox_threads"
+
+
+/**
+ * Task function: run task number i on shared data.
+ */
+typedef void (*mexthreads_task)(void* data, size_t i);
+
+
+size_t mexthreads_count(size_t num_tasks);
+
+size_t mexthreads_run(size_t num_tasks, mexthreads_task task, void* data);
+
+#endif /* MEXTHREADS_H */
@@ -0,0 +1,452 @@
+/**
+ * @file
+ * @brief MATLAB interface to publish files using low level POSIX functions.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2013-2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file implements the function PUBLISHFILE, that copies local files
+ * to their public location avoiding unnecessary copies of data:
+ *   - Targets with the same contents as their source are left untouched.
+ *   - The new contents are written to a temporary file in the target
+ *     directory, that is renamed to the target name when complete.
+ *     Hence readers always see either the previous or the new version.
+ *   - The temporary file is a hard link to the source (if requested and both
+ *     files are in the same file system), a reflink clone of the source (on
+ *     file systems supporting it) or a kernel side copy of the source, in that
+ *     order of preference. The usual read/write copy is the last resort.
+ *   - Lists of files are published concurrently by a set of POSIX threads,
+ *     using the shared thread runtime in mexthreads.c.
+ *
+ * The corresponding mex file may be built with the command:
+ *   mex -output publishfile publishfile.c mexthreads.c -lpthread
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/sendfile.h>
+#endif
+#include "mex.h"
+#include "mexthreads.h"
+
+#define PUBLISHFILE_BUFFER_SIZE 65536
+#define PUBLISHFILE_MESSAGE_SIZE 512
+
+#if defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define PUBLISHFILE_HAVE_COPY_FILE_RANGE
+#endif
+
+
+/**
+ * Actions performed to publish a file.
+ */
+enum publish_action
+{
+  PUBLISH_ERROR = 0,
+  PUBLISH_UNCHANGED,
+  PUBLISH_LINKED,
+  PUBLISH_CLONED,
+  PUBLISH_COPIED
+};
+
+static const char* publish_action_names[] =
+  {"error", "unchanged", "linked", "cloned", "copied"};
+
+
+/**
+ * Publication task of a file.
+ */
+struct publish_task
+{
+  char* source;
+  char* target;
+  int link;
+  enum publish_action action;
+  char message[PUBLISHFILE_MESSAGE_SIZE];
+};
+
+
+/**
+ * @brief Read a whole block from a file descriptor retrying on interruption.
+ * @param fd file descriptor to read from.
+ * @param buffer buffer to store the data.
+ * @param size number of bytes to read.
+ * @return number of bytes read (less than size at end of file), or -1 on error.
+ */
+static ssize_t read_block(int fd, char* buffer, size_t size)
+{
+  size_t done = 0;
+  ssize_t n;
+  while (done < size)
+  {
+    n = read(fd, buffer + done, size - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return -1;
+    if (n == 0)
+      break;
+    done += n;
+  }
+  return done;
+}
+
+
+/**
+ * @brief Check whether two open files have the same contents.
+ * @param fds descriptor of the first file (at offset 0).
+ * @param fdt descriptor of the second file (at offset 0).
+ * @return 1 if the contents are equal, 0 if they differ, -1 on error.
+ *
+ * The files are compared block by block, stopping at the first difference.
+ */
+static int same_contents(int fds, int fdt)
+{
+  char bufs[PUBLISHFILE_BUFFER_SIZE];
+  char buft[PUBLISHFILE_BUFFER_SIZE];
+  ssize_t ns, nt;
+  do
+  {
+    ns = read_block(fds, bufs, sizeof(bufs));
+    nt = read_block(fdt, buft, sizeof(buft));
+    if (ns < 0 || nt < 0)
+      return -1;
+    if (ns != nt || memcmp(bufs, buft, ns) != 0)
+      return 0;
+  } while (ns > 0);
+  return 1;
+}
+
+
+/**
+ * @brief Copy the contents of an open file to another one.
+ * @param fds descriptor of the source file (at offset 0).
+ * @param fdt descriptor of the empty target file.
+ * @param size size of the source file.
+ * @param action set to PUBLISH_CLONED if the contents are shared by reflink.
+ * @return 0 on success, -1 on error.
+ */
+static int copy_contents(int fds, int fdt, off_t size,
+                         enum publish_action* action)
+{
+  char buffer[PUBLISHFILE_BUFFER_SIZE];
+  off_t done = 0;
+  ssize_t n, m, w;
+  *action = PUBLISH_COPIED;
+#ifdef FICLONE
+  if (ioctl(fdt, FICLONE, fds) == 0)
+  {
+    *action = PUBLISH_CLONED;
+    return 0;
+  }
+#endif
+#ifdef PUBLISHFILE_HAVE_COPY_FILE_RANGE
+  while (done < size)
+  {
+    n = copy_file_range(fds, NULL, fdt, NULL, size - done, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    done += n;
+  }
+  if (done == size)
+    return 0;
+#endif
+#ifdef __linux__
+  while (done < size)
+  {
+    n = sendfile(fdt, fds, &done, size - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+  }
+  if (done == size)
+    return 0;
+#endif
+  if (lseek(fds, done, SEEK_SET) < 0 || lseek(fdt, done, SEEK_SET) < 0)
+    return -1;
+  while ((n = read_block(fds, buffer, sizeof(buffer))) > 0)
+  {
+    for (m = 0; m < n; m += w)
+    {
+      w = write(fdt, buffer + m, n - m);
+      if (w < 0 && errno == EINTR)
+        w = 0;
+      else if (w < 0)
+        return -1;
+    }
+  }
+  return (n < 0) ? -1 : 0;
+}
+
+
+/**
+ * @brief Publish a file.
+ * @param task publication task with the source and target file names,
+ *        updated with the action performed and the error message, if any.
+ */
+static void publish_file(struct publish_task* task)
+{
+  struct stat sst, tst;
+  char* temp;
+  const char* base;
+  size_t dirlen;
+  int fds, fdt;
+  int same;
+  enum publish_action action = PUBLISH_ERROR;
+  const char* what = "";
+  int err = 0;
+
+  task->action = PUBLISH_ERROR;
+  task->message[0] = '\0';
+
+  /* Open the source and check if the target is already up to date. */
+  fds = open(task->source, O_RDONLY);
+  if (fds < 0 || fstat(fds, &sst) < 0)
+  {
+    err = errno;
+    snprintf(task->message, sizeof(task->message),
+             "Error opening source file %s: %s.", task->source, strerror(err));
+    if (fds >= 0)
+      close(fds);
+    return;
+  }
+  if (!S_ISREG(sst.st_mode))
+  {
+    snprintf(task->message, sizeof(task->message),
+             "Source is not a regular file: %s.", task->source);
+    close(fds);
+    return;
+  }
+  fdt = open(task->target, O_RDONLY);
+  if (fdt >= 0)
+  {
+    same = (fstat(fdt, &tst) == 0) && S_ISREG(tst.st_mode)
+           && ((sst.st_dev == tst.st_dev && sst.st_ino == tst.st_ino)
+               || (sst.st_size == tst.st_size && same_contents(fds, fdt) > 0));
+    close(fdt);
+    if (same)
+    {
+      task->action = PUBLISH_UNCHANGED;
+      close(fds);
+      return;
+    }
+    if (lseek(fds, 0, SEEK_SET) < 0)
+    {
+      err = errno;
+      snprintf(task->message, sizeof(task->message),
+               "Error reading source file %s: %s.",
+               task->source, strerror(err));
+      close(fds);
+      return;
+    }
+  }
+
+  /* Build the temporary name: hidden file in the target directory. */
+  base = strrchr(task->target, '/');
+  base = base ? base + 1 : task->target;
+  dirlen = base - task->target;
+  temp = malloc(strlen(task->target) + 9);
+  if (!temp)
+  {
+    snprintf(task->message, sizeof(task->message), "Out of memory.");
+    close(fds);
+    return;
+  }
+  sprintf(temp, "%.*s.%s.XXXXXX", (int) dirlen, task->target, base);
+
+  /* Write the temporary file: hard link, reflink or copy. */
+  fdt = mkstemp(temp);
+  if (fdt < 0)
+  {
+    err = errno;
+    what = "creating temporary file";
+  }
+  else if (task->link && close(fdt) == 0 && unlink(temp) == 0
+           && link(task->source, temp) == 0)
+  {
+    action = PUBLISH_LINKED;
+  }
+  else
+  {
+    if (task->link)
+      fdt = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fdt < 0
+        || copy_contents(fds, fdt, sst.st_size, &action) < 0
+        || fchmod(fdt, sst.st_mode & 0777) < 0)
+    {
+      err = errno;
+      what = "writing temporary file";
+      action = PUBLISH_ERROR;
+    }
+    if (fdt >= 0 && close(fdt) < 0 && action != PUBLISH_ERROR)
+    {
+      err = errno;
+      what = "writing temporary file";
+      action = PUBLISH_ERROR;
+    }
+  }
+  close(fds);
+
+  /* Replace the target atomically. */
+  if (action != PUBLISH_ERROR && rename(temp, task->target) < 0)
+  {
+    err = errno;
+    what = "renaming temporary file";
+    action = PUBLISH_ERROR;
+  }
+  if (action == PUBLISH_ERROR)
+  {
+    snprintf(task->message, sizeof(task->message), "Error %s %s: %s.",
+             what, temp, strerror(err));
+    unlink(temp);
+  }
+  task->action = action;
+  free(temp);
+}
+
+
+/**
+ * @brief Thread task publishing a file of the list.
+ * @param data array of publish_task.
+ * @param i index of the task to run.
+ */
+static void publish_worker(void* data, size_t i)
+{
+  publish_file(&((struct publish_task*) data)[i]);
+}
+
+
+/**
+ * @brief Get a copy of the string in a char array or a cell array element.
+ * @param a char array or cell array.
+ * @param i index of the cell array element (ignored for char arrays).
+ * @return dynamically allocated string (NULL if not a string).
+ */
+static char* get_string(const mxArray* a, size_t i)
+{
+  const mxArray* s = mxIsCell(a) ? mxGetCell(a, i) : a;
+  return (s && mxIsChar(s)) ? mxArrayToString(s) : NULL;
+}
+
+
+void mexFunction( int nlhs, mxArray *plhs[],
+                  int nrhs, const mxArray *prhs[] )
+{
+  struct publish_task* tasks;
+  size_t num_tasks, i;
+  int link = 0;
+  int iscell;
+  mxLogical* success;
+
+  /* Check for proper number of arguments. */
+  if (nrhs < 2 || nrhs > 3)
+    mexErrMsgIdAndTxt("glider_toolbox:publishfile:BadCall",
+                      "Two or three inputs required.");
+  if (nlhs > 3)
+    mexErrMsgIdAndTxt("glider_toolbox:publishfile:BadCall",
+                      "Too many output arguments.");
+  iscell = mxIsCell(prhs[0]);
+  if ( (iscell ? !mxIsCell(prhs[1]) : !(mxIsChar(prhs[0]) && mxIsChar(prhs[1])))
+       || (iscell && mxGetNumberOfElements(prhs[0])
+                     != mxGetNumberOfElements(prhs[1])) )
+    mexErrMsgIdAndTxt("glider_toolbox:publishfile:BadCall",
+                      "Sources and targets must be strings "
+                      "or cell arrays of strings of the same size.");
+  if (nrhs > 2)
+  {
+    if (mxGetNumberOfElements(prhs[2]) != 1
+        || !(mxIsLogical(prhs[2]) || mxIsNumeric(prhs[2])))
+      mexErrMsgIdAndTxt("glider_toolbox:publishfile:BadCall",
+                        "Link flag must be a scalar logical.");
+    link = mxGetScalar(prhs[2]) != 0;
+  }
+
+  /* Get the file names. */
+  num_tasks = iscell ? mxGetNumberOfElements(prhs[0]) : 1;
+  tasks = mxCalloc(num_tasks > 0 ? num_tasks : 1, sizeof(*tasks));
+  for (i = 0; i < num_tasks; i++)
+  {
+    tasks[i].source = get_string(prhs[0], i);
+    tasks[i].target = get_string(prhs[1], i);
+    tasks[i].link = link;
+    if (!tasks[i].source || !tasks[i].target)
+      mexErrMsgIdAndTxt("glider_toolbox:publishfile:BadCall",
+                        "Sources and targets must be strings "
+                        "or cell arrays of strings of the same size.");
+  }
+
+  /* Publish the files concurrently. */
+  mexthreads_run(num_tasks, publish_worker, tasks);
+
+  /* Assign the outputs. */
+  if (iscell)
+  {
+    plhs[0] = mxCreateLogicalArray(mxGetNumberOfDimensions(prhs[0]),
+                                   mxGetDimensions(prhs[0]));
+    if (nlhs > 1)
+      plhs[1] = mxCreateCellArray(mxGetNumberOfDimensions(prhs[0]),
+                                  mxGetDimensions(prhs[0]));
+    if (nlhs > 2)
+      plhs[2] = mxCreateCellArray(mxGetNumberOfDimensions(prhs[0]),
+                                  mxGetDimensions(prhs[0]));
+  }
+  else
+  {
+    plhs[0] = mxCreateLogicalMatrix(1, 1);
+  }
+  success = mxGetLogicals(plhs[0]);
+  for (i = 0; i < num_tasks; i++)
+  {
+    success[i] = (tasks[i].action != PUBLISH_ERROR);
+    if (nlhs > 1)
+    {
+      if (iscell)
+        mxSetCell(plhs[1], i, mxCreateString(tasks[i].message));
+      else
+        plhs[1] = mxCreateString(tasks[i].message);
+    }
+    if (nlhs > 2)
+    {
+      if (iscell)
+        mxSetCell(plhs[2], i,
+                  mxCreateString(publish_action_names[tasks[i].action]));
+      else
+        plhs[2] = mxCreateString(publish_action_names[tasks[i].action]);
+    }
+    mxFree(tasks[i].source);
+    mxFree(tasks[i].target);
+  }
+  mxFree(tasks);
+}
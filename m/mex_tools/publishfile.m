@@ -0,0 +1,141 @@
+function [success, message, action] = publishfile(source, target, link)
+%PUBLISHFILE  Copy files to their public location avoiding unnecessary copies.
+%
+%  Syntax:
+%    [SUCCESS, MESSAGE, ACTION] = PUBLISHFILE(SOURCE, TARGET)
+%    [SUCCESS, MESSAGE, ACTION] = PUBLISHFILE(SOURCE, TARGET, LINK)
+%
+%  Description:
+%    [SUCCESS, MESSAGE, ACTION] = PUBLISHFILE(SOURCE, TARGET) publishes the
+%    file named by string SOURCE to the location named by string TARGET,
+%    and returns whether the operation succeeded in logical SUCCESS,
+%    the error message, if any, in string MESSAGE, and the action performed
+%    in string ACTION:
+%      'unchanged': TARGET already had the same contents as SOURCE.
+%      'linked': TARGET was made a hard link to SOURCE (see below).
+%      'cloned': TARGET was made a reflink clone of SOURCE.
+%      'copied': the contents of SOURCE were copied to TARGET.
+%      'error': the file could not be published.
+%    The new contents are written to a hidden temporary file in the target
+%    directory, and it is renamed to TARGET when complete. Hence TARGET is
+%    replaced atomically, and readers never see a partially written file.
+%
+%    SOURCE and TARGET may also be cell arrays of strings of the same size.
+%    In that case all the files are published at once, and outputs are
+%    arrays of the same size with the result of each file.
+%
+%    [SUCCESS, MESSAGE, ACTION] = PUBLISHFILE(SOURCE, TARGET, LINK) publishes
+%    TARGET as a hard link to SOURCE when LINK is true and both are in the same
+%    file system, saving the space of a copy.
+%
+%  Notes:
+%    This function provides a compatibility interface for MATLAB and Octave.
+%    The mex file implementation (see SETUPMEXPUBLISHFILE) publishes the files
+%    concurrently using low level POSIX functions: it compares the contents
+%    block by block without reading whole files, and creates the temporary file
+%    by reflink (FICLONE) or kernel side copy (COPY_FILE_RANGE, SENDFILE) when
+%    available. This implementation is used when the mex file is not available,
+%    comparing the contents in memory and copying the files with COPYFILE.
+%    Hard links are only created by the mex file implementation.
+%
+%    A hard link shares the data with the source. Use it only when the source
+%    is never modified in place once published.
+%
+%  Examples:
+%    [success, message, action] = ...
+%      publishfile('netcdf/happyglider_l1.nc', 'public/happyglider_l1.nc')
+%    [success, message, action] = ...
+%      publishfile({'figures/temp.png' 'figures/salt.png'}, ...
+%                  {'public/temp.png' 'public/salt.png'})
+%
+%  See also:
+%    SETUPMEXPUBLISHFILE
+%    COPYFILE
+%    MOVEFILE
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(2, 3);
+
+  if nargin < 3
+    link = false;
+  end
+
+  if iscell(source)
+    success = false(size(source));
+    message = cell(size(source));
+    action = cell(size(source));
+    for i = 1:numel(source)
+      [success(i), message{i}, action{i}] = ...
+        publishfile(source{i}, target{i}, link);
+    end
+    return
+  end
+
+  success = false;
+  message = '';
+  action = 'error';
+
+  %% Check whether the target is up to date.
+  source_info = dir(source);
+  target_info = dir(target);
+  if ~isscalar(source_info) || source_info.isdir
+    message = sprintf('Source is not a regular file: %s.', source);
+    return
+  end
+  if isscalar(target_info) && ~target_info.isdir ...
+      && target_info.bytes == source_info.bytes
+    source_contents = readcontents(source);
+    target_contents = readcontents(target);
+    if isequal(source_contents, target_contents)
+      success = true;
+      action = 'unchanged';
+      return
+    end
+  end
+
+  %% Copy to a temporary file and rename it.
+  [target_dir, target_name, target_ext] = fileparts(target);
+  temp = fullfile(target_dir, ...
+                  ['.' target_name target_ext '.' ...
+                   sprintf('%06d', floor(1e6 * rand()))]);
+  [success, message] = copyfile(source, temp);
+  if success
+    [success, message] = movefile(temp, target, 'f');
+  end
+  if success
+    action = 'copied';
+  elseif exist(temp, 'file')
+    delete(temp);
+  end
+
+end
+
+
+function contents = readcontents(filename)
+%READCONTENTS  Read the contents of a file as a byte array (empty on error).
+  contents = [];
+  fid = fopen(filename, 'r');
+  if fid >= 0
+    contents = fread(fid, inf, '*uint8');
+    fclose(fid);
+  end
+end
@@ -0,0 +1,201 @@
+function writeNetCDFTemplate(filename, ncinfo)
+%WRITENETCDFTEMPLATE  Write the structure of a NetCDF file as a CDL template.
+%
+%  Syntax:
+%    WRITENETCDFTEMPLATE(FILENAME, NCINFO)
+%
+%  Description:
+%    WRITENETCDFTEMPLATE(FILENAME, NCINFO) writes to the file named by string
+%    FILENAME the dimensions, global attributes, and variables with their
+%    attributes described by struct NCINFO, in CDL (the text representation
+%    of NetCDF files used by the utilities NCGEN and NCDUMP) without data.
+%    NCINFO is a struct like the ones returned by the NetCDF output
+%    configuration functions, with the following fields:
+%      DIMENSIONS: struct array with fields 'NAME' and 'LENGTH' defining the
+%        dimensions. A length of 0 defines the record (unlimited) dimension.
+%      ATTRIBUTES: struct array with fields 'NAME' and 'VALUE' defining global
+%        attributes.
+%      VARIABLES: struct defining variable metadata as needed by SAVENC,
+%        with fields 'DIMENSIONS', 'ATTRIBUTES' and optionally 'DATATYPE',
+%        'TYPE' and 'NAME'.
+%
+%  Notes:
+%    The template is the input of the native program GTB_XBD2NC, that generates
+%    the L0 NetCDF file of Slocum deployments without a MATLAB runtime. It is
+%    also a valid input for NCGEN.
+%
+%    The type of each variable is given by the field 'DATATYPE' (NetCDF type
+%    name) or 'TYPE' (MATLAB class name, as used by GENERATEOUTPUTNETCDF),
+%    and defaults to double. The type of each attribute is the NetCDF type
+%    corresponding to the class of its value. Classes without a matching
+%    NetCDF classic type are written as doubles.
+%
+%    Attributes with empty values are written as empty strings. Dimensions
+%    must have a defined length, since they can not be inferred from the data.
+%
+%  Examples:
+%    writeNetCDFTemplate('ncl0_slocum.cdl', configRTOutputNetCDFL0Slocum())
+%
+%  See also:
+%    CONFIGRTOUTPUTNETCDFL0SLOCUM
+%    GENERATEOUTPUTNETCDF
+%    SAVENC
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(2, 2);
+
+  NETCDF_TYPES = {'double' 'float'  'int'   'short' 'byte' 'char'};
+  NATIVE_TYPES = {'double' 'single' 'int32' 'int16' 'int8' 'char'};
+
+  [~, name, ~] = fileparts(filename);
+  [fid, message] = fopen(filename, 'w');
+  if fid < 0
+    error('glider_toolbox:writeNetCDFTemplate:FileError', ...
+          'Could not open file %s: %s.', filename, message);
+  end
+
+  try
+    fprintf(fid, 'netcdf %s {\n', name);
+
+    % Dimensions.
+    fprintf(fid, 'dimensions:\n');
+    dim_name_list = {};
+    if isfield(ncinfo, 'dimensions')
+      dim_name_list = {ncinfo.dimensions.name};
+      for dim = ncinfo.dimensions(:)'
+        if isempty(dim.length)
+          error('glider_toolbox:writeNetCDFTemplate:InvalidDimension', ...
+                'Undefined length of dimension: %s.', dim.name);
+        elseif dim.length == 0
+          fprintf(fid, '\t%s = UNLIMITED ;\n', dim.name);
+        else
+          fprintf(fid, '\t%s = %d ;\n', dim.name, dim.length);
+        end
+      end
+    end
+
+    % Variables with their attributes.
+    fprintf(fid, 'variables:\n');
+    if isfield(ncinfo, 'variables')
+      field_name_list = fieldnames(ncinfo.variables);
+      for field_idx = 1:numel(field_name_list)
+        field_name = field_name_list{field_idx};
+        var_meta = ncinfo.variables.(field_name);
+        var_name = field_name;
+        if isfield(var_meta, 'name')
+          var_name = var_meta.name;
+        end
+        var_type = 'double';
+        if isfield(var_meta, 'datatype')
+          var_type = var_meta.datatype;
+        elseif isfield(var_meta, 'type') ...
+            && any(strcmp(var_meta.type, NATIVE_TYPES))
+          var_type = NETCDF_TYPES{strcmp(var_meta.type, NATIVE_TYPES)};
+        end
+        var_dims = cellstr(var_meta.dimensions);
+        undefined_dims = setdiff(var_dims, dim_name_list);
+        if ~isempty(undefined_dims)
+          error('glider_toolbox:writeNetCDFTemplate:InvalidDimension', ...
+                'Undefined dimension of variable %s: %s.', ...
+                var_name, undefined_dims{1});
+        end
+        if isempty(var_dims)
+          fprintf(fid, '\t%s %s ;\n', var_type, var_name);
+        else
+          var_dims_str = sprintf('%s, ', var_dims{:});
+          fprintf(fid, '\t%s %s(%s) ;\n', ...
+                  var_type, var_name, var_dims_str(1:end-2));
+        end
+        if isfield(var_meta, 'attributes')
+          for att = var_meta.attributes(:)'
+            fprintf(fid, '\t\t%s:%s = %s ;\n', ...
+                    var_name, att.name, formatValue(att.value));
+          end
+        end
+      end
+    end
+
+    % Global attributes.
+    if isfield(ncinfo, 'attributes')
+      fprintf(fid, '\n// global attributes:\n');
+      for att = ncinfo.attributes(:)'
+        fprintf(fid, '\t\t:%s = %s ;\n', att.name, formatValue(att.value));
+      end
+    end
+
+    fprintf(fid, '}\n');
+  catch exception
+    fclose(fid);
+    delete(filename);
+    rethrow(exception);
+  end
+  fclose(fid);
+
+end
+
+
+function str = formatValue(value)
+%FORMATVALUE  CDL representation of an attribute value.
+  if isempty(value)
+    str = '""';
+    return
+  end
+  if ischar(value)
+    str = strrep(value(:)', '\', '\\');
+    str = strrep(str, '"', '\"');
+    str = strrep(str, sprintf('\n'), '\n');
+    str = ['"' str '"'];
+    return
+  end
+  switch class(value)
+    case 'single'
+      format = '%.9gf';
+      suffix = 'f';
+    case 'int32'
+      format = '%d';
+      suffix = '';
+    case 'int16'
+      format = '%ds';
+      suffix = '';
+    case 'int8'
+      format = '%db';
+      suffix = '';
+    otherwise
+      format = '%.17gd';
+      suffix = '';
+  end
+  value = double(value(:)');
+  str_list = cell(size(value));
+  for value_idx = 1:numel(value)
+    if isnan(value(value_idx))
+      str_list{value_idx} = ['NaN' suffix];
+    elseif isinf(value(value_idx)) && value(value_idx) > 0
+      str_list{value_idx} = ['Infinity' suffix];
+    elseif isinf(value(value_idx))
+      str_list{value_idx} = ['-Infinity' suffix];
+    else
+      str_list{value_idx} = sprintf(format, value(value_idx));
+    end
+  end
+  str = sprintf('%s, ', str_list{:});
+  str = str(1:end-2);
+end
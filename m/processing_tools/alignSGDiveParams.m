@@ -19,6 +19,10 @@ function data = alignSGDiveParams(data, meta, params)
 %    during the dive as if they were timestamped as the first dive record. For
 %    some parameters (e.g. SENSOR_SECS) this might not be the nearest record.
 %
+%    The first record of each dive is found sorting the dive start times
+%    together with the record times, which takes O((N+D)log(N+D)) time and
+%    O(N+D) memory for N records and D dives.
+%
 %  Examples:
 %    data = alignSGDiveParams(data, meta, params)
 %
@@ -52,23 +56,33 @@ function data = alignSGDiveParams(data, meta, params)
   dive_start = [1900 + dive_start(:,3) dive_start(:, [1:2 4:6])];
   dive_start_secs = etime(dive_start, dive_start(ones(size(dive_start,1),1),:));
   record_secs = data.elaps_t;
-  delta_secs = bsxfun(@minus, record_secs(:), dive_start_secs(:)');
-  delta_secs(delta_secs < 0) = nan;
-  [first_records_offsets, first_records_indices] = min(delta_secs);
-  dive_with_records = isfinite(first_records_offsets);
-  first_records = false(size(record_secs));
-  first_records(first_records_indices(dive_with_records)) = true;
-  other_records = ~first_records;
+  % Find the first record of each dive merging the sorted record times with
+  % the dive start times, without computing all record-dive time differences.
+  % Dive starts go first in the merge, so that the stable sort places them
+  % before any record with the same time, and the number of records preceding
+  % each dive start is the number of records before the dive.
+  % Invalid record times (NaN) are sorted last and never selected.
+  num_dives = numel(dive_start_secs);
+  [sorted_secs, record_order] = sort(record_secs(:));
+  num_valid_records = sum(~isnan(sorted_secs));
+  [~, merge_order] = sort([dive_start_secs(:); sorted_secs(1:num_valid_records)]);
+  merge_dives = (merge_order <= num_dives);
+  records_before = cumsum(~merge_dives);
+  first_records_sorted = zeros(num_dives, 1);
+  first_records_sorted(merge_order(merge_dives)) = records_before(merge_dives) + 1;
+  dive_with_records = (first_records_sorted <= num_valid_records);
+  first_records_indices = record_order(first_records_sorted(dive_with_records));
   param_name_list = cellstr(params);
   for param_name_idx = 1:numel(param_name_list)
     param_name = param_name_list{param_name_idx};
     if isfield(data, param_name)
-      data.(param_name)(first_records) = data.(param_name)(dive_with_records);
+      param_values = data.(param_name)(dive_with_records);
       if iscell(data.(param_name))
-        data.(param_name)(other_records) = {[]};
+        data.(param_name)(:) = {[]};
       else
-        data.(param_name)(other_records) = nan;
+        data.(param_name)(:) = nan;
       end
+      data.(param_name)(first_records_indices) = param_values;
     end
   end
 
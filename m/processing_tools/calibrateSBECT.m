@@ -30,6 +30,9 @@ function [temp, cond] = calibrateSBECT(temp_freq, cond_freq, pres, temp_coefs, c
 %    the CT sails shipped with Seaglider gliders. They also appear in the
 %    basestation file 'sg_calib_constants.m'.
 %
+%    Both equations are evaluated by CALIBRATESENSORS, in a single pass over
+%    the raw measurements when its mex file is available.
+%
 %  Examples:
 %    temp_true = [1.0      4.5     15.0     18.5     24.0     29.0     32.5     ]
 %    cond_true = [2.97836  3.28569  4.26827  4.61375  5.17227  5.69472  6.06756 ]
@@ -40,6 +43,9 @@ function [temp, cond] = calibrateSBECT(temp_freq, cond_freq, pres, temp_coefs, c
 %    cond_coefs = [-9.92304872     1.11163373    -2.02979731e-3  2.29265437e-4 -9.57e-8  3.25e-6]
 %    [temp, cond] = calibrateSBECT(temp_freq, cond_freq, pres, temp_coefs, cond_coefs)
 %
+%  See also:
+%    CALIBRATESENSORS
+%
 %  Authors:
 %    Joan Pau Beltran  <joanpau.beltran@socib.cat>
 
@@ -63,23 +69,19 @@ function [temp, cond] = calibrateSBECT(temp_freq, cond_freq, pres, temp_coefs, c
   narginchk(5, 5);
   
   if isstruct(temp_coefs)
-    jihg_temp = [temp_coefs.t_j temp_coefs.t_i temp_coefs.t_h temp_coefs.t_g];
+    coefs_temp = [temp_coefs.t_g temp_coefs.t_h temp_coefs.t_i temp_coefs.t_j];
   else
-    jihg_temp = temp_coefs([4 3 2 1]);
+    coefs_temp = temp_coefs([1 2 3 4]);
   end
   
   if isstruct(cond_coefs)
-    jih0g_cond = [cond_coefs.c_j cond_coefs.c_i cond_coefs.c_h 0 cond_coefs.c_g];
-    ctcor = cond_coefs.ctcor;
-    cpcor = cond_coefs.cpcor;
+    coefs_cond = [cond_coefs.c_g cond_coefs.c_h cond_coefs.c_i cond_coefs.c_j ...
+                 cond_coefs.ctcor cond_coefs.cpcor];
   else
-    jih0g_cond = [cond_coefs([4 3 2]) 0 cond_coefs(1)];
-    ctcor = cond_coefs(5);
-    cpcor = cond_coefs(6);
+    coefs_cond = cond_coefs([1 2 3 4 5 6]);
   end
   
-  temp = 1 ./ polyval(jihg_temp, log(1000 ./ temp_freq)) - 273.15;
-  cond = 0.1 * ...
-    polyval(jih0g_cond, cond_freq ./ 1000) ./ (1 + ctcor * temp + cpcor * pres);
+  [temp, cond] = calibratesensors('sbect', temp_freq, cond_freq, pres, ...
+                                  coefs_temp(:)', coefs_cond(:)');
 
 end
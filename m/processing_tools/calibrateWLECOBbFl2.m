@@ -33,6 +33,9 @@ function [chlr, cdom, scat] = calibrateWLECOBbFl2(chlr_cnts, cdom_cnts, scat_cnt
 %    the ECO Triplet Puck shipped with Seaglider gliders. They also appear in 
 %    the basestation file 'sg_calib_constants.m'.
 %
+%    The three signals are calibrated by CALIBRATESENSORS, in a single pass
+%    over the raw measurements when its mex file is available.
+%
 %  Examples:
 %    chlr_cnts = [50 51 51 57 63 80 83 83 81 72 68 67 64 57 56 54 52 51 50]
 %    cdom_cnts = [45 49 50 50 51 56 57 59 57 60 57 61 58 58 58 57 57 60 56]
@@ -44,6 +47,9 @@ function [chlr, cdom, scat] = calibrateWLECOBbFl2(chlr_cnts, cdom_cnts, scat_cnt
 %      calibrateWLECOBbFl2(chlr_cnts, cdom_cnts, scat_cnts, ...
 %                          chlr_coefs, cdom_coefs, scat_coefs)
 %
+%  See also:
+%    CALIBRATESENSORS
+%
 %  Authors:
 %    Joan Pau Beltran  <joanpau.beltran@socib.cat>
 
@@ -82,8 +88,7 @@ function [chlr, cdom, scat] = calibrateWLECOBbFl2(chlr_cnts, cdom_cnts, scat_cnt
     sd_scat = scat_coefs([1 2]);
   end
   
-  chlr = sd_chlr(1)*(chlr_cnts - sd_chlr(2));
-  cdom = sd_cdom(1)*(cdom_cnts - sd_cdom(2));
-  scat = sd_scat(1)*(scat_cnts - sd_scat(2));
+  [chlr, cdom, scat] = calibratesensors('affine', ...
+    chlr_cnts, cdom_cnts, scat_cnts, [sd_chlr(:)'; sd_cdom(:)'; sd_scat(:)']);
 
 end
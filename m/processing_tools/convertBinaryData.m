@@ -12,9 +12,11 @@ function [] = convertBinaryData( input_path, output_path, glider_type, varargin)
 %    directory, convert them to ascii format in the ascii directory, and
 %    store the returned absolute path for later use. Since some conversion
 %    may fail use a cell array of string cell arrays and flatten it when
-%    finished, leaving only the succesfully created dbas. Give a second try
-%    to failing files, because they might have failed due to  a missing
-%    cache file generated later. 
+%    finished, leaving only the succesfully created dbas. The sensor list
+%    cache files needed by the binary files are checked before the
+%    conversion with LOADSENSORLISTCACHE. Files providing the sensor lists
+%    are converted first, and files whose sensor list cache file is missing
+%    are reported upfront and skipped.
 %
 %  Input:
 %    INPUT_PATH: Location where the binary xdb files are in the local drive.
@@ -110,29 +112,39 @@ function [] = convertBinaryData( input_path, output_path, glider_type, varargin)
         disp(['Binary files path: ' input_path]);
         disp(['Binary files found: ' num2str(numel(xbd_names)) ...
              ' (' num2str(sum(xbd_sizes)*2^-10) ' kB).']);
+        % Check the sensor lists needed by the binary files before converting.
+        % Files with unfactored sensor lists generate the cache files needed 
+        % by the factored ones, so convert them first. Report files whose
+        % sensor list is not available upfront and skip them.
+        xbd_fullfiles = cellfun(@(n)(fullfile(input_path, n)), xbd_names, ...
+                                'UniformOutput', false);
+        [xbd_crcs, xbd_factored, xbd_missing] = ...
+          loadSensorListCache(xbd_fullfiles, options.cache);
+        if any(xbd_missing)
+          disp(['Binary files with missing sensor list cache files: ' ...
+                num2str(sum(xbd_missing)) '.']);
+          xbd_missing_info = [reshape(xbd_names(xbd_missing), 1, []);
+                              reshape(xbd_crcs(xbd_missing), 1, [])];
+          fprintf('  %s (%s.cac)\n', xbd_missing_info{:});
+        end
+        [~, xbd_order] = sort(xbd_factored);
         new_files = cell(size(xbd_names));
-        for conversion_retry = 1:2
-          for xbd_idx = 1:numel(xbd_names)
-            if isempty(new_files{xbd_idx})
-              xbd_name_ext = xbd_names{xbd_idx};
-              dba_name_ext = regexprep(xbd_name_ext, ...
-                                       options.xbd_name_pattern, ...
-                                       options.dba_name_replace);
-              xbd_fullfile = fullfile(input_path, xbd_name_ext);
-              dba_fullfile = fullfile(output_path, dba_name_ext);
-              try
-                new_files{xbd_idx} = ...
-                  {xbd2dba(xbd_fullfile, dba_fullfile, ...
-                           'cache', options.cache, ...
-                           'cmdname', options.cmdname)};
-              catch exception
-                new_files{xbd_idx} = {};
-                if conversion_retry == 2
-                  disp(['Error converting binary file ' xbd_name_ext ':']);
-                  disp(getReport(exception, 'extended'));
-                end
-              end
-            end
+        for xbd_idx = xbd_order(~xbd_missing(xbd_order))
+          xbd_name_ext = xbd_names{xbd_idx};
+          dba_name_ext = regexprep(xbd_name_ext, ...
+                                   options.xbd_name_pattern, ...
+                                   options.dba_name_replace);
+          xbd_fullfile = xbd_fullfiles{xbd_idx};
+          dba_fullfile = fullfile(output_path, dba_name_ext);
+          try
+            new_files{xbd_idx} = ...
+              {xbd2dba(xbd_fullfile, dba_fullfile, ...
+                       'cache', options.cache, ...
+                       'cmdname', options.cmdname)};
+          catch exception
+            new_files{xbd_idx} = {};
+            disp(['Error converting binary file ' xbd_name_ext ':']);
+            disp(getReport(exception, 'extended'));
           end
         end
         new_files = [new_files{:}];
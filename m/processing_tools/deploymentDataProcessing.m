@@ -25,6 +25,10 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
 %           previously converted. In this case, it will save time to skip
 %           this step. The conversion uses the shell dbd2asc 
 %          script profided by Slocumdefined by config.wrcprogs.dbd2asc.
+%           Alternatively, Slocum binary files may be loaded directly in the
+%           next step by setting processing_config.file_options.binary_loading
+%           to 1. Then the conversion is skipped and the binary files are
+%           read once with XBD2MAT, without writing and parsing ascii files.
 %      - Load data from all files in a single and consistent structure.
 %      - Generate standarized product version of raw data (NetCDF level 0).
 %           This step is optional and happens when the netcdf0 file name is
@@ -73,6 +77,11 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
 %           optional and happens when the figure directory name is
 %           defined in the data_paths or data_paths is a directory name.
 %
+%    The duration of each step and the amount of data handled (files and bytes
+%    downloaded, files loaded, samples processed, profiles found and QC flags
+%    set) are recorded as metrics labeled by deployment with RECORDMETRIC,
+%    to be exported by WRITEMETRICS.
+%
 %  Inputs:
 %    DATA_PATH defines the location of the input files and the products that
 %      are created including netCDF files and figures. It may be a directory 
@@ -84,7 +93,9 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
 %      the following folders will be created under the input directory: binary, 
 %      log, ascii, figure and netcdf. The files netcdf_l0.nc, netcdf_l1.nc
 %      and netcdf_l2.nc are created for L0, L1 and L2 netCDF files
-%      respecively.
+%      respecively. The sensor and thermal lag parameter estimates are kept
+%      across runs in the file lag_params_cache.mat, or in the file given by
+%      the LAG_CACHE field of the struct if any (see PROCESSGLIDERDATA).
 %
 %    DEPLOYMENT contains the information of the deployment to be processed.
 %    It should be a structure containing the following information:
@@ -256,6 +267,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
           netcdf_l0_file = fullfile(data_paths, 'netcdf', 'netcdf_l0.nc');
           netcdf_l1_file = fullfile(data_paths, 'netcdf', 'netcdf_l1.nc');
           netcdf_l2_file = fullfile(data_paths, 'netcdf', 'netcdf_l2.nc');
+          lag_cache_file = fullfile(data_paths, 'lag_params_cache.mat');
       else   %if strcmp(options.data_tree, 'default')
           binary_dir     = fullfile(data_paths);
           cache_dir      = fullfile(data_paths);
@@ -265,6 +277,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
           netcdf_l0_file = fullfile(data_paths, 'netcdf_l0.nc');
           netcdf_l1_file = fullfile(data_paths, 'netcdf_l1.nc');
           netcdf_l2_file = fullfile(data_paths, 'netcdf_l2.nc');
+          lag_cache_file = fullfile(data_paths, 'lag_params_cache.mat');
       end
   elseif isstruct(data_paths)
       binary_dir         = fullfile(data_paths.base_dir, data_paths.binary_path);
@@ -277,6 +290,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
       netcdf_l1_file     = '';
       netcdf_l2_file     = '';
       netcdf_egol1_file  = '';
+      lag_cache_file     = '';
       
       if isfield(data_paths,'figure_path') && ~isempty(data_paths.figure_path)
         figure_dir         = fullfile(data_paths.base_dir, data_paths.figure_path);
@@ -296,6 +310,9 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
       if isfield(data_paths,'netcdf_egol1') && ~isempty(data_paths.netcdf_egol1)
         netcdf_egol1_file     = fullfile(data_paths.base_dir, data_paths.netcdf_egol1);
       end
+      if isfield(data_paths,'lag_cache') && ~isempty(data_paths.lag_cache)
+        lag_cache_file     = fullfile(data_paths.base_dir, data_paths.lag_cache);
+      end
   else
     error('glider_toolbox:deploymentDataProcessing:InvalidOptions', ...
           'Data path input must be a string or a structure.');
@@ -348,7 +365,12 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
     processing_config.preprocessing_options.calibration_parameter_list = deployment.calibrations;
   end
   
+  %% Set labels of the metrics of this deployment (see RECORDMETRIC).
+  metric_labels = struct('deployment', deployment.deployment_name, ...
+                         'glider', deployment.glider_name);
+  
   %% Download deployment glider files from station(s).
+  stage_start = tic();
   user_dockserver = 0;
   if ~isempty(config.dockservers) && isfield(config.dockservers, 'active')
       user_dockserver = config.dockservers.active;
@@ -369,6 +391,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
          %DSbin_options.basestations = config.basestations;
          DSbin_options.glider = glider_serial;
       end
+      files_before = dir(output_path);
       try
         getBinaryData(output_path, log_dir, glider_type, ...
                     processing_config.file_options, config.dockservers.server, DSbin_options);
@@ -376,13 +399,33 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
                 error('glider_toolbox:deploymentDataProcessing:CallFailed', ...
                       'Error getting remote files:%s', getReport(exception, 'extended'));
       end
+      % Count new or updated files comparing the listings before and after.
+      files_after = dir(output_path);
+      file_key = @(f)(sprintf('%s %d %.10f', f.name, f.bytes, f.datenum));
+      files_new = ~[files_after.isdir] ...
+        & ~ismember(arrayfun(file_key, files_after(:)', 'UniformOutput', false), ...
+                    arrayfun(file_key, files_before(:)', 'UniformOutput', false));
+      recordMetric('counter', 'glider_toolbox_files_downloaded_total', ...
+                   sum(files_new), metric_labels);
+      recordMetric('counter', 'glider_toolbox_bytes_downloaded_total', ...
+                   sum([files_after(files_new).bytes]), metric_labels);
+      recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                   toc(stage_start), setfield(metric_labels, 'stage', 'download'));
   end
   
   %% Convert binary data to ascii format
+  stage_start = tic();
   if ~isfield(processing_config.file_options, 'format_conversion')
       processing_config.file_options.format_conversion = 1;
   end
-  if processing_config.file_options.format_conversion
+  if ~isfield(processing_config.file_options, 'binary_loading')
+      processing_config.file_options.binary_loading = 0;
+  end
+  binary_loading = processing_config.file_options.binary_loading ...
+                   && any(strcmp(glider_type, {'slocum_g1' 'slocum_g2'}));
+  if binary_loading
+      disp('Skip binary conversion: binary files are loaded directly');
+  elseif processing_config.file_options.format_conversion
       try
         convertBinaryData( binary_dir, ascii_dir,  glider_type, ...
                            'xbd_name_pattern', processing_config.file_options.xbd_name_pattern, ...
@@ -393,18 +436,31 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
           error('glider_toolbox:deploymentDataProcessing:ProcessError', ...
                 'Error generating Ascii data from %s: %s', binary_dir, getReport(exception, 'extended'));
       end
+      recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                   toc(stage_start), setfield(metric_labels, 'stage', 'conversion'));
   else
       disp('Skip binary conversion due to request of no binary format conversion');
   end
 
-  %% Load data from ascii deployment glider files.
+  %% Load data from ascii (or binary) deployment glider files.
+  stage_start = tic();
+  if binary_loading
+      load_dir = binary_dir;
+  else
+      load_dir = ascii_dir;
+  end
   try
-    [meta_raw, data_raw, source_files] = loadAsciiData( ascii_dir, glider_type, deployment.deployment_start, ...
-                 processing_config.file_options, 'end_utc', deployment.deployment_end);
+    [meta_raw, data_raw, source_files] = loadAsciiData( load_dir, glider_type, deployment.deployment_start, ...
+                 processing_config.file_options, 'end_utc', deployment.deployment_end, ...
+                 'binary', binary_loading, 'cache', cache_dir);
   catch exception
       error('glider_toolbox:deploymentDataProcessing:ProcessError', ...
-            'Error loading Ascii data from %s: %s', ascii_dir, getReport(exception, 'extended'));
+            'Error loading data from %s: %s', load_dir, getReport(exception, 'extended'));
   end
+  recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+               toc(stage_start), setfield(metric_labels, 'stage', 'loading'));
+  recordMetric('counter', 'glider_toolbox_files_loaded_total', ...
+               numel(source_files), metric_labels);
   
   if strcmp(options.data_result, 'raw')
     meta_res = meta_raw;
@@ -529,6 +585,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
   %% Preprocess raw glider data.
   if ~isempty(fieldnames(data_raw))
     disp('Preprocessing raw data...');
+    stage_start = tic();
     try
       if strcmp(glider_type, 'seaglider')
         seaglider_time_sensor_select = strcmp('elaps_t', {processing_config.preprocessing_options.time_list.time});
@@ -541,6 +598,8 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
       error('glider_toolbox:deploymentDataProcessing:ProcessError', ...
             'Error preprocessing glider deployment data: %s', getReport(exception, 'extended'));
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'preprocessing'));
   end
 
   if strcmp(options.data_result, 'preprocessed')
@@ -551,6 +610,10 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
   %% Process preprocessed glider data.
   if ~isempty(fieldnames(data_preprocessed))
     disp('Processing glider data...');
+    stage_start = tic();
+    if ~isempty(lag_cache_file)
+      processing_config.processing_options.lag_cache = lag_cache_file;
+    end
     try
       [data_processed, meta_processed] = ...
         processGliderData(data_preprocessed, meta_preprocessed, ...
@@ -559,6 +622,16 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
       error('glider_toolbox:deploymentDataProcessing:ProcessError', ...
             'Error processing glider deployment data: %s', getReport(exception, 'extended'));
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'processing'));
+    if isfield(data_processed, 'time')
+      recordMetric('counter', 'glider_toolbox_samples_processed_total', ...
+                   numel(data_processed.time), metric_labels);
+    end
+    if isfield(data_processed, 'profile_index')
+      recordMetric('gauge', 'glider_toolbox_profiles', ...
+                   max([0; data_processed.profile_index(:)]), metric_labels);
+    end
   end
   
   if strcmp(options.data_result, 'processed')
@@ -588,6 +661,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
   if ~isempty(fieldnames(data_qc_processed)) && ~isempty(netcdf_l1_file)
     netcdf_l1_options = processing_config.netcdf_l1_options;
     disp('Generating NetCDF L1 output...');
+    stage_start = tic();
     try
       outputs.netcdf_l1 = generateOutputNetCDF( ...
         netcdf_l1_file, data_qc_processed, meta_qc_processed, deployment, ...
@@ -601,6 +675,8 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
             netcdf_l1_file ':']);
       disp(getReport(exception, 'extended'));
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'netcdf_l1'));
   elseif isempty(netcdf_l1_file)
       disp('Skip generation of NetCDF L1 outputs');
   end
@@ -608,6 +684,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
   %% Generate processed data figures.
   if ~isempty(fieldnames(data_qc_processed)) && ~isempty(figure_dir)
     disp('Generating figures from processed data...');
+    stage_start = tic();
     try
       figures.figproc = generateGliderFigures( ...
         data_qc_processed, processing_config.figproc_options, ...
@@ -617,6 +694,8 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
       disp('Error generating processed data figures:');
       disp(getReport(exception, 'extended'));
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'figures_processed'));
   end
 
   
@@ -664,6 +743,19 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
             meta_res = meta_qc_postprocessed;
             data_res = data_qc_postprocessed;
         end
+        
+        % Count the flags set in the QC variables.
+        qc_names = fieldnames(data_qc_postprocessed);
+        qc_names = qc_names(~cellfun(@isempty, regexp(qc_names, '_QC$', 'once')));
+        qc_flags_set = 0;
+        for qc_name_idx = 1:numel(qc_names)
+          qc_flags = data_qc_postprocessed.(qc_names{qc_name_idx});
+          if ~isscalar(qc_flags)
+            qc_flags_set = qc_flags_set + sum(qc_flags(:) ~= 0 & ~isnan(qc_flags(:)));
+          end
+        end
+        recordMetric('counter', 'glider_toolbox_qc_flags_set_total', ...
+                     qc_flags_set, metric_labels);
     end
   end
   
@@ -704,6 +796,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
   %% Grid processed glider data.
   if ~isempty(fieldnames(data_processed))
     disp('Gridding glider data...');
+    stage_start = tic();
     try
       [data_gridded, meta_gridded] = ...
         gridGliderData(data_processed, meta_processed, processing_config.gridding_options);
@@ -711,6 +804,8 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
       error('glider_toolbox:deploymentDataProcessing:ProcessError', ...
             'Error gridding glider deployment data: %s', getReport(exception, 'extended'));
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'gridding'));
   end
   
   if strcmp(options.data_result, 'gridded')
@@ -743,6 +838,7 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
   %% Generate gridded data figures.
   if ~isempty(fieldnames(data_gridded)) && ~isempty(figure_dir)
     disp('Generating figures from gridded data...');
+    stage_start = tic();
     try
       figures.figgrid = generateGliderFigures( ...
         data_gridded, processing_config.figgrid_options, ...
@@ -752,6 +848,8 @@ function [outputs, figures, meta_res, data_res] = deploymentDataProcessing(data_
       disp('Error generating gridded data figures:');
       disp(getReport(exception, 'extended'));
     end
+    recordMetric('histogram', 'glider_toolbox_stage_duration_seconds', ...
+                 toc(stage_start), setfield(metric_labels, 'stage', 'figures_gridded'));
   end
   
 end
\ No newline at end of file
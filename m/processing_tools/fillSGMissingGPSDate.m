@@ -1,9 +1,10 @@
-function [stampnum, hhmmss, ddmmyy] = fillSGMissingGPSDate(hhmmss, ddmmyy)
+function [stampnum, hhmmss, ddmmyy, stampsecs] = fillSGMissingGPSDate(hhmmss, ddmmyy)
 %FILLSGMISSINGGPSDATE  Fill missing date component of Seaglider GPS timestamps.
 %
 %  Syntax:
 %    STAMPNUM = FILLSGMISSINGGPSDATE(DDMMYY, HHMMSS)
 %    [STAMPNUM, HHMMSS, DDMMYY] = FILLSGMISSINGGPSDATE(HHMMSS, DDMMYY)
+%    [STAMPNUM, HHMMSS, DDMMYY, STAMPSECS] = FILLSGMISSINGGPSDATE(HHMMSS, DDMMYY)
 %
 %  Description:
 %    STAMPNUM = FILLSGMISSINGGPSDATE(DDMMYY, HHMMSS) fills the date component
@@ -15,16 +16,29 @@ function [stampnum, hhmmss, ddmmyy] = fillSGMissingGPSDate(hhmmss, ddmmyy)
 %    returns the same input arrays HHMMSS and DDMMYY but with the empty
 %    entries in DDMMYY filled with the corresponding date component value.
 %
+%    [STAMPNUM, HHMMSS, DDMMYY, STAMPSECS] = FILLSGMISSINGGPSDATE(HHMMSS, DDMMYY)
+%    also returns the timestamps as POSIX times (seconds since 1970-01-01 UTC)
+%    in array STAMPSECS.
+%
 %  Notes:
 %    GPS lines in Seaglider log may have no date component and the corresponding
 %    entries of input DDMMYY will be empty. Those entries are filled computing
 %    the corresponding date from the next timestamp with a date component and
 %    taking into account day roll backs inferred from the time components.
+%    Entries with no date component after them, or with invalid components,
+%    are invalid (NaN).
+%
+%    Date and time components are parsed with integer arithmetic instead of
+%    date string conversions, and the day roll backs of all entries are
+%    computed at once, so the conversion cost is linear in the number of
+%    entries. Two digit years are taken in the range 1970-2069.
 %
 %  Examples:
 %    stampvec = fillSGMissingGPSTimestamp(hhmmss, ddmmyy)
 %
 %  See also:
+%    UTC2POSIXTIME
+%    POSIXTIME2UTC
 %
 %  Authors:
 %    Joan Pau Beltran  <joanpau.beltran@socib.cat>
@@ -48,29 +62,85 @@ function [stampnum, hhmmss, ddmmyy] = fillSGMissingGPSDate(hhmmss, ddmmyy)
 
   narginchk(2, 2);
   
-  nodate = cellfun(@isempty, cellstr(ddmmyy));
-  stampvec(~nodate, :) = ...
-    datevec(strcat(ddmmyy(~nodate,:),hhmmss(~nodate,:)), 'ddmmyyHHMMSS');
-  nodate_boundary = find([true; xor(nodate(1:end-1), nodate(2:end))]);
-  for i = numel(nodate_boundary):-1:2
-    index_curr = nodate_boundary(i);  
-    index_prev = nodate_boundary(i-1);  
-    if nodate(index_prev)
-      stampvec(index_prev:index_curr-1, :) = ...
-        datevec(strcat(ddmmyy(index_curr,:), hhmmss(index_prev:index_curr-1,:)), ...
-                'ddmmyyHHMMSS');
-      dateroll = 0 > diff(datenum(stampvec(index_prev:index_curr,:)));
-      stampvec(index_prev:index_curr-1, 3) = ...
-        stampvec(index_prev:index_curr-1, 3) - flipud(cumsum(flipud(dateroll)));
-    end
-  end
-  stampnum = datenum(stampvec);
-  if nargout > 1
+  % Parse the time and date components with integer arithmetic.
+  % Entries that are not 6 digit strings (e.g. empty dates) are invalid.
+  [tod_digits, tod_valid] = parseDigits(hhmmss);
+  [date_digits, date_valid] = parseDigits(ddmmyy);
+  tod = tod_digits * [36000; 3600; 600; 60; 10; 1];
+  tod(~tod_valid) = nan;
+  dmy = date_digits(:, [1 3 5]) * 10 + date_digits(:, [2 4 6]);
+  dmy(:, 3) = dmy(:, 3) + 1900 + 100 * (dmy(:, 3) < 70);
+  days = civil2days(dmy(:, 3), dmy(:, 2), dmy(:, 1));
+  days(~date_valid) = nan;
+  
+  % Take the date of undated entries from the next dated entry, and roll it
+  % back one day for each time decrease between the entry and the dated one.
+  % The decreases are accumulated backwards over all the entries at once,
+  % and the count for each undated entry is the difference between its
+  % accumulated value and the one of its next dated entry.
+  nodate = ~date_valid;
+  date_indices = find(date_valid);
+  date_count = cumsum(date_valid);
+  fillable = nodate & (date_count < numel(date_indices));
+  next_indices = date_indices(date_count(fillable) + 1);
+  dateroll = false(size(tod));
+  dateroll(1:end-1) = nodate(1:end-1) & (tod(2:end) < tod(1:end-1));
+  rollback = flipud(cumsum(flipud(dateroll)));
+  days(fillable) = days(next_indices) ...
+                 - (rollback(fillable) - rollback(next_indices));
+  
+  stampsecs = 86400 * days + tod;
+  stampnum = posixtime2utc(stampsecs);
+  
+  if nargout > 1 && any(nodate)
+    fill_days = days(nodate);
+    fill_valid = ~isnan(fill_days);
+    fill_days(~fill_valid) = 0;
+    [year, month, day] = days2civil(fill_days);
+    fill_strings = ...
+      reshape(sprintf('%02d%02d%02d', [day month mod(year, 100)]'), 6, [])';
+    fill_strings(~fill_valid, :) = ' ';
     if ischar(ddmmyy)
-      ddmmyy(nodate, 1:6) = datestr(stampnum(nodate), 'ddmmyy');
+      ddmmyy(nodate, 1:6) = fill_strings;
     else
-      ddmmyy(nodate) = cellstr(datestr(stampnum(nodate), 'ddmmyy'));
+      ddmmyy(nodate) = cellstr(fill_strings);
     end
   end
   
 end
+
+
+function [digits, valid] = parseDigits(str)
+%PARSEDIGITS  Split 6 digit strings into a matrix of digit values.
+  str = char(cellstr(str));
+  str(:, end+1:6) = ' ';
+  digits = double(str(:, 1:6)) - double('0');
+  valid = all(0 <= digits & digits <= 9, 2);
+  digits(~valid, :) = 0;
+end
+
+
+function days = civil2days(year, month, day)
+%CIVIL2DAYS  Days since 1970-01-01 of proleptic Gregorian calendar dates.
+  year = year - (month <= 2);
+  era = floor(year / 400);
+  yoe = year - 400 * era;
+  doy = floor((153 * mod(month + 9, 12) + 2) / 5) + day - 1;
+  doe = 365 * yoe + floor(yoe / 4) - floor(yoe / 100) + doy;
+  days = 146097 * era + doe - 719468;
+end
+
+
+function [year, month, day] = days2civil(days)
+%DAYS2CIVIL  Proleptic Gregorian calendar dates of days since 1970-01-01.
+  days = days + 719468;
+  era = floor(days / 146097);
+  doe = days - 146097 * era;
+  yoe = floor((doe - floor(doe / 1460) + floor(doe / 36524) ...
+               - floor(doe / 146096)) / 365);
+  doy = doe - (365 * yoe + floor(yoe / 4) - floor(yoe / 100));
+  mp = floor((5 * doy + 2) / 153);
+  day = doy - floor((153 * mp + 2) / 5) + 1;
+  month = mp + 3 - 12 * (mp >= 10);
+  year = 400 * era + yoe + (month <= 2);
+end
@@ -235,8 +235,12 @@ function [profile_index, profile_direction] = findProfiles(varargin)
   cast_tail(cast_tail_index(cast_valid)) = 0.5;
   profile_index = 0.5 + cumsum(cast_head + cast_tail);
   profile_direction = nan(size(depth));
-  for i = 1:numel(valid_index)-1
-    profile_direction(valid_index(i):valid_index(i+1)-1) = sdy(i);
+  % Each vertical direction lasts from a valid entry until the next one:
+  % spread them cumulating the starts of the direction segments.
+  if numel(valid_index) > 1
+    sdy_start = zeros(valid_index(end) - valid_index(1), 1);
+    sdy_start(valid_index(1:end-1) - valid_index(1) + 1) = 1;
+    profile_direction(valid_index(1):valid_index(end)-1) = sdy(cumsum(sdy_start));
   end
 
 end
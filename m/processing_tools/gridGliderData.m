@@ -69,6 +69,12 @@ function [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, varargin)
 %        String cell array with the names of the variables to be interpolated
 %        over the output profiles.
 %        Default value: {} (do nothing except compute profile coordinates)
+%      CHUNK_MEMORY: memory budget for the variable readings.
+%        Non-negative number with the memory (in bytes) available for the array
+%        of readings of the variables to grid. Casts are gridded in windows of
+%        consecutive casts whose readings fit in it, with the same output.
+%        If infinite, all readings are copied to the array at once.
+%        Default value: inf
 %
 %  Notes:
 %    This function is an improved version of a previous function by Tomeu Garau
@@ -79,11 +85,16 @@ function [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, varargin)
 %        each new depth level with the diameter of the depth resolution
 %        (instead of interpolation).
 %
+%    Gridded variables keep the precision of the original sequences:
+%    single precision sequences (see option SINGLE_PRECISION_LIST of
+%    PROCESSGLIDERDATA) are gridded in single precision.
+%
 %  Examples:
 %    [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, options)
 %
 %  See also:
 %    PROCESSGLIDERDATA
+%    SUMMARIZESEGMENTS
 %
 %  Authors:
 %    Joan Pau Beltran  <joanpau.beltran@socib.cat>
@@ -105,7 +116,7 @@ function [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, varargin)
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-  narginchk(2, 16);
+  narginchk(2, 18);
   
   
   %% Set gridding options from default values and extra arguments.
@@ -118,6 +129,7 @@ function [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, varargin)
   options.depth_list = {'depth'};
   options.depth_step = 1;
   options.variable_list = {};
+  options.chunk_memory = inf;
   % Parse option key-value pairs in any accepted call signature.
   if isscalar(varargin) && isstruct(varargin{1})
     % Options passed as a single option struct argument:
@@ -234,10 +246,14 @@ function [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, varargin)
   depth = data_proc.(depth_sequence);
   num_variables = numel(variable_name_list);
   num_instants = numel(time);
-  variables = nan(num_instants, num_variables);
-  for variable_name_idx = 1:num_variables
-    variable_name = variable_name_list{variable_name_idx};
-    variables(:, variable_name_idx) = data_proc.(variable_name)(:);
+  % Single precision sequences are gridded in single precision,
+  % unless they are mixed with double precision sequences.
+  variable_single_list = ...
+    cellfun(@(v)(isa(data_proc.(v), 'single')), variable_name_list);
+  if ~isempty(variable_single_list) && all(variable_single_list)
+    variables_class = 'single';
+  else
+    variables_class = 'double';
   end
 
   
@@ -246,6 +262,49 @@ function [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, varargin)
   profile_range = (1:num_casts);
 
 
+  %% Compute cast windows.
+  % The variable array is built for a window of consecutive casts at a time,
+  % with as many casts as fit in the memory budget. This needs casts made of
+  % contiguous readings (as returned by FINDPROFILES), otherwise all casts
+  % are gridded in a single window with all the readings.
+  window_first_cast = 1;
+  window_last_cast = num_casts;
+  window_start = 1;
+  window_end = num_instants;
+  if isfinite(options.chunk_memory) && num_casts > 0
+    casts = summarizeSegments(profile);
+    if all(casts.last - casts.first + 1 == casts.samples)
+      cast_start = casts.first;
+      cast_end = casts.last;
+      cast_start(casts.samples == 0) = inf;
+      cast_end(casts.samples == 0) = -inf;
+      record_bytes = num_variables * 8;
+      if strcmp(variables_class, 'single')
+        record_bytes = num_variables * 4;
+      end
+      max_records = max(1, floor(options.chunk_memory / record_bytes));
+      window_first_cast = 1;
+      window_last_cast = zeros(0, 1);
+      window_records = 0;
+      for cast_idx = 1:num_casts
+        if window_records > 0 ...
+            && window_records + casts.samples(cast_idx) > max_records
+          window_last_cast(end+1, 1) = cast_idx - 1; %#ok<AGROW>
+          window_first_cast(end+1, 1) = cast_idx; %#ok<AGROW>
+          window_records = 0;
+        end
+        window_records = window_records + casts.samples(cast_idx);
+      end
+      window_last_cast(end+1, 1) = num_casts;
+      window_start = arrayfun(@(c1, c2)(min(cast_start(c1:c2))), ...
+                              window_first_cast, window_last_cast);
+      window_end = arrayfun(@(c1, c2)(max(cast_end(c1:c2))), ...
+                            window_first_cast, window_last_cast);
+    end
+  end
+  num_windows = numel(window_first_cast);
+
+
   %% Compute depth intervals.
   depth_resolution = options.depth_step;
   depth_min = round(min(depth) / depth_resolution) * depth_resolution;
@@ -304,21 +363,30 @@ function [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, varargin)
   fprintf('  number of depth levels: %d\n', num_levels);
   fprintf('  number of profiles    : %d\n', num_casts);
   fprintf('  number of variables   : %d\n', num_variables);
-  data_grid_variables = nan(num_casts, num_levels, num_variables);
-  for cast_idx = 1:num_casts
-    cast_select = (profile == cast_idx);
-    cast_lat = latitude(cast_select);
-    cast_lon = longitude(cast_select);
-    cast_depth = depth(cast_select);
-    cast_time = time(cast_select);
-    cast_variables = variables(cast_select, :);
-    data_grid.time(cast_idx) = nanmean(cast_time);
-    data_grid.latitude(cast_idx) = nanmean(cast_lat);
-    data_grid.longitude(cast_idx) = nanmean(cast_lon);
-    if ~isempty(cast_variables) % Speed up when there are no variables.
-      data_grid_variables(cast_idx, :, :) = ...
-        cell2mat(arrayfun(@(d) nanmean(cast_variables(abs(cast_depth-d)<=0.5*depth_resolution, :), 1), ...
-                          depth_range(:), 'UniformOutput', false));
+  fprintf('  number of windows     : %d\n', num_windows);
+  data_grid_variables = nan(num_casts, num_levels, num_variables, variables_class);
+  for window_idx = 1:num_windows
+    window_select = window_start(window_idx):window_end(window_idx);
+    window_profile = profile(window_select);
+    variables = nan(numel(window_select), num_variables, variables_class);
+    for variable_name_idx = 1:num_variables
+      variable_name = variable_name_list{variable_name_idx};
+      variables(:, variable_name_idx) = data_proc.(variable_name)(window_select);
+    end
+    for cast_idx = window_first_cast(window_idx):window_last_cast(window_idx)
+      cast_select = window_select(window_profile == cast_idx);
+      cast_lat = latitude(cast_select);
+      cast_lon = longitude(cast_select);
+      cast_depth = depth(cast_select);
+      cast_time = time(cast_select);
+      cast_variables = variables(cast_select - window_select(1) + 1, :);
+      data_grid.time(cast_idx) = nanmean(cast_time);
+      data_grid.latitude(cast_idx) = nanmean(cast_lat);
+      data_grid.longitude(cast_idx) = nanmean(cast_lon);
+      if ~isempty(cast_variables) % Speed up when there are no variables.
+        data_grid_variables(cast_idx, :, :) = ...
+          cell2mat(arrayfun(@(d) nanmean(cast_variables(abs(cast_depth-d)<=0.5*depth_resolution, :), 1), ...
+                            depth_range(:), 'UniformOutput', false));
         
 %         cast_count = cell2mat(arrayfun(@(d) sum(abs(cast_depth-d)<=0.5*depth_resolution), ...
 %                           depth_range(:), 'UniformOutput', false));
@@ -337,20 +405,23 @@ function [data_grid, meta_grid] = gridGliderData(data_proc, meta_proc, varargin)
 %         plot(cast_depth,cast_variables(:,1), '*')
 %         hold on
 %         plot(depth_range, data_grid_variables(cast_idx,:,1), 'r*')
+      end
     end
   end
-  % Move binned variable data to output struct.
+  % Move binned variable data to output struct,
+  % keeping the precision of the original sequence.
   for variable_name_idx = 1:num_variables
     variable_name = variable_name_list{variable_name_idx};
-    data_grid.(variable_name) = data_grid_variables(:, :, variable_name_idx);
+    if variable_single_list(variable_name_idx)
+      data_grid.(variable_name) = ...
+        single(data_grid_variables(:, :, variable_name_idx));
+    else
+      data_grid.(variable_name) = ...
+        double(data_grid_variables(:, :, variable_name_idx));
+    end
   end
   %%}
 
-  c = data_grid.chlorophyll;
-  cv = reshape(c,numel(c),1);
-  cs = tabulate(cv);
-  plot(cs(:,1),cs(:,3))
-  
   %% Add gridding metadata:
   meta_grid.profile_index = meta_proc.(profile_sequence);
   meta_grid.profile_index.grid_sources = profile_sequence;
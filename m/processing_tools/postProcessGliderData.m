@@ -37,6 +37,13 @@ function [data_conv, meta_conv] = postProcessGliderData( data_proc, meta_proc, v
 %
 %    DEPLOYMENT contains the information of the deployment to be processed.
 %
+%  Notes:
+%    The phase and phase number are derived from the changes of the profile
+%    direction in a single vectorized pass. The renaming of the variables is
+%    resolved first for all the parameters in PARAM_CONVERT, and then applied
+%    to the field names of the data and metadata structs at once, without
+%    copying the arrays of the renamed variables.
+%
 %  Authors:
 %    Miguel Charcos Llorens  <mcharcos@socib.es>
 %
@@ -127,35 +134,29 @@ function [data_conv, meta_conv] = postProcessGliderData( data_proc, meta_proc, v
     meta_conv.phase.method = 'postProcessGliderData';
     meta_conv.phase_number.sources = 'profile_direction positioning_method';
     meta_conv.phase_number.method = 'postProcessGliderData';
-    profile_direction = data_conv.profile_direction;   
+    profile_direction = data_conv.profile_direction(:);
     positioning_method = data_conv.positioning_method; 
-    data_conv.phase = zeros(size(profile_direction));
-    data_conv.phase_number = zeros(size(profile_direction));
     
     %TODO: More accurate calculations of phase and phase_number
-    for i=2:numel(data_conv.profile_direction)
-        if profile_direction(i) == profile_direction(i-1);
-            data_conv.phase_number(i) = data_conv.phase_number(i-1);
-            data_conv.phase(i) = data_conv.phase(i-1);
-        else
-            data_conv.phase_number(i) = data_conv.phase_number(i-1) + 1;
-            
-            % Check the phase according to profile direction
-            if profile_direction(i) == 0 
-                if positioning_method == 0
-                    data_conv.phase(i) = 0;
-                else
-                    data_conv.phase(i) = 2;
-                end
-            elseif profile_direction(i) == 1
-                data_conv.phase(i) = 1;
-            elseif profile_direction(i) == -1
-                data_conv.phase(i) = 4;
-            else
-                data_conv.phase(i) = 6;
-            end
-        end
+    % A new phase starts at every change of profile direction (invalid
+    % directions always start a new phase). Each phase is set according to
+    % the profile direction at its start, and the first one is 0.
+    phase_start = [false; profile_direction(2:end) ~= profile_direction(1:end-1)];
+    phase_number = cumsum(phase_start);
+    phase_start_direction = profile_direction(phase_start);
+    phase_values = 6 * ones(numel(phase_start_direction) + 1, 1);
+    phase_values(1) = 0;
+    phase_values([false; phase_start_direction == 1]) = 1;
+    phase_values([false; phase_start_direction == -1]) = 4;
+    if all(positioning_method(:) == 0)
+        phase_values([false; phase_start_direction == 0]) = 0;
+    else
+        phase_values([false; phase_start_direction == 0]) = 2;
     end
+    data_conv.phase = reshape(phase_values(phase_number + 1), ...
+                              size(data_conv.profile_direction));
+    data_conv.phase_number = reshape(phase_number, ...
+                                     size(data_conv.profile_direction));
     
     
     %% Data and sensor variables. Populate sensor list and convert the variable names as indicated by param_convert option
@@ -182,29 +183,40 @@ function [data_conv, meta_conv] = postProcessGliderData( data_proc, meta_proc, v
     meta_conv.sensor_resolution.method  = 'postProcessGliderData';
     data_conv.sensor_resolution         = []; 
     
-    % Fill values
+    % Build the renaming map: each parameter takes the variable chosen for it,
+    % if present in data and metadata and with some valid value. When the same
+    % variable is chosen for several parameters, only the first one takes it.
     param_convert_list = fieldnames(options.param_convert);
+    param_choice_list = struct2cell(options.param_convert);
+    [~, param_choice_first] = unique(param_choice_list, 'first');
+    param_rename_select = false(size(param_convert_list));
+    param_rename_select(param_choice_first) = true;
+    param_rename_select = param_rename_select ...
+        & isfield(data_conv, param_choice_list) ...
+        & isfield(meta_conv, param_choice_list) ...
+        & ~strcmp(param_convert_list, param_choice_list);
+    param_rename_index = find(param_rename_select);
+    param_rename_select(param_rename_index) = ...
+        cellfun(@(c)(any(data_conv.(c)(:) > 0)), param_choice_list(param_rename_index));
+    data_conv = renameFields(data_conv, ...
+                             param_choice_list(param_rename_select), ...
+                             param_convert_list(param_rename_select));
+    meta_conv = renameFields(meta_conv, ...
+                             param_choice_list(param_rename_select), ...
+                             param_convert_list(param_rename_select));
+    
+    % Fill values
     empty_string16 = '                ';
     empty_string32 = char(strcat({empty_string16},{empty_string16}));                     
     empty_string64 = char(strcat({empty_string32},{empty_string32}));
     empty_string256 = char(strcat({empty_string64},{empty_string64},{empty_string64},{empty_string64})); 
-    field_list = fieldnames(data_conv);
     for param_change_idx = 1:numel(param_convert_list)
         param_convert_sensor = empty_string64;
         param_convert_name = param_convert_list{param_change_idx};
         laux = min(length(param_convert_sensor),length(param_convert_name));
         param_convert_sensor(1:laux) = upper(param_convert_name(1:laux));
         
-        param_choice = options.param_convert.(param_convert_name);
-        if isfield(meta_conv, param_choice) && ismember(param_choice, field_list) && any(data_conv.(param_choice) > 0) 
-            [data_conv(:).(param_convert_name)] = deal(data_conv(:).(param_choice));
-            data_conv = rmfield(data_conv,param_choice);
-            
-            [meta_conv(:).(param_convert_name)] = deal(meta_conv(:).(param_choice));
-            meta_conv = rmfield(meta_conv,param_choice);
-        end
-        field_list = fieldnames(data_conv);
-        if isfield(meta_conv, param_convert_name) && ismember(param_convert_name, field_list) && any(data_conv.(param_convert_name) > 0) 
+        if isfield(meta_conv, param_convert_name) && isfield(data_conv, param_convert_name) && any(data_conv.(param_convert_name) > 0) 
             % TODO: Could input dimensions and read the structure to know
             % how to truncate/extend the size of the strings.            
             param_convert_serial_number = empty_string16;
@@ -607,3 +619,17 @@ function [data_conv, meta_conv] = postProcessGliderData( data_proc, meta_proc, v
     
 end
 
+
+function s = renameFields(s, old_names, new_names)
+% RENAMEFIELDS  Rename fields of a scalar struct without copying their values.
+%   Fields named as any of the new names (and not renamed themselves) are
+%   replaced by the renamed ones.
+    replaced_names = intersect(setdiff(new_names, old_names), fieldnames(s));
+    if ~isempty(replaced_names)
+        s = rmfield(s, replaced_names);
+    end
+    field_names = fieldnames(s);
+    [~, rename_index] = ismember(old_names, field_names);
+    field_names(rename_index) = new_names;
+    s = cell2struct(struct2cell(s), field_names, 1);
+end
@@ -29,6 +29,12 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
 %        Upcasts and downcasts are identified finding local extrema of the
 %        chosen depth or pressure sequence, and the glider vertical direction
 %        is deduced.
+%      - Summary of casts and transects:
+%        The sample range, start and end time, position and depth, and distance
+%        covered of each cast and transect are computed in a single pass and
+%        stored in the field SEGMENTS of the metadata of the index sequences
+%        (see SUMMARIZESEGMENTS). Later steps select the data of each cast by
+%        its sample range instead of searching the whole profile index.
 %      - CTD flow speed derivation:
 %        Flow speed through the CTD cell may be derived from selected depth,
 %        time and pitch sequences. A nominal pitch value may be given if the
@@ -48,6 +54,9 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
 %      - Density derivation:
 %        In situ density may be derived from any set of conductivity,
 %        temperature and pressure sequences already selected or produced.
+%      - Precision reduction:
+%        Selected sequences may be stored in single precision, to save memory
+%        in the processing chain and space in the output files.
 %
 %    DATA_PRE should be a struct in the format returned by PREPROCESSGLIDERDATA,
 %    where each field is a sequence of measurements of the variable with the 
@@ -299,6 +308,35 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
 %                              'salinity',    {'salinity'    'salinity_corrected_thermal'}, ...
 %                              'temperature', {'temperature' 'temperature'}, ...
 %                              'pressure',    {'pressure'    'pressure'})
+%      SINGLE_PRECISION_LIST: sequences to store in single precision.
+%        String cell array with the names of the sequences to convert to single
+%        precision (fields in DATA_PROC). Input sequences are converted before
+%        any processing, and derived sequences when produced, so the processing
+%        of those sequences and of the sequences derived only from them is done
+%        in single precision too. Use it only for sequences whose resolution
+%        fits in single precision (e.g. fluorescence or backscatter payload
+%        sensors), never for coordinate sequences like time or position.
+%        Single precision sequences keep that precision when gridded, and are
+%        written as float variables in NetCDF files unless the output
+%        configuration specifies another type.
+%        Default value: {} (all sequences in double precision)
+%      CHUNK_MEMORY: memory budget for chunked processing.
+%        Non-negative number with the memory (in bytes) available for the
+%        temporaries of the processing. If the whole mission does not fit in
+%        it, the sensor processing steps are performed in windows of whole
+%        profiles (see PROCESSGLIDERDATACHUNKED), with the same output.
+%        If infinite, the whole mission is processed at once.
+%        Default value: inf
+%      CHUNK_OVERLAP: profile overlap of processing windows.
+%        Positive integer with the number of profiles added at both sides of
+%        each window in chunked processing (at least one, for the parameter
+%        estimation on consecutive profiles).
+%        Default value: 1
+%      LAG_CACHE: sensor and thermal lag parameter estimate cache file.
+%        String with the name of the MAT file where the parameter estimates of
+%        each pair of casts are kept across calls (see note below).
+%        If empty, all the estimates are computed from scratch.
+%        Default value: '' (no cache)
 %
 %    The following options are deprecated and should not be used:
 %      PROFILING_SEQUENCE_LIST: sequence choices for cast identification.
@@ -322,6 +360,24 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
 %    This function is based on the previous work by Tomeu Garau. He is the true
 %    glider man.
 %
+%    Chunked processing keeps the steps on the reference sequences (filling,
+%    filtering, distance, profile identification...) on the whole mission,
+%    since they involve few sequences, and it is intended for long missions
+%    with many sensor sequences.
+%
+%    When option LAG_CACHE is given, each sensor or thermal lag estimate of
+%    a pair of casts is stored in the cache file with the MD5 digest of the
+%    data of the pair, the estimation function and its minimization options
+%    (except the initial guess) as key. Pairs whose key is in the cache take
+%    the stored estimate without performing the minimization, so processing a
+%    growing deployment again (like in real time) only estimates the parameters
+%    of the new pairs. The new pairs are warm started from the estimate of the
+%    previous pair with valid parameters instead of the default initial guess,
+%    since consecutive pairs usually have close parameters. Hence the estimates
+%    may slightly differ from the ones without cache. Only the estimates with
+%    positive exit flag are stored, so failed minimizations are retried.
+%    The cache file may be removed at any time to start from scratch.
+%
 %  Examples:
 %    [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, options)
 %
@@ -331,6 +387,8 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
 %    FINDTRANSECTS
 %    COMPUTECUMULATIVEDISTANCE
 %    FINDPROFILES
+%    SUMMARIZESEGMENTS
+%    PROCESSGLIDERDATACHUNKED
 %    VALIDATEPROFILE
 %    APPLYSEABIRDPRESSUREFILTER
 %    FINDSENSORLAGPARAMS
@@ -361,7 +419,7 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
   
-  narginchk(2, 56);
+  narginchk(2, 64);
   
   %% Configure default values for optional profile identification settings.
   default_profiling_time = [];
@@ -443,6 +501,13 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
            'temperature', {'temperature' 'temperature'}, ...
            'pressure',    {'pressure'    'pressure'});
   
+  options.single_precision_list = {};
+  
+  options.chunk_memory = inf;
+  options.chunk_overlap = 1;
+  
+  options.lag_cache = '';
+  
   
   %% Get options from extra arguments.
   % Parse option key-value pairs in any accepted call signature.
@@ -489,11 +554,34 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
   end
   
   
+  %% Process in profile windows, if a memory budget is given.
+  if isfinite(options.chunk_memory)
+    [data_proc, meta_proc] = ...
+      processGliderDataChunked(data_pre, meta_pre, options);
+    return
+  end
+  
+  
   %% Initialize output variables.
   data_proc = data_pre;
   meta_proc = meta_pre;
   
   
+  %% Convert input sequences to single precision, if needed.
+  single_precision_list = cellstr(options.single_precision_list);
+  single_precision_list = ...
+    intersect(single_precision_list(:), fieldnames(data_proc));
+  if ~isempty(single_precision_list)
+    fprintf('Converting sequences to single precision:\n');
+    fprintf('  %s\n', single_precision_list{:});
+  end
+  for single_precision_idx = 1:numel(single_precision_list)
+    single_precision_name = single_precision_list{single_precision_idx};
+    data_proc.(single_precision_name) = single(data_proc.(single_precision_name));
+    meta_proc.(single_precision_name).precision = 'single';
+  end
+  
+  
   %% Fill missing time readings, if needed.
   % Regular sampling is assumed on time gaps.
   if options.time_filling && isfield(data_proc, 'time')
@@ -744,6 +832,33 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
   end
   
   
+  %% Summarize profiles and transects, if available.
+  % The summaries are kept in the metadata of the index sequences for the
+  % later steps working profile by profile (flow speed, sensor lag and thermal
+  % lag), and for the selection of processing windows in PROCESSGLIDERDATACHUNKED.
+  segment_sources = {'time' 'latitude' 'longitude' 'distance_over_ground'};
+  segment_options = {'time' 'latitude' 'longitude' 'distance'};
+  segment_select = isfield(data_proc, segment_sources);
+  segment_args = ...
+    [segment_options(segment_select); ...
+     cellfun(@(f)(data_proc.(f)), segment_sources(segment_select), ...
+             'UniformOutput', false)];
+  if isfield(data_proc, 'profile_index')
+    fprintf('Summarizing profiles...\n');
+    profile_segment_args = segment_args;
+    if profiling_avail
+      profile_segment_args(:, end+1) = {'depth'; data_proc.(profiling_depth)};
+    end
+    meta_proc.profile_index.segments = ...
+      summarizeSegments(data_proc.profile_index, profile_segment_args{:});
+  end
+  if isfield(data_proc, 'transect_index')
+    fprintf('Summarizing transects...\n');
+    meta_proc.transect_index.segments = ...
+      summarizeSegments(data_proc.transect_index, segment_args{:});
+  end
+  
+  
   %% Derive flow speed through CTD cell, if needed and data available.
   % Time and depth sequences must be present in already processed data.
   % Pitch may be also a sequence in processed data (preferred) 
@@ -790,9 +905,10 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
     fprintf('  pitch minimum threshold            : %f\n', options.flow_ctd_min_pitch);
     fprintf('  vertical velocity minimum threshold: %f\n', options.flow_ctd_min_velocity);
     data_proc.flow_ctd = nan(size(data_proc.time));
-    num_profiles = fix(max(data_proc.profile_index));
+    prof_segments = meta_proc.profile_index.segments;
+    num_profiles = numel(prof_segments.index);
     for profile_idx = 1:num_profiles
-      prof_select = (data_proc.profile_index == profile_idx);
+      prof_select = profileEntries(prof_segments, data_proc.profile_index, profile_idx);
       prof_time = data_proc.(flow_ctd_time)(prof_select);
       prof_depth = data_proc.(flow_ctd_depth)(prof_select);
       if flow_ctd_pitch_avail
@@ -826,6 +942,22 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
   end
  
   
+  %% Load lag parameter estimate cache, if needed.
+  % Estimates of unchanged cast pairs are taken from the cache instead of
+  % computed again, and the new ones are added to it (see note on LAG_CACHE).
+  lag_cache = [];
+  lag_cache_count = 0;
+  lag_cache_enabled = ~isempty(options.lag_cache) && ...
+    (any(arrayfun(@(o)(ischar(o.parameters) && strcmpi(o.parameters, 'auto')), ...
+                  options.sensor_lag_list)) ...
+     || any(arrayfun(@(o)(ischar(o.parameters) && strcmpi(o.parameters, 'auto')), ...
+                     options.thermal_lag_list)));
+  if lag_cache_enabled
+    lag_cache = loadLagCache(options.lag_cache);
+    lag_cache_count = lag_cache.Count;
+  end
+  
+  
   %% Perform sensor lag estimation and correction, if needed.
   % Sensor, time and depth sequences must be present in already processed data.
   for sensor_lag_option_idx = 1:numel(options.sensor_lag_list)
@@ -927,7 +1059,8 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
     if sensor_lag_prof_avail && sensor_lag_raw_avail ...
         && sensor_lag_time_avail && sensor_lag_depth_avail ...
         && (sensor_lag_flow_const || sensor_lag_flow_avail)
-      num_profiles = fix(max(data_proc.profile_index));
+      prof_segments = meta_proc.profile_index.segments;
+      num_profiles = numel(prof_segments.index);
       % Estimate sensor lag time constant, if needed.
       if sensor_lag_params_avail
         % Sensor lag time constant given (do not perform estimation).
@@ -945,14 +1078,16 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
         sensor_lag_estimates = nan(num_profiles-1, sensor_lag_num_params);
         sensor_lag_exitflags = nan(num_profiles-1, 1);
         sensor_lag_residuals = nan(num_profiles-1, 1);
+        sensor_lag_guess = [];
+        sensor_lag_reused = 0;
         for profile_idx = 1:(num_profiles-1)
-          prof1_select = (data_proc.profile_index == profile_idx);
+          prof1_select = profileEntries(prof_segments, data_proc.profile_index, profile_idx);
           [~, ~, prof1_dir] = ...
             find(data_proc.profile_direction(prof1_select), 1);
           prof1_raw = data_proc.(sensor_lag_raw)(prof1_select);
           prof1_time = data_proc.(sensor_lag_time)(prof1_select);
           prof1_depth = data_proc.(sensor_lag_depth)(prof1_select);
-          prof2_select = (data_proc.profile_index == profile_idx + 1);
+          prof2_select = profileEntries(prof_segments, data_proc.profile_index, profile_idx+1);
           [~, ~, prof2_dir] = ...
             find(data_proc.profile_direction(prof2_select), 1);
           prof2_raw = data_proc.(sensor_lag_raw)(prof2_select);
@@ -982,9 +1117,14 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
             try
               [sensor_lag_estimates(profile_idx, :), ...
                sensor_lag_exitflags(profile_idx), ...
-               sensor_lag_residuals(profile_idx)] = ...
-                findSensorLagParams(prof1_vars{:}, prof2_vars{:}, sensor_lag_minopts);
-              if sensor_lag_exitflags(profile_idx) <= 0
+               sensor_lag_residuals(profile_idx), sensor_lag_cached] = ...
+                findLagParamsCached(lag_cache, 'findSensorLagParams', ...
+                                    [prof1_vars prof2_vars], ...
+                                    sensor_lag_minopts, sensor_lag_guess);
+              sensor_lag_reused = sensor_lag_reused + sensor_lag_cached;
+              if sensor_lag_exitflags(profile_idx) > 0
+                sensor_lag_guess = sensor_lag_estimates(profile_idx, :);
+              else
                  warning('glider_toolbox:processGliderData:SensorLagMinimizationError', ...
                          'Minimization did not converge for casts %d and %d, residual area: %f.', ...
                          profile_idx, profile_idx+1, sensor_lag_residuals(profile_idx));
@@ -996,6 +1136,10 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
             end
           end
         end
+        if lag_cache_enabled
+          fprintf('  cached estimates   : %d of %d cast pairs\n', ...
+                  sensor_lag_reused, num_profiles-1);
+        end
         % Compute statistical estimate from individual profile estimates.
         sensor_lag_constants = sensor_lag_estimator(sensor_lag_estimates);
       end
@@ -1018,7 +1162,7 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
         end
         data_proc.(sensor_lag_cor) = nan(size(data_proc.(sensor_lag_raw)));
         for profile_idx = 1:num_profiles
-          prof_select = (data_proc.profile_index == profile_idx);
+          prof_select = profileEntries(prof_segments, data_proc.profile_index, profile_idx);
           prof_raw = data_proc.(sensor_lag_raw)(prof_select);
           prof_time = data_proc.(sensor_lag_time)(prof_select);
           prof_depth = data_proc.(sensor_lag_depth)(prof_select);
@@ -1179,7 +1323,8 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
         && thermal_lag_temp_raw_avail && thermal_lag_pres_avail ...
         && thermal_lag_time_avail && thermal_lag_depth_avail ...
         && (thermal_lag_flow_const || thermal_lag_flow_avail)
-      num_profiles = fix(max(data_proc.profile_index));
+      prof_segments = meta_proc.profile_index.segments;
+      num_profiles = numel(prof_segments.index);
       % Estimate thermal lag constant, if needed.
       if thermal_lag_params_avail
         % Thermal lag parameters given.
@@ -1199,8 +1344,10 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
         thermal_lag_estimates = nan(num_profiles-1, thermal_lag_num_params);
         thermal_lag_residuals = nan(num_profiles-1, 1);
         thermal_lag_exitflags = nan(num_profiles-1, 1);
+        thermal_lag_guess = [];
+        thermal_lag_reused = 0;
         for profile_idx = 1:(num_profiles-1)
-          prof1_select = (data_proc.profile_index == profile_idx);
+          prof1_select = profileEntries(prof_segments, data_proc.profile_index, profile_idx);
           [~, ~, prof1_dir] = ...
             find(data_proc.profile_direction(prof1_select), 1);
           prof1_cond = data_proc.(thermal_lag_cond_raw)(prof1_select);
@@ -1208,7 +1355,7 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
           prof1_pres = data_proc.(thermal_lag_pres_raw)(prof1_select);
           prof1_time = data_proc.(thermal_lag_time)(prof1_select);
           prof1_depth = data_proc.(thermal_lag_depth)(prof1_select);
-          prof2_select = (data_proc.profile_index == profile_idx + 1);
+          prof2_select = profileEntries(prof_segments, data_proc.profile_index, profile_idx+1);
           [~, ~, prof2_dir] = ...
             find(data_proc.profile_direction(prof2_select), 1);
           prof2_cond = data_proc.(thermal_lag_cond_raw)(prof2_select);
@@ -1242,9 +1389,14 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
             try
               [thermal_lag_estimates(profile_idx, :), ...
                thermal_lag_exitflags(profile_idx), ...
-               thermal_lag_residuals(profile_idx)] = ...
-                findThermalLagParams(prof1_vars{:}, prof2_vars{:}, thermal_lag_minopts);
-              if thermal_lag_exitflags(profile_idx) <= 0
+               thermal_lag_residuals(profile_idx), thermal_lag_cached] = ...
+                findLagParamsCached(lag_cache, 'findThermalLagParams', ...
+                                    [prof1_vars prof2_vars], ...
+                                    thermal_lag_minopts, thermal_lag_guess);
+              thermal_lag_reused = thermal_lag_reused + thermal_lag_cached;
+              if thermal_lag_exitflags(profile_idx) > 0
+                thermal_lag_guess = thermal_lag_estimates(profile_idx, :);
+              else
                  warning('glider_toolbox:processGliderData:ThermalLagMinimizationError', ...
                          'Minimization did not converge for casts %d and %d, residual area: %f.', ...
                          profile_idx, profile_idx+1, thermal_lag_residuals(profile_idx));
@@ -1256,6 +1408,10 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
             end
           end
         end
+        if lag_cache_enabled
+          fprintf('  cached estimates     : %d of %d cast pairs\n', ...
+                  thermal_lag_reused, num_profiles-1);
+        end
         % Compute statistical estimate from individual profile estimates.
         % Use feval to allow estimator as either function handle or name string.
         thermal_lag_constants = thermal_lag_estimator(thermal_lag_estimates);
@@ -1285,7 +1441,7 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
         data_proc.(thermal_lag_temp_cor) = ...
           nan(size(data_proc.(thermal_lag_temp_raw)));
         for profile_idx = 1:num_profiles
-          prof_select = (data_proc.profile_index == profile_idx);
+          prof_select = profileEntries(prof_segments, data_proc.profile_index, profile_idx);
           prof_cond_raw = data_proc.(thermal_lag_cond_raw)(prof_select);
           prof_temp_raw = data_proc.(thermal_lag_temp_raw)(prof_select);
           prof_time = data_proc.(thermal_lag_time)(prof_select);
@@ -1335,6 +1491,12 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
   end
   
   
+  %% Save lag parameter estimate cache, if updated.
+  if lag_cache_enabled && lag_cache.Count > lag_cache_count
+    saveLagCache(options.lag_cache, lag_cache);
+  end
+  
+  
   %% Derive salinity from pressure, conductivity and temperature, if available.
   for salinity_option_idx = 1:numel(options.salinity_list)
     salinity_option = options.salinity_list(salinity_option_idx);
@@ -1384,4 +1546,147 @@ function [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, varargin
     end
   end
   
+  
+  %% Convert derived sequences to single precision, if needed.
+  single_precision_list = cellstr(options.single_precision_list);
+  single_precision_list = ...
+    intersect(single_precision_list(:), fieldnames(data_proc));
+  for single_precision_idx = 1:numel(single_precision_list)
+    single_precision_name = single_precision_list{single_precision_idx};
+    if ~isa(data_proc.(single_precision_name), 'single')
+      data_proc.(single_precision_name) = ...
+        single(data_proc.(single_precision_name));
+      meta_proc.(single_precision_name).precision = 'single';
+    end
+  end
+  
+end
+
+
+function select = profileEntries(segments, index, k)
+%PROFILEENTRIES  Entries of a profile by its range, or by search if not contiguous.
+  if segments.contiguous(k)
+    select = segments.first(k):segments.last(k);
+  else
+    select = find(index == k);
+  end
+end
+
+
+function [params, exitflag, residual, cached] = findLagParamsCached(cache, method, vars, minopts, guess)
+%FINDLAGPARAMSCACHED  Lag parameter estimation of a cast pair through the estimate cache.
+%  Without cache (empty), the estimation function is called with the given
+%  minimization options. Otherwise the estimate is taken from the cache map
+%  if its key is there, or computed starting from the given guess (if any)
+%  and added to the cache map (a handle object) if the exit flag is positive.
+  cached = false;
+  if ~isa(cache, 'containers.Map')
+    [params, exitflag, residual] = feval(method, vars{:}, minopts);
+    return
+  end
+  key = lagCacheKey(method, minopts, vars);
+  if isKey(cache, key)
+    entry = cache(key);
+    params = entry.params;
+    exitflag = entry.exitflag;
+    residual = entry.residual;
+    cached = true;
+    return
+  end
+  if ~isempty(guess)
+    minopts.guess = guess;
+  end
+  [params, exitflag, residual] = feval(method, vars{:}, minopts);
+  if exitflag > 0
+    cache(key) = ...
+      struct('params', params, 'exitflag', exitflag, 'residual', residual);
+  end
+end
+
+
+function key = lagCacheKey(method, minopts, vars)
+%LAGCACHEKEY  Cache key of a lag parameter estimation as MD5 digest of its inputs.
+%  The initial guess is left out, since it is not part of the problem.
+  if isstruct(minopts)
+    minopts_fields = fieldnames(minopts);
+    minopts = rmfield(minopts, minopts_fields(strcmpi('guess', minopts_fields)));
+  end
+  bytes = serializeValue({method minopts vars});
+  if exist('OCTAVE_VERSION', 'builtin')
+    key = hash('md5', char(bytes'));
+  else
+    digest = java.security.MessageDigest.getInstance('MD5');
+    digest.update(bytes);
+    key = sprintf('%02x', typecast(digest.digest(), 'uint8'));
+  end
+end
+
+
+function bytes = serializeValue(value)
+%SERIALIZEVALUE  Byte sequence identifying the class, size and contents of a value.
+  header = uint8(sprintf('%s(%s):', class(value), sprintf('%d,', size(value))));
+  if ischar(value)
+    contents = typecast(uint16(value(:)), 'uint8');
+  elseif islogical(value)
+    contents = uint8(value(:));
+  elseif isnumeric(value) && isreal(value)
+    contents = typecast(value(:), 'uint8');
+  elseif isnumeric(value)
+    contents = [typecast(real(value(:)), 'uint8'); typecast(imag(value(:)), 'uint8')];
+  elseif iscell(value)
+    contents = cellfun(@serializeValue, value(:), 'UniformOutput', false);
+    contents = vertcat(zeros(0, 1, 'uint8'), contents{:});
+  elseif isstruct(value)
+    contents = serializeValue({fieldnames(value) struct2cell(value)});
+  elseif isa(value, 'function_handle')
+    contents = serializeValue(func2str(value));
+  else
+    contents = zeros(0, 1, 'uint8');
+  end
+  bytes = [header(:); contents(:)];
+end
+
+
+function cache = loadLagCache(filename)
+%LOADLAGCACHE  Load lag parameter estimates from cache file into a map indexed by key.
+%  A missing or unreadable file gives an empty map.
+  cache = containers.Map('KeyType', 'char', 'ValueType', 'any');
+  if ~exist(filename, 'file')
+    return
+  end
+  try
+    contents = load(filename, 'lag_cache');
+    entries = contents.lag_cache;
+    for entry_idx = 1:numel(entries)
+      cache(entries(entry_idx).key) = rmfield(entries(entry_idx), 'key');
+    end
+  catch exception
+    warning('glider_toolbox:processGliderData:LagCacheError', ...
+            'Could not load lag parameter cache %s: %s.', ...
+            filename, exception.message);
+  end
+end
+
+
+function saveLagCache(filename, cache)
+%SAVELAGCACHE  Save lag parameter estimates in map indexed by key to cache file.
+%  Errors are reported as warnings, since the cache is not needed for output.
+  lag_cache_keys = keys(cache);
+  lag_cache = values(cache);
+  lag_cache = [lag_cache{:}];
+  [lag_cache.key] = lag_cache_keys{:};
+  try
+    [cache_dir, ~, ~] = fileparts(filename);
+    if ~isempty(cache_dir) && ~exist(cache_dir, 'dir')
+      [success, message] = mkdir(cache_dir);
+      if ~success
+        error('glider_toolbox:processGliderData:LagCacheError', '%s', message);
+      end
+    end
+    save(filename, 'lag_cache');
+  catch exception
+    warning('glider_toolbox:processGliderData:LagCacheError', ...
+            'Could not save lag parameter cache %s: %s.', ...
+            filename, exception.message);
+  end
 end
@@ -0,0 +1,455 @@
+function [data_proc, meta_proc] = processGliderDataChunked(data_pre, meta_pre, options)
+%PROCESSGLIDERDATACHUNKED  Glider data processing in profile windows under a memory budget.
+%
+%  Syntax:
+%    [DATA_PROC, META_PROC] = PROCESSGLIDERDATACHUNKED(DATA_PRE, META_PRE, OPTIONS)
+%
+%  Description:
+%    [DATA_PROC, META_PROC] = PROCESSGLIDERDATACHUNKED(DATA_PRE, META_PRE, OPTIONS)
+%    performs the same processing as PROCESSGLIDERDATA on the preprocessed
+%    glider data in structs DATA_PRE and META_PRE with the processing options
+%    in struct OPTIONS (with all the options of PROCESSGLIDERDATA set),
+%    but without building the temporaries of the sensor processing steps for
+%    the whole mission at once when it does not fit in the memory budget given
+%    by option CHUNK_MEMORY. The processing is done in the following passes:
+%      - Reference pass:
+%        The steps on the navigation and reference sequences (filling of
+%        missing values, transect identification, distance over ground,
+%        pressure filtering, depth derivation, profile identification and
+%        flow speed derivation) are performed on the whole mission, but only
+%        on those sequences. These steps are stateful (the filters and the
+%        cumulative sums depend on all the previous readings) but involve
+%        a small number of sequences.
+%      - Parameter estimation passes:
+%        For each sensor lag or thermal lag correction with parameters to be
+%        estimated, the individual estimates for each pair of consecutive
+%        profiles are computed window by window, and the statistical estimate
+%        is computed over all of them as in the whole mission processing.
+%      - Correction and derivation pass:
+%        The sensor and thermal lag corrections (with the estimated or preset
+%        parameters) and the salinity and density derivations are performed
+%        window by window, and the results are copied to the output sequences.
+%    Each window is made of consecutive whole profiles, extended with the
+%    number of profiles before and after given by option CHUNK_OVERLAP, and
+%    only the readings of the central profiles (and the readings between
+%    them) are kept from each window. The number of profiles in each window is
+%    chosen so that its working set is below the memory budget. The working
+%    set is approximated as four times the size of the input sequences of
+%    the window (the input, the output and the temporaries of the processing).
+%
+%    The output is the same as the output of the whole mission processing,
+%    since the steps performed window by window work profile by profile (the
+%    estimation on consecutive profile pairs), or reading by reading.
+%    If the whole mission fits in the memory budget, or there is no profile
+%    to align the windows to, or the readings of some profiles are not
+%    contiguous, the whole mission is processed at once.
+%
+%  Notes:
+%    This function is called by PROCESSGLIDERDATA when option CHUNK_MEMORY is
+%    finite, and should not be needed to be called directly.
+%
+%    The output sequences are still full length arrays (in the same number as
+%    the whole mission processing), but the temporaries of each step are
+%    limited to the size of a window. The raw sensor sequences that are not
+%    modified by the processing are shared with the input (not copied).
+%
+%    The reference sequences are the time, position, navigation depth,
+%    attitude, heading, waypoint coordinates, pressure and CTD time sequences,
+%    and the sequences given in options PROFILING_LIST and FLOW_CTD_LIST.
+%
+%  Examples:
+%    [data_proc, meta_proc] = ...
+%      processGliderData(data_pre, meta_pre, 'chunk_memory', 2^30)
+%
+%  See also:
+%    PROCESSGLIDERDATA
+%    SUMMARIZESEGMENTS
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(3, 3);
+
+
+  %% Set chunking parameters.
+  % The working set of the processing is approximated as this factor times
+  % the size of the input sequences.
+  working_factor = 4;
+  memory_budget = options.chunk_memory;
+  chunk_overlap = max(1, round(options.chunk_overlap));
+  options.chunk_memory = inf;
+
+
+  %% Process the whole mission at once if it fits in the memory budget.
+  sequence_list = fieldnames(data_pre);
+  if isempty(sequence_list)
+    num_records = 0;
+  else
+    num_records = numel(data_pre.(sequence_list{1}));
+  end
+  if num_records == 0 ...
+      || working_factor * num_records ...
+         * recordBytes(data_pre, sequence_list, num_records) <= memory_budget
+    [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, options);
+    return
+  end
+
+
+  %% Select reference sequences.
+  reference_list = ...
+    {'time' 'time_position' 'latitude' 'longitude' 'depth' ...
+     'roll' 'pitch' 'heading' 'waypoint_latitude' 'waypoint_longitude' ...
+     'pressure' 'time_ctd'};
+  profiling_fields = intersect({'depth' 'time'}, fieldnames(options.profiling_list));
+  flow_ctd_fields = intersect({'depth' 'time' 'pitch'}, fieldnames(options.flow_ctd_list));
+  for field_idx = 1:numel(profiling_fields)
+    reference_list = ...
+      [reference_list {options.profiling_list.(profiling_fields{field_idx})}]; %#ok<AGROW>
+  end
+  for field_idx = 1:numel(flow_ctd_fields)
+    reference_list = ...
+      [reference_list {options.flow_ctd_list.(flow_ctd_fields{field_idx})}]; %#ok<AGROW>
+  end
+  reference_list = ...
+    intersect(reference_list(cellfun(@ischar, reference_list)), sequence_list);
+  source_list = sequence_list(~ismember(sequence_list, reference_list));
+  % Sequences computed over the whole mission not needed in the windows.
+  global_list = {'latitude' 'longitude' 'time_position' ...
+                 'waypoint_latitude' 'waypoint_longitude' ...
+                 'transect_index' 'distance_over_ground'};
+
+
+  %% Process reference sequences of the whole mission.
+  fprintf('Processing reference sequences of whole mission:\n');
+  fprintf('  %s\n', reference_list{:});
+  reference_options = options;
+  reference_options.sensor_lag_list = options.sensor_lag_list([]);
+  reference_options.thermal_lag_list = options.thermal_lag_list([]);
+  reference_options.salinity_list = options.salinity_list([]);
+  reference_options.density_list = options.density_list([]);
+  data_ref = rmfield(data_pre, source_list);
+  meta_ref = rmfield(meta_pre, intersect(fieldnames(meta_pre), source_list));
+  [data_ref, meta_ref] = processGliderData(data_ref, meta_ref, reference_options);
+  if ~isfield(data_ref, 'profile_index')
+    fprintf('No profiles to align processing windows to, processing whole mission...\n');
+    [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, options);
+    return
+  end
+  if ~all(meta_ref.profile_index.segments.contiguous)
+    fprintf('Interleaved profiles can not be split in windows, processing whole mission...\n');
+    [data_proc, meta_proc] = processGliderData(data_pre, meta_pre, options);
+    return
+  end
+  derived_list = fieldnames(data_ref);
+  derived_list = derived_list(~ismember(derived_list, global_list));
+
+
+  %% Compute processing windows.
+  % Each chunk is made of consecutive profiles, and its window is extended
+  % with the overlap profiles at both sides. The core ranges of the chunks
+  % partition the whole mission, including readings out of any profile.
+  record_bytes = ...
+    recordBytes(data_pre, source_list, num_records) ...
+    + recordBytes(data_ref, derived_list, num_records);
+  max_records = max(1, floor(memory_budget / (working_factor * record_bytes)));
+  num_profiles = numel(meta_ref.profile_index.segments.index);
+  prof_first = meta_ref.profile_index.segments.first;
+  prof_last = meta_ref.profile_index.segments.last;
+  chunk_first = zeros(0, 1);
+  chunk_last = zeros(0, 1);
+  profile_idx = 1;
+  while profile_idx <= num_profiles
+    last_idx = profile_idx;
+    while last_idx < num_profiles
+      window_start = prof_first(max(1, profile_idx - chunk_overlap));
+      window_end = prof_last(min(num_profiles, last_idx + 1 + chunk_overlap));
+      if window_end - window_start + 1 > max_records
+        break
+      end
+      last_idx = last_idx + 1;
+    end
+    chunk_first(end+1, 1) = profile_idx; %#ok<AGROW>
+    chunk_last(end+1, 1) = last_idx; %#ok<AGROW>
+    profile_idx = last_idx + 1;
+  end
+  num_chunks = numel(chunk_first);
+  window_first = max(1, chunk_first - chunk_overlap);
+  window_last = min(num_profiles, chunk_last + chunk_overlap);
+  chunks.offset = window_first - 1;
+  chunks.pairs = arrayfun(@(p, q)(p:min(q, num_profiles - 1)), ...
+                          chunk_first, chunk_last, 'UniformOutput', false);
+  chunks.core_start = [1; prof_last(chunk_last(1:end-1)) + 1];
+  chunks.core_end = [prof_last(chunk_last(1:end-1)); num_records];
+  chunks.window_start = min(chunks.core_start, prof_first(window_first));
+  chunks.window_end = max(chunks.core_end, prof_last(window_last));
+  fprintf('Processing sensor sequences in windows with settings:\n');
+  fprintf('  memory budget     : %f\n', memory_budget);
+  fprintf('  profile overlap   : %d\n', chunk_overlap);
+  fprintf('  number of windows : %d\n', num_chunks);
+  fprintf('  number of profiles: %d\n', num_profiles);
+
+
+  %% Set window processing options.
+  % Reference steps are already done, the profile index is given in the input.
+  window_options = options;
+  window_options.time_filling = false;
+  window_options.position_filling = false;
+  window_options.depth_filling = false;
+  window_options.attitude_filling = false;
+  window_options.heading_filling = false;
+  window_options.waypoint_filling = false;
+  window_options.pressure_filtering = false;
+  window_options.depth_ctd_derivation = false;
+  window_options.profiling_list = struct('depth', {}, 'time', {});
+  window_options.flow_ctd_list = options.flow_ctd_list([]);
+  window_meta = meta_ref;
+  window_meta = rmfield(window_meta, intersect(fieldnames(window_meta), global_list));
+  meta_source_list = intersect(fieldnames(meta_pre), source_list);
+  for source_idx = 1:numel(meta_source_list)
+    window_meta.(meta_source_list{source_idx}) = ...
+      meta_pre.(meta_source_list{source_idx});
+  end
+  windows = struct('data_pre', data_pre, 'data_ref', data_ref, ...
+                   'meta', window_meta, ...
+                   'source_list', {source_list}, ...
+                   'derived_list', {derived_list});
+
+
+  %% Estimate lag parameters over the whole mission, if needed.
+  % Each estimation uses the previous corrections with their final parameters,
+  % and skips the later ones.
+  sensor_lag_list = options.sensor_lag_list;
+  thermal_lag_list = options.thermal_lag_list;
+  sensor_lag_auto = ...
+    arrayfun(@(o)(ischar(o.parameters) && strcmpi(o.parameters, 'auto')), ...
+             sensor_lag_list);
+  thermal_lag_auto = ...
+    arrayfun(@(o)(ischar(o.parameters) && strcmpi(o.parameters, 'auto')), ...
+             thermal_lag_list);
+  sensor_lag_estimation = cell(size(sensor_lag_list));
+  thermal_lag_estimation = cell(size(thermal_lag_list));
+  for sensor_lag_idx = find(sensor_lag_auto(:)')
+    fprintf('Estimating sensor lag parameters %d over all windows...\n', ...
+            sensor_lag_idx);
+    estimation_options = window_options;
+    estimation_options.sensor_lag_list = sensor_lag_list(1:sensor_lag_idx);
+    estimation_options.thermal_lag_list = thermal_lag_list([]);
+    estimation_options.salinity_list = options.salinity_list([]);
+    estimation_options.density_list = options.density_list([]);
+    estimation_options.single_precision_list = {};
+    sensor_lag_option = sensor_lag_list(sensor_lag_idx);
+    num_params = 2;
+    if isfield(sensor_lag_option, 'constant_flow') ...
+        && ~isempty(sensor_lag_option.constant_flow) ...
+        && sensor_lag_option.constant_flow
+      num_params = 1;
+    end
+    estimation = estimateLagParams(windows, chunks, estimation_options, ...
+                                   sensor_lag_option.corrected, num_params);
+    estimation.estimator = lagEstimator(sensor_lag_option);
+    estimation.parameters = estimation.estimator(estimation.estimates);
+    sensor_lag_list(sensor_lag_idx).parameters = estimation.parameters;
+    sensor_lag_estimation{sensor_lag_idx} = estimation;
+  end
+  for thermal_lag_idx = find(thermal_lag_auto(:)')
+    fprintf('Estimating thermal lag parameters %d over all windows...\n', ...
+            thermal_lag_idx);
+    estimation_options = window_options;
+    estimation_options.sensor_lag_list = sensor_lag_list;
+    estimation_options.thermal_lag_list = thermal_lag_list(1:thermal_lag_idx);
+    estimation_options.salinity_list = options.salinity_list([]);
+    estimation_options.density_list = options.density_list([]);
+    estimation_options.single_precision_list = {};
+    thermal_lag_option = thermal_lag_list(thermal_lag_idx);
+    num_params = 4;
+    if isfield(thermal_lag_option, 'constant_flow') ...
+        && ~isempty(thermal_lag_option.constant_flow) ...
+        && thermal_lag_option.constant_flow
+      num_params = 2;
+    end
+    estimation = estimateLagParams(windows, chunks, estimation_options, ...
+                                   thermal_lag_option.conductivity_corrected, ...
+                                   num_params);
+    estimation.estimator = lagEstimator(thermal_lag_option);
+    estimation.parameters = estimation.estimator(estimation.estimates);
+    thermal_lag_list(thermal_lag_idx).parameters = estimation.parameters;
+    thermal_lag_estimation{thermal_lag_idx} = estimation;
+  end
+
+
+  %% Perform corrections and derivations window by window.
+  % Only new sequences and sequences modified by the processing are copied
+  % from the windows, the other input sequences are shared with the input.
+  window_options.sensor_lag_list = sensor_lag_list;
+  window_options.thermal_lag_list = thermal_lag_list;
+  single_precision_list = cellstr(options.single_precision_list);
+  modified_list = [{options.sensor_lag_list.corrected} ...
+                   {options.thermal_lag_list.conductivity_corrected} ...
+                   {options.thermal_lag_list.temperature_corrected} ...
+                   {options.salinity_list.salinity} ...
+                   {options.density_list.density} ...
+                   single_precision_list(:)'];
+  data_proc = data_ref;
+  meta_proc = meta_ref;
+  stitched_list = {};
+  for chunk_idx = 1:num_chunks
+    fprintf('Processing window %d of %d...\n', chunk_idx, num_chunks);
+    [data_win, meta_win] = windowData(windows, chunks, chunk_idx);
+    [data_win, meta_win] = processGliderData(data_win, meta_win, window_options);
+    core_select = chunks.core_start(chunk_idx):chunks.core_end(chunk_idx);
+    window_select = core_select - chunks.window_start(chunk_idx) + 1;
+    window_list = fieldnames(data_win);
+    window_list = window_list(~ismember(window_list, derived_list) ...
+                              & (~ismember(window_list, sequence_list) ...
+                                 | ismember(window_list, modified_list)));
+    for window_idx = 1:numel(window_list)
+      field_name = window_list{window_idx};
+      if ~isfield(data_proc, field_name)
+        data_proc.(field_name) = ...
+          nan(num_records, 1, class(data_win.(field_name)));
+        meta_proc.(field_name) = meta_win.(field_name);
+        stitched_list{end+1, 1} = field_name; %#ok<AGROW>
+      end
+      data_proc.(field_name)(core_select) = data_win.(field_name)(window_select);
+    end
+  end
+  clear('data_win', 'meta_win');
+
+
+  %% Add unmodified input sequences and restore the sequence order.
+  shared_list = source_list(~isfield(data_proc, source_list));
+  for shared_idx = 1:numel(shared_list)
+    data_proc.(shared_list{shared_idx}) = data_pre.(shared_list{shared_idx});
+    if isfield(meta_pre, shared_list{shared_idx})
+      meta_proc.(shared_list{shared_idx}) = meta_pre.(shared_list{shared_idx});
+    end
+  end
+  reference_derived_list = fieldnames(data_ref);
+  reference_derived_list = ...
+    reference_derived_list(~ismember(reference_derived_list, sequence_list));
+  stitched_list = stitched_list(~ismember(stitched_list, sequence_list));
+  data_proc = orderfields(data_proc, ...
+                          [sequence_list; reference_derived_list; stitched_list]);
+
+
+  %% Add lag parameter estimation metadata.
+  for sensor_lag_idx = find(sensor_lag_auto(:)')
+    field_name = sensor_lag_list(sensor_lag_idx).corrected;
+    if isfield(meta_proc, field_name)
+      meta_proc.(field_name) = ...
+        estimationMetadata(meta_proc.(field_name), ...
+                           sensor_lag_estimation{sensor_lag_idx}, ...
+                           'findSensorLagParams');
+    end
+  end
+  for thermal_lag_idx = find(thermal_lag_auto(:)')
+    field_name_list = {thermal_lag_list(thermal_lag_idx).conductivity_corrected
+                       thermal_lag_list(thermal_lag_idx).temperature_corrected};
+    for field_name_idx = 1:numel(field_name_list)
+      field_name = field_name_list{field_name_idx};
+      if isfield(meta_proc, field_name)
+        meta_proc.(field_name) = ...
+          estimationMetadata(meta_proc.(field_name), ...
+                             thermal_lag_estimation{thermal_lag_idx}, ...
+                             'findThermalLagParams');
+      end
+    end
+  end
+
+end
+
+
+function bytes = recordBytes(data, field_list, num_records)
+%RECORDBYTES  Size in bytes of a reading of the given sequences.
+  bytes = 0;
+  for field_idx = 1:numel(field_list)
+    field_value = data.(field_list{field_idx}); %#ok<NASGU>
+    field_info = whos('field_value');
+    bytes = bytes + field_info.bytes / num_records;
+  end
+end
+
+
+function [data_win, meta_win] = windowData(windows, chunks, chunk_idx)
+%WINDOWDATA  Input sequences of a processing window.
+%  The profile index is renumbered to start from 1 in the window.
+  window_select = chunks.window_start(chunk_idx):chunks.window_end(chunk_idx);
+  data_win = struct();
+  for source_idx = 1:numel(windows.source_list)
+    source_name = windows.source_list{source_idx};
+    data_win.(source_name) = windows.data_pre.(source_name)(window_select);
+  end
+  for derived_idx = 1:numel(windows.derived_list)
+    derived_name = windows.derived_list{derived_idx};
+    data_win.(derived_name) = windows.data_ref.(derived_name)(window_select);
+  end
+  data_win.profile_index = data_win.profile_index - chunks.offset(chunk_idx);
+  meta_win = windows.meta;
+end
+
+
+function estimation = estimateLagParams(windows, chunks, options, field_name, num_params)
+%ESTIMATELAGPARAMS  Collect lag parameter estimates of all profile pairs.
+%  The estimates of the pairs starting at the central profiles of each window
+%  are taken from the metadata of the corrected sequence, or set invalid if
+%  there is no estimation in the window (no valid input data).
+  num_chunks = numel(chunks.offset);
+  estimates = cell(num_chunks, 1);
+  exitflags = cell(num_chunks, 1);
+  for chunk_idx = 1:num_chunks
+    pair_rows = chunks.pairs{chunk_idx} - chunks.offset(chunk_idx);
+    [data_win, meta_win] = windowData(windows, chunks, chunk_idx);
+    [~, meta_win] = processGliderData(data_win, meta_win, options);
+    if isfield(meta_win, field_name) ...
+        && isfield(meta_win.(field_name), 'parameter_estimates')
+      estimates{chunk_idx} = ...
+        meta_win.(field_name).parameter_estimates(pair_rows, :);
+      exitflags{chunk_idx} = ...
+        meta_win.(field_name).parameter_exitflags(pair_rows, :);
+    else
+      estimates{chunk_idx} = nan(numel(pair_rows), num_params);
+      exitflags{chunk_idx} = nan(numel(pair_rows), 1);
+    end
+  end
+  estimation.estimates = vertcat(nan(0, num_params), estimates{:});
+  estimation.exitflags = vertcat(nan(0, 1), exitflags{:});
+end
+
+
+function estimator = lagEstimator(lag_option)
+%LAGESTIMATOR  Statistical estimator of a lag correction option.
+  estimator = @nanmedian;
+  if isfield(lag_option, 'estimator') && ~isempty(lag_option.estimator)
+    if ischar(lag_option.estimator)
+      estimator = str2func(lag_option.estimator);
+    else
+      estimator = lag_option.estimator;
+    end
+  end
+end
+
+
+function meta = estimationMetadata(meta, estimation, method)
+%ESTIMATIONMETADATA  Replace preset parameter metadata with estimation metadata.
+  meta.parameter_method = method;
+  meta.parameter_estimator = func2str(estimation.estimator);
+  meta.parameter_estimates = estimation.estimates;
+  meta.parameter_exitflags = estimation.exitflags;
+end
@@ -0,0 +1,206 @@
+function segments = summarizeSegments(index, varargin)
+%SUMMARIZESEGMENTS  Summarize segments of a sequence given by a segment index.
+%
+%  Syntax:
+%    SEGMENTS = SUMMARIZESEGMENTS(INDEX)
+%    SEGMENTS = SUMMARIZESEGMENTS(INDEX, OPTIONS)
+%    SEGMENTS = SUMMARIZESEGMENTS(INDEX, OPT1, VAL1, ...)
+%
+%  Description:
+%    SEGMENTS = SUMMARIZESEGMENTS(INDEX) summarizes the segments (profiles,
+%    transects...) of a sequence given by the segment index in vector INDEX,
+%    where the K-th segment is made of the entries of INDEX equal to K.
+%    Non-integer or invalid (NaN) entries of INDEX (e.g. the entries between
+%    profiles with a half-integer profile index) do not belong to any segment.
+%    SEGMENTS is a struct with the following fields, all of them column vectors
+%    with an entry for each segment from 1 to the maximum segment index:
+%      INDEX: segment index.
+%      SAMPLES: number of entries in the segment.
+%      FIRST: index of the first entry of the segment in INDEX.
+%      LAST: index of the last entry of the segment in INDEX.
+%        For empty segments FIRST is 1 and LAST is 0, so that the range
+%        FIRST(K):LAST(K) always selects the entries of the K-th segment,
+%        provided that they are contiguous in INDEX (see CONTIGUOUS).
+%      CONTIGUOUS: whether all the entries from FIRST to LAST belong to the
+%        segment (true for empty segments). It is true for all the segments of
+%        the profile index returned by FINDPROFILES and the transect index
+%        returned by FINDTRANSECTS, but an index built or edited otherwise may
+%        have interleaved segments. The entries of a segment that is not
+%        contiguous must be selected comparing INDEX with the segment number.
+%      START_TIME: first valid time of the segment.
+%      END_TIME: last valid time of the segment.
+%      START_LATITUDE: first valid latitude of the segment.
+%      START_LONGITUDE: first valid longitude of the segment.
+%      END_LATITUDE: last valid latitude of the segment.
+%      END_LONGITUDE: last valid longitude of the segment.
+%      START_DEPTH: first valid depth of the segment.
+%      END_DEPTH: last valid depth of the segment.
+%      DIRECTION: sign of the difference between the end and start depths,
+%        1 for descending segments and -1 for ascending segments.
+%      DISTANCE: difference between the last and first valid cumulative
+%        distance of the segment (distance covered along the segment).
+%    Fields whose source sequence is not given in the options are invalid (NaN).
+%
+%    SEGMENTS = SUMMARIZESEGMENTS(INDEX, OPTIONS) and
+%    SEGMENTS = SUMMARIZESEGMENTS(INDEX, OPT1, VAL1, ...) accept the following
+%    options given in key-value pairs OPT1, VAL1... or in a struct OPTIONS
+%    with field names as option keys and field values as option values,
+%    to provide the source sequences of the summary fields. All of them should
+%    be vectors with the same number of elements as INDEX:
+%      TIME: time sequence for fields START_TIME and END_TIME.
+%        Default value: [] (not available)
+%      LATITUDE: latitude sequence for fields START_LATITUDE and END_LATITUDE.
+%        Default value: [] (not available)
+%      LONGITUDE: longitude sequence for fields START_LONGITUDE and
+%        END_LONGITUDE.
+%        Default value: [] (not available)
+%      DEPTH: depth sequence for fields START_DEPTH, END_DEPTH and DIRECTION.
+%        Default value: [] (not available)
+%      DISTANCE: cumulative distance sequence for field DISTANCE
+%        (e.g. the output of COMPUTECUMULATIVEDISTANCE).
+%        Default value: [] (not available)
+%
+%  Notes:
+%    The summary is computed in a single pass over the sequences without
+%    looping over the segments, so it takes O(N+S) time for N entries and
+%    S segments. It is intended to be computed once after the segmentation,
+%    and reused by any later step working segment by segment (selecting the
+%    entries of a segment by its range is much cheaper than comparing the
+%    whole index with the segment number), or reporting segment statistics.
+%
+%  Examples:
+%    index = [1 1 1 1.5 2 2 2.5 2.5 3 3 3]
+%    time = 1:11
+%    depth = [0 5 10 nan 8 3 nan 2 4 6 8]
+%    segments = summarizeSegments(index, 'time', time, 'depth', depth)
+%    prof2 = segments.first(2):segments.last(2)
+%    segments = summarizeSegments([1 1 2 1 2])
+%    prof1 = find([1 1 2 1 2] == 1)
+%
+%  See also:
+%    FINDPROFILES
+%    FINDTRANSECTS
+%    COMPUTECUMULATIVEDISTANCE
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 11);
+
+
+  %% Set options and default values.
+  options.time = [];
+  options.latitude = [];
+  options.longitude = [];
+  options.depth = [];
+  options.distance = [];
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:summarizeSegments:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:summarizeSegments:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+
+
+  %% Select the entries belonging to a segment.
+  segment = index(:);
+  member = (segment >= 1) & (segment == fix(segment));
+  if any(member)
+    num_segments = max(segment(member));
+  else
+    num_segments = 0;
+  end
+
+
+  %% Compute segment sizes and bounds.
+  segments.index = (1:num_segments)';
+  segments.samples = accumarray(segment(member), 1, [num_segments 1]);
+  [segments.first, segments.last] = ...
+    segmentBounds(segment, member, num_segments);
+  segments.contiguous = ...
+    (segments.samples == segments.last - segments.first + 1) ...
+    | (segments.samples == 0);
+
+
+  %% Compute segment start and end values of given sequences.
+  [segments.start_time, segments.end_time] = ...
+    segmentValues(options.time, segment, member, num_segments);
+  [segments.start_latitude, segments.end_latitude] = ...
+    segmentValues(options.latitude, segment, member, num_segments);
+  [segments.start_longitude, segments.end_longitude] = ...
+    segmentValues(options.longitude, segment, member, num_segments);
+  [segments.start_depth, segments.end_depth] = ...
+    segmentValues(options.depth, segment, member, num_segments);
+  segments.direction = sign(segments.end_depth - segments.start_depth);
+  [start_distance, end_distance] = ...
+    segmentValues(options.distance, segment, member, num_segments);
+  segments.distance = end_distance - start_distance;
+
+end
+
+
+function [first, last] = segmentBounds(segment, select, num_segments)
+%SEGMENTBOUNDS  First and last selected entries of each segment.
+%  Indexed assignment with repeated subscripts keeps the last assigned value,
+%  so the last entry of each segment is assigned in forward order,
+%  and the first one in reverse order.
+  first = ones(num_segments, 1);
+  last = zeros(num_segments, 1);
+  select_index = find(select);
+  last(segment(select_index)) = select_index;
+  select_index = flipud(select_index);
+  first(segment(select_index)) = select_index;
+end
+
+
+function [start_value, end_value] = segmentValues(value, segment, member, num_segments)
+%SEGMENTVALUES  First and last valid values of a sequence in each segment.
+  start_value = nan(num_segments, 1);
+  end_value = nan(num_segments, 1);
+  if ~isempty(value)
+    [first, last] = segmentBounds(segment, member & ~isnan(value(:)), num_segments);
+    valid = (last > 0);
+    start_value(valid) = value(first(valid));
+    end_value(valid) = value(last(valid));
+  end
+end
@@ -30,6 +30,13 @@ function [ data_qc, meta_qc ] = postProcessQCGliderData( data_proc, meta_proc, v
 %    META_QC is also a struct with one field per variable, adding processing 
 %    metadata to any existing metadata in META_PROC.
 %
+%  Notes:
+%
+%    Quality flags are stored as int8 and uncertainties as single, the types
+%    of the corresponding NetCDF variables. Data arrays in DATA_PROC are
+%    shared with DATA_QC and not copied, since they are not modified.
+%    The new variables take one eighth (flags) and one half (uncertainties)
+%    of the memory required by double arrays.
 %
 %  Authors:
 %    Miguel Charcos Llorens  <mcharcos@socib.es>
@@ -65,12 +72,12 @@ function [ data_qc, meta_qc ] = postProcessQCGliderData( data_proc, meta_proc, v
         if isnumeric(data_qc.(var_name)) && ...
             ~strcmp(var_name(1:min(8,length(var_name))), 'history_')
             new_name = strcat(names_data{i},'_QC');
-            data_qc.(new_name) = zeros(size(data_qc.(var_name)));
+            data_qc.(new_name) = zeros(size(data_qc.(var_name)), 'int8');
             meta_qc.(new_name).sources = var_name; 
             meta_qc.(new_name).method = 'default0';
             
             new_name = strcat(names_data{i},'_UNCERTAINTY');
-            data_qc.(new_name) = zeros(size(data_qc.(var_name)));
+            data_qc.(new_name) = zeros(size(data_qc.(var_name)), 'single');
             meta_qc.(new_name).sources = var_name; 
             meta_qc.(new_name).method = 'default0';
         end
@@ -82,11 +89,11 @@ function [ data_qc, meta_qc ] = postProcessQCGliderData( data_proc, meta_proc, v
             isfield(data_qc, 'longitude')
         meta_qc.position_QC.sources = 'latitude longitude'; 
         meta_qc.position_QC.method = 'default0';
-        data_qc.position_QC = zeros(size(data_qc.latitude));
+        data_qc.position_QC = zeros(size(data_qc.latitude), 'int8');
         
         meta_qc.position_UNCERTAINTY.sources = 'latitude longitude'; 
         meta_qc.position_UNCERTAINTY.method = 'default0';
-        data_qc.position_UNCERTAINTY = zeros(size(data_qc.latitude));
+        data_qc.position_UNCERTAINTY = zeros(size(data_qc.latitude), 'single');
     end
 
     % Geospatial GPS Quality control
@@ -94,19 +101,19 @@ function [ data_qc, meta_qc ] = postProcessQCGliderData( data_proc, meta_proc, v
             isfield(data_qc, 'longitude_gps') 
         meta_qc.position_gps_QC.sources = 'latitude_gps longitude_gps'; 
         meta_qc.position_gps_QC.method = 'default0';
-        data_qc.position_gps_QC = zeros(size(data_qc.latitude_gps));
+        data_qc.position_gps_QC = zeros(size(data_qc.latitude_gps), 'int8');
         
         meta_qc.position_gps_UNCERTAINTY.sources = 'latitude_gps longitude_gps'; 
         meta_qc.position_gps_UNCERTAINTY.method = 'default0';
-        data_qc.position_gps_UNCERTAINTY = zeros(size(data_qc.latitude_gps));
+        data_qc.position_gps_UNCERTAINTY = zeros(size(data_qc.latitude_gps), 'single');
     end
 
     % dates Quality control
-    data_qc.deployment_start_QC         = -128;    % TODO: verify value
+    data_qc.deployment_start_QC         = int8(-128);    % TODO: verify value
     meta_qc.deployment_start_QC.sources = 'deployment_start'; 
     meta_qc.deployment_start_QC.method  = 'default0';
     
-    data_qc.deployment_end_QC         = -128;    % TODO: verify value
+    data_qc.deployment_end_QC         = int8(-128);    % TODO: verify value
     meta_qc.deployment_end_QC.sources = 'deployment_start'; 
     meta_qc.deployment_end_QC.method  = 'default0';
     
@@ -0,0 +1,102 @@
+function sensor_list = cac2mat(source)
+%CAC2MAT  Load a Slocum sensor list from a cache file.
+%
+%  Syntax:
+%    SENSOR_LIST = CAC2MAT(FILENAME)
+%    SENSOR_LIST = CAC2MAT(BYTES)
+%
+%  Description:
+%    SENSOR_LIST = CAC2MAT(FILENAME) reads the Slocum sensor list cache file
+%    named by string FILENAME (xxxxxxxx.cac file), and returns the description
+%    of the columns stored in the binary files using that sensor list in struct
+%    SENSOR_LIST with fields:
+%      SENSORS: string cell array with the names of the sensors in use,
+%        in the same order they are stored in the binary data cycles.
+%      UNITS: string cell array with the units of the sensors in use.
+%      BYTES: int8 array with the number of bytes of each sensor in use.
+%      NUMBERS: int16 array with the number of each sensor in use
+%        in the full list of sensors of the glider.
+%      NUM_SENSORS: number of sensors in the full list (used or not).
+%
+%    SENSOR_LIST = CAC2MAT(BYTES) parses the sensor list from the lines given
+%    as a vector of class uint8 (or int8) BYTES, e.g. the unfactored sensor
+%    list embedded in a Slocum binary file (see XBD2MAT).
+%
+%  Notes:
+%    Cache files are produced by the conversion program 'dbd2asc' when it
+%    converts a binary file containing the full sensor list, and are named
+%    after the CRC of the list (in lower case hexadecimal digits).
+%    Each line describes a sensor with the format:
+%      s: INUSE NUMBER INDEX BYTES NAME UNITS
+%    where INUSE is T or F, NUMBER is the sensor number, INDEX is the position
+%    of the sensor in the binary data cycle (-1 if not in use) and BYTES
+%    is the size of the sensor value in the binary data cycle. Binary files
+%    with an unfactored sensor list contain the same lines after the header.
+%
+%  Examples:
+%    sensor_list = cac2mat('2a1d0bd1.cac')
+%    sensor_list = cac2mat(uint8(sprintf('s: T 0 0 8 m_present_time timestamp\n')))
+%
+%  See also:
+%    XBDHEADER
+%    LOADSENSORLISTCACHE
+%    XBD2DBA
+%    XBD2MAT
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 1);
+
+  line_format = 's: %s %d %d %d %s %s';
+  if ischar(source)
+    [fid, fid_msg] = fopen(source, 'r');
+    if fid < 0
+      error('glider_toolbox:cac2mat:FileError', fid_msg);
+    end
+    try
+      values = textscan(fid, line_format, 'ReturnOnError', false);
+    catch exception
+      fclose(fid);
+      rethrow(exception);
+    end
+    fclose(fid);
+  elseif isa(source, 'uint8') || isa(source, 'int8')
+    values = textscan(char(typecast(source(:), 'uint8')'), line_format, ...
+                      'ReturnOnError', false);
+  else
+    error('glider_toolbox:cac2mat:InvalidInput', ...
+          'Input must be a file name or a byte vector.');
+  end
+
+  % Keep only the sensors in use, sorted by position in the data cycle.
+  inuse = strcmp(values{1}, 'T') & values{3} >= 0;
+  [~, order] = sort(values{3}(inuse));
+  numbers = values{2}(inuse);
+  bytes = values{4}(inuse);
+  sensors = values{5}(inuse);
+  units = values{6}(inuse);
+  sensor_list.sensors = sensors(order);
+  sensor_list.units = units(order);
+  sensor_list.bytes = int8(bytes(order));
+  sensor_list.numbers = int16(numbers(order));
+  sensor_list.num_sensors = numel(values{1});
+
+end
@@ -20,6 +20,10 @@ function [engs, logs] = getBasestationFiles(basestation, glider, eng_dir, log_di
 %    USER: user to access the basestation if needed (string).
 %    PASS: password of the basestation if needed (string).
 %    CONN: name or handle of connection type function, @FTP (default) or @SFTP.
+%  BASESTATION may also be a struct array describing several basestations
+%  mirroring the same glider directories. The basestations are listed
+%  concurrently and each file is downloaded only once, from the basestation
+%  that responded fastest among the ones that have it (see GETMIRRORFILES).
 %
 %    [ENGS, LOGS] = GETBASESTATIONFILES(BASESTATION, GLIDER, ENG_DIR, LOG_DIR, OPTIONS) and 
 %    [ENGS, LOGS] = GETBASESTATIONFILES(BASESTATION, GLIDER, ENG_DIR, LOG_DIR, OPT1, VAL1, ...)
@@ -66,6 +70,10 @@ function [engs, logs] = getBasestationFiles(basestation, glider, eng_dir, log_di
 %    in options ENG2DATE and LOG2DATE and define the dive range in options 
 %    START and FINAL.
 %
+%    When several basestations are given, a file is considered the same on all
+%    of them if it has the same name, size and modification time. Otherwise
+%    the largest copy (and the newest among the largest) is downloaded.
+%
 %  Examples:
 %    basestation.host = 'ftp.mybasestation.org'
 %    basestation.user = 'myself'
@@ -82,6 +90,7 @@ function [engs, logs] = getBasestationFiles(basestation, glider, eng_dir, log_di
 %                          'start', now()-7, 'final', now())
 %
 %  See also:
+%    GETMIRRORFILES
 %    FTP
 %    SFTP
 %    DIR
@@ -162,41 +171,21 @@ function [engs, logs] = getBasestationFiles(basestation, glider, eng_dir, log_di
   updatefunc = @(l,r)(l.bytes < r.bytes);
   if isfinite(options.start) || isfinite(options.final)
     eng_newfunc = @(r)(options.start <= options.eng2date(r) && ...
-                       options.xbd2date(r) <= options.final);
+                       options.eng2date(r) <= options.final);
     log_newfunc = @(r)(options.start <= options.log2date(r) && ...
                        options.log2date(r) <= options.final);
   end
 
 
-  %% Open (S)FTP connection.
-  host = basestation.host;
-  user = [];
-  pass = [];
-  conn = @ftp;
-  if isfield(basestation, 'user') && ~isequal(basestation.user, [])
-    user = basestation.user;
-  end
-  if isfield(basestation, 'pass') && ~isequal(basestation.pass, [])
-    pass = basestation.pass;
-  end
-  if isfield(basestation, 'conn') && ~isequal(basestation.conn, [])
-    conn = basestation.conn;
-    if ischar(conn)
-      conn = str2func(conn);
-    end
-  end
-  disp(['Connecting to host ' host '...']);
-  ftp_handle = conn(host, user, pass);
-
-
   %% Engineering data file download.
-  disp('Downloading engineering data files...');
+  disp(['Downloading engineering data files from' ...
+        sprintf(' %s', basestation.host) '...']);
   engs = {};
   if ~isequal(eng_name, [])
     try
-      engs = getfiles(ftp_handle, 'target', eng_dir, ...
-                      'source', remote_eng_dir, 'include', eng_name, ...
-                      'new', eng_newfunc, 'update', updatefunc);
+      engs = getmirrorfiles(basestation, 'target', eng_dir, ...
+                            'source', remote_eng_dir, 'include', eng_name, ...
+                            'new', eng_newfunc, 'update', updatefunc);
     catch exception
       warning('glider_toolbox:getBasestationFiles:DownloadError', ...
               'Error downloading engineering data files: %s', exception.message);
@@ -206,13 +195,14 @@ function [engs, logs] = getBasestationFiles(basestation, glider, eng_dir, log_di
 
 
   %% Log data file download.
-  disp('Downloading log data files...');
+  disp(['Downloading log data files from' ...
+        sprintf(' %s', basestation.host) '...']);
   logs = {};
   if ~isequal(log_name, [])
     try
-      logs = getfiles(ftp_handle, 'target', log_dir, ...
-                      'source', remote_log_dir, 'include', log_name, ...
-                      'new', log_newfunc, 'update', updatefunc);
+      logs = getmirrorfiles(basestation, 'target', log_dir, ...
+                            'source', remote_log_dir, 'include', log_name, ...
+                            'new', log_newfunc, 'update', updatefunc);
     catch exception
       warning('glider_toolbox:getBasestationFiles:DownloadError', ...
               'Error downloading log data files: %s.', exception.message);
@@ -220,9 +210,4 @@ function [engs, logs] = getBasestationFiles(basestation, glider, eng_dir, log_di
     disp([num2str(numel(logs)) ' new/updated log data files fetched.']);
   end
 
-  
-  %% Close ftp connection.
-  close(ftp_handle);
-  disp(['Closed connection to host ' basestation.host '.']);
-
 end
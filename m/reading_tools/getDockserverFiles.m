@@ -1,10 +1,11 @@
-function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargin)
+function [xbds, logs, xbd_contents] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargin)
 %GETDOCKSERVERFILES  Get binary data files and surface log files from dockserver through (S)FTP.
 %
 %  Syntax:
 %    [XBDS, LOGS] = GETDOCKSERVERFILES(DOCKSERVER, GLIDER, XBD_DIR, LOG_DIR)
 %    [XBDS, LOGS] = GETDOCKSERVERFILES(DOCKSERVER, GLIDER, XBD_DIR, LOG_DIR, OPTIONS)
 %    [XBDS, LOGS] = GETDOCKSERVERFILES(DOCKSERVER, GLIDER, XBD_DIR, LOG_DIR, OPT1, VAL1, ...)
+%    [XBDS, LOGS, XBD_CONTENTS] = GETDOCKSERVERFILES(...)
 %
 %  [XBDS, LOGS] = GETDOCKSERVERFILES(DOCKSERVER, GLIDER, XBD_DIR, LOG_DIR) 
 %  retrieves new binary files (.[smdtne]bd) and surface dialog files from the
@@ -18,6 +19,10 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
 %    USER: user to access the dockserver if needed (string).
 %    PASS: password of the dockserver if needed (string).
 %    CONN: name or handle of connection type function, @FTP (default) or @SFTP.
+%  DOCKSERVER may also be a struct array describing several dockservers
+%  mirroring the same glider directories. The dockservers are listed
+%  concurrently and each file is downloaded only once, from the dockserver
+%  that responded fastest among the ones that have it (see GETMIRRORFILES).
 %
 %  [XBDS, LOGS] = GETDOCKSERVERFILES(DOCKSERVER, GLIDER, XBD_DIR, LOG_DIR, OPTIONS) and
 %  [XBDS, LOGS] = GETDOCKSERVERFILES(DOCKSERVER, GLIDER, XBD_DIR, LOG_DIR, OPT1, VAL1, ...)
@@ -56,6 +61,21 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
 %      The function receives a struct in the format returned by function DIR
 %      and should return a date in a format comparable to START and FINAL.
 %      Default value: date from file name (see note on date filtering)
+%    XBDHEADER: filter binary files by their header.
+%      If given, read the ascii header of the remote binary files selected by
+%      the other filters without downloading them, and download only the files
+%      whose header satisfies the given predicate. The function receives a 
+%      struct in the format returned by function XBDHEADER, with tags like
+%      MISSION_NAME, FILEOPEN_TIME or SENSOR_LIST_CRC, and should return true
+%      if the file should be downloaded. Files whose header can not be read
+%      (like files still being written) are not downloaded.
+%      This requires an SFTP connection (see note on header filtering).
+%      Default value: [] (do not filter files by header)
+%    XBDCONTENTS: download binary files to memory too.
+%      If true, the binary files fetched through an SFTP connection are
+%      received in memory and written to XBD_DIR in the same transfer, and
+%      their contents are returned in XBD_CONTENTS (see below).
+%      Default value: false
 %    REMOTE_BASE_DIR: Root directory where the data live in the dockserver.
 %    REMOTE_XBD_DIR: Path relative to REMOTE_BASE_DIR to the xbd files.
 %    REMOTE_LOG_DIR: Path relative to REMOTE_BASE_DIR to the log files.
@@ -65,6 +85,12 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
 %      REMOTE_BASE_DIR/GLIDER/REMOTE_LOG_DIR. Otherwise, XBD and LOG paths
 %      are directly under REMOTE_BASE_DIR.%
 %
+%  [XBDS, LOGS, XBD_CONTENTS] = GETDOCKSERVERFILES(...) also returns a cell
+%  array XBD_CONTENTS with the same size as XBDS, with the contents of each
+%  binary file as a column vector of class uint8 when option XBDCONTENTS is
+%  true and the file was fetched through SFTP, or empty otherwise. They may be
+%  decoded in place by XBD2MAT, without reading the files back from disk.
+%
 %  Notes:
 %    By default, date filtering is done based on the mission date computed
 %    from the file names, not on the modification time. It relies on remote
@@ -84,6 +110,16 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
 %      modem: transmission method ('modem' or 'network').
 %      20120510T091438: ISO 8601 UTC timestamp.
 %
+%    Header filtering reads the first bytes of all candidate binary files in a
+%    single pipelined operation through the PEEK method of the SFTP connection, 
+%    so files from other missions or files of segments already fetched may be 
+%    discarded remotely instead of being downloaded and discarded during the
+%    conversion.
+%
+%    When several dockservers are given, a file is considered the same on all
+%    of them if it has the same name, size and modification time. Otherwise
+%    the largest copy (and the newest among the largest) is downloaded.
+%
 %    This function is based on the previous work by Tomeu Garau. He is the true
 %    glider man.
 %
@@ -101,12 +137,19 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
 %      getDockserverFiles(dockserver, glider, xbd_dir, log_dir, ...
 %                         'xbd', '^*.[st]bd$', 'log', [], ...
 %                         'start', now()-7, 'final', now())
+%    % Get only binary files from a given mission through SFTP:
+%    dockserver.conn = @sftp
+%    [xbds, logs] = ...
+%      getDockserverFiles(dockserver, glider, xbd_dir, log_dir, ...
+%                         'xbdheader', @(h)(strcmp(h.mission_name, 'FUNNY.MI')))
 %
 %  See also:
+%    GETMIRRORFILES
 %    FTP
 %    SFTP
 %    DIR
 %    REGEX
+%    XBDHEADER
 %
 %  Authors:
 %    Joan Pau Beltran  <joanpau.beltran@socib.cat>
@@ -128,7 +171,7 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-  narginchk(3, 23);
+  narginchk(3, 27);
   
   %% Set options and default values.
   % Old dockservers used this other base path:
@@ -147,6 +190,8 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
   options.log2date = ...
     @(f)(datenum(str2double(regexp(f.name, '^.*_.*_(\d{4})(\d{2})(\d{2})T(\d{2})(\d{2})(\d{2})\.log$', ...
                                    'tokens','once'))));
+  options.xbdheader = [];
+  options.xbdcontents = false;
   
   
   %% Parse optional arguments.
@@ -193,6 +238,7 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
   log_name = options.log;
   xbd_newfunc = [];
   log_newfunc = [];
+  xbd_headerfunc = [];
   updatefunc = @(l,r)(l.bytes < r.bytes);
   if isfinite(options.start) || isfinite(options.final)
     xbd_newfunc = @(r)(options.start <= options.xbd2date(r) && ...
@@ -200,37 +246,28 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
     log_newfunc = @(r)(options.start <= options.log2date(r) && ...
                        options.log2date(r) <= options.final);
   end
-
-
-  %% Open (S)FTP connection.
-  host = dockserver.host;
-  user = [];
-  pass = [];
-  conn = @ftp;
-  if isfield(dockserver, 'user') && ~isequal(dockserver.user, [])
-    user = dockserver.user;
-  end
-  if isfield(dockserver, 'pass') && ~isequal(dockserver.pass, [])
-    pass = dockserver.pass;
-  end
-  if isfield(dockserver, 'conn') && ~isequal(dockserver.conn, [])
-    conn = dockserver.conn;
-    if ischar(conn)
-      conn = str2func(conn);
+  if ~isempty(options.xbdheader)
+    xbdheaderfunc = options.xbdheader;
+    if ischar(xbdheaderfunc)
+      xbdheaderfunc = str2func(xbdheaderfunc);
     end
+    xbd_headerfunc = @(b)(checkHeader(b, xbdheaderfunc));
   end
-  disp(['Connecting to host ' host '...']);
-  ftp_handle = conn(host, user, pass);
 
 
   %% Binary data file download.
-  disp('Downloading binary data files...');
+  disp(['Downloading binary data files from' ...
+        sprintf(' %s', dockserver.host) '...']);
   xbds = {};
+  xbd_contents = {};
   if ~isequal(xbd_name, [])
     try
-     xbds = getfiles(ftp_handle, 'target', xbd_dir, ...
-                     'source', remote_xbd_dir, 'include', xbd_name, ...
-                     'new', xbd_newfunc, 'update', updatefunc);
+     [xbds, xbd_contents] = ...
+       getmirrorfiles(dockserver, 'target', xbd_dir, ...
+                      'source', remote_xbd_dir, 'include', xbd_name, ...
+                      'new', xbd_newfunc, 'update', updatefunc, ...
+                      'header', xbd_headerfunc, ...
+                      'contents', options.xbdcontents);
     catch exception
       warning('glider_toolbox:getDockserverFiles:DownloadError', ...
               'Error downloading binary data files: %s', exception.message);
@@ -240,13 +277,14 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
 
 
   %% Surface log file download.
-  disp('Downloading surface log files...');
+  disp(['Downloading surface log files from' ...
+        sprintf(' %s', dockserver.host) '...']);
   logs = {};
-  if ~isequal(xbd_name, [])
+  if ~isequal(log_name, [])
     try
-     logs = getfiles(ftp_handle, 'target', log_dir, ...
-                     'source', remote_log_dir, 'include', log_name, ...
-                     'new', log_newfunc, 'update', updatefunc);
+     logs = getmirrorfiles(dockserver, 'target', log_dir, ...
+                           'source', remote_log_dir, 'include', log_name, ...
+                           'new', log_newfunc, 'update', updatefunc);
     catch exception
       warning('glider_toolbox:getDockserverFiles:DownloadError', ...
               'Error downloading surface log files: %s.', exception.message);
@@ -254,10 +292,17 @@ function [xbds, logs] = getDockserverFiles(dockserver, xbd_dir, log_dir, varargi
     disp([num2str(numel(logs)) ' new/updated surface log files fetched.']);
   end
 
-  
-  %% Close ftp connection.
-  close(ftp_handle);
-  disp(['Closed connection to host ' dockserver.host '.']);
-
 end
 
+
+function valid = checkHeader(bytes, headerfunc)
+%CHECKHEADER  Check the header of a binary file given by its first bytes.
+  try
+    valid = logical(headerfunc(xbdheader(bytes)));
+  catch exception
+    if ~strncmp(exception.identifier, 'glider_toolbox:xbdheader:', 25)
+      rethrow(exception);
+    end
+    valid = false;
+  end
+end
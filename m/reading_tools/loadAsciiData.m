@@ -5,7 +5,7 @@ function [meta_raw, data_raw, source_files] = loadAsciiData( input_path, glider_
 %       [META_RAW, DATA_RAW, SOURCE_FILES] = ...
 %            LOADASCIIDATA( INPUT_PATH, GLIDER_TYPE, START_UTC, FILE_OPTIONS)
 %       [META_RAW, DATA_RAW, SOURCE_FILES] = ...
-%            LOADASCIIDATA( INPUT_PATH, GLIDER_TYPE, START_UTC, FILE_OPTIONS, 'END_UTC', END_UTC)
+%            LOADASCIIDATA( INPUT_PATH, GLIDER_TYPE, START_UTC, FILE_OPTIONS, OPT1, VAL1, ...)
 %
 %  Description:
 %    LOADASCIIDATA reads ascii files with glider data from Slocum,
@@ -24,7 +24,16 @@ function [meta_raw, data_raw, source_files] = loadAsciiData( input_path, glider_
 %      LOADSEAEXPLORER accordingly. 
 %
 %  Options:
-%    START_UTC: End date of the period of interest. Default is current date.
+%    END_UTC: End date of the period of interest. Default is current date.
+%    BINARY: Load Slocum binary files directly instead of ascii files.
+%      When true, INPUT_PATH is the binary directory and the files matching
+%      FILE_OPTIONS.XBD_NAME_PATTERN_NAV and FILE_OPTIONS.XBD_NAME_PATTERN_SCI
+%      (default '^.*\.dbd$' and '^.*\.ebd$') are read with XBD2MAT, so that
+%      no conversion to ascii is needed (see LOADSLOCUMDATA). It is ignored for
+%      other glider types, whose files are already in ascii format.
+%      Default is false.
+%    CACHE: Directory with the sensor list cache files needed to load binary
+%      files with factored sensor lists. Default is empty.
 %
 %  Ouput:
 %    
@@ -53,9 +62,11 @@ function [meta_raw, data_raw, source_files] = loadAsciiData( input_path, glider_
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-    narginchk(4, 6);
+    narginchk(4, 10);
     
     options.end_utc          = NaN;
+    options.binary           = false;
+    options.cache            = [];
     
     %% Parse optional arguments.
     % Get option key-value pairs in any accepted call signature.
@@ -95,15 +106,27 @@ function [meta_raw, data_raw, source_files] = loadAsciiData( input_path, glider_
     try
         switch glider_type
           case {'slocum_g1' 'slocum_g2'}
+            name_pattern_nav = file_options.dba_name_pattern_nav;
+            name_pattern_sci = file_options.dba_name_pattern_sci;
+            if options.binary
+              name_pattern_nav = '^.*\.dbd$';
+              name_pattern_sci = '^.*\.ebd$';
+              if isfield(file_options, 'xbd_name_pattern_nav')
+                name_pattern_nav = file_options.xbd_name_pattern_nav;
+              end
+              if isfield(file_options, 'xbd_name_pattern_sci')
+                name_pattern_sci = file_options.xbd_name_pattern_sci;
+              end
+            end
             [meta_raw, data_raw] = ...
-              loadSlocumData(input_path, ...
-                             file_options.dba_name_pattern_nav, ...
-                             file_options.dba_name_pattern_sci, ...
+              loadSlocumData(input_path, name_pattern_nav, name_pattern_sci, ...
                              'timenav', file_options.dba_time_sensor_nav, ...
                              'timesci', file_options.dba_time_sensor_sci, ...
                              'sensors', file_options.dba_sensors, ...
                              'period', [load_start load_final], ...
-                             'format', 'struct');
+                             'format', 'struct', ...
+                             'binary', options.binary, ...
+                             'cache', options.cache);
             source_files = {meta_raw.headers.filename_label};
           case 'seaglider'
             [meta_raw, data_raw] = ...
@@ -0,0 +1,125 @@
+function [crcs, factored, missing, sensor_lists] = loadSensorListCache(xbd_files, cache_dir)
+%LOADSENSORLISTCACHE  Check and load the sensor lists needed by Slocum binary files.
+%
+%  Syntax:
+%    [CRCS, FACTORED, MISSING, SENSOR_LISTS] =
+%      LOADSENSORLISTCACHE(XBD_FILES, CACHE_DIR)
+%
+%  Description:
+%    [CRCS, FACTORED, MISSING, SENSOR_LISTS] =
+%      LOADSENSORLISTCACHE(XBD_FILES, CACHE_DIR) reads the ascii header of
+%    the Slocum binary files named by string or string cell array XBD_FILES,
+%    and checks the sensor list they use against the cache files in directory
+%    CACHE_DIR. This allows to detect all the binary files that can not be
+%    converted before invoking the conversion program on any of them.
+%    Outputs are:
+%      CRCS: string cell array with the sensor list CRC of each binary file in
+%        lower case hexadecimal digits (empty if the header could not be read
+%        or the file does not use sensor list factoring).
+%      FACTORED: logical array with the value of the sensor list factored flag
+%        of each binary file (false if the header could not be read).
+%      MISSING: logical array flagging the binary files with a factored sensor
+%        list whose CRC is neither in the cache directory nor in any of the
+%        binary files with an unfactored sensor list in XBD_FILES.
+%      SENSOR_LISTS: containers.Map with the sensor list CRCs found in the
+%        cache directory as keys and the sensor lists returned by CAC2MAT
+%        as values.
+%
+%  Notes:
+%    The sensor lists are decoded once and kept in memory across calls
+%    in a map indexed by CRC, shared by all the deployments processed in the
+%    same session. The CRC identifies the contents of the sensor list, so the
+%    decoded list is valid regardless of the cache directory it comes from.
+%
+%    Binary files with an unfactored sensor list produce the cache file of its
+%    CRC when converted. Hence converting them before the factored ones
+%    is enough to make available all the sensor lists that may be available.
+%
+%  Examples:
+%    xbd_files = {'happyglider-1970-000-0-0.sbd' 'happyglider-1970-000-0-1.sbd'}
+%    [crcs, factored, missing, sensor_lists] = ...
+%      loadSensorListCache(xbd_files, 'cache')
+%
+%  See also:
+%    XBDHEADER
+%    CAC2MAT
+%    XBD2DBA
+%    CONVERTBINARYDATA
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(2, 2);
+
+  persistent decoded_lists;
+  if isempty(decoded_lists)
+    decoded_lists = containers.Map('KeyType', 'char', 'ValueType', 'any');
+  end
+
+
+  %% Read the sensor list CRC and factored flag of each binary file.
+  xbd_files = cellstr(xbd_files);
+  crcs = repmat({''}, size(xbd_files));
+  factored = false(size(xbd_files));
+  for xbd_idx = 1:numel(xbd_files)
+    try
+      header = xbdheader(xbd_files{xbd_idx});
+    catch exception %#ok<NASGU>
+      % Leave unreadable files to the conversion program to report the error.
+      continue
+    end
+    if isfield(header, 'sensor_list_crc')
+      crcs{xbd_idx} = lower(header.sensor_list_crc);
+      factored(xbd_idx) = isfield(header, 'sensor_list_factored') ...
+                          && header.sensor_list_factored == 1;
+    end
+  end
+
+
+  %% Load the sensor lists available in the cache directory.
+  % Decode each list only the first time it is seen.
+  sensor_lists = containers.Map('KeyType', 'char', 'ValueType', 'any');
+  crc_list = unique(crcs(~cellfun(@isempty, crcs)));
+  for crc_idx = 1:numel(crc_list)
+    crc = crc_list{crc_idx};
+    if isKey(decoded_lists, crc)
+      sensor_lists(crc) = decoded_lists(crc);
+      continue
+    end
+    cac_file = fullfile(cache_dir, [crc '.cac']);
+    if exist(cac_file, 'file')
+      try
+        decoded_lists(crc) = cac2mat(cac_file);
+        sensor_lists(crc) = decoded_lists(crc);
+      catch exception
+        disp(['Error reading sensor list cache file ' cac_file ':']);
+        disp(getReport(exception, 'extended'));
+      end
+    end
+  end
+
+
+  %% Flag the files whose sensor list can not be resolved.
+  provided_crcs = unique(crcs(~factored & ~cellfun(@isempty, crcs)));
+  missing = factored ...
+          & ~ismember(crcs, keys(sensor_lists)) ...
+          & ~ismember(crcs, provided_crcs);
+
+end
@@ -1,5 +1,5 @@
 function [meta, data] = loadSlocumData(dbadir, navregexp, sciregexp, varargin)
-%LOADSLOCUMDATA  Load Slocum data from dba files in directory.
+%LOADSLOCUMDATA  Load Slocum data from dba or binary files in directory.
 %
 %  Syntax:
 %    [META, DATA] = LOADSLOCUMDATA(DBADIR, NAVREGEXP, SCIREGEXP)
@@ -50,12 +50,34 @@ function [meta, data] = loadSlocumData(dbadir, navregexp, sciregexp, varargin)
 %        filtering is not performed and all sensors cycles in the input list
 %        will be present in output.
 %        Default value: 'all' (do not perform time filtering).
+%      BINARY: load binary files instead of dba files.
+%        Boolean setting whether the files matching NAVREGEXP and SCIREGEXP
+%        are Slocum binary files (xxx.[smdtne]bd files) to be read directly
+%        with XBD2MAT instead of dba files to be read with DBA2MAT. This avoids
+%        converting the binary files to dba format and parsing them back.
+%        Default value: false
+%      CACHE: sensor list cache directory.
+%        String with the path to the directory with the sensor list cache files
+%        needed to load binary files with factored sensor lists (see XBD2MAT).
+%        It is ignored when loading dba files.
+%        Default value: [] (no cache directory)
+%      CONTENTS: binary file contents already in memory.
+%        containers.Map with the names of some binary files in DBADIR (without
+%        directory) as keys, and their contents as uint8 column vectors as
+%        values, for example as downloaded to memory by GETDOCKSERVERFILES.
+%        Those files are decoded from memory by XBD2MAT instead of reading
+%        them from disk. It is ignored when loading dba files.
+%        Default value: [] (read all the files from disk)
 %
 %  Notes:
 %    This function is a simple shortcut to load all dba data in a directory
 %    belonging to the same deployment or transect. It just filters the contents
-%    of the directory and calls DBA2MAT, DBACAT and DBAMERGE, bypassing the
-%    given options (with conversions when needed).
+%    of the directory and calls DBA2MAT (or XBD2MAT), DBACAT and DBAMERGE,
+%    bypassing the given options (with conversions when needed).
+%
+%    When loading binary files, the files with unfactored sensor lists are
+%    loaded first, so that they write the cache files needed by the factored
+%    ones with the same sensor list.
 %
 %  Examples:
 %    [meta, data] = ...
@@ -67,11 +89,16 @@ function [meta, data] = loadSlocumData(dbadir, navregexp, sciregexp, varargin)
 %                     'sensors', sensors_of_interest,
 %                     'period', period_of_interest, ...
 %                     'format', 'struct');
+%    [meta, data] = ...
+%      loadSlocumData(xbddir, '^.*\.dbd$', '^.*\.ebd$', ...
+%                     'binary', true, 'cache', cachedir, ...
+%                     'format', 'struct');
 %
 %  See also:
 %    DIR
 %    REGEXP
 %    DBA2MAT
+%    XBD2MAT
 %    DBACAT
 %    DBAMERGE
 %
@@ -95,7 +122,7 @@ function [meta, data] = loadSlocumData(dbadir, navregexp, sciregexp, varargin)
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-  narginchk(3, 13);
+  narginchk(3, 19);
   
   
   %% Set options and default values.
@@ -104,6 +131,9 @@ function [meta, data] = loadSlocumData(dbadir, navregexp, sciregexp, varargin)
   options.timesci = 'sci_m_present_time';
   options.sensors = 'all';
   options.period = 'all';
+  options.binary = false;
+  options.cache = [];
+  options.contents = [];
   
   
   %% Parse optional arguments.
@@ -146,28 +176,48 @@ function [meta, data] = loadSlocumData(dbadir, navregexp, sciregexp, varargin)
   dba_nav_sizes = [dbadir_contents(dba_nav_sel).bytes];
   dba_sci_names = {dbadir_contents(dba_sci_sel).name};
   dba_sci_sizes = [dbadir_contents(dba_sci_sel).bytes];
-  disp(['Ascii files directory: ' dbadir]);
+  disp(['Data files directory: ' dbadir]);
   disp(['Navigation data files found: ' num2str(numel(dba_nav_names)) ...
         ' (' num2str(sum(dba_nav_sizes)*2^-10) ' kB).']);
   disp(['Scientific data files found: ' num2str(numel(dba_sci_names)) ...
         ' (' num2str(sum(dba_sci_sizes)*2^-10) ' kB).']);
   
   
+  %% Set the file reader and the loading order.
+  % Binary files with unfactored sensor lists are loaded first (see note).
+  dba_nav_files = cellfun(@(n)(fullfile(dbadir, n)), dba_nav_names, ...
+                          'UniformOutput', false);
+  dba_sci_files = cellfun(@(n)(fullfile(dbadir, n)), dba_sci_names, ...
+                          'UniformOutput', false);
+  dba_nav_order = 1:numel(dba_nav_names);
+  dba_sci_order = 1:numel(dba_sci_names);
+  if options.binary
+    file_type = 'binary';
+    read_file = @(f)(xbd2mat(fileSource(f, options.contents), ...
+                             'sensors', options.sensors, ...
+                             'cache', options.cache));
+    [~, dba_nav_factored] = loadSensorListCache(dba_nav_files, options.cache);
+    [~, dba_sci_factored] = loadSensorListCache(dba_sci_files, options.cache);
+    [~, dba_nav_order] = sort(dba_nav_factored);
+    [~, dba_sci_order] = sort(dba_sci_factored);
+  else
+    file_type = 'dba';
+    read_file = @(f)(dba2mat(f, 'sensors', options.sensors));
+  end
+  
+  
   %% Load navigation files.
   disp('Loading navigation files...');
-  dba_nav_files = cell(size(dba_nav_names));
   dba_nav_success = false(size(dba_nav_names));
   meta_nav = cell(size(dba_nav_names));
   data_nav = cell(size(dba_nav_names));
-  for dba_nav_idx = 1:numel(dba_nav_names)
+  for dba_nav_idx = dba_nav_order
     try
-      dba_nav_files{dba_nav_idx} = ...
-        fullfile(dbadir, dba_nav_names{dba_nav_idx});
       [meta_nav{dba_nav_idx}, data_nav{dba_nav_idx}] = ...
-        dba2mat(dba_nav_files{dba_nav_idx}, 'sensors', options.sensors);
+        read_file(dba_nav_files{dba_nav_idx});
       dba_nav_success(dba_nav_idx) = true;
     catch exception
-      disp(['Error loading dba file ' dba_nav_files{dba_nav_idx} ':']);
+      disp(['Error loading ' file_type ' file ' dba_nav_files{dba_nav_idx} ':']);
       disp(getReport(exception, 'extended'));
     end
   end
@@ -179,19 +229,16 @@ function [meta, data] = loadSlocumData(dbadir, navregexp, sciregexp, varargin)
   
   %% Load science files.
   disp('Loading science files...');
-  dba_sci_files = cell(size(dba_sci_names));
   dba_sci_success = false(size(dba_sci_names));
   meta_sci = cell(size(dba_sci_names));
   data_sci = cell(size(dba_sci_names));
-  for dba_sci_idx = 1:numel(dba_sci_names)
+  for dba_sci_idx = dba_sci_order
     try
-      dba_sci_files{dba_sci_idx} = ...
-        fullfile(dbadir, dba_sci_names{dba_sci_idx});
       [meta_sci{dba_sci_idx}, data_sci{dba_sci_idx}] = ...
-        dba2mat(dba_sci_files{dba_sci_idx}, 'sensors', options.sensors);
+        read_file(dba_sci_files{dba_sci_idx});
       dba_sci_success(dba_sci_idx) = true;
     catch exception
-      disp(['Error loading dba file ' dba_sci_files{dba_sci_idx} ':']);
+      disp(['Error loading ' file_type ' file ' dba_sci_files{dba_sci_idx} ':']);
       disp(getReport(exception, 'extended'));
     end
   end
@@ -214,3 +261,15 @@ function [meta, data] = loadSlocumData(dbadir, navregexp, sciregexp, varargin)
              'format', options.format);
 
 end
+
+
+function source = fileSource(filename, contents)
+%FILESOURCE  Contents of a file if given in memory, or its name otherwise.
+  source = filename;
+  if isa(contents, 'containers.Map')
+    [~, name, ext] = fileparts(filename);
+    if isKey(contents, [name ext])
+      source = contents([name ext]);
+    end
+  end
+end
@@ -1,15 +1,21 @@
-function [meta, data] = sx2mat(filename, varargin)
+function [meta, data] = sx2mat(source, varargin)
 %SX2MAT  Load data and metadata from a SeaExplorer data file.
 %
 %  Syntax:
 %    [META, DATA] = SX2MAT(FILENAME)
 %    [META, DATA] = SX2MAT(FILENAME, OPTIONS)
 %    [META, DATA] = SX2MAT(FILENAME, OPT1, VAL1, ...)
+%    [META, DATA] = SX2MAT(BYTES, ...)
 %
 %  Description:
 %    [META, DATA] = SX2MAT(FILENAME) reads the SeaExplorer file named by string
 %    FILENAME, loading its metadata in struct META and its data in array DATA.
 %
+%    [META, DATA] = SX2MAT(BYTES, ...) parses the contents of a SeaExplorer
+%    file given as a vector of class uint8 (or int8) BYTES instead of reading it
+%    from disk, for example as downloaded to memory with the MREAD method of
+%    SFTP objects (see option SOURCE below).
+%
 %    [META, DATA] = SX2MAT(FILENAME, OPTIONS) and 
 %    [META, DATA] = SX2MAT(FILENAME, OPT1, VAL1, ...) accept the following 
 %    options given in key-value pairs OPT1, VAL1... or in a struct OPTIONS with 
@@ -36,11 +42,16 @@ function [meta, data] = sx2mat(filename, varargin)
 %        (seconds since 1970-01-01 00:00:00 UTC) with DATENUM
 %        and UTC2POSIXTIME.
 %        Default value: {'Timestamp' 'PLD_REALTIMECLOCK'}
+%      SOURCE: source file name.
+%        String with the name of the file the data comes from, to be used in
+%        the metadata when the contents of the file are given in memory.
+%        Default value: '' (use FILENAME, or empty if contents given)
 %
 %    META has the following fields based on the tags of the ascii header:
 %      VARIABLES: string cell array with the names of the variables present
 %        in the returned data array (in the same column order as the data).
-%      SOURCES: string cell array containing FILENAME.
+%      SOURCES: string cell array containing FILENAME (without directory),
+%        or the source name given in options.
 %
 %  Examples:
 %    % Retrieve data from all variables as array:
@@ -50,6 +61,9 @@ function [meta, data] = sx2mat(filename, varargin)
 %    % Retrieve attitude data as struct:
 %    [meta, data] = sx2mat('test.gli.0001', 'format', 'struct', ...
 %                          'variables', {'Heading' 'Pitch' 'Roll'});
+%    % Parse a file downloaded to memory:
+%    bytes = mread(h, 'test.gli.0001');
+%    [meta, data] = sx2mat(bytes, 'source', 'test.gli.0001')
 %
 %  See also:
 %    SXCAT
@@ -78,13 +92,14 @@ function [meta, data] = sx2mat(filename, varargin)
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-  narginchk(1, 7);
+  narginchk(1, 9);
   
   
   %% Set options and default values.
   options.format = 'array';
   options.variables = 'all';
   options.time = {'Timestamp' 'PLD_REALTIMECLOCK'};
+  options.source = '';
   
   
   %% Parse optional arguments.
@@ -126,23 +141,49 @@ function [meta, data] = sx2mat(filename, varargin)
   time_variable_list = cellstr(options.time);
   
   
-  %% Open the file.
-  [fid, fid_msg] = fopen(filename, 'r');
-  if fid < 0
-    error('glider_toolbox:sx2mat:FileError', fid_msg);
+  %% Open the file, if not given in memory.
+  % Contents given in memory are parsed in place by TEXTSCAN,
+  % skipping the header line instead of copying the data lines.
+  fid = [];
+  if ischar(source)
+    [fid, fid_msg] = fopen(source, 'r');
+    if fid < 0
+      error('glider_toolbox:sx2mat:FileError', fid_msg);
+    end
+    [~, name, ext] = fileparts(source);
+    source_name = [name ext];
+    data_source = fid;
+    data_header_lines = 0;
+  elseif isa(source, 'uint8') || isa(source, 'int8')
+    source_name = '';
+    data_source = char(typecast(source(:), 'uint8')');
+    data_header_lines = 1;
+  else
+    error('glider_toolbox:sx2mat:InvalidInput', ...
+          'Input must be a file name or a byte vector.');
+  end
+  if ~isempty(options.source)
+    source_name = options.source;
   end
   
   
   %% Process the file.
   try
     % Read variable names in header line.
-    header = fgetl(fid);
+    if isempty(fid)
+      header_end = find(data_source == 10, 1, 'first');
+      if isempty(header_end)
+        header_end = numel(data_source) + 1;
+      end
+      header = data_source(1:header_end-1);
+    else
+      header = fgetl(fid);
+    end
     variable_values = ...
       textscan(header, '%s', 'Delimiter', ';', 'ReturnOnError', false);
     
     % Build metadata structure.
-    [~, name, ext] = fileparts(filename);
-    meta.sources = {[name ext]};
+    meta.sources = {source_name};
     meta.variables = variable_values{1};
     
     % Read variable data filtering selected variables if needed.
@@ -156,8 +197,9 @@ function [meta, data] = sx2mat(filename, varargin)
       meta.variables = variables(variable_select);
       time_variable_select = time_variable_select(variable_select);
     end
-    data_values = textscan(fid, [variable_format{:} '%*s'], ...
-                           'Delimiter', ';', 'ReturnOnError', false);
+    data_values = textscan(data_source, [variable_format{:} '%*s'], ...
+                           'Delimiter', ';', 'ReturnOnError', false, ...
+                           'HeaderLines', data_header_lines);
     
     % Convert timestamp variables to numeric format.
     for time_variable_idx = find(time_variable_select)
@@ -187,12 +229,16 @@ function [meta, data] = sx2mat(filename, varargin)
     end
   catch exception
     % Close the file after a reading error.
-    fclose(fid);
+    if ~isempty(fid)
+      fclose(fid);
+    end
     rethrow(exception);
   end
   
   
   %% Close the file after successful reading.
-  fclose(fid); 
+  if ~isempty(fid)
+    fclose(fid);
+  end
 
 end
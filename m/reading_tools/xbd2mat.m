@@ -0,0 +1,399 @@
+function [meta, data] = xbd2mat(source, varargin)
+%XBD2MAT  Load data and metadata from a Slocum binary file.
+%
+%  Syntax:
+%    [META, DATA] = XBD2MAT(FILENAME)
+%    [META, DATA] = XBD2MAT(FILENAME, OPTIONS)
+%    [META, DATA] = XBD2MAT(FILENAME, OPT1, VAL1, ...)
+%    [META, DATA] = XBD2MAT(BYTES, ...)
+%
+%  Description:
+%    [META, DATA] = XBD2MAT(FILENAME) reads the Slocum binary file named by
+%    string FILENAME (xxx.[smdtne]bd file), decoding its data cycles directly
+%    without converting it to ascii format first, and returns its metadata in
+%    struct META and its data in array DATA, in the same form as DBA2MAT does
+%    for the dba file produced by the conversion program from the same file.
+%
+%    [META, DATA] = XBD2MAT(BYTES, ...) decodes the contents of a binary file
+%    given as a vector of class uint8 (or int8) BYTES instead of reading it
+%    from disk, for example as downloaded to memory with the MREAD method of
+%    SFTP objects. The source name in the metadata is then built from the file
+%    name tags in the header.
+%
+%    [META, DATA] = XBD2MAT(FILENAME, OPTIONS) and
+%    [META, DATA] = XBD2MAT(FILENAME, OPT1, VAL1, ...) accept the following
+%    options given in key-value pairs OPT1, VAL1... or in a struct OPTIONS with
+%    field names as option keys and field values as option values:
+%      FORMAT: data output format.
+%        String setting the format of the output DATA. Valid values are:
+%          'array': DATA is a matrix with sensor readings in the column order
+%            specified by the SENSORS metadata field.
+%          'struct': DATA is a struct with sensor names as field names
+%            and column vectors of sensor readings as field values.
+%        Default value: 'array'
+%      SENSORS: sensor filtering list.
+%        String cell array with the names of the sensors of interest.
+%        If given, only the sensors present in both the input data file and this
+%        list will be present in output. The string 'all' may also be given,
+%        in which case sensor filtering is not performed and all sensors
+%        in the input data file will be present in output.
+%        Default value: 'all' (do not perform sensor filtering).
+%      CACHE: sensor list cache directory.
+%        String with the path to the directory with the sensor list cache files
+%        (xxxxxxxx.cac files). It is needed to read files with a factored
+%        sensor list. Files with an unfactored sensor list write the cache file
+%        of their list to this directory if it is not there yet, as the
+%        conversion program does.
+%        Default value: [] (no cache directory)
+%
+%    META has the same fields as returned by DBA2MAT:
+%      HEADERS: a struct with the ascii tags present in the binary file header.
+%      SENSORS: string cell array with the names of the sensors present
+%        in the returned data array (in the same column order as the data).
+%      UNITS: string cell array with the units of the sensors present
+%        in the returned data array.
+%      BYTES: array with the number of bytes of each sensor present
+%        in the returned data array.
+%      SOURCES: string cell array containing FILENAME (without directory).
+%
+%  Notes:
+%    Each data cycle of a Slocum binary file starts with the tag 'd' followed
+%    by 2 bits for each sensor in use (most significant bits first) stating
+%    whether the sensor has not been updated (0), has been updated with the
+%    same value (1) or has a new value (2), and then the new values in sensor
+%    order, as 1, 2, 4 or 8 byte integers or floats. The byte order is given by
+%    the known bytes cycle that precedes the data cycles. Sensors not updated
+%    are invalid (NaN) in the output, and sensors updated with the same value
+%    repeat their previous new value, as in the output of the conversion.
+%
+%    The file is read entirely in memory. The cycles are traversed once to
+%    find the position of the values of the selected sensors, and then all the
+%    values of each size are decoded at once.
+%
+%    A description of the dbd format may be found here:
+%      <http://marine.rutgers.edu/~kerfoot/slocum/data/readme/wrc_doco/dbd_file_format.txt>
+%
+%  Examples:
+%    % Retrieve data from all sensors as array:
+%    [meta, data] = xbd2mat('happyglider-1970-000-0-0.sbd')
+%    % Decode a file downloaded to memory from a dockserver:
+%    bytes = mread(h, 'from-glider/happyglider-1970-000-0-0.sbd');
+%    [meta, data] = xbd2mat(bytes, 'cache', 'cache')
+%    % Retrieve data from time sensors as struct, using a cache directory:
+%    [meta, data] = xbd2mat('happyglider-1970-000-0-0.tbd', ...
+%                           'format', 'struct', 'cache', 'cache', ...
+%                           'sensors', {'m_present_time' 'sci_m_present_time'})
+%
+%  See also:
+%    DBA2MAT
+%    XBDHEADER
+%    CAC2MAT
+%    XBD2DBA
+%    DBACAT
+%    DBAMERGE
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 7);
+
+
+  %% Set options and default values.
+  options.format = 'array';
+  options.sensors = 'all';
+  options.cache = [];
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:xbd2mat:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:xbd2mat:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+
+
+  %% Set option flags and values.
+  output_format = lower(options.format);
+  sensor_filtering = true;
+  if ischar(options.sensors) && strcmp(options.sensors, 'all')
+    sensor_filtering = false;
+  end
+  sensor_list = cellstr(options.sensors);
+
+
+  %% Read the whole file, if not given in memory.
+  if ischar(source)
+    [fid, fid_msg] = fopen(source, 'r');
+    if fid < 0
+      error('glider_toolbox:xbd2mat:FileError', fid_msg);
+    end
+    bytes = fread(fid, inf, '*uint8');
+    fclose(fid);
+  elseif isa(source, 'uint8') || isa(source, 'int8')
+    bytes = typecast(source(:), 'uint8');
+  else
+    error('glider_toolbox:xbd2mat:InvalidInput', ...
+          'Input must be a file name or a byte vector.');
+  end
+
+
+  %% Read the header tags.
+  header = xbdheader(bytes);
+  newlines = find(bytes == 10);
+  header_struct = struct();
+  header_fields = {
+    'dbd_label' 'encoding_ver' 'num_ascii_tags' 'all_sensors' ...
+    'filename' 'the8x3_filename' 'filename_extension' 'filename_label' ...
+    'mission_name' 'fileopen_time' 'sensors_per_cycle' 'num_label_lines' };
+  for header_field_idx = 1:numel(header_fields)
+    header_field = header_fields{header_field_idx};
+    header_struct.(header_field) = header.(header_field);
+  end
+  if isfield(header, 'num_segments')
+    header_struct.num_segments = header.num_segments;
+    header_struct.segment_filenames = ...
+      arrayfun(@(i)(header.(sprintf('segment_filename_%d', i))), ...
+               (0:header.num_segments-1)', 'UniformOutput', false);
+  else
+    header_struct.num_segments = [];
+    header_struct.segment_filenames = {};
+  end
+
+
+  %% Get the sensor list, from the file itself or from the cache.
+  position = newlines(header.num_ascii_tags) + 1;
+  factored = isfield(header, 'sensor_list_factored') ...
+             && header.sensor_list_factored == 1;
+  if isfield(header, 'sensor_list_crc')
+    crc = lower(header.sensor_list_crc);
+  else
+    crc = '';
+  end
+  if factored
+    if isempty(options.cache) || isempty(crc)
+      error('glider_toolbox:xbd2mat:MissingSensorList', ...
+            'Factored sensor list with no cache directory.');
+    end
+    sensor_list_info = cac2mat(fullfile(options.cache, [crc '.cac']));
+  else
+    % The sensor list is made of the consecutive lines starting with 's:'
+    % after the ascii tags (the known bytes cycle starts with 'sa').
+    list_end = header.num_ascii_tags;
+    while list_end < numel(newlines) ...
+        && bytes(newlines(list_end) + 1) == 115 ... % 's'
+        && bytes(newlines(list_end) + 2) == 58      % ':'
+      list_end = list_end + 1;
+    end
+    if list_end == header.num_ascii_tags
+      error('glider_toolbox:xbd2mat:InvalidSensorList', ...
+            'Missing sensor list.');
+    end
+    sensor_list_bytes = bytes(position:newlines(list_end));
+    sensor_list_info = cac2mat(sensor_list_bytes);
+    position = newlines(list_end) + 1;
+    % Write the cache file of the sensor list if not available yet.
+    % It is written to a hidden temporary file in the cache directory and
+    % renamed when complete, so that interrupted or concurrent runs never
+    % leave a truncated cache file.
+    if ~isempty(options.cache) && ~isempty(crc)
+      cac_file = fullfile(options.cache, [crc '.cac']);
+      if ~exist(cac_file, 'file')
+        cac_temp = fullfile(options.cache, ...
+                            ['.' crc '.cac.' ...
+                             sprintf('%06d', floor(1e6 * rand()))]);
+        [cac_fid, cac_msg] = fopen(cac_temp, 'w');
+        if cac_fid >= 0
+          cac_count = fwrite(cac_fid, sensor_list_bytes, 'uint8');
+          cac_status = fclose(cac_fid);
+          if cac_count == numel(sensor_list_bytes) && cac_status == 0
+            [cac_success, cac_msg] = movefile(cac_temp, cac_file, 'f');
+          else
+            cac_success = false;
+            cac_msg = 'write error';
+          end
+          if ~cac_success && exist(cac_temp, 'file')
+            delete(cac_temp);
+          end
+        end
+        if cac_fid < 0 || ~cac_success
+          warning('glider_toolbox:xbd2mat:CacheError', ...
+                  'Could not write cache file %s: %s.', cac_file, cac_msg);
+        end
+      end
+    end
+  end
+  num_sensors = numel(sensor_list_info.sensors);
+  if num_sensors ~= header.sensors_per_cycle
+    error('glider_toolbox:xbd2mat:InvalidSensorList', ...
+          'Sensor list mismatch (%d sensors in list, %d in cycle).', ...
+          num_sensors, header.sensors_per_cycle);
+  end
+  sensor_bytes = double(sensor_list_info.bytes(:))';
+
+
+  %% Select the sensors of interest.
+  sensors = sensor_list_info.sensors(:);
+  units = sensor_list_info.units(:);
+  if sensor_filtering
+    selected_sensors = ismember(sensors, sensor_list);
+  else
+    selected_sensors = true(size(sensors));
+  end
+  num_selected = sum(selected_sensors);
+  selected_bytes = sensor_bytes(selected_sensors);
+
+
+  %% Check the known bytes cycle to get the byte order of the file.
+  % The known bytes cycle is the tag 's', the tag 'a', the integer 0x1234,
+  % the float 123.456 and the double 123456789.12345.
+  if numel(bytes) < position + 15 || ~isequal(bytes(position:position+1)', 'sa')
+    error('glider_toolbox:xbd2mat:InvalidKnownBytes', ...
+          'Missing known bytes cycle.');
+  end
+  known_int = bytes(position+2:position+3)';
+  if isequal(known_int, uint8([18 52]))
+    file_big_endian = true;
+  elseif isequal(known_int, uint8([52 18]))
+    file_big_endian = false;
+  else
+    error('glider_toolbox:xbd2mat:InvalidKnownBytes', ...
+          'Unknown byte order.');
+  end
+  [~, ~, machine_endian] = computer();
+  swap_bytes = (file_big_endian ~= strcmp(machine_endian, 'B'));
+  position = position + 16;
+
+
+  %% Find the state and the position of the value of each selected sensor.
+  % This is the only sequential part, since the size of each cycle depends
+  % on the number of sensors updated with a new value. The states of all
+  % sensors are needed to find the offset of the values in each cycle,
+  % but only the ones of the selected sensors are kept.
+  state_length = ceil(num_sensors / 4);
+  max_cycles = floor((numel(bytes) - position + 1) / (1 + state_length));
+  states = zeros(max_cycles, num_selected, 'uint8');
+  value_offset = zeros(max_cycles, num_selected, 'uint32');
+  state_shifts = -[6; 4; 2; 0];
+  num_cycles = 0;
+  while position <= numel(bytes) && bytes(position) == 100 % 'd'
+    state_end = position + state_length;
+    if state_end > numel(bytes)
+      break
+    end
+    cycle_states = bitand(bitshift(repmat(bytes(position+1:state_end)', 4, 1), ...
+                                   repmat(state_shifts, 1, state_length)), 3);
+    cycle_states = cycle_states(1:num_sensors);
+    cycle_sizes = sensor_bytes .* (cycle_states == 2);
+    cycle_length = sum(cycle_sizes);
+    if state_end + cycle_length > numel(bytes)
+      break
+    end
+    cycle_offsets = state_end + 1 + cumsum(cycle_sizes) - cycle_sizes;
+    num_cycles = num_cycles + 1;
+    states(num_cycles, :) = cycle_states(selected_sensors);
+    value_offset(num_cycles, :) = cycle_offsets(selected_sensors);
+    position = state_end + cycle_length + 1;
+  end
+  if position <= numel(bytes) && bytes(position) ~= 88 % 'X'
+    warning('glider_toolbox:xbd2mat:InvalidCycle', ...
+            'Unexpected cycle tag or truncated cycle at byte %d.', position);
+  end
+  states = states(1:num_cycles, :);
+  value_offset = value_offset(1:num_cycles, :);
+
+
+  %% Decode new values of selected sensors by size.
+  new_value = (states == 2);
+  values = nan(num_cycles, num_selected);
+  size_list = [1 2 4 8];
+  type_list = {'int8' 'int16' 'single' 'double'};
+  for size_idx = 1:numel(size_list)
+    value_select = ...
+      bsxfun(@and, new_value, selected_bytes == size_list(size_idx));
+    if ~any(value_select(:))
+      continue
+    end
+    value_bytes = bytes(bsxfun(@plus, double(value_offset(value_select))', ...
+                               (0:size_list(size_idx)-1)'));
+    if swap_bytes
+      value_bytes = flipud(value_bytes);
+    end
+    values(value_select) = ...
+      double(typecast(value_bytes(:), type_list{size_idx}));
+  end
+
+
+  %% Fill values updated with the same value with the previous new value.
+  % The k-th new value of each sensor in column major order is found adding
+  % the number of new values of the previous sensors.
+  same_value = (states == 1);
+  if any(same_value(:))
+    new_count = cumsum(new_value, 1);
+    new_offset = cumsum([0 sum(new_value(:, 1:end-1), 1)]);
+    new_values = values(new_value);
+    same_index = bsxfun(@plus, new_count, new_offset);
+    same_select = same_value & (new_count > 0);
+    values(same_select) = new_values(same_index(same_select));
+  end
+
+
+  %% Build metadata and data output.
+  if ischar(source)
+    [~, name, ext] = fileparts(source);
+    meta.sources = {[name ext]};
+  else
+    meta.sources = {[header.filename '.' header.filename_extension]};
+  end
+  meta.headers = header_struct;
+  meta.sensors = sensors(selected_sensors);
+  meta.units = units(selected_sensors);
+  meta.bytes = sensor_list_info.bytes(selected_sensors);
+  switch output_format
+    case 'array'
+      data = values;
+    case 'struct'
+      data = cell2struct(num2cell(values, 1), meta.sensors, 2);
+    otherwise
+      error('glider_toolbox:xbd2mat:InvalidFormat', ...
+            'Invalid output format: %s.', output_format)
+  end
+
+end
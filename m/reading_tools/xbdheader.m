@@ -0,0 +1,135 @@
+function header = xbdheader(source)
+%XBDHEADER  Read the ascii header of a Slocum binary data file.
+%
+%  Syntax:
+%    HEADER = XBDHEADER(FILENAME)
+%    HEADER = XBDHEADER(BYTES)
+%
+%  Description:
+%    HEADER = XBDHEADER(FILENAME) reads the ascii header tags at the beginning
+%    of the Slocum binary file named by string FILENAME (xxx.[smdtne]bd file),
+%    and returns them in struct HEADER, without reading the sensor list or the
+%    binary data that follow them.
+%
+%    HEADER = XBDHEADER(BYTES) parses the header from the contents of a binary
+%    file given as a vector of class uint8 (or int8) BYTES. It is enough that
+%    BYTES contains the beginning of the file up to the last ascii tag,
+%    which is useful to inspect remote files without retrieving them entirely.
+%
+%    HEADER has one field for each tag present in the header, with the same
+%    name as the tag. The value of the tags with numeric values (see below)
+%    is converted to double, and the rest are kept as strings:
+%      DBD_LABEL: string.
+%      ENCODING_VER: string.
+%      NUM_ASCII_TAGS: number.
+%      ALL_SENSORS: number (flag, 1 if the file has all the sensors).
+%      FILENAME: string.
+%      THE8X3_FILENAME: string.
+%      FILENAME_EXTENSION: string.
+%      FILENAME_LABEL: string.
+%      MISSION_NAME: string.
+%      FILEOPEN_TIME: string.
+%      SENSORS_PER_CYCLE: number.
+%      NUM_LABEL_LINES: number.
+%      NUM_SEGMENTS: number (optional).
+%      SEGMENT_FILENAME_0, ... : string (optional).
+%      SENSOR_LIST_CRC: string (optional).
+%      SENSOR_LIST_FACTORED: number (optional).
+%
+%  Notes:
+%    The header of a Slocum binary file is made of NUM_ASCII_TAGS text lines
+%    of the form 'tag: value'. The third tag is always NUM_ASCII_TAGS.
+%
+%    Tags SENSOR_LIST_CRC and SENSOR_LIST_FACTORED are present in files
+%    produced by gliders with sensor list factoring enabled. When the list is
+%    factored (SENSOR_LIST_FACTORED is 1) the file does not contain the sensor
+%    list, and the conversion program needs the cache file named after the
+%    sensor list CRC (see CAC2MAT). Otherwise the sensor list follows the
+%    header as consecutive lines starting with 's:', one for each sensor.
+%
+%    A description of the dbd format may be found here:
+%      <http://marine.rutgers.edu/~kerfoot/slocum/data/readme/wrc_doco/dbd_file_format.txt>
+%
+%  Examples:
+%    header = xbdheader('happyglider-1970-000-0-0.sbd')
+%    fid = fopen('happyglider-1970-000-0-0.sbd', 'r');
+%    bytes = fread(fid, 1024, '*uint8');
+%    fclose(fid);
+%    header = xbdheader(bytes)
+%
+%  See also:
+%    CAC2MAT
+%    LOADSENSORLISTCACHE
+%    XBD2DBA
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 1);
+
+  numeric_tags = {'num_ascii_tags' 'all_sensors' 'sensors_per_cycle' ...
+                  'num_label_lines' 'num_segments' 'sensor_list_factored'};
+
+
+  %% Get the header lines.
+  % The header is never longer than a few hundred bytes, so read a fixed
+  % amount of bytes and split them in lines instead of reading line by line.
+  if ischar(source)
+    [fid, fid_msg] = fopen(source, 'r');
+    if fid < 0
+      error('glider_toolbox:xbdheader:FileError', fid_msg);
+    end
+    bytes = fread(fid, 4096, '*uint8');
+    fclose(fid);
+  elseif isa(source, 'uint8') || isa(source, 'int8')
+    bytes = typecast(source(:), 'uint8');
+  else
+    error('glider_toolbox:xbdheader:InvalidInput', ...
+          'Input must be a file name or a byte vector.');
+  end
+  newlines = find(bytes == 10);
+  if numel(newlines) < 3
+    error('glider_toolbox:xbdheader:InvalidHeader', ...
+          'Missing mandatory header tags.');
+  end
+
+
+  %% Parse the tags.
+  % Only parse the number of tags declared in the third one,
+  % the binary sensor list or the data follow the last one.
+  tags = regexp(char(bytes(1:newlines(3))'), '(\w+):\s*(\S*)\s*\n', 'tokens');
+  if numel(tags) < 3 || ~strcmp(tags{3}{1}, 'num_ascii_tags')
+    error('glider_toolbox:xbdheader:InvalidHeader', ...
+          'Missing number of ascii tags.');
+  end
+  num_ascii_tags = str2double(tags{3}{2});
+  if numel(newlines) < num_ascii_tags
+    error('glider_toolbox:xbdheader:InvalidHeader', ...
+          'Incomplete header (%d of %d tags).', ...
+          numel(newlines), num_ascii_tags);
+  end
+  tags = regexp(char(bytes(1:newlines(num_ascii_tags))'), ...
+                '(\w+):\s*(\S*)\s*\n', 'tokens');
+  tags = vertcat(tags{:});
+  numeric_select = ismember(tags(:,1), numeric_tags);
+  tags(numeric_select, 2) = num2cell(str2double(tags(numeric_select, 2)));
+  header = cell2struct(tags(:,2), tags(:,1), 1);
+
+end
@@ -0,0 +1,72 @@
+function time = xbdopentime(header)
+%XBDOPENTIME  Opening time of a Slocum binary data file from its header.
+%
+%  Syntax:
+%    TIME = XBDOPENTIME(HEADER)
+%
+%  Description:
+%    TIME = XBDOPENTIME(HEADER) returns the time the Slocum binary file with
+%    ascii header in struct HEADER was opened by the glider, as a serial date
+%    number, parsed from the value of the tag FILEOPEN_TIME. HEADER is a struct
+%    in the format returned by function XBDHEADER. TIME is NaN if the tag is
+%    missing or its value has not the expected format.
+%
+%  Notes:
+%    The value of the tag FILEOPEN_TIME is the date in the format of the C
+%    function ASCTIME (UTC time of the glider clock), with underscores instead
+%    of spaces, like:
+%      Thu_Nov__8_12:46:06_2012
+%
+%  Examples:
+%    header = xbdheader('happyglider-1970-000-0-0.sbd')
+%    time = xbdopentime(header)
+%    datestr(time)
+%
+%  See also:
+%    XBDHEADER
+%    GETDOCKSERVERFILES
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(1, 1);
+
+  month_names = {'Jan' 'Feb' 'Mar' 'Apr' 'May' 'Jun' ...
+                 'Jul' 'Aug' 'Sep' 'Oct' 'Nov' 'Dec'};
+
+  time = NaN;
+  if ~isfield(header, 'fileopen_time') || ~ischar(header.fileopen_time)
+    return
+  end
+  fields = regexp(header.fileopen_time, ...
+                  '^\w+_+(\w+)_+(\d+)_+(\d+):(\d+):(\d+)_+(\d+)$', ...
+                  'tokens', 'once');
+  if isempty(fields)
+    return
+  end
+  [~, month] = ismember(fields{1}, month_names);
+  if month == 0
+    return
+  end
+  numbers = str2double(fields(2:end));
+  time = datenum(numbers(5), month, numbers(1), ...
+                 numbers(2), numbers(3), numbers(4));
+
+end
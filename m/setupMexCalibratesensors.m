@@ -0,0 +1,114 @@
+function setupMexCalibratesensors()
+%SETUPMEXCALIBRATESENSORS  Build mex file for sensor calibration function CALIBRATESENSORS.
+%
+%  Syntax:
+%    SETUPMEXCALIBRATESENSORS()
+%
+%  Description:
+%    SETUPMEXCALIBRATESENSORS() builds a mex file implementing the function
+%    CALIBRATESENSORS, that applies the factory calibrations of the sensors
+%    in a single pass over the raw measurements.
+%      TARGET:
+%        /path/to/calibratesensors.mex(a64)
+%      SOURCES:
+%        /path/to/calibratesensors.c
+%        /path/to/mexthreads.c
+%      INCLUDES:
+%        none
+%      LIBRARIES:
+%        -lpthread
+%        -lmvec (on x86-64 GNU/Linux only)
+%      FLAGS:
+%        COPTIMFLAGS='-O3 -ffp-contract=off -fno-math-errno -fwrapv -DNDEBUG'
+%        -DCALIBRATESENSORS_LIBMVEC (on x86-64 GNU/Linux only)
+%
+%  Notes:
+%    The work is split in tasks run by a set of threads using the shared thread
+%    runtime of the mex files in 'mexthreads.c'. The number of threads is
+%    limited by the number of processors and by the environment variable
+%    GLIDER_TOOLBOX_THREADS, if set (see SETENV). The processors are shared
+%    with the other processes of the node through the slot files in the
+%    directory given by GLIDER_TOOLBOX_THREADS_DIR (see SETUPCONFIGURATION).
+%
+%    With GCC on x86 processors, the calibration kernels are compiled for several
+%    instruction sets (default, SSE4.2, AVX2 and AVX-512), and the best one
+%    supported by the processor is selected when the mex file is loaded, so the
+%    same mex file may be used on heterogeneous nodes. The optimization flags
+%    enable the vectorization of the kernels and disable the contraction of
+%    floating point operations. On x86-64 GNU/Linux systems the logarithm of
+%    the Sea-Bird CT kernel is vectorized too, using the vector math library of
+%    the GNU C library (libmvec, available since version 2.22). Its logarithms
+%    differ from the scalar ones in the last bits, so the temperatures computed
+%    by each version of the kernels may differ by about 1e-13 degrees Celsius.
+%    On other systems that kernel is scalar and all versions give the same
+%    results. The version in use may be queried and changed with
+%    CALIBRATESENSORS('isa'), and compared with BENCHMARKCALIBRATESENSORS.
+%
+%    This function uses the function MEX to build the target. On GNU/Linux 
+%    systems, the build process might fail after a warning if the compiler 
+%    version is newer than the latest version supported by MATLAB, even though
+%    running the same MEX command on a system shell builds the target properly.
+%    The reason is that MATLAB may extent or overwrite the environment variable
+%    LD_LIBRARY_PATH to point to its own version of the standard libraries,
+%    causing an incompatibility with the version of the compiler.
+%    To solve the problem, either build the target from the shell or temporarily
+%    overwrite the environment variable LD_LIBRARY_PATH from the MATLAB session.
+%
+%  Examples:
+%    % Compile sensor calibration function.
+%    setupMexCalibratesensors();
+%
+%    % Incompatible versions of system compiler and libraries shipped with the
+%    % interpreter may cause build failure.
+%    % Try to build the target against system libraries instead of shipped ones.
+%    ld_library_path = getenv('LD_LIBRARY_PATH')
+%    setenv('LD_LIBRARY_PATH')
+%    setupMexCalibratesensors()
+%    setenv('LD_LIBRARY_PATH', ld_library_path)
+%    clear('ld_library_path')
+%
+%  See also:
+%    CALIBRATESENSORS
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(0, 0);
+
+  funcname = 'calibratesensors';
+  funcpath = which(funcname);
+  
+  if isempty(funcpath)
+    error('glider_toolbox:setup:NotFound', ...
+          'Could not find location of %s.', funcname);
+  end
+  
+  prefix = fileparts(funcpath);
+  target = fullfile(prefix, [funcname '.' mexext()]);
+  sources = fullfile(prefix, {[funcname '.c'] 'mexthreads.c'});
+  libmvec = {};
+  if ~isempty(regexpi(computer(), '^(glnxa64|x86_64-.*linux-gnu)$', 'once'))
+    libmvec = {'-DCALIBRATESENSORS_LIBMVEC' '-lmvec'};
+  end
+  
+  mex('-output', target, sources{:}, libmvec{:}, '-lpthread', ...
+      'COPTIMFLAGS=-O3 -ffp-contract=off -fno-math-errno -fwrapv -DNDEBUG');
+
+end
@@ -0,0 +1,94 @@
+function setupMexPublishfile()
+%SETUPMEXPUBLISHFILE  Build mex file for file publication function PUBLISHFILE.
+%
+%  Syntax:
+%    SETUPMEXPUBLISHFILE()
+%
+%  Description:
+%    SETUPMEXPUBLISHFILE() builds a mex file implementing the function
+%    PUBLISHFILE, that copies files to their public location using low level
+%    POSIX functions and threads.
+%      TARGET:
+%        /path/to/publishfile.mex(a64)
+%      SOURCES:
+%        /path/to/publishfile.c
+%        /path/to/mexthreads.c
+%      INCLUDES:
+%        none
+%      LIBRARIES:
+%        -lpthread
+%
+%  Notes:
+%    The work is split in tasks run by a set of threads using the shared thread
+%    runtime of the mex files in 'mexthreads.c'. The number of threads is
+%    limited by the number of processors and by the environment variable
+%    GLIDER_TOOLBOX_THREADS, if set (see SETENV). The processors are shared
+%    with the other processes of the node through the slot files in the
+%    directory given by GLIDER_TOOLBOX_THREADS_DIR (see SETUPCONFIGURATION).
+%
+%    Reflink clones (FICLONE) and kernel side copies (COPY_FILE_RANGE and
+%    SENDFILE) are only used when available at build time (GNU/Linux).
+%
+%    This function uses the function MEX to build the target. On GNU/Linux 
+%    systems, the build process might fail after a warning if the compiler 
+%    version is newer than the latest version supported by MATLAB, even though
+%    running the same MEX command on a system shell builds the target properly.
+%    The reason is that MATLAB may extent or overwrite the environment variable
+%    LD_LIBRARY_PATH to point to its own version of the standard libraries,
+%    causing an incompatibility with the version of the compiler.
+%    To solve the problem, either build the target from the shell or temporarily
+%    overwrite the environment variable LD_LIBRARY_PATH from the MATLAB session.
+%
+%  Examples:
+%    % Compile file publication function.
+%    setupMexPublishfile();
+%
+%    % Incompatible versions of system compiler and libraries shipped with the
+%    % interpreter may cause build failure.
+%    % Try to build the target against system libraries instead of shipped ones.
+%    ld_library_path = getenv('LD_LIBRARY_PATH')
+%    setenv('LD_LIBRARY_PATH')
+%    setupMexPublishfile()
+%    setenv('LD_LIBRARY_PATH', ld_library_path)
+%    clear('ld_library_path')
+%
+%  See also:
+%    PUBLISHFILE
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2013-2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(0, 0);
+
+  funcname = 'publishfile';
+  funcpath = which(funcname);
+  
+  if isempty(funcpath)
+    error('glider_toolbox:setup:NotFound', ...
+          'Could not find location of %s.', funcname);
+  end
+  
+  prefix = fileparts(funcpath);
+  target = fullfile(prefix, [funcname '.' mexext()]);
+  sources = fullfile(prefix, {[funcname '.c'] 'mexthreads.c'});
+  
+  mex('-output', target, sources{:}, '-lpthread');
+
+end
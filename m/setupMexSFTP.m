@@ -1,8 +1,10 @@
-function setupMexSFTP()
+function setupMexSFTP(varargin)
 %SETUPMEXSFTP  Build mex file for internal functions of SFTP object methods.
 %
 %  Syntax:
 %    SETUPMEXSFTP()
+%    SETUPMEXSFTP(OPTIONS)
+%    SETUPMEXSFTP(OPT1, VAL1, ...)
 %
 %  Description:
 %    SETUPMEXSFTP() builds a mex file interface to perform operations through an
@@ -35,6 +37,24 @@ function setupMexSFTP()
 %        -Wl,-rpath=$ORIGIN/libssh/lib
 %        -l ssh
 %
+%    SETUPMEXSFTP(OPTIONS) and SETUPMEXSFTP(OPT1, VAL1, ...) accept the
+%    following options given in key-value pairs OPT1, VAL1... or in a struct
+%    OPTIONS with field names as option keys and field values as option values:
+%      CODECS: compression formats.
+%        String cell array with the compression formats to enable in the
+%        transfers (streaming decompression when downloading and compression
+%        when uploading). Each format needs the development files of its
+%        library installed on the system, and defines a macro in the build:
+%          'gzip': zlib (macro MEXSFTP_WITH_ZLIB, library -l z).
+%          'xz': liblzma (macro MEXSFTP_WITH_LZMA, library -l lzma).
+%          'zstd': libzstd (macro MEXSFTP_WITH_ZSTD, library -l zstd).
+%        After building the target, a check of the given formats is built in a
+%        temporary directory (defining also the macro MEXSFTP_CODEC_CHECK) and
+%        run for each one. The check compresses and decompresses generated
+%        data in chunks like the transfers do, and throws an error if the data
+%        do not match or if a truncated stream is not detected.
+%        Default value: {} (no compression formats)
+%
 %  Notes:
 %    The libssh library provides a client API for the SFTP protocol. 
 %    The official web site of the library is:
@@ -43,6 +63,8 @@ function setupMexSFTP()
 %    On Debian based systems, the libssh library may be installed from the main
 %    section of the official repositories running the following command as root:
 %      apt-get install libssh-dev
+%    and the compression libraries with:
+%      apt-get install zlib1g-dev liblzma-dev libzstd-dev
 %
 %    This function uses the function MEX to build the target. On GNU/Linux 
 %    systems, the build process might fail after a warning if the compiler 
@@ -63,6 +85,9 @@ function setupMexSFTP()
 %    % or locally in the private/libssh directory of the @sftp class.
 %    setupMexSFTP()
 %
+%    % Enable decompression and compression of gzip and xz files in transfers.
+%    setupMexSFTP('codecs', {'gzip' 'xz'})
+%
 %    % Incompatible versions of system compiler and libraries shipped with the
 %    % the interpreter may cause build failure.
 %    % Try to build the target against system libraries instead of shipped ones.
@@ -96,7 +121,43 @@ function setupMexSFTP()
 %  You should have received a copy of the GNU General Public License
 %  along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-  narginchk(0, 0);
+  narginchk(0, 2);
+  
+  
+  %% Set options and default values.
+  options.codecs = {};
+  
+  
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:setupMexSFTP:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:setupMexSFTP:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+  
+  
+  %% Build the target.
 
   funcname = 'mexsftp';
   funcpath =  which('@sftp/private/mexsftp');
@@ -114,6 +175,18 @@ function setupMexSFTP()
   includedir = fullfile(libsshdir, 'include');
   librarydir = fullfile(libsshdir, 'lib');
   rpath = fullfile('\\\$ORIGIN', 'libssh', 'lib');
+  codec_map = {
+    'gzip' 'MEXSFTP_WITH_ZLIB' 'z'
+    'xz'   'MEXSFTP_WITH_LZMA' 'lzma'
+    'zstd' 'MEXSFTP_WITH_ZSTD' 'zstd' };
+  codecs = cellstr(options.codecs);
+  [codec_found, codec_index] = ismember(codecs, codec_map(:,1));
+  if ~all(codec_found)
+    error('glider_toolbox:setupMexSFTP:InvalidCodec', ...
+          'Invalid compression format: %s.', codecs{find(~codec_found, 1)});
+  end
+  codec_flags = [strcat('-D', codec_map(codec_index, 2)); 
+                 strcat('-l', codec_map(codec_index, 3))];
 
   if exist(libsshdir, 'dir')
     mex('-output', target, ...
@@ -121,9 +194,52 @@ function setupMexSFTP()
         ['-L' librarydir], ...
         ['-l' libssh], ...
         ['-Wl,-rpath=' rpath], ...
-        sources);
+        codec_flags{:}, sources);
   else
-    mex('-output', target, ['-l' libssh], sources);
+    mex('-output', target, ['-l' libssh], codec_flags{:}, sources);
+  end
+  
+  
+  %% Check the compression formats.
+  % The check is a separate build of the same source with its own entry point,
+  % since the target is private to the SFTP methods.
+  if isempty(codecs)
+    return
+  end
+  check_name = [funcname 'check'];
+  check_dir = tempname();
+  check_target = fullfile(check_dir, [check_name '.' mexext()]);
+  [success, message] = mkdir(check_dir);
+  if ~success
+    error('glider_toolbox:setupMexSFTP:CheckError', ...
+          'Could not create directory %s: %s.', check_dir, message);
+  end
+  try
+    if exist(libsshdir, 'dir')
+      mex('-output', check_target, '-DMEXSFTP_CODEC_CHECK', ...
+          ['-I' includedir], ...
+          ['-L' librarydir], ...
+          ['-l' libssh], ...
+          ['-Wl,-rpath=' librarydir], ...
+          codec_flags{:}, sources);
+    else
+      mex('-output', check_target, '-DMEXSFTP_CODEC_CHECK', ...
+          ['-l' libssh], codec_flags{:}, sources);
+    end
+    addpath(check_dir);
+    for codec_idx = 1:numel(codecs)
+      feval(check_name, codecs{codec_idx});
+      fprintf('Round trip check of compression format %s passed.\n', ...
+              codecs{codec_idx});
+    end
+  catch exception
+    rmpath(check_dir);
+    clear(check_name);
+    rmdir(check_dir, 's');
+    rethrow(exception);
   end
+  rmpath(check_dir);
+  clear(check_name);
+  rmdir(check_dir, 's');
 
 end
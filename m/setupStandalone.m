@@ -0,0 +1,177 @@
+function setupStandalone(varargin)
+%SETUPSTANDALONE  Build standalone executables of the processing chain.
+%
+%  Syntax:
+%    SETUPSTANDALONE()
+%    SETUPSTANDALONE(OPTIONS)
+%    SETUPSTANDALONE(OPT1, VAL1, ...)
+%
+%  Description:
+%    SETUPSTANDALONE() builds standalone executables of the main entry points
+%    of the processing chain with the MATLAB Compiler, so that the processing
+%    may be run on nodes without a MATLAB installation or license, using only
+%    the freely redistributable MATLAB Runtime. The executables include all
+%    the toolbox functions, the mex files built for the current platform and
+%    the external libraries in the 'ext_lib/lib' directory of the toolbox.
+%    Configuration files are not included, they are read at run time from the
+%    toolbox directory given by the environment variable GLIDER_TOOLBOX_DIR
+%    (see CONFIGGLIDERTOOLBOXPATH). The executables are built with these
+%    attributes:
+%      ENTRY POINTS:
+%        main_glider_data_processing_daemon
+%        gliderDataProcessing
+%      TARGET:
+%        /path/to/glider_toolbox/bin/standalone
+%
+%    SETUPSTANDALONE(OPTIONS) and SETUPSTANDALONE(OPT1, VAL1, ...) accept the
+%    following options given in key-value pairs OPT1, VAL1... or in a struct
+%    OPTIONS with field names as option keys and field values as option values:
+%      MAINS: entry points.
+%        String cell array with the names of the functions to build an
+%        executable for. Each entry point must be a function, not a script.
+%        Default value: {'main_glider_data_processing_daemon'
+%                        'gliderDataProcessing'}
+%      TARGET: output directory.
+%        String with the path of the directory where the executables and their
+%        launcher scripts generated by the compiler are written to.
+%        Default value: fullfile(glider_toolbox_dir, 'bin', 'standalone')
+%
+%  Notes:
+%    This function uses the function MCC of the MATLAB Compiler to build the
+%    targets. It is not available in Octave, where the processing chain may be
+%    run from the command line with 'octave --eval' instead.
+%
+%    The mex files of the toolbox (SETUPMEXPOSIXTIME, SETUPMEXPOLY2TRI,
+%    SETUPMEXSFTP...) must be built before building the executables.
+%
+%    The compiler generates a launcher script 'run_<entry_point>.sh' for each
+%    executable taking the MATLAB Runtime directory as first argument. The
+%    script 'gtb_standalone' in the 'bin' directory of the toolbox wraps them,
+%    setting the toolbox directory for the configuration files. The command
+%    line arguments of the executables are passed as strings, so numeric
+%    options should be given as strings too.
+%
+%    The executables built here still need the MATLAB Runtime. Only the
+%    loading of Slocum binary files and the generation of the L0 NetCDF file
+%    are available without it, as the native program 'gtb_xbd2nc' built with
+%    'make native' from the toolbox directory. That program does not read the
+%    toolbox configuration: it needs a CDL template written beforehand by
+%    WRITENETCDFTEMPLATE in MATLAB or Octave. The rest of the chain (L1
+%    processing, L2 gridding, figures and publishing) has no native version
+%    and runs only in MATLAB, Octave or these executables.
+%
+%  Examples:
+%    % Build the processing daemon and the generic processing function.
+%    setupStandalone()
+%    % Build only the processing daemon in a custom directory.
+%    setupStandalone('mains', {'main_glider_data_processing_daemon'}, ...
+%                    'target', '/opt/glider_toolbox/bin')
+%
+%  See also:
+%    MCC
+%    ISDEPLOYED
+%    CONFIGGLIDERTOOLBOXPATH
+%    MAIN_GLIDER_DATA_PROCESSING_DAEMON
+%    GLIDERDATAPROCESSING
+%    WRITENETCDFTEMPLATE
+%
+%  Authors:
+%    Joan Pau Beltran  <joanpau.beltran@socib.cat>
+
+%  Copyright (C) 2016
+%  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears
+%  <http://www.socib.es>
+%
+%  This program is free software: you can redistribute it and/or modify
+%  it under the terms of the GNU General Public License as published by
+%  the Free Software Foundation, either version 3 of the License, or
+%  (at your option) any later version.
+%
+%  This program is distributed in the hope that it will be useful,
+%  but WITHOUT ANY WARRANTY; without even the implied warranty of
+%  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+%  GNU General Public License for more details.
+%
+%  You should have received a copy of the GNU General Public License
+%  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  narginchk(0, 4);
+
+  glider_toolbox_dir = configGliderToolboxPath();
+
+
+  %% Set options and default values.
+  options.mains = {'main_glider_data_processing_daemon' 'gliderDataProcessing'};
+  options.target = fullfile(glider_toolbox_dir, 'bin', 'standalone');
+
+
+  %% Parse optional arguments.
+  % Get option key-value pairs in any accepted call signature.
+  argopts = varargin;
+  if isscalar(argopts) && isstruct(argopts{1})
+    % Options passed as a single option struct argument:
+    % field names are option keys and field values are option values.
+    opt_key_list = fieldnames(argopts{1});
+    opt_val_list = struct2cell(argopts{1});
+  elseif mod(numel(argopts), 2) == 0
+    % Options passed as key-value argument pairs.
+    opt_key_list = argopts(1:2:end);
+    opt_val_list = argopts(2:2:end);
+  else
+    error('glider_toolbox:setupStandalone:InvalidOptions', ...
+          'Invalid optional arguments (neither key-value pairs nor struct).');
+  end
+  % Overwrite default options with values given in extra arguments.
+  for opt_idx = 1:numel(opt_key_list)
+    opt = lower(opt_key_list{opt_idx});
+    val = opt_val_list{opt_idx};
+    if isfield(options, opt)
+      options.(opt) = val;
+    else
+      error('glider_toolbox:setupStandalone:InvalidOption', ...
+            'Invalid option: %s.', opt);
+    end
+  end
+
+
+  %% Check compiler and mex files.
+  if ~exist('mcc', 'file')
+    error('glider_toolbox:setupStandalone:NotFound', ...
+          'Could not find the MATLAB Compiler (function mcc).');
+  end
+  mexfuncs = {'posixtime' 'poly2tri' 'publishfile' 'calibratesensors'};
+  for mexfunc_idx = 1:numel(mexfuncs)
+    if exist(mexfuncs{mexfunc_idx}, 'file') ~= 3
+      warning('glider_toolbox:setupStandalone:MexNotFound', ...
+              'Mex file %s not found, the m file will be used if present.', ...
+              mexfuncs{mexfunc_idx});
+    end
+  end
+
+
+  %% Build an executable for each entry point.
+  % Scripts and functions called by name (like the processing script run by
+  % the daemon, or the plotting functions given in the configuration) are not
+  % found by the dependency analysis, so the whole toolbox is added.
+  mains = cellstr(options.mains);
+  target = options.target;
+  [success, message] = mkdir(target);
+  if ~success
+    error('glider_toolbox:setupStandalone:DirectoryError', ...
+          'Could not create directory %s: %s.', target, message);
+  end
+  archive_args = {'-a' fullfile(glider_toolbox_dir, 'm')};
+  ext_lib_dir = fullfile(glider_toolbox_dir, 'ext_lib', 'lib');
+  ext_libs = dir(ext_lib_dir);
+  ext_libs = ext_libs([ext_libs.isdir] & ~strncmp({ext_libs.name}, '.', 1));
+  for ext_lib_idx = 1:numel(ext_libs)
+    archive_args(end+1:end+2) = ...
+      {'-a' fullfile(ext_lib_dir, ext_libs(ext_lib_idx).name)};
+  end
+  for main_idx = 1:numel(mains)
+    main = mains{main_idx};
+    disp(['Building standalone executable ' main '...']);
+    mcc('-m', which(main), '-d', target, '-R', '-nodisplay', archive_args{:});
+  end
+
+end
@@ -0,0 +1,1012 @@
+/**
+ * @file
+ * @brief Native writer of NetCDF classic files and reader of CDL templates.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file implements the functions declared in cdf.h.
+ *
+ * The CDL reader understands the subset of the language used to describe
+ * the header of classic files: the dimensions section, the variables section
+ * with variable declarations and variable and global attributes, and comments.
+ * The data section, if any, is ignored. Attribute types follow the ncgen
+ * rules: strings are char attributes, integer constants are int attributes
+ * and floating point constants are double attributes, unless they have a
+ * type suffix ('b' byte, 's' short, 'l' int, 'f' float, 'd' double).
+ */
+
+
+#include "cdf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <limits.h>
+
+#define CDF_NC_DIMENSION 10
+#define CDF_NC_VARIABLE 11
+#define CDF_NC_ATTRIBUTE 12
+#define CDF_MAX_OFFSET_32 2147483647UL
+#define CDF_CHUNK_BYTES 65536
+
+
+static char * copy_string(const char *str)
+{
+  char *copy;
+  copy = malloc(strlen(str) + 1);
+  if (copy)
+    strcpy(copy, str);
+  return copy;
+}
+
+static size_t cdf_type_size(cdf_type type)
+{
+  switch (type) {
+    case CDF_BYTE:
+    case CDF_CHAR:
+      return 1;
+    case CDF_SHORT:
+      return 2;
+    case CDF_INT:
+    case CDF_FLOAT:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+static size_t pad4(size_t n)
+{
+  return (n + 3) & ~((size_t) 3);
+}
+
+
+void init_cdf_file(cdf_file_struct *file)
+{
+  memset(file, 0, sizeof(*file));
+}
+
+void free_cdf_att(cdf_att_struct *att)
+{
+  free(att->name);
+  free(att->text);
+  free(att->values);
+  memset(att, 0, sizeof(*att));
+}
+
+void free_cdf_file(cdf_file_struct *file)
+{
+  size_t i, j;
+  for (i = 0; i < file->num_dims; i++)
+    free(file->dims[i].name);
+  free(file->dims);
+  for (i = 0; i < file->num_atts; i++)
+    free_cdf_att(&file->atts[i]);
+  free(file->atts);
+  for (i = 0; i < file->num_vars; i++) {
+    free(file->vars[i].name);
+    free(file->vars[i].dims);
+    for (j = 0; j < file->vars[i].num_atts; j++)
+      free_cdf_att(&file->vars[i].atts[j]);
+    free(file->vars[i].atts);
+  }
+  free(file->vars);
+  init_cdf_file(file);
+}
+
+int set_cdf_att_text(cdf_att_struct *att, const char *name, const char *text)
+{
+  memset(att, 0, sizeof(*att));
+  att->name = copy_string(name);
+  att->text = copy_string(text);
+  att->type = CDF_CHAR;
+  att->length = text ? strlen(text) : 0;
+  if (!att->name || !att->text) {
+    free_cdf_att(att);
+    return 1;
+  }
+  return 0;
+}
+
+int set_cdf_att_values(cdf_att_struct *att, const char *name, cdf_type type,
+                       const double *values, size_t length)
+{
+  memset(att, 0, sizeof(*att));
+  att->name = copy_string(name);
+  att->values = malloc((length + 1) * sizeof(double));
+  att->type = type;
+  att->length = length;
+  if (!att->name || !att->values) {
+    free_cdf_att(att);
+    return 1;
+  }
+  if (length > 0)
+    memcpy(att->values, values, length * sizeof(double));
+  return 0;
+}
+
+int copy_cdf_att(cdf_att_struct *dst, const cdf_att_struct *src)
+{
+  if (src->type == CDF_CHAR)
+    return set_cdf_att_text(dst, src->name, src->text ? src->text : "");
+  return set_cdf_att_values(dst, src->name, src->type,
+                            src->values, src->length);
+}
+
+const cdf_att_struct * find_cdf_att(const cdf_att_struct *atts, size_t n,
+                                    const char *name)
+{
+  size_t i;
+  for (i = 0; i < n; i++)
+    if (strcmp(atts[i].name, name) == 0)
+      return &atts[i];
+  return NULL;
+}
+
+
+/*
+ * CDL lexer: names, strings, numbers and punctuation, skipping comments.
+ */
+
+typedef enum {
+  CDL_END,
+  CDL_NAME,
+  CDL_STRING,
+  CDL_NUMBER,
+  CDL_PUNCT,
+  CDL_ERROR
+} cdl_token_kind;
+
+typedef struct cdl_lexer_struct {
+  const char *text;
+  size_t pos;
+  cdl_token_kind kind;
+  char punct;
+  char *str;
+  size_t str_len;
+  size_t str_cap;
+  double number;
+  cdf_type number_type;
+  int pushed;
+} cdl_lexer_struct;
+
+static int is_cdl_name_char(int c)
+{
+  return isalnum(c) || c == '_' || c == '.' || c == '@' || c == '+'
+         || c == '-';
+}
+
+static int append_cdl_char(cdl_lexer_struct *lex, char c)
+{
+  char *grown;
+  if (lex->str_len + 1 >= lex->str_cap) {
+    lex->str_cap = lex->str_cap ? 2 * lex->str_cap : 256;
+    grown = realloc(lex->str, lex->str_cap);
+    if (!grown)
+      return 1;
+    lex->str = grown;
+  }
+  lex->str[lex->str_len++] = c;
+  lex->str[lex->str_len] = '\0';
+  return 0;
+}
+
+static void lex_cdl_number(cdl_lexer_struct *lex)
+{
+  const char *start;
+  char *end;
+  size_t k;
+  int floating;
+  start = lex->text + lex->pos;
+  lex->number = strtod(start, &end);
+  if (end == start) {
+    lex->kind = CDL_ERROR;
+    return;
+  }
+  floating = 0;
+  for (k = 0; start + k < end; k++)
+    if (strchr(".eEnNiI", start[k]))
+      floating = 1;
+  lex->number_type = floating ? CDF_DOUBLE : CDF_INT;
+  if (*end && strchr("bBsSlLfFdD", *end) && !is_cdl_name_char(end[1])) {
+    switch (tolower((unsigned char) *end)) {
+      case 'b': lex->number_type = CDF_BYTE; break;
+      case 's': lex->number_type = CDF_SHORT; break;
+      case 'l': lex->number_type = CDF_INT; break;
+      case 'f': lex->number_type = CDF_FLOAT; break;
+      default: lex->number_type = CDF_DOUBLE; break;
+    }
+    end++;
+  }
+  lex->pos = end - lex->text;
+  lex->kind = CDL_NUMBER;
+}
+
+static cdl_token_kind next_cdl_token(cdl_lexer_struct *lex)
+{
+  const char *t;
+  char c;
+  if (lex->pushed) {
+    lex->pushed = 0;
+    return lex->kind;
+  }
+  t = lex->text;
+  for (;;) {
+    while (t[lex->pos] && isspace((unsigned char) t[lex->pos]))
+      lex->pos++;
+    if (t[lex->pos] == '/' && t[lex->pos + 1] == '/') {
+      while (t[lex->pos] && t[lex->pos] != '\n')
+        lex->pos++;
+      continue;
+    }
+    break;
+  }
+  c = t[lex->pos];
+  lex->str_len = 0;
+  if (lex->str)
+    lex->str[0] = '\0';
+  if (!c) {
+    lex->kind = CDL_END;
+  } else if (c == '"') {
+    lex->pos++;
+    lex->kind = CDL_STRING;
+    if (append_cdl_char(lex, '\0'))
+      return lex->kind = CDL_ERROR;
+    lex->str_len = 0;
+    while (t[lex->pos] && t[lex->pos] != '"') {
+      c = t[lex->pos++];
+      if (c == '\\' && t[lex->pos]) {
+        c = t[lex->pos++];
+        switch (c) {
+          case 'n': c = '\n'; break;
+          case 't': c = '\t'; break;
+          case 'r': c = '\r'; break;
+          default: break;
+        }
+      }
+      if (append_cdl_char(lex, c))
+        return lex->kind = CDL_ERROR;
+    }
+    if (t[lex->pos] != '"')
+      return lex->kind = CDL_ERROR;
+    lex->pos++;
+  } else if (isdigit((unsigned char) c) || c == '-' || c == '+'
+             || (c == '.' && isdigit((unsigned char) t[lex->pos + 1]))) {
+    lex_cdl_number(lex);
+  } else if (isalpha((unsigned char) c) || c == '_') {
+    lex->kind = CDL_NAME;
+    while (is_cdl_name_char((unsigned char) t[lex->pos]))
+      if (append_cdl_char(lex, t[lex->pos++]))
+        return lex->kind = CDL_ERROR;
+  } else if (strchr("{}(),;=:", c)) {
+    lex->pos++;
+    lex->kind = CDL_PUNCT;
+    lex->punct = c;
+  } else {
+    lex->kind = CDL_ERROR;
+  }
+  return lex->kind;
+}
+
+static int is_cdl_punct(cdl_lexer_struct *lex, char c)
+{
+  return lex->kind == CDL_PUNCT && lex->punct == c;
+}
+
+static int expect_cdl_punct(cdl_lexer_struct *lex, char c)
+{
+  next_cdl_token(lex);
+  return is_cdl_punct(lex, c);
+}
+
+static int parse_cdl_type(const char *name, cdf_type *type)
+{
+  if (strcmp(name, "byte") == 0)
+    *type = CDF_BYTE;
+  else if (strcmp(name, "char") == 0)
+    *type = CDF_CHAR;
+  else if (strcmp(name, "short") == 0)
+    *type = CDF_SHORT;
+  else if (strcmp(name, "int") == 0 || strcmp(name, "long") == 0)
+    *type = CDF_INT;
+  else if (strcmp(name, "float") == 0 || strcmp(name, "real") == 0)
+    *type = CDF_FLOAT;
+  else if (strcmp(name, "double") == 0)
+    *type = CDF_DOUBLE;
+  else
+    return 0;
+  return 1;
+}
+
+/*
+ * Parse the values of an attribute up to the semicolon.
+ */
+static int parse_cdl_att(cdl_lexer_struct *lex, cdf_att_struct *att,
+                         const char *name, const char* *message)
+{
+  char *text = NULL;
+  char *grown_text;
+  double *values = NULL;
+  double *grown;
+  size_t text_len, length, capacity;
+  cdf_type type;
+  int first, status;
+  text_len = 0;
+  length = 0;
+  capacity = 0;
+  type = CDF_DOUBLE;
+  first = 1;
+  status = 1;
+  for (;;) {
+    next_cdl_token(lex);
+    if (lex->kind == CDL_STRING && (first || text)) {
+      grown_text = realloc(text, text_len + lex->str_len + 1);
+      if (!grown_text) {
+        *message = "Out of memory";
+        goto cleanup;
+      }
+      text = grown_text;
+      memcpy(text + text_len, lex->str, lex->str_len + 1);
+      text_len += lex->str_len;
+    } else if ((lex->kind == CDL_NUMBER || lex->kind == CDL_NAME)
+               && (first || values)) {
+      if (lex->kind == CDL_NAME) {
+        /* Special floating point values. */
+        if (strcmp(lex->str, "NaN") == 0 || strcmp(lex->str, "NaNf") == 0)
+          lex->number = NAN;
+        else if (strcmp(lex->str, "Infinity") == 0
+                 || strcmp(lex->str, "Infinityf") == 0)
+          lex->number = INFINITY;
+        else {
+          *message = "Invalid attribute value in template";
+          goto cleanup;
+        }
+        lex->number_type = (lex->str[lex->str_len - 1] == 'f')
+                         ? CDF_FLOAT : CDF_DOUBLE;
+      }
+      if (first)
+        type = lex->number_type;
+      if (length == capacity) {
+        capacity = capacity ? 2 * capacity : 8;
+        grown = realloc(values, capacity * sizeof(double));
+        if (!grown) {
+          *message = "Out of memory";
+          goto cleanup;
+        }
+        values = grown;
+      }
+      values[length++] = lex->number;
+    } else {
+      *message = "Invalid attribute value in template";
+      goto cleanup;
+    }
+    first = 0;
+    next_cdl_token(lex);
+    if (is_cdl_punct(lex, ';'))
+      break;
+    if (!is_cdl_punct(lex, ',')) {
+      *message = "Missing semicolon after attribute in template";
+      goto cleanup;
+    }
+  }
+  if (text)
+    status = set_cdf_att_text(att, name, text);
+  else
+    status = set_cdf_att_values(att, name, type, values, length);
+  if (status)
+    *message = "Out of memory";
+
+cleanup:
+  free(text);
+  free(values);
+  return status;
+}
+
+static int append_cdf_att(cdf_att_struct **atts, size_t *n,
+                          const cdf_att_struct *att)
+{
+  cdf_att_struct *grown;
+  grown = realloc(*atts, (*n + 1) * sizeof(**atts));
+  if (!grown)
+    return 1;
+  *atts = grown;
+  (*atts)[(*n)++] = *att;
+  return 0;
+}
+
+static long find_cdf_dim(const cdf_file_struct *file, const char *name)
+{
+  size_t i;
+  for (i = 0; i < file->num_dims; i++)
+    if (strcmp(file->dims[i].name, name) == 0)
+      return (long) i;
+  return -1;
+}
+
+static long find_cdf_var(const cdf_file_struct *file, const char *name)
+{
+  size_t i;
+  for (i = 0; i < file->num_vars; i++)
+    if (strcmp(file->vars[i].name, name) == 0)
+      return (long) i;
+  return -1;
+}
+
+static int parse_cdl_dims(cdl_lexer_struct *lex, cdf_file_struct *file,
+                          const char* *message)
+{
+  cdf_dim_struct *grown;
+  char *name;
+  for (;;) {
+    next_cdl_token(lex);
+    if (lex->kind != CDL_NAME)
+      break;
+    /* Next section keyword. */
+    if (strcmp(lex->str, "variables") == 0 || strcmp(lex->str, "data") == 0)
+      break;
+    name = copy_string(lex->str);
+    grown = realloc(file->dims, (file->num_dims + 1) * sizeof(*file->dims));
+    if (!name || !grown) {
+      free(name);
+      *message = "Out of memory";
+      return 1;
+    }
+    file->dims = grown;
+    file->dims[file->num_dims].name = name;
+    file->dims[file->num_dims].length = 0;
+    file->num_dims++;
+    if (!expect_cdl_punct(lex, '=')) {
+      *message = "Invalid dimension in template";
+      return 1;
+    }
+    next_cdl_token(lex);
+    if (lex->kind == CDL_NUMBER && lex->number >= 0) {
+      file->dims[file->num_dims - 1].length = (size_t) lex->number;
+    } else if (!(lex->kind == CDL_NAME
+                 && (strcmp(lex->str, "UNLIMITED") == 0
+                     || strcmp(lex->str, "unlimited") == 0))) {
+      *message = "Invalid dimension length in template";
+      return 1;
+    }
+    next_cdl_token(lex);
+    if (!is_cdl_punct(lex, ';') && !is_cdl_punct(lex, ',')) {
+      *message = "Missing semicolon after dimension in template";
+      return 1;
+    }
+  }
+  lex->pushed = 1;
+  return 0;
+}
+
+static int parse_cdl_var(cdl_lexer_struct *lex, cdf_file_struct *file,
+                         cdf_type type, const char* *message)
+{
+  cdf_var_struct *grown;
+  cdf_var_struct *var;
+  size_t *dims;
+  long dim;
+  for (;;) {
+    next_cdl_token(lex);
+    if (lex->kind != CDL_NAME) {
+      *message = "Invalid variable declaration in template";
+      return 1;
+    }
+    grown = realloc(file->vars, (file->num_vars + 1) * sizeof(*file->vars));
+    if (!grown) {
+      *message = "Out of memory";
+      return 1;
+    }
+    file->vars = grown;
+    var = &file->vars[file->num_vars++];
+    memset(var, 0, sizeof(*var));
+    var->type = type;
+    var->name = copy_string(lex->str);
+    if (!var->name) {
+      *message = "Out of memory";
+      return 1;
+    }
+    next_cdl_token(lex);
+    if (is_cdl_punct(lex, '(')) {
+      do {
+        next_cdl_token(lex);
+        dim = (lex->kind == CDL_NAME) ? find_cdf_dim(file, lex->str) : -1;
+        if (dim < 0) {
+          *message = "Unknown dimension of variable in template";
+          return 1;
+        }
+        dims = realloc(var->dims, (var->num_dims + 1) * sizeof(size_t));
+        if (!dims) {
+          *message = "Out of memory";
+          return 1;
+        }
+        var->dims = dims;
+        var->dims[var->num_dims++] = dim;
+        next_cdl_token(lex);
+      } while (is_cdl_punct(lex, ','));
+      if (!is_cdl_punct(lex, ')')) {
+        *message = "Invalid variable dimensions in template";
+        return 1;
+      }
+      next_cdl_token(lex);
+    }
+    if (is_cdl_punct(lex, ';'))
+      return 0;
+    if (!is_cdl_punct(lex, ',')) {
+      *message = "Missing semicolon after variable in template";
+      return 1;
+    }
+  }
+}
+
+int read_cdf_template(cdf_file_struct *file, const char *filename,
+                      const char* *message)
+{
+  FILE *f;
+  char *text = NULL;
+  long size;
+  cdl_lexer_struct lex;
+  cdf_att_struct att;
+  cdf_type type;
+  char *var_name = NULL;
+  long var;
+  int status = 1;
+
+  init_cdf_file(file);
+  memset(&lex, 0, sizeof(lex));
+  f = fopen(filename, "r");
+  if (!f) {
+    *message = "Could not open template";
+    return 1;
+  }
+  if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0
+      || fseek(f, 0, SEEK_SET) != 0
+      || !(text = malloc(size + 1))
+      || fread(text, 1, size, f) != (size_t) size) {
+    fclose(f);
+    free(text);
+    *message = "Could not read template";
+    return 1;
+  }
+  fclose(f);
+  text[size] = '\0';
+  lex.text = text;
+
+  next_cdl_token(&lex);
+  if (lex.kind != CDL_NAME || strcmp(lex.str, "netcdf") != 0
+      || next_cdl_token(&lex) != CDL_NAME || !expect_cdl_punct(&lex, '{')) {
+    *message = "Missing netcdf header in template";
+    goto cleanup;
+  }
+  for (;;) {
+    next_cdl_token(&lex);
+    if (is_cdl_punct(&lex, '}')) {
+      break;
+    } else if (lex.kind == CDL_NAME && strcmp(lex.str, "dimensions") == 0) {
+      if (!expect_cdl_punct(&lex, ':')
+          || parse_cdl_dims(&lex, file, message)) {
+        if (!is_cdl_punct(&lex, ':') && lex.kind != CDL_NAME)
+          *message = "Invalid dimensions section in template";
+        goto cleanup;
+      }
+    } else if (lex.kind == CDL_NAME && strcmp(lex.str, "variables") == 0) {
+      if (!expect_cdl_punct(&lex, ':')) {
+        *message = "Invalid variables section in template";
+        goto cleanup;
+      }
+    } else if (lex.kind == CDL_NAME && strcmp(lex.str, "data") == 0) {
+      /* The data section is not needed, skip it. */
+      while (next_cdl_token(&lex) != CDL_END && lex.kind != CDL_ERROR
+             && !is_cdl_punct(&lex, '}'))
+        ;
+      break;
+    } else if (is_cdl_punct(&lex, ':')) {
+      /* Global attribute. */
+      if (next_cdl_token(&lex) != CDL_NAME) {
+        *message = "Invalid global attribute in template";
+        goto cleanup;
+      }
+      var_name = copy_string(lex.str);
+      if (!var_name || !expect_cdl_punct(&lex, '=')
+          || parse_cdl_att(&lex, &att, var_name, message)) {
+        if (var_name && !is_cdl_punct(&lex, '='))
+          *message = "Invalid global attribute in template";
+        goto cleanup;
+      }
+      free(var_name);
+      var_name = NULL;
+      if (append_cdf_att(&file->atts, &file->num_atts, &att)) {
+        free_cdf_att(&att);
+        *message = "Out of memory";
+        goto cleanup;
+      }
+    } else if (lex.kind == CDL_NAME && parse_cdl_type(lex.str, &type)) {
+      if (parse_cdl_var(&lex, file, type, message))
+        goto cleanup;
+    } else if (lex.kind == CDL_NAME) {
+      /* Variable attribute. */
+      var = find_cdf_var(file, lex.str);
+      if (var < 0 || !expect_cdl_punct(&lex, ':')
+          || next_cdl_token(&lex) != CDL_NAME) {
+        *message = "Invalid variable attribute in template";
+        goto cleanup;
+      }
+      var_name = copy_string(lex.str);
+      if (!var_name || !expect_cdl_punct(&lex, '=')
+          || parse_cdl_att(&lex, &att, var_name, message)) {
+        if (var_name && !is_cdl_punct(&lex, '='))
+          *message = "Invalid variable attribute in template";
+        goto cleanup;
+      }
+      free(var_name);
+      var_name = NULL;
+      if (append_cdf_att(&file->vars[var].atts, &file->vars[var].num_atts,
+                         &att)) {
+        free_cdf_att(&att);
+        *message = "Out of memory";
+        goto cleanup;
+      }
+    } else {
+      *message = "Syntax error in template";
+      goto cleanup;
+    }
+  }
+  status = 0;
+
+cleanup:
+  if (status)
+    free_cdf_file(file);
+  free(var_name);
+  free(lex.str);
+  free(text);
+  return status;
+}
+
+
+/*
+ * Writer of the classic format. All the values are big endian.
+ */
+
+typedef struct cdf_buffer_struct {
+  unsigned char *data;
+  size_t length;
+  size_t capacity;
+  int failed;
+} cdf_buffer_struct;
+
+static void put_cdf_bytes(cdf_buffer_struct *buf, const void *src, size_t n)
+{
+  unsigned char *grown;
+  size_t capacity;
+  if (buf->failed)
+    return;
+  if (buf->length + n > buf->capacity) {
+    capacity = buf->capacity ? buf->capacity : 4096;
+    while (buf->length + n > capacity)
+      capacity *= 2;
+    grown = realloc(buf->data, capacity);
+    if (!grown) {
+      buf->failed = 1;
+      return;
+    }
+    buf->data = grown;
+    buf->capacity = capacity;
+  }
+  memcpy(buf->data + buf->length, src, n);
+  buf->length += n;
+}
+
+static void put_cdf_uint(cdf_buffer_struct *buf, unsigned long long value,
+                         int size)
+{
+  unsigned char bytes[8];
+  int k;
+  for (k = 0; k < size; k++)
+    bytes[k] = (unsigned char) (value >> (8 * (size - 1 - k)));
+  put_cdf_bytes(buf, bytes, size);
+}
+
+static void put_cdf_padding(cdf_buffer_struct *buf, size_t n)
+{
+  static const unsigned char zeros[4] = {0, 0, 0, 0};
+  put_cdf_bytes(buf, zeros, pad4(n) - n);
+}
+
+static void put_cdf_name(cdf_buffer_struct *buf, const char *name)
+{
+  size_t n;
+  n = strlen(name);
+  put_cdf_uint(buf, n, 4);
+  put_cdf_bytes(buf, name, n);
+  put_cdf_padding(buf, n);
+}
+
+/*
+ * Convert a double to the external representation of a type,
+ * rounding and saturating integers and mapping NaN to zero as MATLAB does.
+ */
+static void put_cdf_value(cdf_buffer_struct *buf, cdf_type type, double value)
+{
+  union { float f; unsigned int u; } f32;
+  union { double d; unsigned long long u; } f64;
+  double lo, hi;
+  long long i;
+  switch (type) {
+    case CDF_FLOAT:
+      f32.f = (float) value;
+      put_cdf_uint(buf, f32.u, 4);
+      return;
+    case CDF_DOUBLE:
+      f64.d = value;
+      put_cdf_uint(buf, f64.u, 8);
+      return;
+    case CDF_CHAR:
+      lo = 0;
+      hi = 255;
+      break;
+    case CDF_BYTE:
+      lo = -128;
+      hi = 127;
+      break;
+    case CDF_SHORT:
+      lo = -32768;
+      hi = 32767;
+      break;
+    default:
+      lo = -2147483648.0;
+      hi = 2147483647.0;
+      break;
+  }
+  value = isnan(value) ? 0 : round(value);
+  value = (value < lo) ? lo : (value > hi) ? hi : value;
+  i = (long long) value;
+  put_cdf_uint(buf, (unsigned long long) i, cdf_type_size(type));
+}
+
+static void put_cdf_atts(cdf_buffer_struct *buf,
+                         const cdf_att_struct *atts, size_t n)
+{
+  size_t i, j, size;
+  if (n == 0) {
+    put_cdf_uint(buf, 0, 4);
+    put_cdf_uint(buf, 0, 4);
+    return;
+  }
+  put_cdf_uint(buf, CDF_NC_ATTRIBUTE, 4);
+  put_cdf_uint(buf, n, 4);
+  for (i = 0; i < n; i++) {
+    put_cdf_name(buf, atts[i].name);
+    put_cdf_uint(buf, atts[i].type, 4);
+    put_cdf_uint(buf, atts[i].length, 4);
+    if (atts[i].type == CDF_CHAR)
+      put_cdf_bytes(buf, atts[i].text, atts[i].length);
+    else
+      for (j = 0; j < atts[i].length; j++)
+        put_cdf_value(buf, atts[i].type, atts[i].values[j]);
+    size = atts[i].length * cdf_type_size(atts[i].type);
+    put_cdf_padding(buf, size);
+  }
+}
+
+static int is_cdf_record_var(const cdf_file_struct *file,
+                             const cdf_var_struct *var)
+{
+  return var->num_dims > 0 && file->dims[var->dims[0]].length == 0;
+}
+
+/* Number of values of a variable in each record (or in total if fixed). */
+static size_t cdf_var_values(const cdf_file_struct *file,
+                             const cdf_var_struct *var)
+{
+  size_t k, n;
+  n = 1;
+  for (k = is_cdf_record_var(file, var) ? 1 : 0; k < var->num_dims; k++)
+    n *= file->dims[var->dims[k]].length;
+  return n;
+}
+
+static void put_cdf_header(cdf_buffer_struct *buf, const cdf_file_struct *file,
+                           int version, const unsigned long long *begins)
+{
+  size_t i, k;
+  const cdf_var_struct *var;
+  put_cdf_bytes(buf, "CDF", 3);
+  put_cdf_uint(buf, version, 1);
+  put_cdf_uint(buf, file->num_recs, 4);
+  if (file->num_dims == 0) {
+    put_cdf_uint(buf, 0, 4);
+    put_cdf_uint(buf, 0, 4);
+  } else {
+    put_cdf_uint(buf, CDF_NC_DIMENSION, 4);
+    put_cdf_uint(buf, file->num_dims, 4);
+    for (i = 0; i < file->num_dims; i++) {
+      put_cdf_name(buf, file->dims[i].name);
+      put_cdf_uint(buf, file->dims[i].length, 4);
+    }
+  }
+  put_cdf_atts(buf, file->atts, file->num_atts);
+  if (file->num_vars == 0) {
+    put_cdf_uint(buf, 0, 4);
+    put_cdf_uint(buf, 0, 4);
+  } else {
+    put_cdf_uint(buf, CDF_NC_VARIABLE, 4);
+    put_cdf_uint(buf, file->num_vars, 4);
+    for (i = 0; i < file->num_vars; i++) {
+      var = &file->vars[i];
+      put_cdf_name(buf, var->name);
+      put_cdf_uint(buf, var->num_dims, 4);
+      for (k = 0; k < var->num_dims; k++)
+        put_cdf_uint(buf, var->dims[k], 4);
+      put_cdf_atts(buf, var->atts, var->num_atts);
+      put_cdf_uint(buf, var->type, 4);
+      put_cdf_uint(buf, pad4(cdf_var_values(file, var)
+                             * cdf_type_size(var->type)), 4);
+      put_cdf_uint(buf, begins[i], (version == 1) ? 4 : 8);
+    }
+  }
+}
+
+/*
+ * Compute the offsets of the variables after a header of the given length:
+ * fixed size variables first, then the records with a slab of each record
+ * variable. The record size is not padded if there is one record variable.
+ */
+static unsigned long long layout_cdf_file(const cdf_file_struct *file,
+                                          size_t header_length,
+                                          unsigned long long *begins,
+                                          size_t *record_size)
+{
+  unsigned long long offset, record_start;
+  size_t i, num_record_vars, vsize;
+  offset = header_length;
+  num_record_vars = 0;
+  for (i = 0; i < file->num_vars; i++) {
+    if (is_cdf_record_var(file, &file->vars[i])) {
+      num_record_vars++;
+      continue;
+    }
+    begins[i] = offset;
+    offset += pad4(cdf_var_values(file, &file->vars[i])
+                   * cdf_type_size(file->vars[i].type));
+  }
+  record_start = offset;
+  *record_size = 0;
+  for (i = 0; i < file->num_vars; i++) {
+    if (!is_cdf_record_var(file, &file->vars[i]))
+      continue;
+    vsize = cdf_var_values(file, &file->vars[i])
+          * cdf_type_size(file->vars[i].type);
+    begins[i] = record_start + *record_size;
+    *record_size += (num_record_vars == 1) ? vsize : pad4(vsize);
+  }
+  return record_start;
+}
+
+static int flush_cdf_buffer(cdf_buffer_struct *buf, FILE *f)
+{
+  int failed;
+  failed = buf->failed
+           || fwrite(buf->data, 1, buf->length, f) != buf->length;
+  buf->length = 0;
+  return failed;
+}
+
+int write_cdf_file(const cdf_file_struct *file, const char *filename,
+                   const char* *message)
+{
+  cdf_buffer_struct buf;
+  unsigned long long *begins = NULL;
+  unsigned long long record_start, last;
+  size_t header_length, record_size, num_record_vars, i, r, k, n;
+  const cdf_var_struct *var;
+  int version, status = 1;
+  FILE *f = NULL;
+
+  memset(&buf, 0, sizeof(buf));
+  begins = calloc(file->num_vars + 1, sizeof(*begins));
+  if (!begins) {
+    *message = "Out of memory";
+    return 1;
+  }
+  num_record_vars = 0;
+  for (i = 0; i < file->num_vars; i++)
+    num_record_vars += is_cdf_record_var(file, &file->vars[i]);
+
+  /* Use the classic format unless the offsets do not fit in 32 bits. */
+  for (version = 1; version <= 2; version++) {
+    buf.length = 0;
+    put_cdf_header(&buf, file, version, begins);
+    header_length = buf.length;
+    record_start = layout_cdf_file(file, header_length, begins, &record_size);
+    last = record_start;
+    for (i = 0; i < file->num_vars; i++)
+      if (begins[i] > last)
+        last = begins[i];
+    if (last <= CDF_MAX_OFFSET_32)
+      break;
+  }
+  if (version > 2)
+    version = 2;
+  buf.length = 0;
+  put_cdf_header(&buf, file, version, begins);
+  if (buf.failed) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+
+  f = fopen(filename, "wb");
+  if (!f) {
+    *message = "Could not create file";
+    goto cleanup;
+  }
+  if (flush_cdf_buffer(&buf, f))
+    goto write_error;
+
+  /* Fixed size variables. */
+  for (i = 0; i < file->num_vars; i++) {
+    var = &file->vars[i];
+    if (is_cdf_record_var(file, var))
+      continue;
+    n = cdf_var_values(file, var);
+    for (k = 0; k < n; k++) {
+      put_cdf_value(&buf, var->type, var->data ? var->data[k] : NAN);
+      if (buf.length >= CDF_CHUNK_BYTES && flush_cdf_buffer(&buf, f))
+        goto write_error;
+    }
+    put_cdf_padding(&buf, n * cdf_type_size(var->type));
+  }
+
+  /* Records, with a slab of each record variable. */
+  for (r = 0; r < file->num_recs; r++) {
+    for (i = 0; i < file->num_vars; i++) {
+      var = &file->vars[i];
+      if (!is_cdf_record_var(file, var))
+        continue;
+      n = cdf_var_values(file, var);
+      for (k = 0; k < n; k++)
+        put_cdf_value(&buf, var->type,
+                      var->data ? var->data[r * n + k] : NAN);
+      if (num_record_vars > 1)
+        put_cdf_padding(&buf, n * cdf_type_size(var->type));
+      if (buf.length >= CDF_CHUNK_BYTES && flush_cdf_buffer(&buf, f))
+        goto write_error;
+    }
+  }
+  if (flush_cdf_buffer(&buf, f))
+    goto write_error;
+  if (fclose(f) != 0) {
+    f = NULL;
+    goto write_error;
+  }
+  f = NULL;
+  status = 0;
+  goto cleanup;
+
+write_error:
+  *message = buf.failed ? "Out of memory" : "Could not write file";
+  if (f)
+    fclose(f);
+  f = NULL;
+  remove(filename);
+
+cleanup:
+  free(buf.data);
+  free(begins);
+  return status;
+}
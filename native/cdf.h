@@ -0,0 +1,109 @@
+/**
+ * @file
+ * @brief Native writer of NetCDF classic files and reader of CDL templates.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file declares the functions to describe and write NetCDF files
+ * in the classic format without the NetCDF library:
+ *   - read_cdf_template parses the header of a CDL file (the text format
+ *     of the ncgen and ncdump utilities, see WRITENETCDFTEMPLATE) with the
+ *     dimensions, variables and attributes of the file, without data.
+ *   - write_cdf_file writes a file with the data of its variables, in the
+ *     classic format, or in the 64-bit offset format if it is too large.
+ * Dimensions of length zero are unlimited (record dimensions). Numeric
+ * attribute values and variable data are given as doubles and converted to
+ * the type of the attribute or the variable when writing.
+ *
+ * The format specification may be found here:
+ *   <http://www.unidata.ucar.edu/software/netcdf/docs/file_format_specifications.html>
+ */
+
+#ifndef CDF_H
+#define CDF_H
+
+#include <stddef.h>
+
+
+typedef enum {
+  CDF_BYTE = 1,
+  CDF_CHAR = 2,
+  CDF_SHORT = 3,
+  CDF_INT = 4,
+  CDF_FLOAT = 5,
+  CDF_DOUBLE = 6
+} cdf_type;
+
+typedef struct cdf_dim_struct {
+  char *name;
+  size_t length;            /**< Zero for the unlimited dimension. */
+} cdf_dim_struct;
+
+typedef struct cdf_att_struct {
+  char *name;
+  cdf_type type;
+  size_t length;
+  char *text;               /**< Value of CDF_CHAR attributes. */
+  double *values;           /**< Values of numeric attributes. */
+} cdf_att_struct;
+
+typedef struct cdf_var_struct {
+  char *name;
+  cdf_type type;
+  size_t num_dims;
+  size_t *dims;             /**< Indices of the dimensions. */
+  size_t num_atts;
+  cdf_att_struct *atts;
+  const double *data;       /**< Data in C order, not owned by the variable. */
+} cdf_var_struct;
+
+typedef struct cdf_file_struct {
+  size_t num_dims;
+  cdf_dim_struct *dims;
+  size_t num_atts;
+  cdf_att_struct *atts;
+  size_t num_vars;
+  cdf_var_struct *vars;
+  size_t num_recs;          /**< Length of the unlimited dimension. */
+} cdf_file_struct;
+
+
+void init_cdf_file(cdf_file_struct *file);
+
+void free_cdf_file(cdf_file_struct *file);
+
+void free_cdf_att(cdf_att_struct *att);
+
+int copy_cdf_att(cdf_att_struct *dst, const cdf_att_struct *src);
+
+int set_cdf_att_text(cdf_att_struct *att, const char *name, const char *text);
+
+int set_cdf_att_values(cdf_att_struct *att, const char *name, cdf_type type,
+                       const double *values, size_t length);
+
+const cdf_att_struct * find_cdf_att(const cdf_att_struct *atts, size_t n,
+                                    const char *name);
+
+int read_cdf_template(cdf_file_struct *file, const char *filename,
+                      const char* *message);
+
+int write_cdf_file(const cdf_file_struct *file, const char *filename,
+                   const char* *message);
+
+#endif /* CDF_H */
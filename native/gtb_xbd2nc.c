@@ -0,0 +1,903 @@
+/**
+ * @file
+ * @brief Generate a raw NetCDF file from Slocum binary files without MATLAB.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Usage:
+ *   gtb_xbd2nc -t TEMPLATE -o OUTPUT [-c CACHE] [-s SENSORS]
+ *              [-d DEPLOYMENTS [-i ID]] FILE...
+ *
+ * This program is the native counterpart of the first stages of the real time
+ * processing of Slocum gliders in MAIN_GLIDER_DATA_PROCESSING_RT: it loads the
+ * given binary files (xxx.[smdtne]bd) like LOADSLOCUMDATA and writes the L0
+ * NetCDF file like GENERATEOUTPUTNETCDF, without a MATLAB runtime.
+ *
+ * It covers only that L0 path, it is not a native version of the whole chain:
+ *   - Preprocessing, L1 processing, L2 gridding, figures and publishing are
+ *     not implemented here, and still need MATLAB, Octave or the standalone
+ *     executables built by SETUPSTANDALONE on the MATLAB Runtime.
+ *   - It does not read the toolbox configuration. The CDL template must be
+ *     generated beforehand from the L0 output configuration with
+ *     WRITENETCDFTEMPLATE in MATLAB or Octave, and regenerated when that
+ *     configuration changes.
+ *   - The binary file reader (xbd.c) and the NetCDF writer (cdf.c) are new
+ *     implementations, they do not share code with the mex files or with the
+ *     NetCDF library used by the MATLAB chain.
+ *
+ * Options:
+ *   -t TEMPLATE     CDL file describing the output file (dimensions, global
+ *                   attributes and variables with their attributes), as
+ *                   written by WRITENETCDFTEMPLATE from the output config.
+ *   -o OUTPUT       name of the NetCDF file to generate.
+ *   -c CACHE        directory of the sensor list cache files (default '.').
+ *   -s SENSORS      file with the names of the sensors to load, one per line
+ *                   (default the variables in the template).
+ *   -d DEPLOYMENTS  deployment file in the format of deploymentRT.txt.
+ *                   Its fields overwrite the global attributes with the same
+ *                   name, and its start and end dates set the loading period.
+ *   -i ID           identifier of the deployment to use from that file
+ *                   (required if it defines more than one deployment).
+ *
+ * Navigation files ([smd]bd) and science files ([tne]bd) are distinguished
+ * by the filename extension in their headers. Files that can not be loaded are
+ * reported and skipped, as in LOADSLOCUMDATA. The exit status is 0 on success
+ * (even if there is no data to write), 1 on failure and 2 on invalid usage.
+ *
+ * Build it with 'make native' from the toolbox root directory.
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "xbd.h"
+#include "cdf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define TIME_SENSOR_NAV "m_present_time"
+#define TIME_SENSOR_SCI "sci_m_present_time"
+#define LINE_LENGTH 4096
+
+
+typedef struct deployment_field_struct {
+  char *name;
+  char *text;
+  int numeric;
+  double value;
+} deployment_field_struct;
+
+typedef struct deployment_struct {
+  size_t num_fields;
+  deployment_field_struct *fields;
+} deployment_struct;
+
+
+static const char *usage =
+  "usage: gtb_xbd2nc -t TEMPLATE -o OUTPUT [-c CACHE] [-s SENSORS]\n"
+  "                  [-d DEPLOYMENTS [-i ID]] FILE...\n";
+
+
+static char * copy_string(const char *str)
+{
+  char *copy;
+  copy = malloc(strlen(str) + 1);
+  if (copy)
+    strcpy(copy, str);
+  return copy;
+}
+
+static char * trim_string(char *str)
+{
+  size_t n;
+  while (isspace((unsigned char) *str))
+    str++;
+  n = strlen(str);
+  while (n > 0 && isspace((unsigned char) str[n - 1]))
+    str[--n] = '\0';
+  return str;
+}
+
+static int compare_strings(const void *a, const void *b)
+{
+  return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/*
+ * Read the sensor names in a file, one per line, ignoring blank lines.
+ */
+static int read_sensor_file(char ***sensors, size_t *n, const char *filename)
+{
+  FILE *f;
+  char line[LINE_LENGTH];
+  char *name;
+  char **grown;
+  f = fopen(filename, "r");
+  if (!f)
+    return 1;
+  while (fgets(line, sizeof(line), f)) {
+    name = trim_string(line);
+    if (!*name)
+      continue;
+    grown = realloc(*sensors, (*n + 1) * sizeof(char *));
+    if (!grown || !(grown[*n] = copy_string(name))) {
+      if (grown)
+        *sensors = grown;
+      fclose(f);
+      return 1;
+    }
+    *sensors = grown;
+    (*n)++;
+  }
+  fclose(f);
+  return 0;
+}
+
+
+static void free_deployment(deployment_struct *deployment)
+{
+  size_t i;
+  for (i = 0; i < deployment->num_fields; i++) {
+    free(deployment->fields[i].name);
+    free(deployment->fields[i].text);
+  }
+  free(deployment->fields);
+  deployment->fields = NULL;
+  deployment->num_fields = 0;
+}
+
+static const deployment_field_struct *
+find_deployment_field(const deployment_struct *deployment, const char *name)
+{
+  size_t i;
+  for (i = 0; i < deployment->num_fields; i++)
+    if (strcmp(deployment->fields[i].name, name) == 0)
+      return &deployment->fields[i];
+  return NULL;
+}
+
+/*
+ * Read the fields of a deployment from a deployment file, with the syntax
+ * accepted by READCONFIGFILE (lines 'deployment_list(N).field = value').
+ * Like the processing script, the identifier and the dates are numbers
+ * and the remaining fields are strings. Array values are ignored.
+ */
+static int read_deployment_file(deployment_struct *deployment,
+                                const char *filename, const char *id,
+                                const char* *message)
+{
+  FILE *f;
+  char line[LINE_LENGTH];
+  char *key, *value, *equal, *field, *end;
+  long index, selected, count, *indices = NULL;
+  size_t num_entries, i;
+  deployment_field_struct *entries = NULL;
+  deployment_field_struct *grown;
+  long *grown_indices;
+  int status = 1;
+
+  deployment->num_fields = 0;
+  deployment->fields = NULL;
+  num_entries = 0;
+  f = fopen(filename, "r");
+  if (!f) {
+    *message = "Could not open deployment file";
+    return 1;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    key = trim_string(line);
+    if (!*key || *key == '#' || *key == ';')
+      continue;
+    equal = strchr(key, '=');
+    if (!equal)
+      continue;
+    *equal = '\0';
+    value = equal + 1;
+    while (*value == '=')
+      value++;
+    if ((equal = strchr(value, '=')))
+      *equal = '\0';
+    value = trim_string(value);
+    key = trim_string(key);
+    for (end = key; *end; end++)
+      *end = tolower((unsigned char) *end);
+    if (strncmp(key, "deployment_list(", 16) != 0
+        || (index = strtol(key + 16, &end, 10)) <= 0
+        || strncmp(end, ").", 2) != 0 || !*(field = end + 2)
+        || strchr(value, '|'))
+      continue;
+    grown = realloc(entries, (num_entries + 1) * sizeof(*entries));
+    grown_indices = realloc(indices, (num_entries + 1) * sizeof(long));
+    if (grown)
+      entries = grown;
+    if (grown_indices)
+      indices = grown_indices;
+    if (!grown || !grown_indices) {
+      *message = "Out of memory";
+      goto cleanup;
+    }
+    entries[num_entries].name = copy_string(field);
+    entries[num_entries].text = copy_string(value);
+    entries[num_entries].numeric = strcmp(field, "deployment_id") == 0
+                                   || strcmp(field, "deployment_start") == 0
+                                   || strcmp(field, "deployment_end") == 0;
+    entries[num_entries].value = strtod(value, NULL);
+    indices[num_entries] = index;
+    num_entries++;
+    if (!entries[num_entries - 1].name || !entries[num_entries - 1].text) {
+      *message = "Out of memory";
+      goto cleanup;
+    }
+  }
+
+  /* Select the deployment by identifier, or the only one in the file. */
+  selected = -1;
+  count = 0;
+  for (i = 0; i < num_entries; i++) {
+    if (strcmp(entries[i].name, "deployment_id") != 0)
+      continue;
+    count++;
+    if (!id || entries[i].value == strtod(id, NULL))
+      selected = indices[i];
+  }
+  if (selected < 0 || (!id && count > 1)) {
+    *message = id ? "Deployment not found in deployment file"
+                  : "Deployment id required by deployment file";
+    goto cleanup;
+  }
+  deployment->fields = malloc((num_entries + 1) * sizeof(*entries));
+  if (!deployment->fields) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  for (i = 0; i < num_entries; i++) {
+    if (indices[i] != selected)
+      continue;
+    deployment->fields[deployment->num_fields++] = entries[i];
+    entries[i].name = NULL;
+    entries[i].text = NULL;
+  }
+  status = 0;
+
+cleanup:
+  for (i = 0; i < num_entries; i++) {
+    free(entries[i].name);
+    free(entries[i].text);
+  }
+  free(entries);
+  free(indices);
+  fclose(f);
+  if (status)
+    free_deployment(deployment);
+  return status;
+}
+
+
+/*
+ * Format a POSIX time like DATESTR with format 'yyyy-mm-ddTHH:MM:SS+00:00'.
+ */
+static void format_time(char *str, size_t size, double t)
+{
+  time_t secs;
+  struct tm utc;
+  secs = (time_t) floor(round(t * 1000.0) / 1000.0);
+  gmtime_r(&secs, &utc);
+  strftime(str, size, "%Y-%m-%dT%H:%M:%S+00:00", &utc);
+}
+
+/*
+ * Minimum and maximum of the valid values of a column (NaN if none).
+ */
+static void column_range(const xbd_data_struct *data, long col, double scale,
+                         double (*convert)(double), double *min, double *max)
+{
+  size_t i;
+  double v;
+  *min = NAN;
+  *max = NAN;
+  for (i = 0; i < data->num_rows; i++) {
+    v = data->values[col * data->num_rows + i];
+    if (convert)
+      v = convert(v);
+    v *= scale;
+    if (isnan(v))
+      continue;
+    if (isnan(*min) || v < *min)
+      *min = v;
+    if (isnan(*max) || v > *max)
+      *max = v;
+  }
+}
+
+static double nmea2deg(double nmea)
+{
+  return trunc(nmea / 100) + fmod(nmea, 100) / 60;
+}
+
+static long find_cdf_var_index(const cdf_file_struct *file, const char *name)
+{
+  size_t i;
+  for (i = 0; i < file->num_vars; i++)
+    if (strcmp(file->vars[i].name, name) == 0)
+      return (long) i;
+  return -1;
+}
+
+/* Column of a sensor present in the data and described in the template. */
+static long find_output_sensor(const xbd_data_struct *data,
+                               const cdf_file_struct *tmpl, const char *name)
+{
+  return (find_cdf_var_index(tmpl, name) < 0) ? -1
+                                              : find_xbd_sensor(data, name);
+}
+
+static int append_att(cdf_att_struct **atts, size_t *n, cdf_att_struct *att)
+{
+  cdf_att_struct *grown;
+  grown = realloc(*atts, (*n + 1) * sizeof(**atts));
+  if (!grown) {
+    free_cdf_att(att);
+    return 1;
+  }
+  *atts = grown;
+  (*atts)[(*n)++] = *att;
+  return 0;
+}
+
+static int add_text_att(cdf_att_struct **atts, size_t *n,
+                        const char *name, const char *text)
+{
+  cdf_att_struct att;
+  return set_cdf_att_text(&att, name, text) || append_att(atts, n, &att);
+}
+
+static int add_value_att(cdf_att_struct **atts, size_t *n,
+                         const char *name, double value)
+{
+  cdf_att_struct att;
+  return set_cdf_att_values(&att, name, CDF_DOUBLE, &value, 1)
+         || append_att(atts, n, &att);
+}
+
+static const char * find_att_text(const cdf_att_struct *atts, size_t n,
+                                  const char *name)
+{
+  const cdf_att_struct *att;
+  att = find_cdf_att(atts, n, name);
+  return (att && att->type == CDF_CHAR && att->length > 0) ? att->text : NULL;
+}
+
+/*
+ * Compute the dynamic global attributes like GENERATEOUTPUTNETCDF with the
+ * options used for Slocum gliders in the real time processing.
+ */
+static int make_dynamic_atts(cdf_att_struct **atts, size_t *n,
+                             const xbd_data_struct *data,
+                             const cdf_file_struct *tmpl)
+{
+  static const char *time_sensors[] = {"m_present_time", "sci_m_present_time"};
+  static const char *position_sensors[][2] = {{"m_gps_lon", "m_gps_lat"},
+                                              {"m_lon", "m_lat"}};
+  char str[64];
+  double min, max, lat_min, lat_max;
+  const cdf_var_struct *var;
+  const char *text;
+  long col, lat_col;
+  size_t k;
+  int failed = 0;
+
+  format_time(str, sizeof(str), (double) time(NULL));
+  failed |= add_text_att(atts, n, "date_modified", str);
+  failed |= add_text_att(atts, n, "date_update", str);
+
+  for (k = 0; k < 2; k++) {
+    if ((col = find_output_sensor(data, tmpl, time_sensors[k])) < 0)
+      continue;
+    column_range(data, col, 1, NULL, &min, &max);
+    if (!isnan(min)) {
+      format_time(str, sizeof(str), min);
+      failed |= add_text_att(atts, n, "time_coverage_start", str);
+      format_time(str, sizeof(str), max);
+      failed |= add_text_att(atts, n, "time_coverage_end", str);
+    }
+    break;
+  }
+
+  for (k = 0; k < 2; k++) {
+    col = find_output_sensor(data, tmpl, position_sensors[k][0]);
+    lat_col = find_output_sensor(data, tmpl, position_sensors[k][1]);
+    if (col < 0 || lat_col < 0)
+      continue;
+    column_range(data, col, 1, nmea2deg, &min, &max);
+    column_range(data, lat_col, 1, nmea2deg, &lat_min, &lat_max);
+    failed |= add_value_att(atts, n, "geospatial_lon_min", min);
+    failed |= add_value_att(atts, n, "geospatial_lon_max", max);
+    failed |= add_value_att(atts, n, "geospatial_lat_min", lat_min);
+    failed |= add_value_att(atts, n, "geospatial_lat_max", lat_max);
+    failed |= add_text_att(atts, n, "geospatial_lon_units", "degree_east");
+    failed |= add_text_att(atts, n, "geospatial_lat_units", "degree_north");
+    break;
+  }
+
+  if ((col = find_output_sensor(data, tmpl, "m_depth")) >= 0) {
+    var = &tmpl->vars[find_cdf_var_index(tmpl, "m_depth")];
+    column_range(data, col, 1, NULL, &min, &max);
+    failed |= add_value_att(atts, n, "geospatial_vertical_min", min);
+    failed |= add_value_att(atts, n, "geospatial_vertical_max", max);
+    if ((text = find_att_text(var->atts, var->num_atts, "units")))
+      failed |= add_text_att(atts, n, "geospatial_vertical_units", text);
+    if ((text = find_att_text(var->atts, var->num_atts, "positive")))
+      failed |= add_text_att(atts, n, "geospatial_vertical_positive", text);
+  } else if ((col = find_output_sensor(data, tmpl,
+                                       "sci_water_pressure")) >= 0) {
+    column_range(data, col, 10, NULL, &min, &max);
+    failed |= add_value_att(atts, n, "geospatial_vertical_min", min);
+    failed |= add_value_att(atts, n, "geospatial_vertical_max", max);
+    failed |= add_text_att(atts, n, "geospatial_vertical_units", "meters");
+    failed |= add_text_att(atts, n, "geospatial_vertical_positive", "down");
+  }
+  return failed;
+}
+
+
+/*
+ * Build the output file from the template and the data: global attributes
+ * overwritten by deployment fields or dynamic attributes, and the variables
+ * in the template with data, without the attributes with empty values,
+ * with their values packed and invalid values replaced by the fill value.
+ */
+static int make_output_file(cdf_file_struct *file, double ***buffers,
+                            const cdf_file_struct *tmpl,
+                            const xbd_data_struct *data,
+                            const deployment_struct *deployment,
+                            const char* *message)
+{
+  cdf_att_struct *dyn_atts = NULL;
+  size_t num_dyn_atts, i, j, k, num_names;
+  const cdf_att_struct *source;
+  const deployment_field_struct *field;
+  cdf_att_struct att;
+  const cdf_var_struct *tvar;
+  cdf_var_struct *var;
+  const cdf_att_struct *fill, *offset, *scale;
+  char **names = NULL;
+  double *values;
+  long col;
+  int failed;
+
+  init_cdf_file(file);
+  *buffers = NULL;
+  num_dyn_atts = 0;
+  failed = make_dynamic_atts(&dyn_atts, &num_dyn_atts, data, tmpl);
+
+  /* Dimensions. */
+  file->dims = calloc(tmpl->num_dims + 1, sizeof(*file->dims));
+  failed |= !file->dims;
+  for (i = 0; !failed && i < tmpl->num_dims; i++) {
+    file->dims[i].length = tmpl->dims[i].length;
+    failed |= !(file->dims[i].name = copy_string(tmpl->dims[i].name));
+    file->num_dims++;
+  }
+  file->num_recs = data->num_rows;
+
+  /* Global attributes. */
+  file->atts = calloc(tmpl->num_atts + 1, sizeof(*file->atts));
+  failed |= !file->atts;
+  for (i = 0; !failed && i < tmpl->num_atts; i++) {
+    field = deployment
+          ? find_deployment_field(deployment, tmpl->atts[i].name) : NULL;
+    source = find_cdf_att(dyn_atts, num_dyn_atts, tmpl->atts[i].name);
+    if (field && field->numeric)
+      failed |= set_cdf_att_values(&att, field->name, CDF_DOUBLE,
+                                   &field->value, 1);
+    else if (field)
+      failed |= set_cdf_att_text(&att, field->name, field->text);
+    else
+      failed |= copy_cdf_att(&att, source ? source : &tmpl->atts[i]);
+    if (!failed)
+      file->atts[file->num_atts++] = att;
+  }
+
+  /* Variables in the template with data, sorted by name. */
+  names = malloc((tmpl->num_vars + 1) * sizeof(char *));
+  file->vars = calloc(tmpl->num_vars + 1, sizeof(*file->vars));
+  *buffers = calloc(tmpl->num_vars + 1, sizeof(double *));
+  failed |= !names || !file->vars || !*buffers;
+  num_names = 0;
+  for (i = 0; !failed && i < tmpl->num_vars; i++)
+    if (find_xbd_sensor(data, tmpl->vars[i].name) >= 0)
+      names[num_names++] = tmpl->vars[i].name;
+  if (!failed)
+    qsort(names, num_names, sizeof(char *), compare_strings);
+  for (k = 0; !failed && k < num_names; k++) {
+    tvar = &tmpl->vars[find_cdf_var_index(tmpl, names[k])];
+    if (tvar->num_dims != 1
+        || (tmpl->dims[tvar->dims[0]].length != 0
+            && tmpl->dims[tvar->dims[0]].length != data->num_rows)) {
+      fprintf(stderr, "Skipping variable %s: dimensions do not match data.\n",
+              tvar->name);
+      continue;
+    }
+    var = &file->vars[file->num_vars];
+    var->type = tvar->type;
+    var->num_dims = 1;
+    var->dims = malloc(sizeof(size_t));
+    var->atts = calloc(tvar->num_atts + 1, sizeof(*var->atts));
+    var->name = copy_string(tvar->name);
+    file->num_vars++;
+    if (!var->dims || !var->atts || !var->name) {
+      failed = 1;
+      break;
+    }
+    var->dims[0] = tvar->dims[0];
+    for (j = 0; !failed && j < tvar->num_atts; j++) {
+      if (tvar->atts[j].length == 0)
+        continue;
+      failed |= copy_cdf_att(&var->atts[var->num_atts], &tvar->atts[j]);
+      if (!failed)
+        var->num_atts++;
+    }
+    col = find_xbd_sensor(data, tvar->name);
+    values = malloc((data->num_rows + 1) * sizeof(double));
+    if (!values) {
+      failed = 1;
+      break;
+    }
+    (*buffers)[file->num_vars - 1] = values;
+    memcpy(values, data->values + col * data->num_rows,
+           data->num_rows * sizeof(double));
+    /* Pack the values and replace invalid values like SAVENC does. */
+    offset = find_cdf_att(var->atts, var->num_atts, "add_offset");
+    scale = find_cdf_att(var->atts, var->num_atts, "scale_factor");
+    fill = find_cdf_att(var->atts, var->num_atts, "_FillValue");
+    for (i = 0; i < data->num_rows; i++) {
+      if (offset && offset->type != CDF_CHAR && offset->length > 0)
+        values[i] -= offset->values[0];
+      if (scale && scale->type != CDF_CHAR && scale->length > 0)
+        values[i] /= scale->values[0];
+      if (isnan(values[i]) && fill && fill->type != CDF_CHAR
+          && fill->length > 0)
+        values[i] = fill->values[0];
+    }
+    var->data = values;
+  }
+
+  for (i = 0; i < num_dyn_atts; i++)
+    free_cdf_att(&dyn_atts[i]);
+  free(dyn_atts);
+  free(names);
+  if (failed)
+    *message = "Out of memory";
+  return failed;
+}
+
+static void free_output_file(cdf_file_struct *file, double **buffers)
+{
+  size_t i;
+  if (buffers)
+    for (i = 0; i < file->num_vars; i++)
+      free(buffers[i]);
+  free(buffers);
+  free_cdf_file(file);
+}
+
+/*
+ * Create the parent directories of a file if needed.
+ */
+static int make_parent_dirs(const char *filename)
+{
+  char *path;
+  char *slash;
+  int status = 0;
+  path = copy_string(filename);
+  if (!path)
+    return 1;
+  for (slash = strchr(path + 1, '/'); slash && !status;
+       slash = strchr(slash + 1, '/')) {
+    *slash = '\0';
+    if (mkdir(path, 0777) != 0 && errno != EEXIST)
+      status = 1;
+    *slash = '/';
+  }
+  free(path);
+  return status;
+}
+
+
+/*
+ * Load the binary files, retrying the ones that failed in case that their
+ * sensor list is cached by a file loaded later (see LOADSLOCUMDATA), and
+ * split them in navigation ([smd]bd) and science ([tne]bd) data sets sorted
+ * by filename label. Files that can not be loaded are reported and skipped.
+ */
+static size_t load_files(xbd_data_struct *list, char **files, size_t n,
+                         const char *cache_dir, const xbd_filter_struct *filter)
+{
+  char *loaded;
+  size_t i, pass, num_loaded;
+  const char *message;
+  loaded = calloc(n + 1, 1);
+  if (!loaded)
+    return 0;
+  num_loaded = 0;
+  for (pass = 0; pass < 2 && num_loaded < n; pass++) {
+    for (i = 0; i < n; i++) {
+      if (loaded[i])
+        continue;
+      if (read_xbd_data(&list[i], files[i], cache_dir, filter, &message)) {
+        if (pass == 1)
+          fprintf(stderr, "Error loading binary file %s: %s.\n",
+                  files[i], message);
+        continue;
+      }
+      loaded[i] = 1;
+      num_loaded++;
+    }
+  }
+  for (i = 0, num_loaded = 0; i < n; i++)
+    if (loaded[i])
+      list[num_loaded++] = list[i];
+  free(loaded);
+  return num_loaded;
+}
+
+static int compare_data_labels(const void *a, const void *b)
+{
+  return strcmp(((const xbd_data_struct *) a)->labels[0],
+                ((const xbd_data_struct *) b)->labels[0]);
+}
+
+static int is_bay_extension(const char *ext, const char *bay)
+{
+  return strlen(ext) == 3 && strchr(bay, tolower((unsigned char) ext[0]))
+         && tolower((unsigned char) ext[1]) == 'b'
+         && tolower((unsigned char) ext[2]) == 'd';
+}
+
+static void split_files(xbd_data_struct *list, size_t n,
+                          xbd_data_struct *nav, size_t *num_nav,
+                          xbd_data_struct *sci, size_t *num_sci)
+{
+  size_t i;
+  *num_nav = 0;
+  *num_sci = 0;
+  for (i = 0; i < n; i++) {
+    if (is_bay_extension(list[i].extensions[0], "smd"))
+      nav[(*num_nav)++] = list[i];
+    else if (is_bay_extension(list[i].extensions[0], "tne"))
+      sci[(*num_sci)++] = list[i];
+    else {
+      fprintf(stderr, "Skipping binary file %s.%s: unknown bay.\n",
+              list[i].labels[0], list[i].extensions[0]);
+      free_xbd_data(&list[i]);
+    }
+  }
+  qsort(nav, *num_nav, sizeof(*nav), compare_data_labels);
+  qsort(sci, *num_sci, sizeof(*sci), compare_data_labels);
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *template_file = NULL;
+  const char *output_file = NULL;
+  const char *cache_dir = ".";
+  const char *sensors_file = NULL;
+  const char *deployment_file = NULL;
+  const char *deployment_id = NULL;
+  const char *message = NULL;
+  cdf_file_struct tmpl, output;
+  deployment_struct deployment;
+  xbd_data_struct nav, sci, data;
+  xbd_data_struct *list = NULL, *nav_list = NULL, *sci_list = NULL;
+  xbd_filter_struct filter;
+  const deployment_field_struct *field;
+  double period[2];
+  double *period_ptr = NULL;
+  double **buffers = NULL;
+  char **files;
+  char **sensors = NULL;
+  size_t num_files, num_loaded, num_nav, num_sci, num_sensors, i;
+  char *source_files = NULL;
+  size_t source_length;
+  int opt, status = 1;
+
+  while ((opt = getopt(argc, argv, "t:o:c:s:d:i:h")) != -1) {
+    switch (opt) {
+      case 't': template_file = optarg; break;
+      case 'o': output_file = optarg; break;
+      case 'c': cache_dir = optarg; break;
+      case 's': sensors_file = optarg; break;
+      case 'd': deployment_file = optarg; break;
+      case 'i': deployment_id = optarg; break;
+      case 'h':
+        fputs(usage, stdout);
+        return 0;
+      default:
+        fputs(usage, stderr);
+        return 2;
+    }
+  }
+  if (!template_file || !output_file || optind >= argc
+      || (deployment_id && !deployment_file)) {
+    fputs(usage, stderr);
+    return 2;
+  }
+  files = argv + optind;
+  num_files = argc - optind;
+
+  init_cdf_file(&tmpl);
+  init_cdf_file(&output);
+  init_xbd_data(&nav);
+  init_xbd_data(&sci);
+  init_xbd_data(&data);
+  deployment.num_fields = 0;
+  deployment.fields = NULL;
+  filter.num_sensors = 0;
+  filter.sensors = NULL;
+  num_sensors = 0;
+  num_nav = 0;
+  num_sci = 0;
+
+  if (read_cdf_template(&tmpl, template_file, &message)) {
+    fprintf(stderr, "Error reading template %s: %s.\n",
+            template_file, message);
+    goto cleanup;
+  }
+  if (deployment_file) {
+    if (read_deployment_file(&deployment, deployment_file,
+                             deployment_id, &message)) {
+      fprintf(stderr, "Error reading deployment file %s: %s.\n",
+              deployment_file, message);
+      goto cleanup;
+    }
+    /* Load the data from the deployment start to its end or until now. */
+    field = find_deployment_field(&deployment, "deployment_start");
+    period[0] = field ? (field->value - 719529.0) * 86400.0 : NAN;
+    field = find_deployment_field(&deployment, "deployment_end");
+    period[1] = (field && !isnan(field->value))
+              ? (field->value - 719529.0) * 86400.0 : (double) time(NULL);
+    if (!isnan(period[0]))
+      period_ptr = period;
+  }
+
+  /* Sensors to load, including the timestamps needed for merging. */
+  if (sensors_file) {
+    if (read_sensor_file(&sensors, &num_sensors, sensors_file)) {
+      fprintf(stderr, "Error reading sensor file %s.\n", sensors_file);
+      goto cleanup;
+    }
+  } else {
+    sensors = malloc((tmpl.num_vars + 1) * sizeof(char *));
+    for (i = 0; sensors && i < tmpl.num_vars; i++)
+      if (!(sensors[num_sensors++] = copy_string(tmpl.vars[i].name)))
+        break;
+  }
+  if (sensors) {
+    char **grown = realloc(sensors, (num_sensors + 2) * sizeof(char *));
+    if (grown) {
+      sensors = grown;
+      sensors[num_sensors] = copy_string(TIME_SENSOR_NAV);
+      sensors[num_sensors + 1] = copy_string(TIME_SENSOR_SCI);
+      if (sensors[num_sensors])
+        num_sensors++;
+      if (sensors[num_sensors])
+        num_sensors++;
+    }
+  }
+  if (!sensors || make_xbd_filter(&filter, sensors, num_sensors)) {
+    fprintf(stderr, "Error building sensor filter: Out of memory.\n");
+    goto cleanup;
+  }
+
+  /* Load and merge the data of both bays. */
+  list = calloc(num_files + 1, sizeof(*list));
+  nav_list = calloc(num_files + 1, sizeof(*list));
+  sci_list = calloc(num_files + 1, sizeof(*list));
+  if (!list || !nav_list || !sci_list) {
+    fprintf(stderr, "Error loading binary files: Out of memory.\n");
+    goto cleanup;
+  }
+  num_loaded = load_files(list, files, num_files, cache_dir, &filter);
+  split_files(list, num_loaded, nav_list, &num_nav, sci_list, &num_sci);
+  printf("Navigation files loaded: %lu.\n", (unsigned long) num_nav);
+  printf("Science files loaded: %lu.\n", (unsigned long) num_sci);
+  if (cat_xbd_data(&nav, nav_list, num_nav, TIME_SENSOR_NAV, &message)
+      || cat_xbd_data(&sci, sci_list, num_sci, TIME_SENSOR_SCI, &message)) {
+    fprintf(stderr, "Error combining binary files: %s.\n", message);
+    goto cleanup;
+  }
+  if (merge_xbd_data(&data, &nav, &sci, TIME_SENSOR_NAV, TIME_SENSOR_SCI,
+                     period_ptr, &filter, &message)) {
+    fprintf(stderr, "Error merging data: %s.\n", message);
+    goto cleanup;
+  }
+  if (data.num_sensors == 0) {
+    printf("No deployment data, NetCDF output will be skipped.\n");
+    status = 0;
+    goto cleanup;
+  }
+
+  /* Record the source files like the processing script does. */
+  source_length = 1;
+  for (i = 0; i < data.num_labels; i++)
+    source_length += strlen(data.labels[i]) + 1;
+  source_files = malloc(source_length);
+  if (!source_files) {
+    fprintf(stderr, "Error generating NetCDF output: Out of memory.\n");
+    goto cleanup;
+  }
+  source_files[0] = '\0';
+  for (i = 0; i < data.num_labels; i++) {
+    strcat(source_files, data.labels[i]);
+    strcat(source_files, "\n");
+  }
+  for (i = 0; i < tmpl.num_atts; i++) {
+    if (strcmp(tmpl.atts[i].name, "source_files") != 0
+        || find_deployment_field(&deployment, "source_files"))
+      continue;
+    free_cdf_att(&tmpl.atts[i]);
+    if (set_cdf_att_text(&tmpl.atts[i], "source_files", source_files)) {
+      fprintf(stderr, "Error generating NetCDF output: Out of memory.\n");
+      tmpl.num_atts = i;
+      goto cleanup;
+    }
+  }
+
+  /* Write the file. */
+  printf("Generating NetCDF L0 output...\n");
+  if (make_output_file(&output, &buffers, &tmpl, &data,
+                       deployment_file ? &deployment : NULL, &message)
+      || make_parent_dirs(output_file)
+      || write_cdf_file(&output, output_file, &message)) {
+    fprintf(stderr, "Error generating NetCDF L0 output %s: %s.\n",
+            output_file, message ? message : "Could not create directory");
+    goto cleanup;
+  }
+  printf("Output NetCDF L0 (raw data) generated: %s.\n", output_file);
+  status = 0;
+
+cleanup:
+  free_output_file(&output, buffers);
+  free(source_files);
+  free_xbd_data(&data);
+  free_xbd_data(&nav);
+  free_xbd_data(&sci);
+  for (i = 0; nav_list && i < num_nav; i++)
+    free_xbd_data(&nav_list[i]);
+  for (i = 0; sci_list && i < num_sci; i++)
+    free_xbd_data(&sci_list[i]);
+  free(list);
+  free(nav_list);
+  free(sci_list);
+  for (i = 0; i < num_sensors; i++)
+    free(sensors[i]);
+  free(sensors);
+  free_xbd_filter(&filter);
+  free_deployment(&deployment);
+  free_cdf_file(&tmpl);
+  return status;
+}
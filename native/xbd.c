@@ -0,0 +1,1005 @@
+/**
+ * @file
+ * @brief Native reader of Slocum binary data files.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file implements the functions declared in xbd.h.
+ *
+ * Each data cycle of a Slocum binary file starts with the tag 'd' followed by
+ * 2 bits for each sensor in use (most significant bits first) stating whether
+ * the sensor has not been updated (0), has been updated with the same value (1)
+ * or has a new value (2), and then the new values in sensor order, as 1, 2, 4
+ * or 8 byte integers or floats. The byte order is given by the known bytes
+ * cycle that precedes the data cycles. A description of the format may be
+ * found here:
+ *   <http://marine.rutgers.edu/~kerfoot/slocum/data/readme/wrc_doco/dbd_file_format.txt>
+ */
+
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "xbd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define XBD_HEADER_BYTES 4096
+#define XBD_NAME_LENGTH 256
+
+
+typedef struct xbd_header_struct {
+  long num_ascii_tags;
+  long sensors_per_cycle;
+  int factored;
+  char crc[XBD_NAME_LENGTH];
+  char label[XBD_NAME_LENGTH];
+  char extension[XBD_NAME_LENGTH];
+} xbd_header_struct;
+
+typedef struct xbd_sensor_struct {
+  long index;
+  size_t order;
+  int bytes;
+  char name[XBD_NAME_LENGTH];
+  char units[XBD_NAME_LENGTH];
+} xbd_sensor_struct;
+
+typedef struct xbd_stamp_struct {
+  double stamp;
+  size_t row;
+} xbd_stamp_struct;
+
+
+static char * copy_string(const char *str)
+{
+  char *copy;
+  copy = malloc(strlen(str) + 1);
+  if (copy)
+    strcpy(copy, str);
+  return copy;
+}
+
+static char * concat_string(const char *prefix, const char *str)
+{
+  char *cat;
+  cat = malloc(strlen(prefix) + strlen(str) + 1);
+  if (cat) {
+    strcpy(cat, prefix);
+    strcat(cat, str);
+  }
+  return cat;
+}
+
+static void free_string_list(char **list, size_t n)
+{
+  size_t i;
+  if (list)
+    for (i = 0; i < n; i++)
+      free(list[i]);
+  free(list);
+}
+
+static int compare_strings(const void *a, const void *b)
+{
+  return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+static int compare_sensors(const void *a, const void *b)
+{
+  const xbd_sensor_struct *x = a;
+  const xbd_sensor_struct *y = b;
+  if (x->index != y->index)
+    return (x->index < y->index) ? -1 : 1;
+  return (x->order < y->order) ? -1 : (x->order > y->order);
+}
+
+/*
+ * Sort timestamps like the MATLAB function UNIQUE does:
+ * invalid values go last and are all distinct.
+ */
+static int compare_stamps(const void *a, const void *b)
+{
+  const xbd_stamp_struct *x = a;
+  const xbd_stamp_struct *y = b;
+  int x_nan = isnan(x->stamp);
+  int y_nan = isnan(y->stamp);
+  if (x_nan != y_nan)
+    return x_nan ? 1 : -1;
+  if (!x_nan && x->stamp != y->stamp)
+    return (x->stamp < y->stamp) ? -1 : 1;
+  return (x->row < y->row) ? -1 : (x->row > y->row);
+}
+
+static size_t unique_stamps(xbd_stamp_struct *stamps, size_t n,
+                            double *unique, size_t *index)
+{
+  size_t i, m;
+  qsort(stamps, n, sizeof(*stamps), compare_stamps);
+  m = 0;
+  for (i = 0; i < n; i++) {
+    if (i == 0 || isnan(stamps[i].stamp)
+        || stamps[i].stamp != stamps[i-1].stamp)
+      unique[m++] = stamps[i].stamp;
+    index[stamps[i].row] = m - 1;
+  }
+  return m;
+}
+
+static int match_xbd_filter(const xbd_filter_struct *filter, const char *name)
+{
+  if (!filter)
+    return 1;
+  return bsearch(&name, filter->sensors, filter->num_sensors,
+                 sizeof(char *), compare_strings) != NULL;
+}
+
+static int host_big_endian(void)
+{
+  const unsigned short probe = 0x1234;
+  return *(const unsigned char *) &probe == 0x12;
+}
+
+static double decode_value(const unsigned char *src, int size, int swap)
+{
+  unsigned char buf[8];
+  signed char i8;
+  short i16;
+  float f32;
+  double f64;
+  int k;
+  for (k = 0; k < size; k++)
+    buf[k] = swap ? src[size - 1 - k] : src[k];
+  switch (size) {
+    case 1:
+      memcpy(&i8, buf, 1);
+      return (double) i8;
+    case 2:
+      memcpy(&i16, buf, 2);
+      return (double) i16;
+    case 4:
+      memcpy(&f32, buf, 4);
+      return (double) f32;
+    default:
+      memcpy(&f64, buf, 8);
+      return f64;
+  }
+}
+
+static int read_file_bytes(const char *filename,
+                           unsigned char **buf, size_t *len)
+{
+  FILE *f;
+  long size;
+  *buf = NULL;
+  *len = 0;
+  f = fopen(filename, "rb");
+  if (!f)
+    return 1;
+  if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0
+      || fseek(f, 0, SEEK_SET) != 0) {
+    fclose(f);
+    return 1;
+  }
+  *buf = malloc(size > 0 ? size : 1);
+  if (!*buf || fread(*buf, 1, size, f) != (size_t) size) {
+    free(*buf);
+    *buf = NULL;
+    fclose(f);
+    return 1;
+  }
+  fclose(f);
+  *len = size;
+  return 0;
+}
+
+
+/*
+ * Parse the ascii tags of the header like XBDHEADER does. The third tag is
+ * always the number of tags. The position after the last tag line is returned.
+ */
+static int parse_xbd_header(xbd_header_struct *header,
+                            const unsigned char *buf, size_t len, size_t *end,
+                            const char* *message)
+{
+  size_t pos, stop, line_end;
+  long num_tags, tag_idx;
+  char tag[XBD_NAME_LENGTH];
+  char value[XBD_NAME_LENGTH];
+  const unsigned char *nl;
+  size_t i, k;
+
+  memset(header, 0, sizeof(*header));
+  header->num_ascii_tags = -1;
+  header->sensors_per_cycle = -1;
+  stop = (len < XBD_HEADER_BYTES) ? len : XBD_HEADER_BYTES;
+  num_tags = 3;
+  pos = 0;
+  for (tag_idx = 0; tag_idx < num_tags; tag_idx++) {
+    nl = memchr(buf + pos, '\n', stop - pos);
+    if (!nl) {
+      *message = (tag_idx < 3) ? "Missing mandatory header tags"
+                               : "Incomplete header";
+      return 1;
+    }
+    line_end = nl - buf;
+    /* Tag name up to the colon, value is the first token after it. */
+    for (i = pos, k = 0; i < line_end && buf[i] != ':'
+                         && k < sizeof(tag) - 1; i++)
+      tag[k++] = buf[i];
+    tag[k] = '\0';
+    if (i < line_end && buf[i] == ':')
+      i++;
+    while (i < line_end && (buf[i] == ' ' || buf[i] == '\t'))
+      i++;
+    for (k = 0; i < line_end && buf[i] != ' ' && buf[i] != '\t'
+                && buf[i] != '\r' && k < sizeof(value) - 1; i++)
+      value[k++] = buf[i];
+    value[k] = '\0';
+    if (tag_idx == 2) {
+      if (strcmp(tag, "num_ascii_tags") != 0) {
+        *message = "Missing number of ascii tags";
+        return 1;
+      }
+      num_tags = strtol(value, NULL, 10);
+      header->num_ascii_tags = num_tags;
+    } else if (strcmp(tag, "sensors_per_cycle") == 0) {
+      header->sensors_per_cycle = strtol(value, NULL, 10);
+    } else if (strcmp(tag, "sensor_list_factored") == 0) {
+      header->factored = (strtol(value, NULL, 10) == 1);
+    } else if (strcmp(tag, "sensor_list_crc") == 0) {
+      for (k = 0; value[k]; k++)
+        header->crc[k] = (value[k] >= 'A' && value[k] <= 'Z')
+                       ? value[k] - 'A' + 'a' : value[k];
+      header->crc[k] = '\0';
+    } else if (strcmp(tag, "filename_label") == 0) {
+      strcpy(header->label, value);
+    } else if (strcmp(tag, "filename_extension") == 0) {
+      strcpy(header->extension, value);
+    }
+    pos = line_end + 1;
+  }
+  if (header->sensors_per_cycle < 0) {
+    *message = "Missing number of sensors per cycle";
+    return 1;
+  }
+  *end = pos;
+  return 0;
+}
+
+
+/*
+ * Parse the sensor list lines like CAC2MAT does, keeping only the sensors in
+ * use sorted by their position in the data cycle.
+ */
+static int parse_xbd_sensor_list(xbd_sensor_struct **sensors, size_t *n,
+                                 const unsigned char *buf, size_t len,
+                                 const char* *message)
+{
+  xbd_sensor_struct *list, *grown;
+  size_t capacity, count, order, pos, line_len;
+  const unsigned char *nl;
+  char line[4 * XBD_NAME_LENGTH];
+  char inuse[XBD_NAME_LENGTH];
+  long number, index;
+  int bytes, fields;
+  xbd_sensor_struct sensor;
+
+  list = NULL;
+  capacity = 0;
+  count = 0;
+  order = 0;
+  for (pos = 0; pos < len; pos += line_len + 1) {
+    nl = memchr(buf + pos, '\n', len - pos);
+    line_len = nl ? (size_t) (nl - (buf + pos)) : len - pos;
+    if (line_len >= sizeof(line)) {
+      free(list);
+      *message = "Invalid sensor list line";
+      return 1;
+    }
+    memcpy(line, buf + pos, line_len);
+    line[line_len] = '\0';
+    if (strspn(line, " \t\r") == line_len)
+      continue;
+    fields = sscanf(line, "s: %255s %ld %ld %d %255s %255s",
+                    inuse, &number, &index, &bytes,
+                    sensor.name, sensor.units);
+    if (fields != 6) {
+      free(list);
+      *message = "Invalid sensor list line";
+      return 1;
+    }
+    sensor.index = index;
+    sensor.bytes = bytes;
+    sensor.order = order++;
+    if (strcmp(inuse, "T") != 0 || index < 0)
+      continue;
+    if (bytes != 1 && bytes != 2 && bytes != 4 && bytes != 8) {
+      free(list);
+      *message = "Invalid sensor size in sensor list";
+      return 1;
+    }
+    if (count == capacity) {
+      capacity = capacity ? 2 * capacity : 256;
+      grown = realloc(list, capacity * sizeof(*list));
+      if (!grown) {
+        free(list);
+        *message = "Out of memory";
+        return 1;
+      }
+      list = grown;
+    }
+    list[count++] = sensor;
+  }
+  if (count > 0)
+    qsort(list, count, sizeof(*list), compare_sensors);
+  *sensors = list;
+  *n = count;
+  return 0;
+}
+
+
+void init_xbd_data(xbd_data_struct *data)
+{
+  memset(data, 0, sizeof(*data));
+}
+
+void free_xbd_data(xbd_data_struct *data)
+{
+  free_string_list(data->sensors, data->num_sensors);
+  free_string_list(data->units, data->num_sensors);
+  free(data->bytes);
+  free(data->values);
+  free_string_list(data->labels, data->num_labels);
+  free_string_list(data->extensions, data->num_labels);
+  init_xbd_data(data);
+}
+
+static int alloc_xbd_data(xbd_data_struct *data,
+                          size_t num_rows, size_t num_sensors,
+                          size_t num_labels)
+{
+  size_t i;
+  init_xbd_data(data);
+  data->num_rows = num_rows;
+  data->num_sensors = num_sensors;
+  data->num_labels = num_labels;
+  data->sensors = calloc(num_sensors + 1, sizeof(char *));
+  data->units = calloc(num_sensors + 1, sizeof(char *));
+  data->bytes = calloc(num_sensors + 1, sizeof(int));
+  data->values = malloc((num_rows * num_sensors + 1) * sizeof(double));
+  data->labels = calloc(num_labels + 1, sizeof(char *));
+  data->extensions = calloc(num_labels + 1, sizeof(char *));
+  if (!data->sensors || !data->units || !data->bytes || !data->values
+      || !data->labels || !data->extensions) {
+    free_xbd_data(data);
+    return 1;
+  }
+  for (i = 0; i < num_rows * num_sensors; i++)
+    data->values[i] = NAN;
+  return 0;
+}
+
+static int copy_xbd_labels(xbd_data_struct *data, size_t offset,
+                           const xbd_data_struct *source)
+{
+  size_t i;
+  for (i = 0; i < source->num_labels; i++) {
+    data->labels[offset + i] = copy_string(source->labels[i]);
+    data->extensions[offset + i] = copy_string(source->extensions[i]);
+    if (!data->labels[offset + i] || !data->extensions[offset + i])
+      return 1;
+  }
+  return 0;
+}
+
+long find_xbd_sensor(const xbd_data_struct *data, const char *sensor)
+{
+  size_t i;
+  for (i = 0; i < data->num_sensors; i++)
+    if (strcmp(data->sensors[i], sensor) == 0)
+      return (long) i;
+  return -1;
+}
+
+
+int make_xbd_filter(xbd_filter_struct *filter, char **sensors, size_t n)
+{
+  size_t i, m;
+  filter->num_sensors = 0;
+  filter->sensors = malloc((n + 1) * sizeof(char *));
+  if (!filter->sensors)
+    return 1;
+  for (i = 0; i < n; i++) {
+    filter->sensors[i] = copy_string(sensors[i]);
+    if (!filter->sensors[i]) {
+      free_string_list(filter->sensors, i);
+      filter->sensors = NULL;
+      return 1;
+    }
+  }
+  qsort(filter->sensors, n, sizeof(char *), compare_strings);
+  for (i = 0, m = 0; i < n; i++)
+    if (m == 0 || strcmp(filter->sensors[i], filter->sensors[m-1]) != 0)
+      filter->sensors[m++] = filter->sensors[i];
+    else
+      free(filter->sensors[i]);
+  filter->num_sensors = m;
+  return 0;
+}
+
+void free_xbd_filter(xbd_filter_struct *filter)
+{
+  free_string_list(filter->sensors, filter->num_sensors);
+  filter->sensors = NULL;
+  filter->num_sensors = 0;
+}
+
+
+int read_xbd_data(xbd_data_struct *data, const char *filename,
+                  const char *cache_dir, const xbd_filter_struct *filter,
+                  const char* *message)
+{
+  unsigned char *buf = NULL;
+  unsigned char *cache_buf = NULL;
+  char *cache_file = NULL;
+  char *cache_temp;
+  int cache_ok;
+  size_t len, cache_len, pos, list_end;
+  xbd_header_struct header;
+  xbd_sensor_struct *list = NULL;
+  size_t num_sensors, num_selected, state_length;
+  size_t *selected = NULL;
+  double *last = NULL;
+  double *rows = NULL;
+  double *grown;
+  size_t capacity, num_cycles, i, j, k, cycle_length, value_pos, state_end;
+  int swap, state;
+  const unsigned char *nl;
+  struct stat cache_stat;
+  FILE *f;
+  int status = 1;
+
+  init_xbd_data(data);
+  if (read_file_bytes(filename, &buf, &len)) {
+    *message = "Could not read file";
+    return 1;
+  }
+  if (parse_xbd_header(&header, buf, len, &pos, message))
+    goto cleanup;
+
+  /* Get the sensor list, from the file itself or from the cache. */
+  if (header.factored) {
+    if (!cache_dir || !header.crc[0]) {
+      *message = "Factored sensor list with no cache directory";
+      goto cleanup;
+    }
+    cache_file = malloc(strlen(cache_dir) + strlen(header.crc) + 6);
+    if (!cache_file) {
+      *message = "Out of memory";
+      goto cleanup;
+    }
+    sprintf(cache_file, "%s/%s.cac", cache_dir, header.crc);
+    if (read_file_bytes(cache_file, &cache_buf, &cache_len)) {
+      *message = "Could not read sensor list cache file";
+      goto cleanup;
+    }
+    if (parse_xbd_sensor_list(&list, &num_sensors,
+                              cache_buf, cache_len, message))
+      goto cleanup;
+  } else {
+    /* The sensor list is made of the consecutive lines starting with 's:'
+     * after the ascii tags (the known bytes cycle starts with 'sa'). */
+    list_end = pos;
+    while (list_end + 1 < len && buf[list_end] == 's'
+           && buf[list_end + 1] == ':'
+           && (nl = memchr(buf + list_end, '\n', len - list_end)))
+      list_end = (nl - buf) + 1;
+    if (list_end == pos) {
+      *message = "Missing sensor list";
+      goto cleanup;
+    }
+    if (parse_xbd_sensor_list(&list, &num_sensors,
+                              buf + pos, list_end - pos, message))
+      goto cleanup;
+    /* Write the cache file of the sensor list if not available yet.
+     * It is written to a temporary file in the same directory and renamed,
+     * so that concurrent readers never see a partial cache file. */
+    if (cache_dir && header.crc[0]) {
+      cache_file = malloc(2 * (strlen(cache_dir) + strlen(header.crc)) + 40);
+      if (cache_file) {
+        cache_temp = cache_file + strlen(cache_dir) + strlen(header.crc) + 6;
+        sprintf(cache_file, "%s/%s.cac", cache_dir, header.crc);
+        sprintf(cache_temp, "%s/.%s.cac.%ld",
+                cache_dir, header.crc, (long) getpid());
+        if (stat(cache_file, &cache_stat) != 0) {
+          f = fopen(cache_temp, "wb");
+          cache_ok =
+            f && fwrite(buf + pos, 1, list_end - pos, f) == list_end - pos;
+          if (f && fclose(f) != 0)
+            cache_ok = 0;
+          if (cache_ok && rename(cache_temp, cache_file) != 0)
+            cache_ok = 0;
+          if (!cache_ok) {
+            if (f)
+              remove(cache_temp);
+            fprintf(stderr, "Warning: could not write cache file %s.\n",
+                    cache_file);
+          }
+        }
+      }
+    }
+    pos = list_end;
+  }
+  if ((long) num_sensors != header.sensors_per_cycle) {
+    *message = "Sensor list mismatch";
+    goto cleanup;
+  }
+
+  /* Select the sensors of interest. */
+  selected = malloc((num_sensors + 1) * sizeof(size_t));
+  last = malloc((num_sensors + 1) * sizeof(double));
+  if (!selected || !last) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  num_selected = 0;
+  for (i = 0; i < num_sensors; i++) {
+    last[i] = NAN;
+    if (match_xbd_filter(filter, list[i].name))
+      selected[num_selected++] = i;
+  }
+
+  /* Check the known bytes cycle to get the byte order of the file.
+   * It is the tag 's', the tag 'a', the integer 0x1234, the float 123.456
+   * and the double 123456789.12345. */
+  if (len < pos + 16 || buf[pos] != 's' || buf[pos + 1] != 'a') {
+    *message = "Missing known bytes cycle";
+    goto cleanup;
+  }
+  if (buf[pos + 2] == 0x12 && buf[pos + 3] == 0x34) {
+    swap = !host_big_endian();
+  } else if (buf[pos + 2] == 0x34 && buf[pos + 3] == 0x12) {
+    swap = host_big_endian();
+  } else {
+    *message = "Unknown byte order";
+    goto cleanup;
+  }
+  pos += 16;
+
+  /* Decode the cycles. Sensors updated with the same value repeat their
+   * previous new value in the file, and sensors not updated are invalid. */
+  state_length = (num_sensors + 3) / 4;
+  capacity = 0;
+  num_cycles = 0;
+  while (pos < len && buf[pos] == 'd') {
+    state_end = pos + state_length;
+    if (state_end >= len)
+      break;
+    cycle_length = 0;
+    for (i = 0; i < num_sensors; i++) {
+      state = (buf[pos + 1 + i / 4] >> (6 - 2 * (i % 4))) & 3;
+      if (state == 2)
+        cycle_length += list[i].bytes;
+    }
+    if (state_end + cycle_length >= len)
+      break;
+    if (num_cycles == capacity) {
+      capacity = capacity ? 2 * capacity : 1024;
+      grown = realloc(rows, (capacity * num_selected + 1) * sizeof(double));
+      if (!grown) {
+        *message = "Out of memory";
+        goto cleanup;
+      }
+      rows = grown;
+    }
+    value_pos = state_end + 1;
+    for (i = 0, k = 0; i < num_sensors; i++) {
+      state = (buf[pos + 1 + i / 4] >> (6 - 2 * (i % 4))) & 3;
+      if (state == 2) {
+        last[i] = decode_value(buf + value_pos, list[i].bytes, swap);
+        value_pos += list[i].bytes;
+      }
+      if (k < num_selected && selected[k] == i) {
+        rows[num_cycles * num_selected + k] =
+          (state == 1 || state == 2) ? last[i] : NAN;
+        k++;
+      }
+    }
+    num_cycles++;
+    pos = state_end + cycle_length + 1;
+  }
+  if (pos < len && buf[pos] != 'X')
+    fprintf(stderr, "Warning: unexpected cycle tag or truncated cycle "
+                    "at byte %lu of %s.\n", (unsigned long) pos + 1, filename);
+
+  /* Build the data set. */
+  if (alloc_xbd_data(data, num_cycles, num_selected, 1)) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  for (j = 0; j < num_selected; j++) {
+    data->sensors[j] = copy_string(list[selected[j]].name);
+    data->units[j] = copy_string(list[selected[j]].units);
+    data->bytes[j] = list[selected[j]].bytes;
+    if (!data->sensors[j] || !data->units[j]) {
+      *message = "Out of memory";
+      goto cleanup;
+    }
+    for (i = 0; i < num_cycles; i++)
+      data->values[j * num_cycles + i] = rows[i * num_selected + j];
+  }
+  data->labels[0] = copy_string(header.label);
+  data->extensions[0] = copy_string(header.extension);
+  if (!data->labels[0] || !data->extensions[0]) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  status = 0;
+
+cleanup:
+  if (status)
+    free_xbd_data(data);
+  free(rows);
+  free(last);
+  free(selected);
+  free(list);
+  free(cache_file);
+  free(cache_buf);
+  free(buf);
+  return status;
+}
+
+
+int cat_xbd_data(xbd_data_struct *data, const xbd_data_struct *list, size_t n,
+                 const char *time_sensor, const char* *message)
+{
+  size_t num_names, num_rows, num_labels, num_sensors, num_stamps;
+  size_t f, i, j, k, offset;
+  char **names = NULL;
+  size_t *row_index = NULL;
+  double *stamps = NULL;
+  xbd_stamp_struct *stamp_list = NULL;
+  long time_col, col;
+  double old_value, new_value;
+  double *dst;
+  int status = 1;
+
+  init_xbd_data(data);
+  num_names = 0;
+  num_rows = 0;
+  num_labels = 0;
+  for (f = 0; f < n; f++) {
+    num_names += list[f].num_sensors;
+    num_rows += list[f].num_rows;
+    num_labels += list[f].num_labels;
+  }
+
+  /* Build the sorted list of sensors of all the data sets. */
+  names = malloc((num_names + 1) * sizeof(char *));
+  if (!names) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  for (f = 0, k = 0; f < n; f++)
+    for (j = 0; j < list[f].num_sensors; j++)
+      names[k++] = list[f].sensors[j];
+  qsort(names, num_names, sizeof(char *), compare_strings);
+  for (k = 0, num_sensors = 0; k < num_names; k++)
+    if (num_sensors == 0 || strcmp(names[k], names[num_sensors-1]) != 0)
+      names[num_sensors++] = names[k];
+
+  /* Build the sorted list of timestamps of all the data sets. */
+  stamp_list = malloc((num_rows + 1) * sizeof(*stamp_list));
+  stamps = malloc((num_rows + 1) * sizeof(double));
+  row_index = malloc((num_rows + 1) * sizeof(size_t));
+  if (!stamp_list || !stamps || !row_index) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  for (f = 0, offset = 0; f < n; f++) {
+    time_col = find_xbd_sensor(&list[f], time_sensor);
+    if (time_col < 0 && list[f].num_rows > 0) {
+      *message = "Missing timestamp sensor";
+      goto cleanup;
+    }
+    for (i = 0; i < list[f].num_rows; i++) {
+      stamp_list[offset + i].stamp =
+        list[f].values[time_col * list[f].num_rows + i];
+      stamp_list[offset + i].row = offset + i;
+    }
+    offset += list[f].num_rows;
+  }
+  num_stamps = unique_stamps(stamp_list, num_rows, stamps, row_index);
+
+  /* Fill the output checking for consistency of overlapped data. */
+  if (alloc_xbd_data(data, num_stamps, num_sensors, num_labels)) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  for (j = 0; j < num_sensors; j++) {
+    data->sensors[j] = copy_string(names[j]);
+    if (!data->sensors[j]) {
+      *message = "Out of memory";
+      goto cleanup;
+    }
+  }
+  for (f = 0, offset = 0, k = 0; f < n; f++) {
+    for (j = 0; j < list[f].num_sensors; j++) {
+      col = find_xbd_sensor(data, list[f].sensors[j]);
+      free(data->units[col]);
+      data->units[col] = copy_string(list[f].units[j]);
+      if (!data->units[col]) {
+        *message = "Out of memory";
+        goto cleanup;
+      }
+      data->bytes[col] = list[f].bytes[j];
+      dst = data->values + col * num_stamps;
+      for (i = 0; i < list[f].num_rows; i++) {
+        new_value = list[f].values[j * list[f].num_rows + i];
+        old_value = dst[row_index[offset + i]];
+        if (isnan(new_value))
+          continue;
+        if (!isnan(old_value) && old_value != new_value) {
+          *message = "Inconsistent data";
+          goto cleanup;
+        }
+        dst[row_index[offset + i]] = new_value;
+      }
+    }
+    if (copy_xbd_labels(data, k, &list[f])) {
+      *message = "Out of memory";
+      goto cleanup;
+    }
+    offset += list[f].num_rows;
+    k += list[f].num_labels;
+  }
+  status = 0;
+
+cleanup:
+  if (status)
+    free_xbd_data(data);
+  free(row_index);
+  free(stamps);
+  free(stamp_list);
+  free(names);
+  return status;
+}
+
+
+static int copy_xbd_data(xbd_data_struct *data, const xbd_data_struct *source)
+{
+  size_t j;
+  if (alloc_xbd_data(data, source->num_rows, source->num_sensors,
+                     source->num_labels))
+    return 1;
+  for (j = 0; j < source->num_sensors; j++) {
+    data->sensors[j] = copy_string(source->sensors[j]);
+    data->units[j] = copy_string(source->units[j]);
+    data->bytes[j] = source->bytes[j];
+    if (!data->sensors[j] || !data->units[j]) {
+      free_xbd_data(data);
+      return 1;
+    }
+  }
+  memcpy(data->values, source->values,
+         source->num_rows * source->num_sensors * sizeof(double));
+  if (copy_xbd_labels(data, 0, source)) {
+    free_xbd_data(data);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Keep the rows within the period (and invalid timestamps, as the
+ * comparisons of DBAMERGE do) and the sensors in the filter, in place.
+ */
+static void filter_xbd_data(xbd_data_struct *data, long time_col,
+                            const double *period,
+                            const xbd_filter_struct *filter)
+{
+  size_t i, j, m, num_rows, num_sensors;
+  double t;
+  unsigned char *keep;
+  num_rows = data->num_rows;
+  if (period && time_col >= 0) {
+    keep = malloc(num_rows + 1);
+    if (keep) {
+      for (i = 0, m = 0; i < num_rows; i++) {
+        t = data->values[time_col * num_rows + i];
+        keep[i] = !(t < period[0] || t > period[1]);
+        m += keep[i];
+      }
+      for (j = 0; j < data->num_sensors; j++)
+        for (i = 0, m = 0; i < num_rows; i++)
+          if (keep[i])
+            data->values[j * num_rows + m++] =
+              data->values[j * num_rows + i];
+      /* Columns are compacted one after the other. */
+      for (j = 0; j < data->num_sensors; j++)
+        memmove(data->values + j * m, data->values + j * num_rows,
+                m * sizeof(double));
+      data->num_rows = m;
+      free(keep);
+    }
+  }
+  num_rows = data->num_rows;
+  if (filter) {
+    for (j = 0, num_sensors = 0; j < data->num_sensors; j++) {
+      if (match_xbd_filter(filter, data->sensors[j])) {
+        data->sensors[num_sensors] = data->sensors[j];
+        data->units[num_sensors] = data->units[j];
+        data->bytes[num_sensors] = data->bytes[j];
+        memmove(data->values + num_sensors * num_rows,
+                data->values + j * num_rows, num_rows * sizeof(double));
+        num_sensors++;
+      } else {
+        free(data->sensors[j]);
+        free(data->units[j]);
+      }
+    }
+    data->num_sensors = num_sensors;
+  }
+}
+
+int merge_xbd_data(xbd_data_struct *data,
+                   const xbd_data_struct *nav, const xbd_data_struct *sci,
+                   const char *time_sensor_nav, const char *time_sensor_sci,
+                   const double *period, const xbd_filter_struct *filter,
+                   const char* *message)
+{
+  size_t num_stamps, num_rows, i, j, col, row;
+  xbd_stamp_struct *stamp_list = NULL;
+  double *stamps = NULL;
+  size_t *row_index = NULL;
+  long time_col_nav, time_col_sci, dup;
+  double *time_nav;
+  char *renamed;
+  int status = 1;
+
+  init_xbd_data(data);
+
+  /* Trivial cases: no data at all, or data from only one bay. */
+  if (nav->num_labels == 0 && sci->num_labels == 0)
+    return 0;
+  if (sci->num_labels == 0 || nav->num_labels == 0) {
+    if (copy_xbd_data(data, (sci->num_labels == 0) ? nav : sci)) {
+      *message = "Out of memory";
+      return 1;
+    }
+    time_col_nav = find_xbd_sensor(data, (sci->num_labels == 0)
+                                         ? time_sensor_nav : time_sensor_sci);
+    if (period && time_col_nav < 0) {
+      free_xbd_data(data);
+      *message = "Missing timestamp sensor in merged data set";
+      return 1;
+    }
+    filter_xbd_data(data, time_col_nav, period, filter);
+    return 0;
+  }
+
+  /* Merge the sensors renaming the ones present in both data sets,
+   * to mimic the behaviour of the WRC program 'dba_merge'. */
+  num_rows = nav->num_rows + sci->num_rows;
+  stamp_list = malloc((num_rows + 1) * sizeof(*stamp_list));
+  stamps = malloc((num_rows + 1) * sizeof(double));
+  row_index = malloc((num_rows + 1) * sizeof(size_t));
+  if (!stamp_list || !stamps || !row_index) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  if (alloc_xbd_data(data, num_rows, nav->num_sensors + sci->num_sensors,
+                     nav->num_labels + sci->num_labels)) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+  for (j = 0; j < nav->num_sensors + sci->num_sensors; j++) {
+    if (j < nav->num_sensors) {
+      dup = find_xbd_sensor(sci, nav->sensors[j]);
+      renamed = (dup >= 0 && strncmp(nav->sensors[j], "sci_", 4) == 0)
+              ? concat_string("gld_dup_", nav->sensors[j])
+              : copy_string(nav->sensors[j]);
+      data->units[j] = copy_string(nav->units[j]);
+      data->bytes[j] = nav->bytes[j];
+    } else {
+      col = j - nav->num_sensors;
+      dup = find_xbd_sensor(nav, sci->sensors[col]);
+      renamed = (dup >= 0 && strncmp(sci->sensors[col], "sci_", 4) != 0)
+              ? concat_string("sci_dup_", sci->sensors[col])
+              : copy_string(sci->sensors[col]);
+      data->units[j] = copy_string(sci->units[col]);
+      data->bytes[j] = sci->bytes[col];
+    }
+    data->sensors[j] = renamed;
+    if (!data->sensors[j] || !data->units[j]) {
+      *message = "Out of memory";
+      goto cleanup;
+    }
+  }
+  if (copy_xbd_labels(data, 0, nav)
+      || copy_xbd_labels(data, nav->num_labels, sci)) {
+    *message = "Out of memory";
+    goto cleanup;
+  }
+
+  /* Check that both data sets have their own timestamp sensor. */
+  time_col_nav = -1;
+  time_col_sci = -1;
+  for (j = 0; j < nav->num_sensors; j++)
+    if (strcmp(data->sensors[j], time_sensor_nav) == 0)
+      time_col_nav = j;
+  for (j = 0; j < sci->num_sensors; j++)
+    if (strcmp(data->sensors[nav->num_sensors + j], time_sensor_sci) == 0)
+      time_col_sci = j;
+  if (time_col_nav < 0) {
+    *message = "Missing timestamp sensor in navigation data set";
+    goto cleanup;
+  }
+  if (time_col_sci < 0) {
+    *message = "Missing timestamp sensor in science data set";
+    goto cleanup;
+  }
+
+  /* Interleave the sensor cycles of both data sets by timestamp,
+   * merging the cycles with the same timestamp. */
+  for (i = 0; i < nav->num_rows; i++) {
+    stamp_list[i].stamp = nav->values[time_col_nav * nav->num_rows + i];
+    stamp_list[i].row = i;
+  }
+  for (i = 0; i < sci->num_rows; i++) {
+    stamp_list[nav->num_rows + i].stamp =
+      sci->values[time_col_sci * sci->num_rows + i];
+    stamp_list[nav->num_rows + i].row = nav->num_rows + i;
+  }
+  num_stamps = unique_stamps(stamp_list, num_rows, stamps, row_index);
+  data->num_rows = num_stamps;
+  for (j = 0; j < data->num_sensors * num_stamps; j++)
+    data->values[j] = NAN;
+  for (j = 0; j < nav->num_sensors; j++)
+    for (i = 0; i < nav->num_rows; i++)
+      data->values[j * num_stamps + row_index[i]] =
+        nav->values[j * nav->num_rows + i];
+  for (j = 0; j < sci->num_sensors; j++)
+    for (i = 0; i < sci->num_rows; i++)
+      data->values[(nav->num_sensors + j) * num_stamps
+                   + row_index[nav->num_rows + i]] =
+        sci->values[j * sci->num_rows + i];
+
+  /* Fill missing navigation timestamps with science timestamps. */
+  time_nav = data->values + time_col_nav * num_stamps;
+  for (row = 0; row < num_stamps; row++)
+    if (isnan(time_nav[row]))
+      time_nav[row] =
+        data->values[(nav->num_sensors + time_col_sci) * num_stamps + row];
+
+  filter_xbd_data(data, time_col_nav, period, filter);
+  status = 0;
+
+cleanup:
+  if (status)
+    free_xbd_data(data);
+  free(row_index);
+  free(stamps);
+  free(stamp_list);
+  return status;
+}
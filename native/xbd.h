@@ -0,0 +1,91 @@
+/**
+ * @file
+ * @brief Native reader of Slocum binary data files.
+ * @author Joan Pau Beltran  <joanpau.beltran@socib.cat>
+ *
+ *  Copyright (C) 2016
+ *  ICTS SOCIB - Servei d'observacio i prediccio costaner de les Illes Balears.
+ *  <http://www.socib.es>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * This file declares the functions to load Slocum binary data files
+ * (xxx.[smdtne]bd files) without a MATLAB runtime. They are ports of the
+ * toolbox functions with the same purpose, and produce the same data:
+ *   - read_xbd_data decodes a binary file like XBD2MAT, reading the sensor
+ *     list from the file or from the cache directory (see CAC2MAT).
+ *   - cat_xbd_data combines the data of files from the same bay like DBACAT.
+ *   - merge_xbd_data merges navigation and science data like DBAMERGE.
+ * Data sets hold the sensor readings in a column major array, with a column
+ * for each sensor and a row for each sensor cycle, and invalid values as NaN.
+ *
+ * The functions return zero on success. On failure they return nonzero and
+ * set the message argument to a static string describing the error.
+ */
+
+#ifndef XBD_H
+#define XBD_H
+
+#include <stddef.h>
+
+
+/**
+ * Data set with the sensor readings of one or more binary files.
+ */
+typedef struct xbd_data_struct {
+  size_t num_rows;      /**< Number of sensor cycles. */
+  size_t num_sensors;   /**< Number of sensors. */
+  char **sensors;       /**< Sensor names. */
+  char **units;         /**< Sensor units. */
+  int *bytes;           /**< Sensor sizes in the binary cycles. */
+  double *values;       /**< Readings, num_rows x num_sensors column major. */
+  size_t num_labels;    /**< Number of source files. */
+  char **labels;        /**< Filename label tags of the source files. */
+  char **extensions;    /**< Filename extension tags of the source files. */
+} xbd_data_struct;
+
+
+/**
+ * Sorted list of sensor names to filter the data sets (NULL for all sensors).
+ */
+typedef struct xbd_filter_struct {
+  size_t num_sensors;
+  char **sensors;
+} xbd_filter_struct;
+
+
+void init_xbd_data(xbd_data_struct *data);
+
+void free_xbd_data(xbd_data_struct *data);
+
+int make_xbd_filter(xbd_filter_struct *filter, char **sensors, size_t n);
+
+void free_xbd_filter(xbd_filter_struct *filter);
+
+int read_xbd_data(xbd_data_struct *data, const char *filename,
+                  const char *cache_dir, const xbd_filter_struct *filter,
+                  const char* *message);
+
+int cat_xbd_data(xbd_data_struct *data, const xbd_data_struct *list, size_t n,
+                 const char *time_sensor, const char* *message);
+
+int merge_xbd_data(xbd_data_struct *data,
+                   const xbd_data_struct *nav, const xbd_data_struct *sci,
+                   const char *time_sensor_nav, const char *time_sensor_sci,
+                   const double *period, const xbd_filter_struct *filter,
+                   const char* *message);
+
+long find_xbd_sensor(const xbd_data_struct *data, const char *sensor);
+
+#endif /* XBD_H */